@@ -0,0 +1,162 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** Function call microbenchmark.
+
+    Calls a small function with a typical compiler generated prologue and
+    epilogue in a loop. The function body tests a bit field and builds
+    a 32-bit constant so the common integer idioms are covered as well.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+#include "cpu/ppc/ppcemu.h"
+#include "cpu/ppc/ppcmmu.h"
+#include "devices/memctrl/mpc106.h"
+#include <thirdparty/loguru/loguru.hpp>
+
+#if defined(PPC_BENCHMARKS)
+void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
+    power_off(po_benchmark_exception);
+}
+#endif
+
+constexpr uint32_t num_calls = 100000;
+
+uint32_t call_code[] = {
+    0x38600000, // 00: li      r3,0
+    0x3C800000 | (num_calls >> 16),     // 04: lis r4,num_calls@h
+    0x60840000 | (num_calls & 0xFFFF),  // 08: ori r4,r4,num_calls@l
+    0x7C8903A6, // 0C: mtctr   r4
+    0x48000011, // 10: bl      0x20
+    0x4200FFFC, // 14: bdnz    0x10
+    0x00000000, // 18: illegal, stops ppc_exec
+    0x60000000, // 1C: nop
+    0x7C0802A6, // 20: mflr    r0
+    0x93E1FFFC, // 24: stw     r31,-4(r1)
+    0x90010008, // 28: stw     r0,8(r1)
+    0x9421FFC0, // 2C: stwu    r1,-64(r1)
+    0x7C7F1B78, // 30: mr      r31,r3
+    0x57E5073E, // 34: rlwinm  r5,r31,0,28,31
+    0x28050000, // 38: cmplwi  r5,0
+    0x40820010, // 3C: bne     0x4C
+    0x3CC01234, // 40: lis     r6,0x1234
+    0x60C65678, // 44: ori     r6,r6,0x5678
+    0x7FFF3214, // 48: add     r31,r31,r6
+    0x387F0001, // 4C: addi    r3,r31,1
+    0x80010048, // 50: lwz     r0,72(r1)
+    0x38210040, // 54: addi    r1,r1,64
+    0x7C0803A6, // 58: mtlr    r0
+    0x83E1FFFC, // 5C: lwz     r31,-4(r1)
+    0x4E800020, // 60: blr
+};
+
+constexpr uint32_t stop_addr = 0x18;
+constexpr uint32_t stack_top = 0x8000;
+constexpr uint32_t test_samples = 50;
+constexpr uint32_t test_iterations = 5;
+
+static void prepare_run() {
+    ppc_state.pc = 0;
+    ppc_state.gpr[1] = stack_top;
+    ppc_state.gpr[3] = 0;
+    power_on = true;
+}
+
+int main(int argc, char** argv) {
+    int i, j;
+
+    /* initialize logging */
+    loguru::g_preamble_date    = false;
+    loguru::g_preamble_time    = false;
+    loguru::g_preamble_thread  = false;
+
+    loguru::g_stderr_verbosity = 0;
+    loguru::init(argc, argv);
+
+    MPC106* grackle_obj = new MPC106("GrackleGossamer");
+
+    /* we need some RAM */
+    if (!grackle_obj->add_ram_region(0, stack_top + 0x1000)) {
+        LOG_F(ERROR, "Could not create RAM region");
+        delete(grackle_obj);
+        return -1;
+    }
+
+    constexpr uint64_t bus_freq = 66'820'000ULL;
+    constexpr uint64_t tbr_freq = bus_freq / 4;
+    constexpr uint64_t core_freq = bus_freq * 7 / 2; // 233.87 MHz (CPU PLL ratio of 3.5)
+
+    ppc_cpu_init(grackle_obj, {
+        .version = PPC_VER::MPC750,
+        .timebase_freq_hz = tbr_freq,
+        .bus_freq_hz = bus_freq,
+        .core_freq_hz = core_freq,
+    });
+
+    /* load executable code into RAM at address 0 */
+    for (i = 0; i < sizeof(call_code) / sizeof(call_code[0]); i++) {
+        mmu_write_vmem<uint32_t>(0, i * 4, call_code[i]);
+    }
+
+    prepare_run();
+    ppc_exec_until(stop_addr);
+
+    LOG_F(INFO, "Result: 0x%08X", ppc_state.gpr[3]);
+    uint32_t result = ppc_state.gpr[3];
+
+    // run the clock once for cache fill etc.
+    uint64_t overhead = -1;
+    for (j = 0; j < test_samples; j++) {
+        auto start_time   = std::chrono::steady_clock::now();
+        auto end_time     = std::chrono::steady_clock::now();
+        auto time_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+        if (time_elapsed.count() < overhead)
+            overhead = time_elapsed.count();
+    }
+    LOG_F(INFO, "Overhead Time: %lld ns", overhead);
+
+    for (int theproc = 0; theproc < 2; theproc++) {
+        LOG_F(INFO, "Doing %s", theproc ? "ppc_exec_until" : "ppc_exec");
+        for (i = 0; i < test_iterations; i++) {
+            uint64_t best_sample = -1;
+            for (j = 0; j < test_samples; j++) {
+                prepare_run();
+
+                auto start_time   = std::chrono::steady_clock::now();
+                    (theproc) ? ppc_exec_until(stop_addr) : ppc_exec();
+                auto end_time     = std::chrono::steady_clock::now();
+                auto time_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+                if (time_elapsed.count() < best_sample)
+                    best_sample = time_elapsed.count();
+            }
+            if (ppc_state.gpr[3] != result)
+                LOG_F(INFO, "Result: 0x%08X", ppc_state.gpr[3]);
+            best_sample -= overhead;
+            LOG_F(INFO, "(%d) %lld ns, %.2lf ns/call, %.3lf Mcalls/s", i+1, best_sample,
+                  double(best_sample) / num_calls, 1E3 * num_calls / best_sample);
+        }
+    }
+
+    delete(grackle_obj);
+
+    return 0;
+}
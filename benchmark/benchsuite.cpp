@@ -0,0 +1,582 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** Benchmark suite runner.
+
+    Every workload runs in a child process (the emulator state is global),
+    several children run in parallel. The parent collects one result line
+    from each child and prints a JSON or CSV report with instructions per
+    second, guest seconds per host second and peak memory per instance.
+
+    Workloads:
+    - int:  checksum kernel of bench1
+    - call: function call kernel of bench2
+    - fp:   multiply-add/divide loop
+    - mmu:  data accesses to more pages than the TLB holds, translated
+            through a hashed page table
+    - boot: boots a machine created by MachineFactory for a fixed amount of
+            guest time. Disk images and other machine settings given after
+            "--" are passed to every boot job, so this also covers disk
+            and DBDMA streaming when the guest boots from a disk.
+ */
+
+#include <core/timermanager.h>
+#include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
+#include <devices/common/hwcomponent.h>
+#include <devices/memctrl/mpc106.h>
+#include <devices/video/display_headless.h>
+#include <machines/machinefactory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CLI11.hpp>
+#include <loguru.hpp>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <sys/resource.h>
+#endif
+
+static const char* all_kernels[] = {"int", "call", "fp", "mmu"};
+
+typedef struct BenchResult {
+    std::string workload;
+    std::string machine;
+    bool        ok           = false;
+    uint64_t    runs         = 0;
+    uint64_t    instructions = 0;
+    bool        instr_exact  = false; // false: derived from guest time
+    uint64_t    host_ns      = 0;
+    uint64_t    guest_ns     = 0;
+    uint64_t    max_rss_kb   = 0;
+} BenchResult;
+
+/* ----------------------------- child side ------------------------------ */
+
+// bench1 checksum kernel, r3 = buffer, r4 = length, stops at 0xC4
+static const uint32_t cs_code[] = {
+    0x3863FFFC, 0x7C861671, 0x41820090, 0x70600002, 0x41E2001C, 0xA0030004,
+    0x3884FFFE, 0x38630002, 0x5486F0BF, 0x7CA50114, 0x41820070, 0x70C60003,
+    0x41820014, 0x7CC903A6, 0x84030004, 0x7CA50114, 0x4200FFF8, 0x5486E13F,
+    0x41820050, 0x80030004, 0x7CC903A6, 0x80C30008, 0x7CA50114, 0x80E3000C,
+    0x7CA53114, 0x85030010, 0x7CA53914, 0x42400028, 0x80030004, 0x7CA54114,
+    0x80C30008, 0x7CA50114, 0x80E3000C, 0x7CA53114, 0x85030010, 0x7CA53914,
+    0x4200FFE0, 0x7CA54114, 0x70800002, 0x41E20010, 0xA0030004, 0x38630002,
+    0x7CA50114, 0x70800001, 0x41E20010, 0x88030004, 0x5400402E, 0x7CA50114,
+    0x7C650194, 0x00005AF0
+};
+
+// bench2 call kernel, r1 = stack, r4 = number of calls, stops at 0x18
+static const uint32_t call_code[] = {
+    0x38600000, 0x3C800001, 0x608486A0, 0x7C8903A6, 0x48000011, 0x4200FFFC,
+    0x00000000, 0x60000000, 0x7C0802A6, 0x93E1FFFC, 0x90010008, 0x9421FFC0,
+    0x7C7F1B78, 0x57E5073E, 0x28050000, 0x40820010, 0x3CC01234, 0x60C65678,
+    0x7FFF3214, 0x387F0001, 0x80010048, 0x38210040, 0x7C0803A6, 0x83E1FFFC,
+    0x4E800020,
+};
+
+// r3 = operands, r4 = iterations, stops at 0x2C
+static const uint32_t fp_code[] = {
+    0xC8230000, // 00: lfd     f1,0(r3)
+    0xC8430008, // 04: lfd     f2,8(r3)
+    0xC8630010, // 08: lfd     f3,16(r3)
+    0xC8A30018, // 0C: lfd     f5,24(r3)
+    0x7C8903A6, // 10: mtctr   r4
+    0xFC63107A, // 14: fmadd   f3,f3,f1,f2
+    0xFC8300B2, // 18: fmul    f4,f3,f2
+    0xFCA5202A, // 1C: fadd    f5,f5,f4
+    0xFCC50824, // 20: fdiv    f6,f5,f1
+    0x4200FFF0, // 24: bdnz    0x14
+    0xD8A30018, // 28: stfd    f5,24(r3)
+    0x00000000, // 2C: illegal, never reached
+};
+
+// r3 = first page, r4 = number of pages, stops at 0x14
+static const uint32_t mmu_code[] = {
+    0x7C8903A6, // 00: mtctr   r4
+    0x80A30000, // 04: lwz     r5,0(r3)
+    0x7CC62A14, // 08: add     r6,r6,r5
+    0x38631000, // 0C: addi    r3,r3,4096
+    0x4200FFF4, // 10: bdnz    0x04
+    0x00000000, // 14: illegal, never reached
+};
+
+constexpr uint32_t KERNEL_RAM_SIZE = 0x01000000;
+constexpr uint32_t KERNEL_DATA     = 0x00010000;
+constexpr uint32_t KERNEL_STACK    = 0x00008000;
+constexpr uint32_t CS_SIZE         = 0x8000;
+constexpr uint32_t FP_ITERATIONS   = 100000;
+
+// mmu kernel: 128 MB of segment 1 mapped onto 4 MB of RAM
+constexpr uint32_t MMU_VSID        = 0x123;
+constexpr uint32_t MMU_EA_BASE     = 0x10000000;
+constexpr uint32_t MMU_NUM_PAGES   = 32768;
+constexpr uint32_t MMU_PHYS_BASE   = 0x00400000;
+constexpr uint32_t MMU_PHYS_PAGES  = 1024;
+constexpr uint32_t MMU_HTAB_BASE   = 0x00800000; // 512 KB, HTABMASK = 7
+constexpr uint32_t MMU_HTAB_MASK   = 7;
+
+static uint64_t host_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t max_rss_kb() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru))
+        return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024; // bytes on macOS
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static void load_code(const uint32_t* code, size_t num_words) {
+    for (size_t i = 0; i < num_words; i++)
+        mmu_write_vmem<uint32_t>(0, uint32_t(i * 4), code[i]);
+}
+
+static void setup_mmu_kernel() {
+    // one PTE per page in the primary PTEG, the hash spreads the pages evenly
+    for (uint32_t page = 0; page < MMU_NUM_PAGES; page++) {
+        uint32_t ea         = MMU_EA_BASE + page * 4096;
+        uint32_t page_index = (ea >> 12) & 0xFFFF;
+        uint32_t hash       = (MMU_VSID & 0x7FFFF) ^ page_index;
+        uint32_t pteg       = MMU_HTAB_BASE | ((hash & ((MMU_HTAB_MASK << 10) | 0x3FF)) << 6);
+        uint32_t rpn        = (MMU_PHYS_BASE >> 12) + (page % MMU_PHYS_PAGES);
+
+        uint32_t slot;
+        for (slot = 0; slot < 8; slot++)
+            if (!(mmu_read_vmem<uint32_t>(0, pteg + slot * 8) & 0x80000000))
+                break;
+        if (slot == 8)
+            ABORT_F("PTEG at 0x%08X is full", pteg);
+
+        mmu_write_vmem<uint32_t>(0, pteg + slot * 8,
+            0x80000000 | (MMU_VSID << 7) | (page_index >> 10));
+        mmu_write_vmem<uint32_t>(0, pteg + slot * 8 + 4, (rpn << 12) | 2); // PP = read/write
+    }
+
+    ppc_state.spr[SPR::SDR1] = MMU_HTAB_BASE | MMU_HTAB_MASK;
+    ppc_state.sr[MMU_EA_BASE >> 28] = MMU_VSID;
+    ppc_state.msr |= MSR::DR;
+    mmu_pat_ctx_changed();
+    mmu_change_mode();
+}
+
+static void prepare_kernel_run(const std::string& workload) {
+    ppc_state.pc = 0;
+    if (workload == "int") {
+        ppc_state.gpr[3] = KERNEL_DATA;
+        ppc_state.gpr[4] = CS_SIZE;
+        ppc_state.gpr[5] = 0;
+    } else if (workload == "call") {
+        ppc_state.gpr[1] = KERNEL_STACK;
+        ppc_state.gpr[3] = 0;
+    } else if (workload == "fp") {
+        ppc_state.gpr[3] = KERNEL_DATA;
+        ppc_state.gpr[4] = FP_ITERATIONS;
+    } else if (workload == "mmu") {
+        ppc_state.gpr[3] = MMU_EA_BASE;
+        ppc_state.gpr[4] = MMU_NUM_PAGES;
+        ppc_state.gpr[6] = 0;
+    }
+    power_on = true;
+}
+
+static uint64_t instructions_since([[maybe_unused]] uint64_t start_instrs, uint64_t guest_ns,
+                                   bool& exact) {
+#ifdef CPU_PROFILING
+    exact = true;
+    return num_executed_instrs - start_instrs;
+#else
+    // the instruction period is fixed point nanoseconds with 4 fractional bits
+    exact = false;
+    return (guest_ns << 4) / std::max<uint64_t>(get_instruction_period(), 1);
+#endif
+}
+
+static void run_kernel(BenchResult& res, uint32_t duration_ms) {
+    res.machine = "mpc106";
+
+    std::unique_ptr<MPC106> grackle_obj(new MPC106("GrackleGossamer"));
+    if (!grackle_obj->add_ram_region(0, KERNEL_RAM_SIZE)) {
+        LOG_F(ERROR, "Could not create RAM region");
+        return;
+    }
+
+    constexpr uint64_t bus_freq = 66'820'000ULL;
+    ppc_cpu_init(grackle_obj.get(), {
+        .version = PPC_VER::MPC750,
+        .timebase_freq_hz = bus_freq / 4,
+        .bus_freq_hz = bus_freq,
+        .core_freq_hz = bus_freq * 7 / 2,
+    });
+
+    uint32_t stop_addr;
+    if (res.workload == "int") {
+        load_code(cs_code, std::size(cs_code));
+        srand(0xCAFEBABE);
+        for (uint32_t i = 0; i < CS_SIZE; i++)
+            mmu_write_vmem<uint8_t>(0, KERNEL_DATA + i, rand() % 256);
+        stop_addr = 0xC4;
+    } else if (res.workload == "call") {
+        load_code(call_code, std::size(call_code));
+        stop_addr = 0x18;
+    } else if (res.workload == "fp") {
+        load_code(fp_code, std::size(fp_code));
+        mmu_write_vmem<uint64_t>(0, KERNEL_DATA,      std::bit_cast<uint64_t>(0.999999));
+        mmu_write_vmem<uint64_t>(0, KERNEL_DATA + 8,  std::bit_cast<uint64_t>(1e-6));
+        mmu_write_vmem<uint64_t>(0, KERNEL_DATA + 16, std::bit_cast<uint64_t>(0.0));
+        mmu_write_vmem<uint64_t>(0, KERNEL_DATA + 24, std::bit_cast<uint64_t>(0.0));
+        ppc_msr_did_change(ppc_state.msr, ppc_state.msr | MSR::FP, false);
+        stop_addr = 0x2C;
+    } else if (res.workload == "mmu") {
+        load_code(mmu_code, std::size(mmu_code));
+        setup_mmu_kernel();
+        stop_addr = 0x14;
+    } else {
+        LOG_F(ERROR, "Unknown workload %s", res.workload.c_str());
+        return;
+    }
+
+    // warm up caches and TLBs
+    prepare_kernel_run(res.workload);
+    ppc_exec_until(stop_addr);
+
+#ifdef CPU_PROFILING
+    uint64_t start_instrs = num_executed_instrs;
+#else
+    uint64_t start_instrs = 0;
+#endif
+    uint64_t start_guest = get_virt_time_ns();
+    uint64_t start_host  = host_now_ns();
+    uint64_t end_host    = start_host + uint64_t(duration_ms) * 1000000;
+    uint64_t now;
+
+    do {
+        prepare_kernel_run(res.workload);
+        ppc_exec_until(stop_addr);
+        if (ppc_state.pc != stop_addr) {
+            LOG_F(ERROR, "%s kernel stopped at 0x%08X", res.workload.c_str(), ppc_state.pc);
+            return;
+        }
+        res.runs++;
+        now = host_now_ns();
+    } while (now < end_host);
+
+    res.host_ns      = now - start_host;
+    res.guest_ns     = get_virt_time_ns() - start_guest;
+    res.instructions = instructions_since(start_instrs, res.guest_ns, res.instr_exact);
+    res.ok           = true;
+}
+
+static void run_boot(BenchResult& res, const std::string& rom_path, uint32_t guest_ms,
+                     std::vector<std::string>& machine_args) {
+    g_headless_display = true;
+
+    auto rom_data = std::unique_ptr<char[]>(new char[4 * 1024 * 1024]);
+    memset(&rom_data[0], 0, 4 * 1024 * 1024);
+    std::string path = rom_path;
+    size_t rom_size = MachineFactory::read_boot_rom(path, &rom_data[0]);
+    if (!rom_size)
+        return;
+
+    if (res.machine.empty())
+        res.machine = MachineFactory::machine_name_from_rom(&rom_data[0], rom_size);
+    if (res.machine.empty()) {
+        LOG_F(ERROR, "Could not determine the machine for %s", rom_path.c_str());
+        return;
+    }
+
+    if (MachineFactory::create_machine_for_id(res.machine, &rom_data[0], rom_size,
+                                              machine_args, path) < 0)
+        return;
+
+    TimerManager::get_instance()->add_oneshot_timer(MSECS_TO_NSECS(uint64_t(guest_ms)),
+        [](uint64_t, uint64_t) {
+            power_off(po_quit);
+        });
+
+#ifdef CPU_PROFILING
+    uint64_t start_instrs = num_executed_instrs;
+#else
+    uint64_t start_instrs = 0;
+#endif
+    uint64_t start_guest = get_virt_time_ns();
+    uint64_t start_host  = host_now_ns();
+
+    power_on = true;
+    ppc_exec();
+
+    res.host_ns      = host_now_ns() - start_host;
+    res.guest_ns     = get_virt_time_ns() - start_guest;
+    res.instructions = instructions_since(start_instrs, res.guest_ns, res.instr_exact);
+    res.runs         = 1;
+    res.ok           = power_off_reason == po_quit;
+
+    delete gMachineObj.release();
+}
+
+// the result line a child prints for the parent
+static const char* RESULT_TAG = "BENCHRESULT";
+
+static void print_result_line(const BenchResult& res) {
+    printf("%s %s %s %d %" PRIu64 " %" PRIu64 " %d %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+           RESULT_TAG, res.workload.c_str(), res.machine.empty() ? "-" : res.machine.c_str(),
+           res.ok, res.runs, res.instructions, res.instr_exact, res.host_ns, res.guest_ns,
+           res.max_rss_kb);
+    fflush(stdout);
+}
+
+static bool parse_result_line(const std::string& line, BenchResult& res) {
+    std::istringstream ss(line);
+    std::string tag;
+    int ok, exact;
+    ss >> tag >> res.workload >> res.machine >> ok >> res.runs >> res.instructions
+       >> exact >> res.host_ns >> res.guest_ns >> res.max_rss_kb;
+    if (!ss || tag != RESULT_TAG)
+        return false;
+    res.ok          = ok;
+    res.instr_exact = exact;
+    return true;
+}
+
+/* ----------------------------- parent side ----------------------------- */
+
+typedef struct BenchJob {
+    std::string workload;
+    std::string machine;
+} BenchJob;
+
+static std::string quote_arg(const std::string& arg) {
+#ifdef _WIN32
+    return "\"" + arg + "\"";
+#else
+    std::string out = "'";
+    for (char c : arg) {
+        if (c == '\'')
+            out += "'\\''";
+        else
+            out += c;
+    }
+    return out + "'";
+#endif
+}
+
+static BenchResult run_child(const std::string& self, const BenchJob& job,
+                             const std::string& common_args) {
+    BenchResult res;
+    res.workload = job.workload;
+    res.machine  = job.machine.empty() ? "-" : job.machine;
+
+    std::string cmd = quote_arg(self) + " --job " + job.workload;
+    if (!job.machine.empty())
+        cmd += " --machine " + quote_arg(job.machine);
+    cmd += common_args;
+
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) {
+        LOG_F(ERROR, "Could not start %s", cmd.c_str());
+        return res;
+    }
+
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        std::string line(buf);
+        if (line.compare(0, strlen(RESULT_TAG), RESULT_TAG) == 0)
+            parse_result_line(line, res);
+    }
+    if (pclose(pipe) != 0)
+        res.ok = false;
+
+    return res;
+}
+
+static double mips(const BenchResult& res) {
+    return res.host_ns ? double(res.instructions) * 1E3 / double(res.host_ns) : 0.0;
+}
+
+static double guest_per_host(const BenchResult& res) {
+    return res.host_ns ? double(res.guest_ns) / double(res.host_ns) : 0.0;
+}
+
+static void print_report(FILE* out, const std::vector<BenchResult>& results, bool csv) {
+    if (csv) {
+        fprintf(out, "workload,machine,status,runs,instructions,instructions_exact,"
+                     "host_ns,guest_ns,mips,guest_s_per_host_s,max_rss_kb\n");
+        for (auto& res : results)
+            fprintf(out, "%s,%s,%s,%" PRIu64 ",%" PRIu64 ",%d,%" PRIu64 ",%" PRIu64
+                         ",%.3f,%.4f,%" PRIu64 "\n",
+                    res.workload.c_str(), res.machine.c_str(), res.ok ? "ok" : "failed",
+                    res.runs, res.instructions, res.instr_exact, res.host_ns,
+                    res.guest_ns, mips(res), guest_per_host(res), res.max_rss_kb);
+        return;
+    }
+
+    fprintf(out, "{\"results\":[");
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& res = results[i];
+        fprintf(out, "%s\n {\"workload\":\"%s\",\"machine\":\"%s\",\"status\":\"%s\","
+                     "\"runs\":%" PRIu64 ",\"instructions\":%" PRIu64 ","
+                     "\"instructions_exact\":%s,\"host_ns\":%" PRIu64 ","
+                     "\"guest_ns\":%" PRIu64 ",\"mips\":%.3f,"
+                     "\"guest_s_per_host_s\":%.4f,\"max_rss_kb\":%" PRIu64 "}",
+                i ? "," : "", res.workload.c_str(), res.machine.c_str(),
+                res.ok ? "ok" : "failed", res.runs, res.instructions,
+                res.instr_exact ? "true" : "false", res.host_ns, res.guest_ns,
+                mips(res), guest_per_host(res), res.max_rss_kb);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+int main(int argc, char** argv) {
+    std::string job_workload, job_machine, rom_path, format = "json", out_path;
+    std::vector<std::string> workloads, machines;
+    unsigned num_jobs    = std::max(1U, std::thread::hardware_concurrency());
+    uint32_t duration_ms = 2000;
+    uint32_t boot_ms     = 10000;
+
+    CLI::App app("DingusPPC benchmark suite");
+    app.allow_extras();
+    app.add_option("-w,--workloads", workloads,
+        "Workloads to run (int, call, fp, mmu, boot), default: all kernels, "
+        "plus boot when a ROM is given")
+        ->delimiter(',')
+        ->check(CLI::IsMember({"int", "call", "fp", "mmu", "boot"}));
+    app.add_option("-b,--bootrom", rom_path, "Boot ROM for the boot workload")
+        ->check(CLI::ExistingFile);
+    app.add_option("-m,--machines", machines,
+        "Machines to boot, default: the machine matching the ROM")
+        ->delimiter(',');
+    app.add_option("--duration-ms", duration_ms, "Host time spent in each kernel")
+        ->capture_default_str();
+    app.add_option("--boot-ms", boot_ms, "Guest time each machine boots for")
+        ->capture_default_str();
+    app.add_option("-j,--jobs", num_jobs, "Number of workloads run in parallel");
+    app.add_option("--format", format, "Report format")
+        ->check(CLI::IsMember({"json", "csv"}))
+        ->capture_default_str();
+    app.add_option("-o,--output", out_path, "Report file, default: stdout");
+    app.add_option("--job", job_workload)->group(""); // internal: run one workload
+    app.add_option("--machine", job_machine)->group("");
+    CLI11_PARSE(app, argc, argv);
+
+    loguru::g_preamble_date    = false;
+    loguru::g_preamble_time    = false;
+    loguru::g_preamble_thread  = false;
+    // children only report problems, their results go to the parent
+    loguru::g_stderr_verbosity = job_workload.empty() ? loguru::Verbosity_INFO :
+                                                        loguru::Verbosity_WARNING;
+    loguru::init(argc, argv);
+
+    std::vector<std::string> extra_args = app.remaining_for_passthrough();
+
+    if (!job_workload.empty()) {
+        BenchResult res;
+        res.workload = job_workload;
+        res.machine  = job_machine;
+        if (job_workload == "boot")
+            run_boot(res, rom_path, boot_ms, extra_args);
+        else
+            run_kernel(res, duration_ms);
+        res.max_rss_kb = max_rss_kb();
+        print_result_line(res);
+        return res.ok ? 0 : 1;
+    }
+
+    if (workloads.empty()) {
+        workloads.assign(std::begin(all_kernels), std::end(all_kernels));
+        if (!rom_path.empty())
+            workloads.push_back("boot");
+    }
+
+    std::vector<BenchJob> jobs;
+    for (auto& workload : workloads) {
+        if (workload != "boot") {
+            jobs.push_back({workload, ""});
+        } else if (rom_path.empty()) {
+            LOG_F(ERROR, "The boot workload needs a boot ROM (--bootrom)");
+            return 1;
+        } else if (machines.empty()) {
+            jobs.push_back({workload, ""});
+        } else {
+            for (auto& machine : machines)
+                jobs.push_back({workload, machine});
+        }
+    }
+
+    std::string common_args = " --duration-ms " + std::to_string(duration_ms) +
+                              " --boot-ms " + std::to_string(boot_ms);
+    if (!rom_path.empty())
+        common_args += " --bootrom " + quote_arg(rom_path);
+    if (!extra_args.empty()) {
+        common_args += " --";
+        for (auto& arg : extra_args)
+            common_args += " " + quote_arg(arg);
+    }
+
+    std::vector<BenchResult> results(jobs.size());
+    std::atomic<size_t> next_job{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::max(1U, std::min<unsigned>(num_jobs, jobs.size())); t++) {
+        workers.emplace_back([&]() {
+            for (size_t i; (i = next_job++) < jobs.size();) {
+                results[i] = run_child(argv[0], jobs[i], common_args);
+                LOG_F(INFO, "%s on %s: %s", results[i].workload.c_str(),
+                      results[i].machine.c_str(), results[i].ok ? "done" : "FAILED");
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    FILE* out = stdout;
+    if (!out_path.empty() && !(out = fopen(out_path.c_str(), "w"))) {
+        LOG_F(ERROR, "Could not create %s", out_path.c_str());
+        return 1;
+    }
+    print_report(out, results, format == "csv");
+    if (out != stdout)
+        fclose(out);
+
+    return std::all_of(results.begin(), results.end(),
+                       [](const BenchResult& res) { return res.ok; }) ? 0 : 1;
+}
@@ -175,6 +175,13 @@ private:
     static EventManager* event_manager;
     EventManager() {} // private constructor to implement a singleton
 
+    // deliver guest input, recording or suppressing it for input replay;
+    // return true if the event was delivered
+    bool deliver_mouse(const MouseEvent& me);
+    bool deliver_keyboard(const KeyboardEvent& ke);
+    bool deliver_gamepad(const GamepadEvent& ge);
+    void replay_input_events();
+
     CoreSignal<const WindowEvent&>     _window_signal;
     CoreSignal<const MouseEvent&>      _mouse_signal;
     CoreSignal<const KeyboardEvent&>   _keyboard_signal;
@@ -25,6 +25,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/common/adb/adbkeyboard.h>
 #include <devices/common/hwinterrupt.h>
 #include <devices/common/viacuda.h>
+#include <utils/inputlog.h>
 #include <loguru.hpp>
 #include <SDL3/SDL.h>
 
@@ -193,6 +194,10 @@ void EventManager::poll_events() {
     SDL_Event event;
     bool host_input = false; // set when an input event is delivered to the guest
 
+    // Replayed events go first: the host shortcuts below may return early.
+    if (input_log_replaying())
+        this->replay_input_events();
+
     while (SDL_PollEvent(&event)) {
         events_captured++;
 
@@ -357,10 +362,9 @@ void EventManager::poll_events() {
                         key_ups++;
                     }
 
-                    host_input = true;
-                    this->_keyboard_signal.emit(ke);
+                    host_input |= this->deliver_keyboard(ke);
                     ke.key = AdbKey_Delete;
-                    this->_keyboard_signal.emit(ke);
+                    this->deliver_keyboard(ke);
                     return;
                 }
                 int key_code = get_sdl_event_key_code(event.key, this->kbd_locale);
@@ -379,8 +383,7 @@ void EventManager::poll_events() {
                         ke.flags = event.key.mod & SDL_KMOD_CAPS ?
                             KEYBOARD_EVENT_DOWN : KEYBOARD_EVENT_UP;
                     }
-                    host_input = true;
-                    this->_keyboard_signal.emit(ke);
+                    host_input |= this->deliver_keyboard(ke);
                 } else {
                     LOG_F(WARNING, "Unknown key %x pressed", event.key.key);
                 }
@@ -395,8 +398,7 @@ void EventManager::poll_events() {
                 me.xabs  = (uint32_t)event.motion.x;
                 me.yabs  = (uint32_t)event.motion.y;
                 me.flags = MOUSE_EVENT_MOTION;
-                host_input = true;
-                this->_mouse_signal.emit(me);
+                host_input |= this->deliver_mouse(me);
             }
             break;
 
@@ -414,8 +416,7 @@ void EventManager::poll_events() {
                 me.xabs  = (uint32_t)event.button.x;
                 me.yabs  = (uint32_t)event.button.y;
                 me.flags = MOUSE_EVENT_BUTTON;
-                host_input = true;
-                this->_mouse_signal.emit(me);
+                host_input |= this->deliver_mouse(me);
             }
             break;
 
@@ -433,8 +434,7 @@ void EventManager::poll_events() {
                 me.xabs  = (uint32_t)event.button.x;
                 me.yabs  = (uint32_t)event.button.y;
                 me.flags = MOUSE_EVENT_BUTTON;
-                host_input = true;
-                this->_mouse_signal.emit(me);
+                host_input |= this->deliver_mouse(me);
             }
             break;
 
@@ -459,8 +459,7 @@ void EventManager::poll_events() {
                 }
                 ge.gamepad_id = event.gbutton.which;
                 ge.flags = GAMEPAD_EVENT_DOWN;
-                host_input = true;
-                this->_gamepad_signal.emit(ge);
+                host_input |= this->deliver_gamepad(ge);
             }
             break;
 
@@ -485,8 +484,7 @@ void EventManager::poll_events() {
                 }
                 ge.gamepad_id = event.gbutton.which;
                 ge.flags = GAMEPAD_EVENT_UP;
-                host_input = true;
-                this->_gamepad_signal.emit(ge);
+                host_input |= this->deliver_gamepad(ge);
             }
             break;
 
@@ -510,7 +508,109 @@ void EventManager::poll_events() {
         mark_host_input();
 }
 
+bool EventManager::deliver_mouse(const MouseEvent& me) {
+    if (input_log_replaying())
+        return false;
+    if (input_log_recording()) {
+        InputLogPayload p;
+        p.put(me.flags);
+        p.put_signed(me.xrel);
+        p.put_signed(me.yrel);
+        p.put(me.xabs);
+        p.put(me.yabs);
+        p.put(me.buttons_state);
+        input_log_record(INPUT_LOG_MOUSE, INPUT_LOG_HOST_STREAM, p);
+    }
+    this->_mouse_signal.emit(me);
+    return true;
+}
+
+bool EventManager::deliver_keyboard(const KeyboardEvent& ke) {
+    if (input_log_replaying())
+        return false;
+    if (input_log_recording()) {
+        InputLogPayload p;
+        p.put(ke.flags);
+        p.put(ke.key);
+        input_log_record(INPUT_LOG_KEYBOARD, INPUT_LOG_HOST_STREAM, p);
+    }
+    this->_keyboard_signal.emit(ke);
+    return true;
+}
+
+bool EventManager::deliver_gamepad(const GamepadEvent& ge) {
+    if (input_log_replaying())
+        return false;
+    if (input_log_recording()) {
+        InputLogPayload p;
+        p.put(ge.gamepad_id);
+        p.put(ge.flags);
+        p.put(ge.button);
+        input_log_record(INPUT_LOG_GAMEPAD, INPUT_LOG_HOST_STREAM, p);
+    }
+    this->_gamepad_signal.emit(ge);
+    return true;
+}
+
+// Emit the recorded host events that are due at the current virtual time.
+// Live input is dropped while replaying; the deterministic event timer
+// calls us at the same virtual instants at which the events were recorded.
+void EventManager::replay_input_events() {
+    InputLogPayload p;
+    uint8_t source;
+    bool host_input = false;
+
+    while (input_log_next(INPUT_LOG_HOST_STREAM, source, p)) {
+        switch (source) {
+        case INPUT_LOG_MOUSE: {
+                MouseEvent me{};
+                me.flags         = p.get();
+                me.xrel          = p.get_signed();
+                me.yrel          = p.get_signed();
+                me.xabs          = p.get();
+                me.yabs          = p.get();
+                me.buttons_state = uint8_t(p.get());
+                this->buttons_state = me.buttons_state;
+                this->_mouse_signal.emit(me);
+            }
+            break;
+        case INPUT_LOG_KEYBOARD: {
+                KeyboardEvent ke{};
+                ke.flags = p.get();
+                ke.key   = p.get();
+                this->_keyboard_signal.emit(ke);
+            }
+            break;
+        case INPUT_LOG_GAMEPAD: {
+                GamepadEvent ge{};
+                ge.gamepad_id = p.get();
+                ge.flags      = p.get();
+                ge.button     = uint8_t(p.get());
+                this->_gamepad_signal.emit(ge);
+            }
+            break;
+        case INPUT_LOG_END:
+            LOG_F(INFO, "Input replay finished");
+            power_off(po_quit);
+            continue;
+        default:
+            LOG_F(WARNING, "Input replay: unknown event source %d", source);
+            continue;
+        }
+        host_input = true;
+    }
+
+    if (host_input)
+        mark_host_input();
+}
+
 void EventManager::post_keyboard_state_events() {
+    // the host keyboard state was recorded as key down events at this instant
+    if (input_log_replaying()) {
+        this->replay_input_events();
+        return;
+    }
+
     int count;
     int numkeys;
     const bool *states = SDL_GetKeyboardState(&numkeys);
@@ -553,7 +653,7 @@ void EventManager::post_keyboard_state_events() {
         count++;
         ke.key = swap_command_option(mod->adbkey);
         ke.flags = KEYBOARD_EVENT_DOWN;
-        this->_keyboard_signal.emit(ke);
+        this->deliver_keyboard(ke);
     }
     if (!count)
         LOG_F(INFO, "        (none)");
@@ -583,7 +683,7 @@ void EventManager::post_keyboard_state_events() {
         if (key_code != -1) {
             ke.key = key_code;
             ke.flags = KEYBOARD_EVENT_DOWN;
-            this->_keyboard_signal.emit(ke);
+            this->deliver_keyboard(ke);
         } else {
             LOG_F(WARNING, "        Unknown key %x pressed", keyevent.key);
         }
@@ -23,6 +23,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <loguru.hpp>
 #include "timermanager.h"
+#include <utils/profiler.h>
+#include <utils/stats.h>
 
 #include <cinttypes>
 #include <memory>
@@ -30,13 +32,15 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 TimerManager* TimerManager::timer_manager;
 
-uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb)
+uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb,
+                                          uint64_t slack)
 {
     TimerInfo* ti = new TimerInfo;
 
     ti->id          = ++this->id;
     ti->timeout_ns  = timeout_ns;
     ti->interval_ns = interval;
+    ti->slack_ns    = slack;
     ti->cb          = cb;
 
     std::shared_ptr<TimerInfo> timer_desc(ti);
@@ -52,9 +56,9 @@ uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval
     return ti->id;
 }
 
-uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb)
+uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb, uint64_t slack)
 {
-    return TimerManager::add_absolute_timer(this->get_time_now() + timeout, 0, cb);
+    return TimerManager::add_absolute_timer(this->get_time_now() + timeout, 0, cb, slack);
 }
 
 uint32_t TimerManager::add_immediate_timer(timer_cb cb)
@@ -62,14 +66,15 @@ uint32_t TimerManager::add_immediate_timer(timer_cb cb)
     return TimerManager::add_absolute_timer(0, 0, cb);
 }
 
-uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb)
+uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb,
+                                        uint64_t slack)
 {
-    return TimerManager::add_absolute_timer(this->get_time_now() + delay, interval, cb);
+    return TimerManager::add_absolute_timer(this->get_time_now() + delay, interval, cb, slack);
 }
 
-uint32_t TimerManager::add_cyclic_timer(uint64_t interval, timer_cb cb)
+uint32_t TimerManager::add_cyclic_timer(uint64_t interval, timer_cb cb, uint64_t slack)
 {
-    return this->add_cyclic_timer(interval, interval, cb);
+    return this->add_cyclic_timer(interval, interval, cb, slack);
 }
 
 void TimerManager::cancel_timer(uint32_t id)
@@ -80,10 +85,30 @@ void TimerManager::cancel_timer(uint32_t id)
     }
 }
 
+/** Return the latest time the next wakeup may happen at without firing any
+    timer later than its slack allows. All timers due by then are fired in
+    the same wakeup. Must be called with the queue mutex held. */
+uint64_t TimerManager::next_wakeup_ns()
+{
+    const auto& top = this->timer_queue.top();
+
+    // deadlines of all other timers are past the top one's expiry
+    if (!top->slack_ns)
+        return top->timeout_ns;
+
+    uint64_t wakeup_ns = top->timeout_ns + top->slack_ns;
+    for (const auto& timer : this->timer_queue.container())
+        wakeup_ns = std::min(wakeup_ns, timer->timeout_ns + timer->slack_ns);
+
+    return wakeup_ns;
+}
+
 uint64_t TimerManager::process_timers()
 {
     std::shared_ptr<TimerInfo> cur_timer;
     uint64_t time_now = get_time_now();
+    uint64_t batch_ns = 0;
+    bool     woken = false;
 
 { // mtx scope
     std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
@@ -109,7 +134,18 @@ uint64_t TimerManager::process_timers()
             this->timer_queue.push(cur_timer);
         }
 
+        // timers are fired in expiry order so a batch doesn't reorder
+        // interrupts, later expiries would have needed their own wakeup
+        if (!woken) {
+            woken = true;
+            stat_inc(STAT_TIMER_WAKEUPS);
+        } else if (timeout_ns > batch_ns) {
+            stat_inc(STAT_TIMER_WAKEUPS_SAVED);
+        }
+        batch_ns = std::max(batch_ns, timeout_ns);
+
         this->cb_active = true;
+        stat_inc(STAT_TIMER_EVENTS);
 
         // invoke timer callback
         cb(time_now, timeout_ns);
@@ -127,8 +163,12 @@ uint64_t TimerManager::process_timers()
 } // ] mtx scope
     }
 
-    // return next timer's expiry
-    return cur_timer->timeout_ns;
+    // return next wakeup time
+    std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
+    if (this->timer_queue.empty()) {
+        return 0ULL;
+    }
+    return this->next_wakeup_ns();
 }
 
 uint64_t TimerManager::get_next_timeout_ns()
@@ -137,7 +177,7 @@ uint64_t TimerManager::get_next_timeout_ns()
     if (this->timer_queue.empty()) {
         return 0ULL;
     }
-    return this->timer_queue.top()->timeout_ns;
+    return this->next_wakeup_ns();
 }
 
 void TimerManager::cancel_all_timers()
@@ -149,3 +189,48 @@ void TimerManager::cancel_all_timers()
         this->timer_queue.pop();
     }
 }
+
+class TimerProfile : public BaseProfile {
+public:
+    TimerProfile() : BaseProfile("Timers") {
+        this->reset();
+    }
+
+    void populate_variables(std::vector<ProfileVar>& vars) {
+        uint64_t wakeups    = stats_get(STAT_TIMER_WAKEUPS) - this->base_wakeups;
+        uint64_t saved      = stats_get(STAT_TIMER_WAKEUPS_SAVED) - this->base_saved;
+        uint64_t elapsed_ns = TimerManager::get_instance()->current_time_ns() - this->base_ns;
+
+        vars.clear();
+
+        vars.push_back({.name = "Wakeups",
+                        .format = ProfileVarFmt::DEC,
+                        .value = wakeups});
+
+        vars.push_back({.name = "Wakeups Saved",
+                        .format = ProfileVarFmt::DEC,
+                        .value = saved});
+
+        vars.push_back({.name = "Wakeups Saved per Guest Second",
+                        .format = ProfileVarFmt::DEC,
+                        .value = elapsed_ns ? saved * NS_PER_SEC / elapsed_ns : 0});
+    }
+
+    void reset() {
+        this->base_wakeups = stats_get(STAT_TIMER_WAKEUPS);
+        this->base_saved   = stats_get(STAT_TIMER_WAKEUPS_SAVED);
+        this->base_ns      = TimerManager::get_instance()->current_time_ns();
+    }
+
+private:
+    uint64_t base_wakeups = 0;
+    uint64_t base_saved   = 0;
+    uint64_t base_ns      = 0;
+};
+
+void TimerManager::register_profile()
+{
+    if (gProfilerObj)
+        gProfilerObj->register_profile("Timers",
+            std::unique_ptr<BaseProfile>(new TimerProfile()));
+}
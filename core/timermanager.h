@@ -88,6 +88,12 @@ public:
         return mtx;
     }
 
+    // underlying heap storage, callers must hold the mutex
+    const Container& container() const
+    {
+        return this->c;
+    }
+
 private:
     std::recursive_mutex mtx;
 };
@@ -96,6 +102,7 @@ typedef struct TimerInfo {
     uint32_t id;
     uint64_t timeout_ns;  // timer expiry
     uint64_t interval_ns; // 0 for one-shot timers
+    uint64_t slack_ns;    // how late the timer may fire, see process_timers()
     timer_cb cb;          // timer callback
 } TimerInfo;
 
@@ -131,24 +138,33 @@ public:
     uint64_t current_time_ns() const { return get_time_now(); }
 
     // creating and cancelling timers
-    uint32_t add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb);
-    uint32_t add_oneshot_timer(uint64_t timeout, timer_cb cb);
+    // slack: how much later than requested the timer may fire. Timers
+    // whose windows overlap are fired together in a single wakeup.
+    uint32_t add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb,
+                                uint64_t slack = 0);
+    uint32_t add_oneshot_timer(uint64_t timeout, timer_cb cb, uint64_t slack = 0);
     uint32_t add_immediate_timer(timer_cb cb);
-    uint32_t add_cyclic_timer(uint64_t interval, timer_cb cb);
-    uint32_t add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb);
+    uint32_t add_cyclic_timer(uint64_t interval, timer_cb cb, uint64_t slack = 0);
+    uint32_t add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb,
+                              uint64_t slack = 0);
     void cancel_timer(uint32_t id);
     void cancel_all_timers();
 
     uint64_t process_timers();
 
-    // peek at the next timer's expiry (in guest time) without firing it;
+    // peek at the next wakeup (in guest time) without firing any timer;
     // returns 0 if there are no pending timers
     uint64_t get_next_timeout_ns();
 
+    // register the "Timers" profile with the profiler
+    void register_profile();
+
 private:
     static TimerManager* timer_manager;
     TimerManager(){} // private constructor to implement a singleton
 
+    uint64_t next_wakeup_ns();
+
     // timer queue
     my_priority_queue<std::shared_ptr<TimerInfo>, std::vector<std::shared_ptr<TimerInfo>>, MyGtComparator> timer_queue;
 
@@ -0,0 +1,1114 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The AltiVec (VMX) opcodes for the processor - ppcaltivec.cpp
+
+#ifdef DPPC_ALTIVEC
+
+#include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
+
+#include <algorithm>
+#include <bit>
+#include <cfenv>
+#include <cinttypes>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+/* Host SIMD is used where the plain loops below don't map well onto vector
+   instructions: saturating arithmetic (which also has to report saturation)
+   and vperm. Everything else is written as simple element loops that the
+   compiler vectorizes on its own. The SIMD paths rely on the host being
+   little-endian, see VR_storage. */
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VEC_HAVE_SSE2 1
+/* SSSE3 (pshufb) isn't part of the x86-64 baseline. Unless the build targets
+   it already, the vperm path is compiled for SSSE3 on its own and selected
+   by a CPU feature check at run time. */
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define VEC_HAVE_SSSE3 1
+#define VEC_SSSE3_TARGET
+static constexpr bool vec_host_ssse3 = true;
+#elif defined(__GNUC__)
+#include <tmmintrin.h>
+#define VEC_HAVE_SSSE3 1
+#define VEC_SSSE3_TARGET __attribute__((target("ssse3")))
+static const bool vec_host_ssse3 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") != 0;
+}();
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define VEC_HAVE_NEON 1
+#endif
+
+using namespace dppc_interpreter;
+
+// ============================== Helpers ==============================
+
+#define decode_vops_d(opcode)                                   \
+    VR_storage& vD = ppc_state.vr[(opcode >> 21) & 0x1F];
+
+#define decode_vops_db(opcode)                                  \
+    decode_vops_d(opcode);                                      \
+    const VR_storage vB = ppc_state.vr[(opcode >> 11) & 0x1F];
+
+#define decode_vops_dab(opcode)                                 \
+    decode_vops_db(opcode);                                     \
+    const VR_storage vA = ppc_state.vr[(opcode >> 16) & 0x1F];
+
+#define decode_vops_dabc(opcode)                                \
+    decode_vops_dab(opcode);                                    \
+    const VR_storage vC = ppc_state.vr[(opcode >> 6) & 0x1F];
+
+static inline void vec_check_avail() {
+    if (!(ppc_state.msr & MSR::VEC)) [[unlikely]]
+        ppc_exception_handler(Except_Type::EXC_VEC_UNAVAIL, 0);
+}
+
+/** Host array holding the elements of type T. */
+template <typename T>
+static inline T* lanes(VR_storage& v) {
+    if constexpr (std::is_same_v<T, uint8_t>)  return v.u8;
+    if constexpr (std::is_same_v<T, int8_t>)   return v.s8;
+    if constexpr (std::is_same_v<T, uint16_t>) return v.u16;
+    if constexpr (std::is_same_v<T, int16_t>)  return v.s16;
+    if constexpr (std::is_same_v<T, uint32_t>) return v.u32;
+    if constexpr (std::is_same_v<T, int32_t>)  return v.s32;
+    if constexpr (std::is_same_v<T, float>)    return v.f32;
+    if constexpr (std::is_same_v<T, uint64_t>) return v.u64;
+}
+
+template <typename T>
+static inline const T* lanes(const VR_storage& v) {
+    return lanes<T>(const_cast<VR_storage&>(v));
+}
+
+template <typename T>
+constexpr int num_lanes = 16 / sizeof(T);
+
+/** Element i in PPC numbering, element 0 is the most significant one. */
+template <typename T>
+static inline T& el(VR_storage& v, int i) {
+    if constexpr (std::endian::native == std::endian::little)
+        return lanes<T>(v)[num_lanes<T> - 1 - i];
+    else
+        return lanes<T>(v)[i];
+}
+
+template <typename T>
+static inline T el(const VR_storage& v, int i) {
+    return el<T>(const_cast<VR_storage&>(v), i);
+}
+
+/** Apply op to each pair of elements. The element order doesn't matter. */
+template <typename T, typename F>
+static inline void vec_map(VR_storage& d, const VR_storage& a, const VR_storage& b, F op) {
+    T* pd = lanes<T>(d);
+    const T* pa = lanes<T>(a);
+    const T* pb = lanes<T>(b);
+    for (int i = 0; i < num_lanes<T>; i++)
+        pd[i] = op(pa[i], pb[i]);
+}
+
+template <typename T>
+static inline T vec_sat(int64_t val, bool& sat) {
+    constexpr int64_t lo = std::numeric_limits<T>::min();
+    constexpr int64_t hi = std::numeric_limits<T>::max();
+    if (val > hi) {
+        sat = true;
+        return T(hi);
+    }
+    if (val < lo) {
+        sat = true;
+        return T(lo);
+    }
+    return T(val);
+}
+
+static inline void vec_update_sat(bool sat) {
+    if (sat)
+        ppc_state.vscr |= VSCR::SAT;
+}
+
+static inline void vec_update_cr6(bool all_true, bool all_false) {
+    ppc_state.cr = (ppc_state.cr & ~CR_select::CR6_field) |
+                   (all_true ? (CR_LT >> 24) : 0) | (all_false ? (CR_EQ >> 24) : 0);
+}
+
+static inline uint32_t vec_ea(uint32_t opcode) {
+    uint32_t reg_a = (opcode >> 16) & 0x1F;
+    uint32_t reg_b = (opcode >> 11) & 0x1F;
+    return (reg_a ? ppc_state.gpr[reg_a] : 0) + ppc_state.gpr[reg_b];
+}
+
+// signed 5-bit immediate of vspltis*
+static inline int32_t vec_simm(uint32_t opcode) {
+    int32_t simm = (opcode >> 16) & 0x1F;
+    return (simm & 0x10) ? simm - 0x20 : simm;
+}
+
+#if VEC_HAVE_SSE2
+static inline __m128i vec_load(const VR_storage& v) {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(&v));
+}
+
+static inline void vec_store(VR_storage& v, __m128i x) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(&v), x);
+}
+#endif
+
+// ======================= Floating-point helpers =======================
+
+// Vector arithmetic always rounds to nearest, regardless of FPSCR[RN].
+class VecRoundNearest {
+public:
+    VecRoundNearest() : changed(ppc_state.fpscr & FPSCR::RN_MASK) {
+        if (changed)
+            std::fesetround(FE_TONEAREST);
+    }
+    ~VecRoundNearest() {
+        if (changed)
+            set_host_rounding_mode(ppc_state.fpscr & FPSCR::RN_MASK);
+    }
+
+private:
+    bool changed;
+};
+
+constexpr uint32_t VEC_DEFAULT_NAN = 0x7FC00000;
+
+// denormals are flushed to zero in non-Java mode
+static inline float vfp_flush(float x) {
+    if ((ppc_state.vscr & VSCR::NJ) && std::fpclassify(x) == FP_SUBNORMAL)
+        return std::copysign(0.0f, x);
+    return x;
+}
+
+static inline float vfp_quiet(float x) {
+    return std::bit_cast<float>(std::bit_cast<uint32_t>(x) | 0x00400000);
+}
+
+// NaNs generated by an operation are the PPC default NaN
+static inline float vfp_result(float x) {
+    if (std::isnan(x))
+        return std::bit_cast<float>(VEC_DEFAULT_NAN);
+    return vfp_flush(x);
+}
+
+template <typename F>
+static inline void vfp_unop(uint32_t opcode, F op) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    VecRoundNearest rn;
+    for (int i = 0; i < 4; i++) {
+        float b = vB.f32[i];
+        vD.f32[i] = std::isnan(b) ? vfp_quiet(b) : vfp_result(op(vfp_flush(b)));
+    }
+}
+
+template <typename F>
+static inline void vfp_binop(uint32_t opcode, F op) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    VecRoundNearest rn;
+    for (int i = 0; i < 4; i++) {
+        float a = vA.f32[i];
+        float b = vB.f32[i];
+        if (std::isnan(a))
+            vD.f32[i] = vfp_quiet(a);
+        else if (std::isnan(b))
+            vD.f32[i] = vfp_quiet(b);
+        else
+            vD.f32[i] = vfp_result(op(vfp_flush(a), vfp_flush(b)));
+    }
+}
+
+// vA * vC + vB, NaN priority is A, B, C
+template <bool negate>
+static inline void vfp_madd(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+    VecRoundNearest rn;
+    for (int i = 0; i < 4; i++) {
+        float a = vA.f32[i];
+        float b = vB.f32[i];
+        float c = vC.f32[i];
+        if (std::isnan(a))
+            vD.f32[i] = vfp_quiet(a);
+        else if (std::isnan(b))
+            vD.f32[i] = vfp_quiet(b);
+        else if (std::isnan(c))
+            vD.f32[i] = vfp_quiet(c);
+        else if (negate)
+            vD.f32[i] = vfp_result(-std::fma(vfp_flush(a), vfp_flush(c), -vfp_flush(b)));
+        else
+            vD.f32[i] = vfp_result(std::fma(vfp_flush(a), vfp_flush(c), vfp_flush(b)));
+    }
+}
+
+// ========================= Loads and stores ==========================
+
+void dppc_interpreter::altivec_lvx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~0xFU;
+    uint64_t hi = mmu_read_vmem<uint64_t>(opcode, ea);
+    uint64_t lo = mmu_read_vmem<uint64_t>(opcode, ea + 8);
+    decode_vops_d(opcode);
+    el<uint64_t>(vD, 0) = hi;
+    el<uint64_t>(vD, 1) = lo;
+}
+
+// the LRU hint isn't modelled
+void dppc_interpreter::altivec_lvxl(uint32_t opcode) {
+    altivec_lvx(opcode);
+}
+
+void dppc_interpreter::altivec_lvebx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode);
+    uint8_t val = mmu_read_vmem<uint8_t>(opcode, ea);
+    decode_vops_d(opcode);
+    el<uint8_t>(vD, ea & 0xF) = val;
+}
+
+void dppc_interpreter::altivec_lvehx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~1U;
+    uint16_t val = mmu_read_vmem<uint16_t>(opcode, ea);
+    decode_vops_d(opcode);
+    el<uint16_t>(vD, (ea & 0xF) >> 1) = val;
+}
+
+void dppc_interpreter::altivec_lvewx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~3U;
+    uint32_t val = mmu_read_vmem<uint32_t>(opcode, ea);
+    decode_vops_d(opcode);
+    el<uint32_t>(vD, (ea & 0xF) >> 2) = val;
+}
+
+void dppc_interpreter::altivec_stvx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~0xFU;
+    const VR_storage& vS = ppc_state.vr[(opcode >> 21) & 0x1F];
+    mmu_write_vmem<uint64_t>(opcode, ea, el<uint64_t>(vS, 0));
+    mmu_write_vmem<uint64_t>(opcode, ea + 8, el<uint64_t>(vS, 1));
+}
+
+void dppc_interpreter::altivec_stvxl(uint32_t opcode) {
+    altivec_stvx(opcode);
+}
+
+void dppc_interpreter::altivec_stvebx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode);
+    const VR_storage& vS = ppc_state.vr[(opcode >> 21) & 0x1F];
+    mmu_write_vmem<uint8_t>(opcode, ea, el<uint8_t>(vS, ea & 0xF));
+}
+
+void dppc_interpreter::altivec_stvehx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~1U;
+    const VR_storage& vS = ppc_state.vr[(opcode >> 21) & 0x1F];
+    mmu_write_vmem<uint16_t>(opcode, ea, el<uint16_t>(vS, (ea & 0xF) >> 1));
+}
+
+void dppc_interpreter::altivec_stvewx(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t ea = vec_ea(opcode) & ~3U;
+    const VR_storage& vS = ppc_state.vr[(opcode >> 21) & 0x1F];
+    mmu_write_vmem<uint32_t>(opcode, ea, el<uint32_t>(vS, (ea & 0xF) >> 2));
+}
+
+void dppc_interpreter::altivec_lvsl(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t sh = vec_ea(opcode) & 0xF;
+    decode_vops_d(opcode);
+    for (int i = 0; i < 16; i++)
+        el<uint8_t>(vD, i) = uint8_t(sh + i);
+}
+
+void dppc_interpreter::altivec_lvsr(uint32_t opcode) {
+    vec_check_avail();
+    uint32_t sh = vec_ea(opcode) & 0xF;
+    decode_vops_d(opcode);
+    for (int i = 0; i < 16; i++)
+        el<uint8_t>(vD, i) = uint8_t(16 - sh + i);
+}
+
+// Data stream hints have no architectural effect. They don't need MSR[VEC].
+void dppc_interpreter::altivec_dst(uint32_t opcode) {
+}
+
+void dppc_interpreter::altivec_dstst(uint32_t opcode) {
+}
+
+void dppc_interpreter::altivec_dss(uint32_t opcode) {
+}
+
+// ============================ VSCR access ============================
+
+void dppc_interpreter::altivec_mfvscr(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_d(opcode);
+    vD = {};
+    el<uint32_t>(vD, 3) = ppc_state.vscr;
+}
+
+void dppc_interpreter::altivec_mtvscr(uint32_t opcode) {
+    vec_check_avail();
+    const VR_storage& vB = ppc_state.vr[(opcode >> 11) & 0x1F];
+    ppc_state.vscr = el<uint32_t>(vB, 3) & (VSCR::NJ | VSCR::SAT);
+}
+
+// ========================= Integer arithmetic =========================
+
+template <typename T>
+static inline void vec_add_modulo(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T(a + b); });
+}
+
+template <typename T>
+static inline void vec_sub_modulo(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T(a - b); });
+}
+
+template <typename T, bool sub>
+static inline void vec_addsub_sat(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+
+#if VEC_HAVE_SSE2
+    if constexpr (sizeof(T) <= 2) {
+        __m128i a = vec_load(vA), b = vec_load(vB), r, w;
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            r = sub ? _mm_subs_epu8(a, b) : _mm_adds_epu8(a, b);
+            w = sub ? _mm_sub_epi8(a, b)  : _mm_add_epi8(a, b);
+        } else if constexpr (std::is_same_v<T, int8_t>) {
+            r = sub ? _mm_subs_epi8(a, b) : _mm_adds_epi8(a, b);
+            w = sub ? _mm_sub_epi8(a, b)  : _mm_add_epi8(a, b);
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+            r = sub ? _mm_subs_epu16(a, b) : _mm_adds_epu16(a, b);
+            w = sub ? _mm_sub_epi16(a, b)  : _mm_add_epi16(a, b);
+        } else {
+            r = sub ? _mm_subs_epi16(a, b) : _mm_adds_epi16(a, b);
+            w = sub ? _mm_sub_epi16(a, b)  : _mm_add_epi16(a, b);
+        }
+        vec_store(vD, r);
+        // saturated and wrapped results differ in the lanes that saturated
+        vec_update_sat(_mm_movemask_epi8(_mm_cmpeq_epi8(r, w)) != 0xFFFF);
+        return;
+    }
+#elif VEC_HAVE_NEON
+    if constexpr (sizeof(T) <= 2) {
+        uint8x16_t a = vld1q_u8(vA.u8), b = vld1q_u8(vB.u8), r, w;
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            r = sub ? vqsubq_u8(a, b) : vqaddq_u8(a, b);
+            w = sub ? vsubq_u8(a, b)  : vaddq_u8(a, b);
+        } else if constexpr (std::is_same_v<T, int8_t>) {
+            int8x16_t sa = vreinterpretq_s8_u8(a), sb = vreinterpretq_s8_u8(b);
+            r = vreinterpretq_u8_s8(sub ? vqsubq_s8(sa, sb) : vqaddq_s8(sa, sb));
+            w = sub ? vsubq_u8(a, b) : vaddq_u8(a, b);
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+            uint16x8_t ha = vreinterpretq_u16_u8(a), hb = vreinterpretq_u16_u8(b);
+            r = vreinterpretq_u8_u16(sub ? vqsubq_u16(ha, hb) : vqaddq_u16(ha, hb));
+            w = vreinterpretq_u8_u16(sub ? vsubq_u16(ha, hb) : vaddq_u16(ha, hb));
+        } else {
+            int16x8_t ha = vreinterpretq_s16_u8(a), hb = vreinterpretq_s16_u8(b);
+            r = vreinterpretq_u8_s16(sub ? vqsubq_s16(ha, hb) : vqaddq_s16(ha, hb));
+            w = vreinterpretq_u8_s16(sub ? vsubq_s16(ha, hb) : vaddq_s16(ha, hb));
+        }
+        vst1q_u8(vD.u8, r);
+        vec_update_sat(vminvq_u8(vceqq_u8(r, w)) == 0);
+        return;
+    }
+#endif
+
+    bool sat = false;
+    vec_map<T>(vD, vA, vB, [&sat](T a, T b) {
+        return vec_sat<T>(sub ? int64_t(a) - int64_t(b) : int64_t(a) + int64_t(b), sat);
+    });
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vaddubm(uint32_t opcode) { vec_add_modulo<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vadduhm(uint32_t opcode) { vec_add_modulo<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vadduwm(uint32_t opcode) { vec_add_modulo<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vsububm(uint32_t opcode) { vec_sub_modulo<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vsubuhm(uint32_t opcode) { vec_sub_modulo<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vsubuwm(uint32_t opcode) { vec_sub_modulo<uint32_t>(opcode); }
+
+void dppc_interpreter::altivec_vaddubs(uint32_t opcode) { vec_addsub_sat<uint8_t,  false>(opcode); }
+void dppc_interpreter::altivec_vadduhs(uint32_t opcode) { vec_addsub_sat<uint16_t, false>(opcode); }
+void dppc_interpreter::altivec_vadduws(uint32_t opcode) { vec_addsub_sat<uint32_t, false>(opcode); }
+void dppc_interpreter::altivec_vaddsbs(uint32_t opcode) { vec_addsub_sat<int8_t,   false>(opcode); }
+void dppc_interpreter::altivec_vaddshs(uint32_t opcode) { vec_addsub_sat<int16_t,  false>(opcode); }
+void dppc_interpreter::altivec_vaddsws(uint32_t opcode) { vec_addsub_sat<int32_t,  false>(opcode); }
+void dppc_interpreter::altivec_vsububs(uint32_t opcode) { vec_addsub_sat<uint8_t,  true>(opcode); }
+void dppc_interpreter::altivec_vsubuhs(uint32_t opcode) { vec_addsub_sat<uint16_t, true>(opcode); }
+void dppc_interpreter::altivec_vsubuws(uint32_t opcode) { vec_addsub_sat<uint32_t, true>(opcode); }
+void dppc_interpreter::altivec_vsubsbs(uint32_t opcode) { vec_addsub_sat<int8_t,   true>(opcode); }
+void dppc_interpreter::altivec_vsubshs(uint32_t opcode) { vec_addsub_sat<int16_t,  true>(opcode); }
+void dppc_interpreter::altivec_vsubsws(uint32_t opcode) { vec_addsub_sat<int32_t,  true>(opcode); }
+
+void dppc_interpreter::altivec_vaddcuw(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint32_t>(vD, vA, vB, [](uint32_t a, uint32_t b) {
+        return uint32_t((uint64_t(a) + b) >> 32);
+    });
+}
+
+void dppc_interpreter::altivec_vsubcuw(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint32_t>(vD, vA, vB, [](uint32_t a, uint32_t b) {
+        return uint32_t(a >= b);
+    });
+}
+
+template <typename T>
+static inline void vec_max(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return std::max(a, b); });
+}
+
+template <typename T>
+static inline void vec_min(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return std::min(a, b); });
+}
+
+template <typename T>
+static inline void vec_avg(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T((int64_t(a) + int64_t(b) + 1) >> 1); });
+}
+
+void dppc_interpreter::altivec_vmaxub(uint32_t opcode) { vec_max<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vmaxuh(uint32_t opcode) { vec_max<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vmaxuw(uint32_t opcode) { vec_max<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vmaxsb(uint32_t opcode) { vec_max<int8_t>(opcode); }
+void dppc_interpreter::altivec_vmaxsh(uint32_t opcode) { vec_max<int16_t>(opcode); }
+void dppc_interpreter::altivec_vmaxsw(uint32_t opcode) { vec_max<int32_t>(opcode); }
+void dppc_interpreter::altivec_vminub(uint32_t opcode) { vec_min<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vminuh(uint32_t opcode) { vec_min<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vminuw(uint32_t opcode) { vec_min<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vminsb(uint32_t opcode) { vec_min<int8_t>(opcode); }
+void dppc_interpreter::altivec_vminsh(uint32_t opcode) { vec_min<int16_t>(opcode); }
+void dppc_interpreter::altivec_vminsw(uint32_t opcode) { vec_min<int32_t>(opcode); }
+void dppc_interpreter::altivec_vavgub(uint32_t opcode) { vec_avg<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vavguh(uint32_t opcode) { vec_avg<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vavguw(uint32_t opcode) { vec_avg<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vavgsb(uint32_t opcode) { vec_avg<int8_t>(opcode); }
+void dppc_interpreter::altivec_vavgsh(uint32_t opcode) { vec_avg<int16_t>(opcode); }
+void dppc_interpreter::altivec_vavgsw(uint32_t opcode) { vec_avg<int32_t>(opcode); }
+
+// ============================ Multiplies =============================
+
+// products of the even (odd = 0) or odd (odd = 1) elements
+template <typename TS, typename TD, int odd>
+static inline void vec_mul_eo(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    for (int i = 0; i < num_lanes<TD>; i++)
+        el<TD>(vD, i) = TD(int64_t(el<TS>(vA, 2 * i + odd)) * int64_t(el<TS>(vB, 2 * i + odd)));
+}
+
+void dppc_interpreter::altivec_vmuleub(uint32_t opcode) { vec_mul_eo<uint8_t,  uint16_t, 0>(opcode); }
+void dppc_interpreter::altivec_vmuloub(uint32_t opcode) { vec_mul_eo<uint8_t,  uint16_t, 1>(opcode); }
+void dppc_interpreter::altivec_vmulesb(uint32_t opcode) { vec_mul_eo<int8_t,   int16_t,  0>(opcode); }
+void dppc_interpreter::altivec_vmulosb(uint32_t opcode) { vec_mul_eo<int8_t,   int16_t,  1>(opcode); }
+void dppc_interpreter::altivec_vmuleuh(uint32_t opcode) { vec_mul_eo<uint16_t, uint32_t, 0>(opcode); }
+void dppc_interpreter::altivec_vmulouh(uint32_t opcode) { vec_mul_eo<uint16_t, uint32_t, 1>(opcode); }
+void dppc_interpreter::altivec_vmulesh(uint32_t opcode) { vec_mul_eo<int16_t,  int32_t,  0>(opcode); }
+void dppc_interpreter::altivec_vmulosh(uint32_t opcode) { vec_mul_eo<int16_t,  int32_t,  1>(opcode); }
+
+template <bool round>
+static inline void vec_mhadd(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+    bool sat = false;
+    for (int i = 0; i < 8; i++) {
+        int32_t prod = int32_t(vA.s16[i]) * vB.s16[i];
+        if (round)
+            prod += 0x4000;
+        vD.s16[i] = vec_sat<int16_t>(int64_t(prod >> 15) + vC.s16[i], sat);
+    }
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vmhaddshs(uint32_t opcode)  { vec_mhadd<false>(opcode); }
+void dppc_interpreter::altivec_vmhraddshs(uint32_t opcode) { vec_mhadd<true>(opcode); }
+
+void dppc_interpreter::altivec_vmladduhm(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+    for (int i = 0; i < 8; i++)
+        vD.u16[i] = uint16_t(uint32_t(vA.u16[i]) * vB.u16[i] + vC.u16[i]);
+}
+
+/* Multiply-sum: each word of vD receives the sum of the products of the
+   elements of vA and vB inside that word plus the word of vC. Word j holds
+   the same elements in host and PPC numbering, so host indices are used. */
+template <typename TA, typename TB, typename TD, bool saturate>
+static inline void vec_msum(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+    constexpr int n = num_lanes<TA> / 4;
+    bool sat = false;
+    for (int j = 0; j < 4; j++) {
+        int64_t sum = lanes<TD>(vC)[j];
+        for (int k = 0; k < n; k++)
+            sum += int64_t(lanes<TA>(vA)[j * n + k]) * int64_t(lanes<TB>(vB)[j * n + k]);
+        lanes<TD>(vD)[j] = saturate ? vec_sat<TD>(sum, sat) : TD(sum);
+    }
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vmsumubm(uint32_t opcode) { vec_msum<uint8_t,  uint8_t,  uint32_t, false>(opcode); }
+void dppc_interpreter::altivec_vmsummbm(uint32_t opcode) { vec_msum<int8_t,   uint8_t,  int32_t,  false>(opcode); }
+void dppc_interpreter::altivec_vmsumuhm(uint32_t opcode) { vec_msum<uint16_t, uint16_t, uint32_t, false>(opcode); }
+void dppc_interpreter::altivec_vmsumuhs(uint32_t opcode) { vec_msum<uint16_t, uint16_t, uint32_t, true>(opcode); }
+void dppc_interpreter::altivec_vmsumshm(uint32_t opcode) { vec_msum<int16_t,  int16_t,  int32_t,  false>(opcode); }
+void dppc_interpreter::altivec_vmsumshs(uint32_t opcode) { vec_msum<int16_t,  int16_t,  int32_t,  true>(opcode); }
+
+// sum of the elements of vA inside each word plus the word of vB
+template <typename TA, typename TD>
+static inline void vec_sum4(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    constexpr int n = num_lanes<TA> / 4;
+    bool sat = false;
+    for (int j = 0; j < 4; j++) {
+        int64_t sum = lanes<TD>(vB)[j];
+        for (int k = 0; k < n; k++)
+            sum += lanes<TA>(vA)[j * n + k];
+        lanes<TD>(vD)[j] = vec_sat<TD>(sum, sat);
+    }
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vsum4ubs(uint32_t opcode) { vec_sum4<uint8_t, uint32_t>(opcode); }
+void dppc_interpreter::altivec_vsum4sbs(uint32_t opcode) { vec_sum4<int8_t,  int32_t>(opcode); }
+void dppc_interpreter::altivec_vsum4shs(uint32_t opcode) { vec_sum4<int16_t, int32_t>(opcode); }
+
+void dppc_interpreter::altivec_vsum2sws(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    bool sat = false;
+    vD = {};
+    for (int i = 1; i < 4; i += 2)
+        el<int32_t>(vD, i) = vec_sat<int32_t>(int64_t(el<int32_t>(vA, i - 1)) +
+            el<int32_t>(vA, i) + el<int32_t>(vB, i), sat);
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vsumsws(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    bool sat = false;
+    int64_t sum = el<int32_t>(vB, 3);
+    for (int i = 0; i < 4; i++)
+        sum += el<int32_t>(vA, i);
+    vD = {};
+    el<int32_t>(vD, 3) = vec_sat<int32_t>(sum, sat);
+    vec_update_sat(sat);
+}
+
+// ========================= Logical operations =========================
+
+void dppc_interpreter::altivec_vand(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint64_t>(vD, vA, vB, [](uint64_t a, uint64_t b) { return a & b; });
+}
+
+void dppc_interpreter::altivec_vandc(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint64_t>(vD, vA, vB, [](uint64_t a, uint64_t b) { return a & ~b; });
+}
+
+void dppc_interpreter::altivec_vor(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint64_t>(vD, vA, vB, [](uint64_t a, uint64_t b) { return a | b; });
+}
+
+void dppc_interpreter::altivec_vxor(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint64_t>(vD, vA, vB, [](uint64_t a, uint64_t b) { return a ^ b; });
+}
+
+void dppc_interpreter::altivec_vnor(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<uint64_t>(vD, vA, vB, [](uint64_t a, uint64_t b) { return ~(a | b); });
+}
+
+void dppc_interpreter::altivec_vsel(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+    for (int i = 0; i < 2; i++)
+        vD.u64[i] = (vA.u64[i] & ~vC.u64[i]) | (vB.u64[i] & vC.u64[i]);
+}
+
+// =========================== Element shifts ===========================
+
+template <typename T>
+static inline void vec_rl(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) {
+        return std::rotl(a, b & (sizeof(T) * 8 - 1));
+    });
+}
+
+template <typename T>
+static inline void vec_sl(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T(a << (b & (sizeof(T) * 8 - 1))); });
+}
+
+template <typename T>
+static inline void vec_sr(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T(a >> (b & (sizeof(T) * 8 - 1))); });
+}
+
+// algebraic shift, the elements are reinterpreted as signed
+template <typename T>
+static inline void vec_sra(uint32_t opcode) {
+    using S = std::make_signed_t<T>;
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    vec_map<T>(vD, vA, vB, [](T a, T b) { return T(S(a) >> (b & (sizeof(T) * 8 - 1))); });
+}
+
+void dppc_interpreter::altivec_vrlb(uint32_t opcode)  { vec_rl<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vrlh(uint32_t opcode)  { vec_rl<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vrlw(uint32_t opcode)  { vec_rl<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vslb(uint32_t opcode)  { vec_sl<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vslh(uint32_t opcode)  { vec_sl<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vslw(uint32_t opcode)  { vec_sl<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vsrb(uint32_t opcode)  { vec_sr<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vsrh(uint32_t opcode)  { vec_sr<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vsrw(uint32_t opcode)  { vec_sr<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vsrab(uint32_t opcode) { vec_sra<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vsrah(uint32_t opcode) { vec_sra<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vsraw(uint32_t opcode) { vec_sra<uint32_t>(opcode); }
+
+// ======================= Whole register shifts ========================
+
+void dppc_interpreter::altivec_vsl(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    int sh = el<uint8_t>(vB, 15) & 7;
+    for (int i = 0; i < 16; i++) {
+        uint32_t next = i < 15 ? el<uint8_t>(vA, i + 1) : 0;
+        el<uint8_t>(vD, i) = uint8_t((el<uint8_t>(vA, i) << sh) | (next >> (8 - sh)));
+    }
+}
+
+void dppc_interpreter::altivec_vsr(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    int sh = el<uint8_t>(vB, 15) & 7;
+    for (int i = 0; i < 16; i++) {
+        uint32_t prev = i > 0 ? el<uint8_t>(vA, i - 1) : 0;
+        el<uint8_t>(vD, i) = uint8_t((el<uint8_t>(vA, i) >> sh) | (prev << (8 - sh)));
+    }
+}
+
+void dppc_interpreter::altivec_vslo(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    int sh = (el<uint8_t>(vB, 15) >> 3) & 0xF;
+    for (int i = 0; i < 16; i++)
+        el<uint8_t>(vD, i) = i + sh < 16 ? el<uint8_t>(vA, i + sh) : 0;
+}
+
+void dppc_interpreter::altivec_vsro(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    int sh = (el<uint8_t>(vB, 15) >> 3) & 0xF;
+    for (int i = 0; i < 16; i++)
+        el<uint8_t>(vD, i) = i >= sh ? el<uint8_t>(vA, i - sh) : 0;
+}
+
+void dppc_interpreter::altivec_vsldoi(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    int sh = (opcode >> 6) & 0xF;
+    for (int i = 0; i < 16; i++)
+        el<uint8_t>(vD, i) = i + sh < 16 ? el<uint8_t>(vA, i + sh) : el<uint8_t>(vB, i + sh - 16);
+}
+
+// ============================== Permute ===============================
+
+#if VEC_HAVE_SSSE3
+VEC_SSSE3_TARGET
+static void vec_perm_ssse3(VR_storage& vD, const VR_storage& vA, const VR_storage& vB,
+                           const VR_storage& vC) {
+    // PPC byte k is host byte 15 - k, i.e. k ^ 15
+    __m128i c   = vec_load(vC);
+    __m128i idx = _mm_and_si128(_mm_xor_si128(c, _mm_set1_epi8(0x0F)), _mm_set1_epi8(0x0F));
+    __m128i ra  = _mm_shuffle_epi8(vec_load(vA), idx);
+    __m128i rb  = _mm_shuffle_epi8(vec_load(vB), idx);
+    __m128i use_b = _mm_cmpeq_epi8(_mm_and_si128(c, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+    vec_store(vD, _mm_or_si128(_mm_and_si128(use_b, rb), _mm_andnot_si128(use_b, ra)));
+}
+#endif
+
+void dppc_interpreter::altivec_vperm(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dabc(opcode);
+
+#if VEC_HAVE_SSSE3
+    if (vec_host_ssse3) {
+        vec_perm_ssse3(vD, vA, vB, vC);
+        return;
+    }
+#endif
+#if VEC_HAVE_NEON
+    // with the table {vB, vA}, PPC byte k of vA||vB is table entry 31 - k
+    uint8x16x2_t table = {{vld1q_u8(vB.u8), vld1q_u8(vA.u8)}};
+    uint8x16_t idx = vsubq_u8(vdupq_n_u8(31), vandq_u8(vld1q_u8(vC.u8), vdupq_n_u8(31)));
+    vst1q_u8(vD.u8, vqtbl2q_u8(table, idx));
+#else
+    for (int i = 0; i < 16; i++) {
+        uint8_t sel = el<uint8_t>(vC, i);
+        el<uint8_t>(vD, i) = (sel & 0x10) ? el<uint8_t>(vB, sel & 0xF) : el<uint8_t>(vA, sel & 0xF);
+    }
+#endif
+}
+
+// ============================ Merge, splat ============================
+
+template <typename T, int half>
+static inline void vec_merge(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    constexpr int n = num_lanes<T> / 2;
+    for (int i = 0; i < n; i++) {
+        el<T>(vD, 2 * i)     = el<T>(vA, i + half * n);
+        el<T>(vD, 2 * i + 1) = el<T>(vB, i + half * n);
+    }
+}
+
+void dppc_interpreter::altivec_vmrghb(uint32_t opcode) { vec_merge<uint8_t,  0>(opcode); }
+void dppc_interpreter::altivec_vmrghh(uint32_t opcode) { vec_merge<uint16_t, 0>(opcode); }
+void dppc_interpreter::altivec_vmrghw(uint32_t opcode) { vec_merge<uint32_t, 0>(opcode); }
+void dppc_interpreter::altivec_vmrglb(uint32_t opcode) { vec_merge<uint8_t,  1>(opcode); }
+void dppc_interpreter::altivec_vmrglh(uint32_t opcode) { vec_merge<uint16_t, 1>(opcode); }
+void dppc_interpreter::altivec_vmrglw(uint32_t opcode) { vec_merge<uint32_t, 1>(opcode); }
+
+template <typename T>
+static inline void vec_splt(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    T val = el<T>(vB, ((opcode >> 16) & 0x1F) & (num_lanes<T> - 1));
+    for (int i = 0; i < num_lanes<T>; i++)
+        lanes<T>(vD)[i] = val;
+}
+
+template <typename T>
+static inline void vec_spltis(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_d(opcode);
+    T val = T(vec_simm(opcode));
+    for (int i = 0; i < num_lanes<T>; i++)
+        lanes<T>(vD)[i] = val;
+}
+
+void dppc_interpreter::altivec_vspltb(uint32_t opcode)   { vec_splt<uint8_t>(opcode); }
+void dppc_interpreter::altivec_vsplth(uint32_t opcode)   { vec_splt<uint16_t>(opcode); }
+void dppc_interpreter::altivec_vspltw(uint32_t opcode)   { vec_splt<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vspltisb(uint32_t opcode) { vec_spltis<int8_t>(opcode); }
+void dppc_interpreter::altivec_vspltish(uint32_t opcode) { vec_spltis<int16_t>(opcode); }
+void dppc_interpreter::altivec_vspltisw(uint32_t opcode) { vec_spltis<int32_t>(opcode); }
+
+// ============================ Pack, unpack ============================
+
+// vA supplies the upper half of the result, vB the lower half
+template <typename TS, typename TD, bool saturate>
+static inline void vec_pack(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    constexpr int n = num_lanes<TS>;
+    bool sat = false;
+    for (int i = 0; i < n; i++) {
+        TS a = el<TS>(vA, i);
+        TS b = el<TS>(vB, i);
+        el<TD>(vD, i)     = saturate ? vec_sat<TD>(a, sat) : TD(a);
+        el<TD>(vD, i + n) = saturate ? vec_sat<TD>(b, sat) : TD(b);
+    }
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vpkuhum(uint32_t opcode) { vec_pack<uint16_t, uint8_t,  false>(opcode); }
+void dppc_interpreter::altivec_vpkuwum(uint32_t opcode) { vec_pack<uint32_t, uint16_t, false>(opcode); }
+void dppc_interpreter::altivec_vpkuhus(uint32_t opcode) { vec_pack<uint16_t, uint8_t,  true>(opcode); }
+void dppc_interpreter::altivec_vpkuwus(uint32_t opcode) { vec_pack<uint32_t, uint16_t, true>(opcode); }
+void dppc_interpreter::altivec_vpkshus(uint32_t opcode) { vec_pack<int16_t,  uint8_t,  true>(opcode); }
+void dppc_interpreter::altivec_vpkswus(uint32_t opcode) { vec_pack<int32_t,  uint16_t, true>(opcode); }
+void dppc_interpreter::altivec_vpkshss(uint32_t opcode) { vec_pack<int16_t,  int8_t,   true>(opcode); }
+void dppc_interpreter::altivec_vpkswss(uint32_t opcode) { vec_pack<int32_t,  int16_t,  true>(opcode); }
+
+// 32-bit 8:8:8:8 pixels to 16-bit 1:5:5:5 pixels
+void dppc_interpreter::altivec_vpkpx(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    auto pack_px = [](uint32_t px) {
+        return uint16_t(((px >> 9) & 0xFC00) | ((px >> 6) & 0x03E0) | ((px >> 3) & 0x001F));
+    };
+    for (int i = 0; i < 4; i++) {
+        el<uint16_t>(vD, i)     = pack_px(el<uint32_t>(vA, i));
+        el<uint16_t>(vD, i + 4) = pack_px(el<uint32_t>(vB, i));
+    }
+}
+
+// sign-extends the high (half = 0) or low (half = 1) half of vB
+template <typename TS, typename TD, int half>
+static inline void vec_unpack(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    constexpr int n = num_lanes<TD>;
+    for (int i = 0; i < n; i++)
+        el<TD>(vD, i) = TD(el<TS>(vB, i + half * n));
+}
+
+void dppc_interpreter::altivec_vupkhsb(uint32_t opcode) { vec_unpack<int8_t,  int16_t, 0>(opcode); }
+void dppc_interpreter::altivec_vupkhsh(uint32_t opcode) { vec_unpack<int16_t, int32_t, 0>(opcode); }
+void dppc_interpreter::altivec_vupklsb(uint32_t opcode) { vec_unpack<int8_t,  int16_t, 1>(opcode); }
+void dppc_interpreter::altivec_vupklsh(uint32_t opcode) { vec_unpack<int16_t, int32_t, 1>(opcode); }
+
+// 16-bit 1:5:5:5 pixels to 32-bit pixels with a sign-extended alpha byte
+template <int half>
+static inline void vec_unpack_px(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    for (int i = 0; i < 4; i++) {
+        uint16_t px = el<uint16_t>(vB, i + half * 4);
+        el<uint32_t>(vD, i) = ((px & 0x8000) ? 0xFF000000U : 0) | ((px & 0x7C00) << 6) |
+                              ((px & 0x03E0) << 3) | (px & 0x001F);
+    }
+}
+
+void dppc_interpreter::altivec_vupkhpx(uint32_t opcode) { vec_unpack_px<0>(opcode); }
+void dppc_interpreter::altivec_vupklpx(uint32_t opcode) { vec_unpack_px<1>(opcode); }
+
+// ============================== Compares ==============================
+
+template <field_rc rec, typename T, typename F>
+static inline void vec_cmp(uint32_t opcode, F pred) {
+    using U = std::make_unsigned_t<std::conditional_t<std::is_same_v<T, float>, int32_t, T>>;
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    bool all_true = true, all_false = true;
+    for (int i = 0; i < num_lanes<T>; i++) {
+        bool res = pred(lanes<T>(vA)[i], lanes<T>(vB)[i]);
+        lanes<U>(vD)[i] = res ? U(~U(0)) : U(0);
+        all_true  &= res;
+        all_false &= !res;
+    }
+    if (rec)
+        vec_update_cr6(all_true, all_false);
+}
+
+#define VEC_CMP_INT(name, type, op)                                               \
+template <field_rc rec>                                                           \
+void dppc_interpreter::name(uint32_t opcode) {                                    \
+    vec_cmp<rec, type>(opcode, [](type a, type b) { return a op b; });            \
+}                                                                                 \
+template void dppc_interpreter::name<RC0>(uint32_t opcode);                       \
+template void dppc_interpreter::name<RC1>(uint32_t opcode);
+
+VEC_CMP_INT(altivec_vcmpequbx, uint8_t,  ==)
+VEC_CMP_INT(altivec_vcmpequhx, uint16_t, ==)
+VEC_CMP_INT(altivec_vcmpequwx, uint32_t, ==)
+VEC_CMP_INT(altivec_vcmpgtubx, uint8_t,  >)
+VEC_CMP_INT(altivec_vcmpgtuhx, uint16_t, >)
+VEC_CMP_INT(altivec_vcmpgtuwx, uint32_t, >)
+VEC_CMP_INT(altivec_vcmpgtsbx, int8_t,   >)
+VEC_CMP_INT(altivec_vcmpgtshx, int16_t,  >)
+VEC_CMP_INT(altivec_vcmpgtswx, int32_t,  >)
+
+// comparisons with a NaN operand are false
+#define VEC_CMP_FP(name, op)                                                      \
+template <field_rc rec>                                                           \
+void dppc_interpreter::name(uint32_t opcode) {                                    \
+    vec_cmp<rec, float>(opcode, [](float a, float b) {                            \
+        return vfp_flush(a) op vfp_flush(b);                                      \
+    });                                                                           \
+}                                                                                 \
+template void dppc_interpreter::name<RC0>(uint32_t opcode);                       \
+template void dppc_interpreter::name<RC1>(uint32_t opcode);
+
+VEC_CMP_FP(altivec_vcmpeqfpx, ==)
+VEC_CMP_FP(altivec_vcmpgefpx, >=)
+VEC_CMP_FP(altivec_vcmpgtfpx, >)
+
+// bounds compare: bit 0 is set if vA > vB, bit 1 if vA < -vB
+template <field_rc rec>
+void dppc_interpreter::altivec_vcmpbfpx(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_dab(opcode);
+    bool all_in = true;
+    for (int i = 0; i < 4; i++) {
+        float a = vfp_flush(vA.f32[i]);
+        float b = vfp_flush(vB.f32[i]);
+        uint32_t res = 0;
+        if (!(a <= b))
+            res |= 0x80000000;
+        if (!(a >= -b))
+            res |= 0x40000000;
+        vD.u32[i] = res;
+        all_in &= !res;
+    }
+    if (rec)
+        ppc_state.cr = (ppc_state.cr & ~CR_select::CR6_field) | (all_in ? (CR_EQ >> 24) : 0);
+}
+
+template void dppc_interpreter::altivec_vcmpbfpx<RC0>(uint32_t opcode);
+template void dppc_interpreter::altivec_vcmpbfpx<RC1>(uint32_t opcode);
+
+// ======================== Floating-point math =========================
+
+void dppc_interpreter::altivec_vaddfp(uint32_t opcode) {
+    vfp_binop(opcode, [](float a, float b) { return a + b; });
+}
+
+void dppc_interpreter::altivec_vsubfp(uint32_t opcode) {
+    vfp_binop(opcode, [](float a, float b) { return a - b; });
+}
+
+// the larger of +0 and -0 is +0
+void dppc_interpreter::altivec_vmaxfp(uint32_t opcode) {
+    vfp_binop(opcode, [](float a, float b) {
+        return (a > b || (a == b && !std::signbit(a))) ? a : b;
+    });
+}
+
+void dppc_interpreter::altivec_vminfp(uint32_t opcode) {
+    vfp_binop(opcode, [](float a, float b) {
+        return (a < b || (a == b && std::signbit(a))) ? a : b;
+    });
+}
+
+void dppc_interpreter::altivec_vmaddfp(uint32_t opcode)  { vfp_madd<false>(opcode); }
+void dppc_interpreter::altivec_vnmsubfp(uint32_t opcode) { vfp_madd<true>(opcode); }
+
+// The estimates are computed exactly, which is within their specified error.
+void dppc_interpreter::altivec_vrefp(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return 1.0f / b; });
+}
+
+void dppc_interpreter::altivec_vrsqrtefp(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return 1.0f / std::sqrt(b); });
+}
+
+void dppc_interpreter::altivec_vexptefp(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::exp2(b); });
+}
+
+void dppc_interpreter::altivec_vlogefp(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::log2(b); });
+}
+
+void dppc_interpreter::altivec_vrfin(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::nearbyint(b); });
+}
+
+void dppc_interpreter::altivec_vrfiz(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::trunc(b); });
+}
+
+void dppc_interpreter::altivec_vrfip(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::ceil(b); });
+}
+
+void dppc_interpreter::altivec_vrfim(uint32_t opcode) {
+    vfp_unop(opcode, [](float b) { return std::floor(b); });
+}
+
+// ======================== Fixed-point conversion ======================
+
+// integer to float divided by 2^UIMM
+template <typename T>
+static inline void vec_cvt_from_fixed(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    int scale = (opcode >> 16) & 0x1F;
+    VecRoundNearest rn;
+    for (int i = 0; i < 4; i++)
+        vD.f32[i] = std::ldexp(float(lanes<T>(vB)[i]), -scale);
+}
+
+// float multiplied by 2^UIMM to integer, truncated and saturated
+template <typename T>
+static inline void vec_cvt_to_fixed(uint32_t opcode) {
+    vec_check_avail();
+    decode_vops_db(opcode);
+    int scale = (opcode >> 16) & 0x1F;
+    bool sat = false;
+    for (int i = 0; i < 4; i++) {
+        float b = vfp_flush(vB.f32[i]);
+        if (std::isnan(b)) {
+            lanes<T>(vD)[i] = 0;
+            continue;
+        }
+        double val = std::trunc(std::ldexp(double(b), scale));
+        if (val > double(std::numeric_limits<T>::max())) {
+            lanes<T>(vD)[i] = std::numeric_limits<T>::max();
+            sat = true;
+        } else if (val < double(std::numeric_limits<T>::min())) {
+            lanes<T>(vD)[i] = std::numeric_limits<T>::min();
+            sat = true;
+        } else {
+            lanes<T>(vD)[i] = T(val);
+        }
+    }
+    vec_update_sat(sat);
+}
+
+void dppc_interpreter::altivec_vcfux(uint32_t opcode)  { vec_cvt_from_fixed<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vcfsx(uint32_t opcode)  { vec_cvt_from_fixed<int32_t>(opcode); }
+void dppc_interpreter::altivec_vctuxs(uint32_t opcode) { vec_cvt_to_fixed<uint32_t>(opcode); }
+void dppc_interpreter::altivec_vctsxs(uint32_t opcode) { vec_cvt_to_fixed<int32_t>(opcode); }
+
+#endif // DPPC_ALTIVEC
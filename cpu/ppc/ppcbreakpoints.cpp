@@ -0,0 +1,197 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Execution breakpoints and data watchpoints. */
+
+#include "ppcbreakpoints.h"
+#include "ppcemu.h"
+#include "ppcmmu.h"
+
+#include <loguru.hpp>
+
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+typedef struct Breakpoint {
+    BreakpointType  type;
+    uint32_t        virt_addr; // as entered, for display only
+    uint32_t        phys_addr;
+    uint32_t        length;
+    uint64_t        hits;
+} Breakpoint;
+
+uint32_t g_exec_bp_count = 0;
+uint32_t g_watch_count   = 0;
+
+static std::map<int, Breakpoint> breakpoints;
+static int next_bp_num = 1;
+
+// physical page -> number of breakpoints of that kind on it
+static std::unordered_map<uint32_t, uint32_t> exec_pages;
+static std::unordered_map<uint32_t, uint32_t> watch_pages;
+static std::unordered_set<uint32_t>           exec_addrs;
+
+// physical address of the breakpoint that stopped execution last. It is
+// stepped over once so that continuing doesn't stop on it again right away.
+static uint32_t step_over_addr = 0xFFFFFFFFUL;
+
+static const char* bp_type_name(BreakpointType type) {
+    switch (type) {
+    case BP_EXEC:        return "break";
+    case BP_WATCH_READ:  return "rwatch";
+    case BP_WATCH_WRITE: return "watch";
+    case BP_WATCH_RW:    return "awatch";
+    default:             return "?";
+    }
+}
+
+static void rebuild_exec_addrs() {
+    exec_addrs.clear();
+    for (auto& [num, bp] : breakpoints) {
+        if (bp.type == BP_EXEC)
+            exec_addrs.insert(bp.phys_addr);
+    }
+}
+
+int bp_add_exec(uint32_t virt_addr) {
+    uint32_t phys_addr;
+
+    if (!mmu_translate_dbg(virt_addr & ~3U, phys_addr)) {
+        LOG_F(ERROR, "Breakpoint: address 0x%08X is not mapped", virt_addr);
+        return -1;
+    }
+
+    int num = next_bp_num++;
+    breakpoints[num] = {BP_EXEC, virt_addr & ~3U, phys_addr, 4, 0};
+    exec_pages[phys_addr & PPC_PAGE_MASK]++;
+    exec_addrs.insert(phys_addr);
+    g_exec_bp_count++;
+    return num;
+}
+
+int bp_add_watch(uint32_t virt_addr, uint32_t length, BreakpointType type) {
+    uint32_t phys_addr;
+
+    if (!length || length > PPC_PAGE_SIZE ||
+        ((virt_addr & ~PPC_PAGE_MASK) + length) > PPC_PAGE_SIZE) {
+        LOG_F(ERROR, "Watchpoint: range must not cross a page boundary");
+        return -1;
+    }
+    if (!mmu_translate_dbg(virt_addr, phys_addr)) {
+        LOG_F(ERROR, "Watchpoint: address 0x%08X is not mapped", virt_addr);
+        return -1;
+    }
+
+    int num = next_bp_num++;
+    breakpoints[num] = {type, virt_addr, phys_addr, length, 0};
+    if (!watch_pages[phys_addr & PPC_PAGE_MASK]++)
+        mmu_flush_phys_page(phys_addr & PPC_PAGE_MASK);
+    g_watch_count++;
+    return num;
+}
+
+bool bp_delete(int bp_num) {
+    auto it = breakpoints.find(bp_num);
+    if (it == breakpoints.end())
+        return false;
+
+    const Breakpoint bp = it->second;
+    breakpoints.erase(it);
+
+    uint32_t page = bp.phys_addr & PPC_PAGE_MASK;
+    if (bp.type == BP_EXEC) {
+        if (!--exec_pages[page])
+            exec_pages.erase(page);
+        rebuild_exec_addrs();
+        g_exec_bp_count--;
+    } else {
+        if (!--watch_pages[page]) {
+            watch_pages.erase(page);
+            // let the page back into the primary DTLB
+            mmu_flush_phys_page(page);
+        }
+        g_watch_count--;
+    }
+    return true;
+}
+
+void bp_delete_all() {
+    while (!breakpoints.empty())
+        bp_delete(breakpoints.begin()->first);
+}
+
+void bp_print_list() {
+    if (breakpoints.empty()) {
+        printf("No breakpoints or watchpoints.\n");
+        return;
+    }
+    printf("Num  Type    Address    Physical   Len  Hits\n");
+    for (auto& [num, bp] : breakpoints) {
+        printf("%-4d %-7s %08X   %08X   %-4u %llu\n", num, bp_type_name(bp.type),
+            bp.virt_addr, bp.phys_addr, bp.length, (unsigned long long)bp.hits);
+    }
+}
+
+bool bp_exec_page(uint32_t phys_addr) {
+    return exec_pages.count(phys_addr & PPC_PAGE_MASK) != 0;
+}
+
+bool bp_exec_hit(uint32_t phys_addr, uint32_t virt_addr) {
+    if (phys_addr == step_over_addr) {
+        step_over_addr = 0xFFFFFFFFUL;
+        return false;
+    }
+    step_over_addr = 0xFFFFFFFFUL;
+
+    if (!exec_addrs.count(phys_addr))
+        return false;
+
+    for (auto& [num, bp] : breakpoints) {
+        if (bp.type == BP_EXEC && bp.phys_addr == phys_addr) {
+            bp.hits++;
+            LOG_F(WARNING, "Breakpoint %d hit at 0x%08X (phys 0x%08X)", num, virt_addr, phys_addr);
+        }
+    }
+    step_over_addr = phys_addr;
+    return true;
+}
+
+bool bp_watch_page(uint32_t phys_addr) {
+    return watch_pages.count(phys_addr & PPC_PAGE_MASK) != 0;
+}
+
+void bp_watch_check(uint32_t virt_addr, uint32_t phys_addr, uint32_t size, bool is_write) {
+    BreakpointType access = is_write ? BP_WATCH_WRITE : BP_WATCH_READ;
+
+    for (auto& [num, bp] : breakpoints) {
+        if (!(bp.type & access))
+            continue;
+        if (phys_addr + size <= bp.phys_addr || phys_addr >= bp.phys_addr + bp.length)
+            continue;
+        bp.hits++;
+        LOG_F(WARNING, "Watchpoint %d: %s of %u bytes at 0x%08X (phys 0x%08X), PC=0x%08X",
+            num, is_write ? "write" : "read", size, virt_addr, phys_addr, ppc_state.pc);
+        // the access completes, execution stops after this instruction
+        power_off(po_enter_debugger);
+    }
+}
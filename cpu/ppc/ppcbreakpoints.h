@@ -0,0 +1,64 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Execution breakpoints and data watchpoints.
+
+    Breakpoints are keyed by physical address. The interpreter only checks
+    breakpoints on execution blocks whose page contains one and the MMU only
+    checks watchpoints for pages that contain one; such pages are kept out
+    of the primary DTLB so every access to them takes the slow path.
+    With nothing set both checks reduce to a test of a global counter
+    outside the per-instruction path.
+ */
+
+#ifndef PPC_BREAKPOINTS_H
+#define PPC_BREAKPOINTS_H
+
+#include <cinttypes>
+
+enum BreakpointType : uint8_t {
+    BP_EXEC        = 0,
+    BP_WATCH_READ  = 1,
+    BP_WATCH_WRITE = 2,
+    BP_WATCH_RW    = BP_WATCH_READ | BP_WATCH_WRITE,
+};
+
+// number of execution breakpoints, tested by ppc_exec_inner at block setup
+extern uint32_t g_exec_bp_count;
+// number of data watchpoints, tested by the MMU on secondary TLB refills
+extern uint32_t g_watch_count;
+
+/* Debugger interface. Virtual addresses are translated with the current
+   MMU state; breakpoints stay on the physical address afterwards.
+   The add functions return the breakpoint number or -1 on failure. */
+int  bp_add_exec(uint32_t virt_addr);
+int  bp_add_watch(uint32_t virt_addr, uint32_t length, BreakpointType type);
+bool bp_delete(int bp_num);
+void bp_delete_all();
+void bp_print_list();
+
+/* Interpreter and MMU interface. */
+bool bp_exec_page(uint32_t phys_addr);
+bool bp_exec_hit(uint32_t phys_addr, uint32_t virt_addr);
+bool bp_watch_page(uint32_t phys_addr);
+void bp_watch_check(uint32_t virt_addr, uint32_t phys_addr, uint32_t size, bool is_write);
+
+#endif // PPC_BREAKPOINTS_H
@@ -67,6 +67,23 @@ union FPR_storage {
     uint64_t int64_r;    // double integer representation
 };
 
+#ifdef DPPC_ALTIVEC
+/** AltiVec vector register.
+    The 128-bit value is kept in host byte order, so every element is host
+    endian. On little-endian hosts the elements are therefore stored in
+    reverse order: PPC element 0 is the last array entry. */
+union alignas(16) VR_storage {
+    uint8_t  u8[16];
+    int8_t   s8[16];
+    uint16_t u16[8];
+    int16_t  s16[8];
+    uint32_t u32[4];
+    int32_t  s32[4];
+    float    f32[4];
+    uint64_t u64[2];
+};
+#endif
+
 /**
 Except for the floating-point registers, all registers require
 32 bits for representation. Floating-point registers need 64 bits.
@@ -79,6 +96,8 @@ fpscr = FP Status and Condition Register
   spr = Special Register
   msr = Machine State Register
    sr = Segment Register
+   vr = AltiVec Vector Register
+ vscr = AltiVec Vector Status and Control Register
 **/
 
 typedef struct struct_ppc_state {
@@ -95,6 +114,10 @@ typedef struct struct_ppc_state {
 #if SUPPORTS_PPC_LITTLE_ENDIAN_MODE
     bool is_LE;
 #endif
+#ifdef DPPC_ALTIVEC
+    VR_storage vr[32];
+    uint32_t vscr;
+#endif
 } SetPRS;
 
 extern SetPRS ppc_state;
@@ -124,6 +147,7 @@ enum SPR : int {
     SRR1    = 27,
     TBL_U   = 268, // user mode TBL
     TBU_U   = 269, // user mode TBU
+    VRSAVE  = 256, // AltiVec registers in use
     SPRG0   = 272,
     SPRG1   = 273,
     SPRG2   = 274,
@@ -154,6 +178,7 @@ enum PPC_VER : uint32_t {
     MPC603EV    = 0x00070101,
     MPC750      = 0x00080200,
     MPC604E     = 0x00090202,
+    MPC7400     = 0x000C0209,
     MPC970MP    = 0x00440100,
 };
 
@@ -218,6 +243,7 @@ enum {
 enum CR_select : int32_t {
     CR0_field = (0xF << 28),
     CR1_field = (0xF << 24),
+    CR6_field = (0xF << 4),
 };
 
 // Define bit masks for CR0.
@@ -271,6 +297,14 @@ enum FPSCR : uint32_t {
     FX          = 1UL << 31
 };
 
+/** Bit definitions for the AltiVec Vector Status and Control Register. */
+namespace VSCR {
+enum VSCR : uint32_t {
+    SAT         = 1UL << 0,  // saturation occurred (sticky)
+    NJ          = 1UL << 16, // non-Java mode: denormals are flushed to zero
+};
+}
+
 /** Bit definitions for the Machine State Register (MSR). */
 namespace MSR {
 enum MSR : int {
@@ -350,7 +384,8 @@ enum class Except_Type {
     EXC_NO_FPU,
     EXC_DECR,
     EXC_SYSCALL = 12,
-    EXC_TRACE   = 13
+    EXC_TRACE   = 13,
+    EXC_VEC_UNAVAIL = 14
 };
 
 /** Program Exception subclasses. */
@@ -363,11 +398,6 @@ enum Exc_Cause : uint32_t {
 
 extern unsigned exec_flags;
 
-// Counter of guest accesses to memory-mapped devices, incremented by
-// mmu_read_vmem/mmu_write_vmem. Used by ppcexec.cpp to detect when the
-// guest is idling (spinning without touching any device).
-extern uint64_t g_mmio_access_count;
-
 extern jmp_buf exc_env;
 
 enum Po_Cause : int {
@@ -417,6 +447,10 @@ extern uint32_t ppc_pow_hid0_mask;
 // still permit external input.
 extern bool is_deterministic;
 
+// Set by reads of the time base, the decrementer and the VIA timers.
+// The interpreter uses it to recognize busy-wait loops (see ppcexec.cpp).
+extern bool timer_polled;
+
 // Important Addressing Integers
 extern uint32_t ppc_next_instruction_address;
 
@@ -741,6 +775,169 @@ template <field_rc rec> extern void power_srq(uint32_t opcode);
 }    // namespace dppc_interpreter
 
 // AltiVec instructions
+#ifdef DPPC_ALTIVEC
+namespace dppc_interpreter {
+extern void altivec_lvsl(uint32_t opcode);
+extern void altivec_lvsr(uint32_t opcode);
+extern void altivec_dst(uint32_t opcode);
+extern void altivec_dstst(uint32_t opcode);
+extern void altivec_dss(uint32_t opcode);
+extern void altivec_lvebx(uint32_t opcode);
+extern void altivec_lvehx(uint32_t opcode);
+extern void altivec_lvewx(uint32_t opcode);
+extern void altivec_lvx(uint32_t opcode);
+extern void altivec_lvxl(uint32_t opcode);
+extern void altivec_stvebx(uint32_t opcode);
+extern void altivec_stvehx(uint32_t opcode);
+extern void altivec_stvewx(uint32_t opcode);
+extern void altivec_stvx(uint32_t opcode);
+extern void altivec_stvxl(uint32_t opcode);
+extern void altivec_vmhaddshs(uint32_t opcode);
+extern void altivec_vmhraddshs(uint32_t opcode);
+extern void altivec_vmladduhm(uint32_t opcode);
+extern void altivec_vmsumubm(uint32_t opcode);
+extern void altivec_vmsummbm(uint32_t opcode);
+extern void altivec_vmsumuhm(uint32_t opcode);
+extern void altivec_vmsumuhs(uint32_t opcode);
+extern void altivec_vmsumshm(uint32_t opcode);
+extern void altivec_vmsumshs(uint32_t opcode);
+extern void altivec_vsel(uint32_t opcode);
+extern void altivec_vperm(uint32_t opcode);
+extern void altivec_vsldoi(uint32_t opcode);
+extern void altivec_vmaddfp(uint32_t opcode);
+extern void altivec_vnmsubfp(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpequbx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpequhx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpequwx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpeqfpx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgefpx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtubx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtuhx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtuwx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtfpx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtsbx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtshx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpgtswx(uint32_t opcode);
+template <field_rc rec> extern void altivec_vcmpbfpx(uint32_t opcode);
+extern void altivec_vaddubm(uint32_t opcode);
+extern void altivec_vmaxub(uint32_t opcode);
+extern void altivec_vrlb(uint32_t opcode);
+extern void altivec_vmuloub(uint32_t opcode);
+extern void altivec_vaddfp(uint32_t opcode);
+extern void altivec_vmrghb(uint32_t opcode);
+extern void altivec_vpkuhum(uint32_t opcode);
+extern void altivec_vadduhm(uint32_t opcode);
+extern void altivec_vmaxuh(uint32_t opcode);
+extern void altivec_vrlh(uint32_t opcode);
+extern void altivec_vmulouh(uint32_t opcode);
+extern void altivec_vsubfp(uint32_t opcode);
+extern void altivec_vmrghh(uint32_t opcode);
+extern void altivec_vpkuwum(uint32_t opcode);
+extern void altivec_vadduwm(uint32_t opcode);
+extern void altivec_vmaxuw(uint32_t opcode);
+extern void altivec_vrlw(uint32_t opcode);
+extern void altivec_vmrghw(uint32_t opcode);
+extern void altivec_vpkuhus(uint32_t opcode);
+extern void altivec_vpkuwus(uint32_t opcode);
+extern void altivec_vmaxsb(uint32_t opcode);
+extern void altivec_vslb(uint32_t opcode);
+extern void altivec_vmulosb(uint32_t opcode);
+extern void altivec_vrefp(uint32_t opcode);
+extern void altivec_vmrglb(uint32_t opcode);
+extern void altivec_vpkshus(uint32_t opcode);
+extern void altivec_vmaxsh(uint32_t opcode);
+extern void altivec_vslh(uint32_t opcode);
+extern void altivec_vmulosh(uint32_t opcode);
+extern void altivec_vrsqrtefp(uint32_t opcode);
+extern void altivec_vmrglh(uint32_t opcode);
+extern void altivec_vpkswus(uint32_t opcode);
+extern void altivec_vaddcuw(uint32_t opcode);
+extern void altivec_vmaxsw(uint32_t opcode);
+extern void altivec_vslw(uint32_t opcode);
+extern void altivec_vexptefp(uint32_t opcode);
+extern void altivec_vmrglw(uint32_t opcode);
+extern void altivec_vpkshss(uint32_t opcode);
+extern void altivec_vsl(uint32_t opcode);
+extern void altivec_vlogefp(uint32_t opcode);
+extern void altivec_vpkswss(uint32_t opcode);
+extern void altivec_vaddubs(uint32_t opcode);
+extern void altivec_vminub(uint32_t opcode);
+extern void altivec_vsrb(uint32_t opcode);
+extern void altivec_vmuleub(uint32_t opcode);
+extern void altivec_vrfin(uint32_t opcode);
+extern void altivec_vspltb(uint32_t opcode);
+extern void altivec_vupkhsb(uint32_t opcode);
+extern void altivec_vadduhs(uint32_t opcode);
+extern void altivec_vminuh(uint32_t opcode);
+extern void altivec_vsrh(uint32_t opcode);
+extern void altivec_vmuleuh(uint32_t opcode);
+extern void altivec_vrfiz(uint32_t opcode);
+extern void altivec_vsplth(uint32_t opcode);
+extern void altivec_vupkhsh(uint32_t opcode);
+extern void altivec_vadduws(uint32_t opcode);
+extern void altivec_vminuw(uint32_t opcode);
+extern void altivec_vsrw(uint32_t opcode);
+extern void altivec_vrfip(uint32_t opcode);
+extern void altivec_vspltw(uint32_t opcode);
+extern void altivec_vupklsb(uint32_t opcode);
+extern void altivec_vsr(uint32_t opcode);
+extern void altivec_vrfim(uint32_t opcode);
+extern void altivec_vupklsh(uint32_t opcode);
+extern void altivec_vaddsbs(uint32_t opcode);
+extern void altivec_vminsb(uint32_t opcode);
+extern void altivec_vsrab(uint32_t opcode);
+extern void altivec_vmulesb(uint32_t opcode);
+extern void altivec_vcfux(uint32_t opcode);
+extern void altivec_vspltisb(uint32_t opcode);
+extern void altivec_vpkpx(uint32_t opcode);
+extern void altivec_vaddshs(uint32_t opcode);
+extern void altivec_vminsh(uint32_t opcode);
+extern void altivec_vsrah(uint32_t opcode);
+extern void altivec_vmulesh(uint32_t opcode);
+extern void altivec_vcfsx(uint32_t opcode);
+extern void altivec_vspltish(uint32_t opcode);
+extern void altivec_vupkhpx(uint32_t opcode);
+extern void altivec_vaddsws(uint32_t opcode);
+extern void altivec_vminsw(uint32_t opcode);
+extern void altivec_vsraw(uint32_t opcode);
+extern void altivec_vctuxs(uint32_t opcode);
+extern void altivec_vspltisw(uint32_t opcode);
+extern void altivec_vctsxs(uint32_t opcode);
+extern void altivec_vupklpx(uint32_t opcode);
+extern void altivec_vsububm(uint32_t opcode);
+extern void altivec_vavgub(uint32_t opcode);
+extern void altivec_vand(uint32_t opcode);
+extern void altivec_vmaxfp(uint32_t opcode);
+extern void altivec_vslo(uint32_t opcode);
+extern void altivec_vsubuhm(uint32_t opcode);
+extern void altivec_vavguh(uint32_t opcode);
+extern void altivec_vandc(uint32_t opcode);
+extern void altivec_vminfp(uint32_t opcode);
+extern void altivec_vsro(uint32_t opcode);
+extern void altivec_vsubuwm(uint32_t opcode);
+extern void altivec_vavguw(uint32_t opcode);
+extern void altivec_vor(uint32_t opcode);
+extern void altivec_vxor(uint32_t opcode);
+extern void altivec_vavgsb(uint32_t opcode);
+extern void altivec_vnor(uint32_t opcode);
+extern void altivec_vavgsh(uint32_t opcode);
+extern void altivec_vsubcuw(uint32_t opcode);
+extern void altivec_vavgsw(uint32_t opcode);
+extern void altivec_vsububs(uint32_t opcode);
+extern void altivec_mfvscr(uint32_t opcode);
+extern void altivec_vsum4ubs(uint32_t opcode);
+extern void altivec_vsubuhs(uint32_t opcode);
+extern void altivec_mtvscr(uint32_t opcode);
+extern void altivec_vsum4shs(uint32_t opcode);
+extern void altivec_vsubuws(uint32_t opcode);
+extern void altivec_vsum2sws(uint32_t opcode);
+extern void altivec_vsubsbs(uint32_t opcode);
+extern void altivec_vsum4sbs(uint32_t opcode);
+extern void altivec_vsubshs(uint32_t opcode);
+extern void altivec_vsubsws(uint32_t opcode);
+extern void altivec_vsumsws(uint32_t opcode);
+}    // namespace dppc_interpreter
+#endif
 
 // 64-bit instructions
 
@@ -773,6 +970,9 @@ extern bool toggle_g_realtime();
 /* set_g_idle_cpu_save */
 extern void set_g_idle_cpu_save(bool enabled);
 
+/* set_busy_wait_skip: fast-forward virtual time in timer busy-wait loops */
+extern void set_busy_wait_skip(bool enabled);
+
 /* mark_host_input: the host event poller calls this for every input event */
 extern void mark_host_input();
 
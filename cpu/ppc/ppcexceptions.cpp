@@ -25,6 +25,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <loguru.hpp>
 #include "ppcemu.h"
 #include "ppcmmu.h"
+#include <utils/stats.h>
 
 #include <setjmp.h>
 #include <stdexcept>
@@ -34,6 +35,8 @@ jmp_buf exc_env; /* Global exception environment. */
 
 #if !defined(PPC_TESTS) && !defined(PPC_BENCHMARKS)
 void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
+    stat_inc(STAT_EXCEPTIONS + (static_cast<uint32_t>(exception_type) % STAT_NUM_EXC_TYPES));
+
 #ifdef CPU_PROFILING
     exceptions_processed++;
 #endif
@@ -113,14 +116,26 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
         ppc_next_instruction_address = 0x0D00;
         break;
 
+    case Except_Type::EXC_VEC_UNAVAIL:
+        ppc_state.spr[SPR::SRR0]     = ppc_state.pc & 0xFFFFFFFC;
+        ppc_next_instruction_address = 0x0F20;
+        break;
+
     default:
         ABORT_F("Unknown exception occurred: %X\n", (unsigned)exception_type);
         break;
     }
 
+#ifdef DPPC_ALTIVEC
+    // the 74xx saves MSR[VEC] in SRR1 and disables AltiVec on entry
+    ppc_state.spr[SPR::SRR1] = (ppc_state.msr & (0x0000FF73 | MSR::VEC)) | srr1_bits;
+    uint32_t old_msr_val = ppc_state.msr;
+    uint32_t new_msr_val = old_msr_val & 0xFFFB1041 & ~MSR::VEC;
+#else
     ppc_state.spr[SPR::SRR1] = (ppc_state.msr & 0x0000FF73) | srr1_bits;
     uint32_t old_msr_val = ppc_state.msr;
     uint32_t new_msr_val = old_msr_val & 0xFFFB1041;
+#endif
     /* copy MSR[ILE] to MSR[LE] */
     if (!is_601) {
         new_msr_val = (new_msr_val & ~MSR::LE) | !!(new_msr_val & MSR::ILE);
@@ -215,6 +230,10 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
     case Except_Type::EXC_TRACE:
         exc_descriptor = "Trace exception occurred";
         break;
+
+    case Except_Type::EXC_VEC_UNAVAIL:
+        exc_descriptor = "AltiVec unavailable exception occurred";
+        break;
     }
 
     throw std::invalid_argument(exc_descriptor);
@@ -21,10 +21,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <core/timermanager.h>
 #include <loguru.hpp>
+#include "ppcbreakpoints.h"
 #include "ppcemu.h"
 #include "ppcmmu.h"
 #include "ppcdisasm.h"
+#include "ppctrace.h"
 #include <debugger/symbols.h>
+#include <utils/stats.h>
 
 #include <algorithm>
 #include <atomic>
@@ -425,135 +428,319 @@ void set_virt_time_ns(uint64_t time_now)
 }
 
 // Idle detection for realtime mode. The guest never halts (no PPC
-// equivalent of x86 HLT), so at the desktop it keeps executing its idle
-// path forever, burning a whole host core. We cannot simply sleep
-// whenever the guest is quiet for a moment: stalling guest execution
-// while wall time (and thus every time-based device, timer and driver
-// timeout) keeps advancing derails the guest if it is still doing
-// critical boot work. The distinguishing signal we use is the guest's
-// memory-mapped I/O rate: boot and real work touch devices constantly
-// (hundreds of thousands of accesses per second), while a settled idle
-// desktop touches them at a steady few thousand per second. The rate is
-// low-pass filtered (a burst of accesses an interrupt handler performs
-// in a few microseconds would otherwise look like activity), and only
-// once the filtered rate has stayed low continuously for
-// IDLE_CONFIRM_NS do we throttle.
+// equivalent of x86 HLT unless it uses MSR[POW], which Mac OS rarely does),
+// so at the desktop it keeps executing its idle loop forever, burning a
+// whole host core. Instead of guessing idleness from how busy the guest
+// looks, we recognize the idle loop itself: whenever timers are processed,
+// the code around the current PC is checked for a short backward loop that
+// only polls memory or waits for an interrupt (see is_idle_loop_insn). Such
+// a loop cannot make any progress before the next timer fires, because
+// only a timer (or the interrupt it raises) changes what the loop waits
+// for. The host thread then sleeps until the next timer deadline right
+// away. This covers the Mac OS idle spin (mfmsr/mtmsr with MSR[EE] set,
+// waiting for the decrementer) and polls of a flag in RAM set by an
+// interrupt handler.
 //
-// The first confirmation must be long enough that it cannot be
-// satisfied during boot at all; a boot that takes tens of seconds never
-// yields that much uninterrupted low-rate time. Once the guest has been
-// throttled once it has provably reached its idle state, so afterwards we
-// only ever disengage for sustained work (see guest_is_idle).
-// The confirm and uptime gates were 15 s each, which delayed throttling
-// by ~30 s after the guest actually settled; 6 s / 8 s still skip the
-// brief quiet spells a boot can have while engaging noticeably sooner.
-static constexpr uint64_t IDLE_RATE_EMA_TAU_NS      = 1000000000ULL;   // 1 s
-static constexpr uint64_t IDLE_CONFIRM_RATE         = 30000;           // MMIO accesses per second
-static constexpr uint64_t IDLE_CONFIRM_NS           = 6000000000ULL;   // 6 s, first time
-static constexpr uint64_t IDLE_DISENGAGE_NS         = 1000000000ULL;   // 1 s of sustained high rate
-// Minimum uptime before the throttle may engage at all, so a guest that
-// is still in the middle of booting is never throttled; the confirm
-// timer guards against throttling during any later settling work.
-static constexpr uint64_t IDLE_UPTIME_GUARD_NS      = 8000000000ULL;   // 8 s
-// Upper bound for a single throttle sleep. The sleep normally ends at the
-// next timer deadline, but is capped here so the guest's periodic timers
-// (VBL, decrementer) are never deferred by more than one VBL period; the
-// realtime timer thread polls no faster than this while the throttle is
-// active for the same reason.
+// Loops that read the time base, the decrementer or any device register
+// are busy-waits for a specific time or event and are deliberately not
+// treated as idle: a device register such as the VIA timer counter may
+// change without a timer firing, and sleeping until the next timer would
+// overshoot short delays by up to IDLE_MAX_SLEEP_NS.
+static constexpr unsigned IDLE_LOOP_MAX_INSNS       = 16;
+// Upper bound for a single idle sleep. The sleep normally ends at the next
+// timer deadline; the cap keeps host input and audio latency bounded when
+// the guest has no timer armed for a long time.
 static constexpr uint64_t IDLE_MAX_SLEEP_NS         = 16000000ULL;     // 16 ms
-// While the user is interacting, the throttle must not sleep: the guest
-// services host input (mouse, keyboard, gamepad) and the MMIO that input
-// generates is far below IDLE_CONFIRM_RATE, so without this the throttle
-// would never disengage for interaction and the guest would stay
-// sluggish. mark_host_input() is called by the event poller for every
-// input event; guest_is_idle() refuses to sleep until this long after the
-// last one.
+// Minimum time the guest executes after an idle sleep before the next one.
+// A polling loop whose device register changes on every read can still be
+// mistaken for an idle loop; this guarantees it enough execution to finish.
+static constexpr uint64_t IDLE_MIN_RUN_NS           = 1000000ULL;      // 1 ms
+// While the user is interacting, the guest must not be put to sleep so
+// that it services host input (mouse, keyboard, gamepad) at full speed.
+// mark_host_input() is called by the event poller for every input event;
+// guest_is_idle() refuses to sleep until this long after the last one.
 static constexpr uint64_t IDLE_HOST_INPUT_WAKE_NS   = 300000000ULL;    // 300 ms
-// The detector state is only ever touched by the emulation thread (from
-// guest_is_idle and reset_idle_detector), so it needs no synchronization;
-// the realtime timer thread only reads g_idle_throttle_active below.
-static uint64_t g_idle_last_ns       = 0;
-static uint64_t g_idle_last_mmio     = 0;
-static uint64_t g_mmio_count_ema     = 0; // converges to rate * IDLE_RATE_EMA_TAU_NS
-static uint64_t g_idle_low_ns        = 0; // continuous time with a low filtered rate
-static uint64_t g_idle_high_ns       = 0; // continuous time with a high filtered rate
-static uint64_t g_idle_boot_start_ns = 0;
-static bool     g_idle_engaged       = false;
-// Last guest-time an input event was delivered to the guest. Only
-// written by the event poller and read by guest_is_idle, both on the
-// emulation thread; see IDLE_HOST_INPUT_WAKE_NS.
+// The detector state is only ever touched by the emulation thread, so it
+// needs no synchronization.
+static uint64_t g_idle_wake_ns       = 0; // guest-time the last idle sleep ended
+// Last guest-time an input event was delivered to the guest; see
+// IDLE_HOST_INPUT_WAKE_NS.
 static uint64_t g_last_host_input_ns = 0;
-// True from just before the idle throttle starts its deadline-bounded sleep
-// until the end of the servicing burst that follows it. The sleep is exactly
-// as long as to the next timer deadline, so the throttle fires the due
-// timers itself on wakeup; the realtime timer thread must not raise
-// exec_timer while the throttle is active or it races the idle decision
-// (guest_is_idle bails on exec_timer) and forces a full-speed slice instead
-// of the sleep, and it must not cut the burst short or the guest is starved
-// of the execution it needs to service its devices (the throttle then flaps
-// between sleep and full-speed catch-up, costing more host CPU than the
-// sleep/burst duty cycle alone).
-static std::atomic<bool> g_idle_throttle_active = false;
 
 static void reset_idle_detector()
 {
-    // Called from ppc_cpu_init, i.e. on every boot (including guest
-    // restarts): start over with the long first confirmation and a
-    // fresh uptime gate so a rebooting guest is never throttled during
-    // its boot phase.
-    g_idle_last_ns = 0;
-    g_idle_last_mmio = 0;
-    g_mmio_count_ema = 0;
-    g_idle_low_ns = 0;
-    g_idle_high_ns = 0;
-    g_idle_boot_start_ns = get_virt_time_ns();
-    g_idle_engaged = false;
-    g_idle_throttle_active.store(false);
+    g_idle_wake_ns = 0;
 }
 
-static bool guest_is_idle()
+// Check whether an instruction may appear in an idle loop. Allowed are
+// loads, compares, logical operations, address computations and MSR
+// accesses. Anything that stores, counts or calls something disqualifies
+// the loop since it may then make progress on its own.
+static bool is_idle_loop_insn(uint32_t opcode)
 {
-    const uint64_t now_ns = get_virt_time_ns();
-    const uint64_t elapsed_ns = now_ns - g_idle_last_ns;
-    g_idle_last_ns = now_ns;
-
-    const uint64_t mmio_count = g_mmio_access_count;
-    const uint64_t mmio_delta = mmio_count - g_idle_last_mmio;
-    g_idle_last_mmio = mmio_count;
-
-    if (elapsed_ns > 0) {
-        // Exponential-decay accumulator on the MMIO count. Each window
-        // adds its accesses and the total decays by exp(-elapsed/tau);
-        // it converges to rate * tau regardless of how often this is
-        // called, unlike an additive EMA which tracks the per-window
-        // count when windows are much shorter than tau. Rate is then
-        // count / tau.
-        uint64_t decayed;
-        if (elapsed_ns >= IDLE_RATE_EMA_TAU_NS) {
-            decayed = 0;
-        } else {
-            decayed = g_mmio_count_ema * (IDLE_RATE_EMA_TAU_NS - elapsed_ns) / IDLE_RATE_EMA_TAU_NS;
+    switch (opcode >> 26) {
+    case 10: // cmpli
+    case 11: // cmpi
+    case 21: // rlwinm
+    case 24: // ori
+    case 28: // andi.
+    case 29: // andis.
+    case 32: // lwz
+    case 34: // lbz
+    case 40: // lhz
+    case 42: // lha
+        return true;
+    case 14: // addi
+    case 15: // addis
+        // forming an address is fine, incrementing a counter is not
+        return ((opcode >> 21) & 0x1F) != ((opcode >> 16) & 0x1F);
+    case 16: // bc exiting the loop: relative, not linking, not counting
+        return ((opcode >> 21) & 4) && !(opcode & 3);
+    case 19:
+        return ((opcode >> 1) & 0x3FF) == 150; // isync
+    case 31:
+        switch ((opcode >> 1) & 0x3FF) {
+        case 0:   // cmp
+        case 23:  // lwzx
+        case 28:  // and
+        case 32:  // cmpl
+        case 83:  // mfmsr
+        case 87:  // lbzx
+        case 146: // mtmsr
+        case 279: // lhzx
+        case 444: // or
+        case 598: // sync
+        case 854: // eieio
+            return true;
         }
-        g_mmio_count_ema = decayed + mmio_delta;
+        return false;
+    default:
+        return false;
+    }
+}
 
-        const uint64_t rate = g_mmio_count_ema * 1000000000ULL / IDLE_RATE_EMA_TAU_NS;
-        if (rate < IDLE_CONFIRM_RATE) {
-            g_idle_high_ns = 0;
-            g_idle_low_ns += elapsed_ns;
-        } else {
-            g_idle_low_ns = 0;
-            g_idle_high_ns += elapsed_ns;
+// Check whether an idle loop instruction loads from a device register.
+// The effective address is computed from the current register contents,
+// which hold the values of the previous iteration when the loop is
+// checked. Loads that can't be translated count as device loads.
+static bool is_mmio_load(uint32_t opcode)
+{
+    uint32_t reg_a = (opcode >> 16) & 0x1F;
+    uint32_t ea    = reg_a ? ppc_state.gpr[reg_a] : 0;
+
+    switch (opcode >> 26) {
+    case 32: // lwz
+    case 34: // lbz
+    case 40: // lhz
+    case 42: // lha
+        ea += int16_t(opcode & 0xFFFF);
+        break;
+    case 31:
+        switch ((opcode >> 1) & 0x3FF) {
+        case 23:  // lwzx
+        case 87:  // lbzx
+        case 279: // lhzx
+            ea += ppc_state.gpr[(opcode >> 11) & 0x1F];
+            break;
+        default:
+            return false;
         }
+        break;
+    default:
+        return false;
     }
 
-    // The user just interacted: wake up and process the input at full
-    // speed instead of in short throttle bursts. The wake window is
-    // refreshed by every input event, so it stays disengaged for the
-    // whole interaction and re-throttles shortly after the user stops.
-    if (now_ns < g_last_host_input_ns + IDLE_HOST_INPUT_WAKE_NS) {
+    uint32_t phys_addr;
+    if (!mmu_translate_dbg(ea, phys_addr))
+        return true;
+    AddressMapEntry* entry = mem_ctrl_instance->find_range(phys_addr);
+    return !entry || (entry->type & RT_MMIO);
+}
+
+static bool is_idle_loop_body_insn(uint32_t opcode)
+{
+    return is_idle_loop_insn(opcode) && !is_mmio_load(opcode);
+}
+
+// Check whether the instruction at pc is part of an idle loop: a backward
+// branch closing a loop of at most IDLE_LOOP_MAX_INSNS instructions within
+// the page of pc, made only of instructions accepted by is_idle_loop_insn
+// that don't load from a device register.
+static bool in_idle_loop(uint32_t pc, const uint8_t* pc_real)
+{
+    if (!pc_real || (ppc_state.msr & MSR::LE))
         return false;
+
+    const uint32_t pc_offs = pc & ~PPC_PAGE_MASK;
+
+    for (uint32_t i = 0; i < IDLE_LOOP_MAX_INSNS && pc_offs + i * 4 < PPC_PAGE_SIZE; i++) {
+        uint32_t opcode  = ppc_read_instruction(pc_real + i * 4);
+        uint32_t primary = opcode >> 26;
+        int32_t  disp;
+
+        if (primary != 16 && primary != 18) {
+            if (!is_idle_loop_body_insn(opcode))
+                return false;
+            continue;
+        }
+        if (opcode & 3)
+            return false; // absolute or linking branch
+        if (primary == 16 && !((opcode >> 21) & 4))
+            return false; // counting loop
+
+        if (primary == 18)
+            disp = int32_t(opcode << 6) >> 6;
+        else
+            disp = int16_t(opcode & 0xFFFC);
+
+        if (disp > 0) {
+            if (primary == 18)
+                return false; // jumping out of the loop
+            continue;         // exiting the loop
+        }
+
+        // found the closing backward branch; check the start of the loop
+        int32_t start_offs = int32_t(pc_offs + i * 4) + disp;
+        if (start_offs < 0 || start_offs > int32_t(pc_offs) ||
+            uint32_t(-disp / 4) >= IDLE_LOOP_MAX_INSNS)
+            return false;
+        for (int32_t offs = start_offs; offs < int32_t(pc_offs); offs += 4) {
+            if (!is_idle_loop_body_insn(ppc_read_instruction(pc_real + offs - pc_offs)))
+                return false;
+        }
+        return true;
     }
 
+    return false;
+}
+
+// Busy-wait fast-forward for virtual time. Delay loops (the Delay trap,
+// SCSI bus settle waits, ...) spin reading the time base, the decrementer
+// or a VIA timer until a deadline passes, which costs full interpreter work
+// for every iteration. When a taken backward branch closes a short loop
+// that polled a timer source (see timer_polled) and otherwise consists only
+// of instructions accepted by is_busy_wait_insn, virtual time is moved
+// forward instead of spinning. Nothing but time can change what the loop
+// reads until the next timer deadline, so skipping is capped at that
+// deadline. The loop exit isn't computed: each skip is a fraction of the
+// time the loop has already waited, which bounds the overshoot of the
+// guest's deadline to that fraction while reaching any deadline within
+// a few dozen iterations.
+static constexpr unsigned BUSY_WAIT_MAX_INSNS = 16;
+// Shortest skip, used while a loop has only just started waiting.
+static constexpr FixedNanoseconds BUSY_WAIT_MIN_SKIP = 256ULL << VIRT_TIME_FRAC_BITS;
+// Each skip is 1/8 of the time waited so far, i.e. at most 12.5% overshoot.
+static constexpr int BUSY_WAIT_SKIP_SHIFT = 3;
+
+bool timer_polled = false;
+static bool g_busy_wait_skip = true;
+static uint32_t g_busy_wait_pc;              // closing branch of the loop
+static FixedNanoseconds g_busy_wait_start;   // virtual time the loop started
+static FixedNanoseconds g_busy_wait_last;    // virtual time of the last skip
+
+void set_busy_wait_skip(bool enabled)
+{
+    g_busy_wait_skip = enabled;
+}
+
+// Instructions allowed in a busy-wait loop: those of an idle loop, timer
+// reads and arithmetic computing the elapsed time into a new register.
+static bool is_busy_wait_insn(uint32_t opcode)
+{
+    if (is_idle_loop_insn(opcode))
+        return true;
+    if ((opcode >> 26) != 31)
+        return false;
+
+    uint32_t reg_d = (opcode >> 21) & 0x1F;
+    uint32_t reg_a = (opcode >> 16) & 0x1F;
+    uint32_t reg_b = (opcode >> 11) & 0x1F;
+
+    switch ((opcode >> 1) & 0x3FF) {
+    case 8:   // subfc
+    case 10:  // addc
+    case 40:  // subf
+    case 136: // subfe
+    case 138: // adde
+    case 266: // add
+        // accumulating into an operand would count iterations
+        return reg_d != reg_a && reg_d != reg_b;
+    case 339: // mfspr
+    case 371: // mftb
+        switch ((reg_b << 5) | reg_a) {
+        case SPR::RTCU_U:
+        case SPR::RTCL_U:
+        case SPR::DEC_U:
+        case SPR::RTCU_S:
+        case SPR::RTCL_S:
+        case SPR::DEC_S:
+        case SPR::TBL_U:
+        case SPR::TBU_U:
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+// Check whether the taken branch at branch_pc (host address pc_real)
+// closes a busy-wait loop starting at target.
+static bool is_busy_wait_loop(uint32_t branch_pc, uint32_t target, const uint8_t* pc_real)
+{
+    if (target >= branch_pc || branch_pc - target >= BUSY_WAIT_MAX_INSNS * 4 ||
+        (target & PPC_PAGE_MASK) != (branch_pc & PPC_PAGE_MASK) || (ppc_state.msr & MSR::LE))
+        return false;
+
+    uint32_t opcode  = ppc_read_instruction(pc_real);
+    uint32_t primary = opcode >> 26;
+    if ((primary != 16 && primary != 18) || (opcode & 3))
+        return false; // not a relative branch or linking
+    if (primary == 16 && !((opcode >> 21) & 4))
+        return false; // counting loop
+
+    for (uint32_t addr = target; addr < branch_pc; addr += 4) {
+        if (!is_busy_wait_insn(ppc_read_instruction(pc_real - (branch_pc - addr))))
+            return false;
+    }
+    return true;
+}
+
+// Called for a taken branch after a timer source has been read.
+// Returns the new virtual time.
+static FixedNanoseconds busy_wait_skip(const uint8_t* pc_real, FixedNanoseconds virt_time,
+                                       FixedNanoseconds event_deadline,
+                                       FixedNanoseconds instruction_period)
+{
+    if (!is_busy_wait_loop(ppc_state.pc, ppc_next_instruction_address, pc_real)) {
+        g_busy_wait_pc = 0;
+        return virt_time;
+    }
+
+    // a new loop, or the same loop entered again
+    if (ppc_state.pc != g_busy_wait_pc ||
+        virt_time - g_busy_wait_last > BUSY_WAIT_MAX_INSNS * instruction_period) {
+        g_busy_wait_pc    = ppc_state.pc;
+        g_busy_wait_start = virt_time;
+    }
+
+    FixedNanoseconds skip = std::max(BUSY_WAIT_MIN_SKIP,
+        (virt_time - g_busy_wait_start) >> BUSY_WAIT_SKIP_SHIFT);
+    if (event_deadline <= virt_time)
+        skip = 0;
+    else if (skip > event_deadline - virt_time)
+        skip = event_deadline - virt_time;
+
+    if (skip) {
+        stat_inc(STAT_BUSY_WAIT_SKIPS);
+        stat_inc(STAT_BUSY_WAIT_SKIPPED_NS, skip >> VIRT_TIME_FRAC_BITS);
+    }
+    g_busy_wait_last = virt_time + skip;
+    return g_busy_wait_last;
+}
+
+static bool guest_is_idle(const uint8_t* pc_real)
+{
     // The guest has real work to do: an exception to take, an interrupt
     // asserted that it cannot take yet (MSR.EE off), or a device that
     // requested immediate processing. Do not sleep in these cases.
@@ -561,64 +748,46 @@ static bool guest_is_idle()
         return false;
     }
 
-    // Never throttle before the guest has had a chance to boot.
-    if (now_ns - g_idle_boot_start_ns < IDLE_UPTIME_GUARD_NS) {
-        return false;
+    // The guest put the processor to sleep (MSR[POW]).
+    if (exec_flags & EXEF_SLEEP) {
+        return true;
     }
 
-    // The first throttle only happens after IDLE_CONFIRM_NS of
-    // continuous low rate. Afterwards the throttle stays on through
-    // brief activity (input, a momentary burst) - the guest services it
-    // during the bursts - and only yields to sustained work: once the
-    // rate has been high for IDLE_DISENGAGE_NS it runs at full speed
-    // until the rate drops again, then throttling resumes immediately.
-    // This avoids the flapping where any short spike above the
-    // threshold disengages the throttle for seconds at a time, which
-    // showed up as the CPU jumping back to 99% at the settled desktop.
-    if (g_idle_engaged) {
-        return g_idle_high_ns < IDLE_DISENGAGE_NS;
+    const uint64_t now_ns = get_virt_time_ns();
+
+    // The user just interacted: process the input at full speed. The wake
+    // window is refreshed by every input event, so it stays awake for the
+    // whole interaction.
+    if (now_ns < g_last_host_input_ns + IDLE_HOST_INPUT_WAKE_NS) {
+        return false;
     }
 
-    if (g_idle_low_ns >= IDLE_CONFIRM_NS) {
-        g_idle_engaged = true;
-        return true;
+    if (now_ns < g_idle_wake_ns + IDLE_MIN_RUN_NS) {
+        return false;
     }
-    return false;
+
+    return in_idle_loop(ppc_state.pc, pc_real);
 }
 
-static void process_events_real()
+static void process_events_real(const uint8_t* pc_real)
 {
     exec_timer.store(false);
     uint64_t next_ns = TimerManager::get_instance()->process_timers();
-    if (g_idle_cpu_save.load(std::memory_order_relaxed) && guest_is_idle()) {
-        // The guest is idling: sleep until the next scheduled event
-        // instead of executing its idle path. Guest time is wall-clock
-        // based in realtime mode, so the sleep advances guest time and
-        // the guest's timers (VBL, decrementer, ...) keep firing on
-        // schedule. We still run a short burst afterwards so the guest
-        // services those interrupts and keeps its devices polled.
-        // Only sleep if a timer is actually pending; otherwise the
-        // guest has no interrupt to wake it and the host must keep
-        // executing.
-        if (next_ns != 0) {
-            // The burst must be long enough for the guest to fully
-            // service its pending interrupts (VBL, DEC, device polls)
-            // and return to its idle loop. Shorter bursts (1-4 ms)
-            // starve that servicing: guest time keeps advancing while
-            // the guest executes too little, so it ends up stuck in a
-            // machine-check storm at the external-interrupt vector.
-            // 6 ms per 16 ms window keeps Mac OS X DP3 healthy at ~7%
-            // host CPU.
-            uint64_t time_now = TimerManager::get_instance()->current_time_ns();
-            int64_t slice_ns = next_ns - time_now;
-            const int64_t sleep_ns = std::min((int64_t)IDLE_MAX_SLEEP_NS, slice_ns);
-            g_idle_throttle_active.store(true, std::memory_order_relaxed);
-            if (sleep_ns > 0)
-                std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
-            return;
+    // Sleep until the next scheduled event instead of executing the idle
+    // loop. Guest time is wall-clock based in realtime mode, so the sleep
+    // advances guest time and the guest's timers (VBL, decrementer, ...)
+    // keep firing on schedule: the realtime timer thread raises exec_timer
+    // at the deadline and we get back here to fire the due timers. Only
+    // sleep if a timer is actually pending; otherwise the guest has no
+    // interrupt to wake it and the host must keep executing.
+    if (next_ns != 0 && g_idle_cpu_save.load(std::memory_order_relaxed) && guest_is_idle(pc_real)) {
+        uint64_t time_now = TimerManager::get_instance()->current_time_ns();
+        if (next_ns > time_now) {
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds(std::min(IDLE_MAX_SLEEP_NS, next_ns - time_now)));
+            g_idle_wake_ns = get_virt_time_ns();
         }
     }
-    g_idle_throttle_active.store(false, std::memory_order_relaxed);
 }
 
 static uint64_t process_events()
@@ -637,13 +806,8 @@ static uint64_t process_events()
 
 static void force_cycle_counter_reload()
 {
-    // Tell the interpreter loop to reload the cycle counter. While the idle
-    // throttle is in its sleep/burst cycle the burst must run to its budget
-    // (that servicing is why the guest is awake at all), so do not cut it
-    // short with an early wakeup: process_events runs at the end of the
-    // burst and picks the new timer up anyway.
-    if (!g_idle_throttle_active.load(std::memory_order_relaxed))
-        exec_timer.store(true);
+    // tell the interpreter loop to reload the cycle counter
+    exec_timer.store(true);
 }
 
 uint64_t increment_instruction_period()
@@ -687,17 +851,6 @@ static void realtime_timer_thread_fn()
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
-        if (g_idle_throttle_active.load(std::memory_order_relaxed)) {
-            // The idle throttle is in its sleep/burst cycle and fires the
-            // due timers itself (the sleep is bounded by the next timer
-            // deadline, the burst by its 6 ms budget); raising exec_timer
-            // here would race its idle decision and force full-speed
-            // slices. The throttle wakes at least every IDLE_MAX_SLEEP_NS,
-            // so poll no faster than that instead of adding a wakeup storm
-            // on top of the throttled cycle.
-            std::this_thread::sleep_for(std::chrono::nanoseconds(IDLE_MAX_SLEEP_NS));
-            continue;
-        }
         const uint64_t deadline_ns = timer_manager->get_next_timeout_ns();
         if (deadline_ns == 0) {
             // No timer pending: nothing to schedule, the interpreter loop
@@ -762,7 +915,7 @@ void mark_host_input()
 {
     // Called by the host event poller (emulation thread) for every mouse,
     // keyboard and gamepad event delivered to the guest; guest_is_idle
-    // uses this to keep the throttle awake while the user interacts.
+    // uses this to keep the guest awake while the user interacts.
     // Recorded in guest time (get_virt_time_ns) so guest_is_idle can
     // compare it against its already-computed now_ns without a second
     // clock read; guest time only differs from the wall clock by the
@@ -770,10 +923,128 @@ void mark_host_input()
     g_last_host_input_ns = get_virt_time_ns();
 }
 
+// Block chaining. Every execution block that ends with a jump to another
+// page remembers the host address of the target page, indexed by the
+// address of the exiting instruction. The next time the same instruction
+// jumps to the same page the ITLB lookup is skipped, provided that the
+// ITLB hasn't changed since (see g_itlb_generation in ppcmmu.cpp).
+typedef struct BlockChainEntry {
+    uint32_t    va_page;    // guest page of the jump target
+    uint32_t    generation; // ITLB generation the entry was created in
+    uint8_t*    host_page;  // host address of the target page
+#ifdef LOG_INSTRUCTIONS
+    uint32_t    pa_page;    // physical address of the target page
+#endif
+} BlockChainEntry;
+
+static constexpr uint32_t BLOCK_CHAIN_SIZE = 1024;
+static BlockChainEntry block_chain[BLOCK_CHAIN_SIZE];
+
+static inline uint8_t* block_chain_translate(uint32_t exit_addr, uint32_t target_addr)
+{
+    BlockChainEntry* entry = &block_chain[(exit_addr >> 2) & (BLOCK_CHAIN_SIZE - 1)];
+    const uint32_t target_page = target_addr & PPC_PAGE_MASK;
+
+    if (entry->va_page == target_page && entry->generation == g_itlb_generation) {
+#ifdef LOG_INSTRUCTIONS
+        pcp = entry->pa_page | (target_addr & ~PPC_PAGE_MASK);
+#endif
+        return entry->host_page + (target_addr & ~PPC_PAGE_MASK);
+    }
+
+    uint8_t* host_va = mmu_translate_imem(target_addr ATPCP); // &pcp
+
+    // don't remember fetches from unmapped memory, they stop the machine
+    if (power_on) {
+        entry->va_page    = target_page;
+        entry->generation = g_itlb_generation;
+        entry->host_page  = host_va - (target_addr & ~PPC_PAGE_MASK);
+#ifdef LOG_INSTRUCTIONS
+        entry->pa_page    = pcp & PPC_PAGE_MASK;
+#endif
+    }
+
+    return host_va;
+}
+
+// Instruction fusion. Compilers emit a few pairs of simple integer
+// instructions so often that executing them as a unit can save a share
+// of the dispatch overhead: lis/addis + ori/addi build 32-bit constants
+// and addresses, rlwinm + cmpwi/cmplwi test bit fields before a branch.
+// Neither instruction of a fused pair can raise an exception nor change the
+// control flow so the architectural state after the pair is the same as after
+// executing them one by one.
+// Fusion is enabled with -DPPC_INSTRUCTION_FUSION. It is off by default
+// because the extra check for every instruction ate up the savings on the
+// hosts it was measured on (benchmark/bench1.cpp and bench2.cpp).
+#if defined(PPC_INSTRUCTION_FUSION) && (defined(LOG_INSTRUCTIONS) || defined(LOG__doprnt))
+#undef PPC_INSTRUCTION_FUSION
+#endif
+
+// primary opcodes of the first instruction of a fused pair: addis and rlwinm
+static constexpr uint64_t FUSION_FIRST_OPCODES = (1ULL << 15) | (1ULL << 21);
+
+static inline uint32_t fusion_rot_mask(unsigned rot_mb, unsigned rot_me) {
+    uint32_t m1 = 0xFFFFFFFFUL >> rot_mb;
+    uint32_t m2 = uint32_t(0xFFFFFFFFUL << (31 - rot_me));
+    return ((rot_mb <= rot_me) ? m2 & m1 : m1 | m2);
+}
+
+// Execute two adjacent instructions at once if they form one of the idioms
+// above. Return false without touching any state if they don't.
+static inline bool ppc_exec_fused(uint32_t first, uint32_t second)
+{
+    uint32_t reg_s = (first >> 21) & 0x1F;
+    uint32_t reg_a = (first >> 16) & 0x1F;
+    uint32_t result;
+
+    if ((first >> 26) == 15) {
+        // addis rD,rA,SIMM followed by ori rD,rD,UIMM or addi rD,rD,SIMM
+        if (((second >> 16) & 0x3FF) != ((reg_s << 5) | reg_s))
+            return false;
+        result = (reg_a ? ppc_state.gpr[reg_a] : 0) + (first << 16);
+        if ((second >> 26) == 24)
+            result |= uint16_t(second);
+        else if ((second >> 26) == 14 && reg_s)
+            result += int32_t(int16_t(second));
+        else
+            return false;
+        ppc_state.gpr[reg_s] = result;
+    } else {
+        // rlwinm rA,rS,SH,MB,ME followed by cmpwi/cmplwi crfD,rA,IMM
+        if ((first & 1) || (second & 0xF8600000UL) != 0x28000000UL ||
+            ((second >> 16) & 0x1F) != reg_a)
+            return false;
+        result = ROTL_32(ppc_state.gpr[reg_s], (first >> 11) & 0x1F) &
+            fusion_rot_mask((first >> 6) & 0x1F, (first >> 1) & 0x1F);
+        ppc_state.gpr[reg_a] = result;
+
+        uint32_t crf_d  = (second >> 21) & 0x1C;
+        uint32_t xercon = (ppc_state.spr[SPR::XER] & XER::SO) >> 3;
+        uint32_t cmp_c;
+        if (second & 0x04000000UL) {
+            int32_t simm = int16_t(second);
+            cmp_c = (int32_t(result) == simm) ? 0x20000000UL :
+                (int32_t(result) > simm) ? 0x40000000UL : 0x80000000UL;
+        } else {
+            uint32_t uimm = uint16_t(second);
+            cmp_c = (result == uimm) ? 0x20000000UL :
+                (result > uimm) ? 0x40000000UL : 0x80000000UL;
+        }
+        ppc_state.cr = ((ppc_state.cr & ~(0xf0000000UL >> crf_d)) | ((cmp_c + xercon) >> crf_d));
+    }
+
+#ifdef CPU_PROFILING
+    num_executed_instrs += 2;
+#endif
+    return true;
+}
+
 typedef enum {
     main,
     until,
     debug,
+    trace, // same as main but records every instruction into g_trace
 } ppc_exec_type_t;
 
 typedef enum {
@@ -799,6 +1070,8 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
     uint32_t opcode;
     PPCOpcode* opcode_grabber = ppc_opcode_grabber;
     uint8_t* pc_real;
+    // physical page of the last traced instruction
+    uint32_t trace_va_page = 1, trace_pa_page = 0;
 
     while (power_on) {
         if constexpr (exec_type == debug)
@@ -812,20 +1085,59 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
             eb_end = (eb_start & PPC_PAGE_MASK) + PPC_PAGE_SIZE - 1;
             exec_flags = 0;
             pc_real    = mmu_translate_imem(eb_start ATPCP); // &pcp
+            if (g_exec_bp_count) [[unlikely]] {
+                uint32_t phys_addr;
+                mmu_translate_imem(eb_start, &phys_addr);
+                if (bp_exec_page(phys_addr)) {
+                    if (bp_exec_hit(phys_addr, eb_start)) {
+                        power_off(po_enter_debugger);
+                        break;
+                    }
+                    // single-instruction blocks while on a page with breakpoints
+                    eb_end = 0;
+                }
+            }
         }
 
         opcode = ppc_read_instruction(pc_real);
+        if constexpr (exec_type == trace) {
+            if ((ppc_state.pc & PPC_PAGE_MASK) != trace_va_page) {
+                mmu_translate_imem(ppc_state.pc, &trace_pa_page);
+                trace_pa_page &= PPC_PAGE_MASK;
+                trace_va_page  = ppc_state.pc & PPC_PAGE_MASK;
+            }
+            TraceRec* rec = &g_trace.ring[g_trace.count++ & g_trace.mask];
+            rec->addr  = ppc_state.pc;
+            rec->paddr = trace_pa_page | (ppc_state.pc & ~PPC_PAGE_MASK);
+            rec->ins   = opcode;
+            rec->msr   = ppc_state.msr;
+        }
+#ifdef PPC_INSTRUCTION_FUSION
+        // both instructions of a fused pair must be on the same page and
+        // the second one mustn't be the stop address of ppc_exec_until.
+        // Pages with breakpoints run in single-instruction blocks (eb_end = 0)
+        // so that every instruction goes through bp_exec_hit(), don't fuse
+        // there either.
+        if (exec_type != debug && exec_type != trace && endian == big_end &&
+            ((FUSION_FIRST_OPCODES >> (opcode >> 26)) & 1) &&
+            eb_end && (ppc_state.pc & 0xFFC) != 0xFFC &&
+            (exec_type == main || ppc_state.pc + 4 != start_addr) &&
+            ppc_exec_fused(opcode, ppc_read_instruction(pc_real + 4))) {
+            ppc_state.pc += 4;
+            INCPC(4);
+            if constexpr (time_type == virt)
+                virt_time += instruction_period;
+        } else
+#endif
         ppc_main_opcode(opcode_grabber, opcode);
+        if constexpr (exec_type == trace) {
+            if (g_trace.gprs)
+                trace_gpr_deltas();
+        }
         // In realtime mode guest time is the wall clock, so there is no
-        // per-instruction time to advance; the instruction budget only
-        // bounds the idle burst so a fast host cannot over-run it. The
-        // burst is never cut short because neither exec_timer writer (the
-        // realtime timer thread and force_cycle_counter_reload) raises it
-        // while the throttle is active; the throttle fires due timers
-        // itself on wakeup. In non-realtime mode the throttle is never
-        // active, so this single condition reduces to plain exec_timer
-        // handling and avoids an atomic load and branch on every
-        // instruction.
+        // per-instruction time to advance; due timers are signalled by
+        // exec_timer, raised by the realtime timer thread and by
+        // force_cycle_counter_reload.
         if constexpr (time_type == virt) {
             virt_time += instruction_period;
             g_virt_time = virt_time;
@@ -837,11 +1149,21 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
         }
         if constexpr (time_type == real) {
             if (exec_timer.load(std::memory_order_relaxed)) [[unlikely]] {
-                process_events_real();
+                process_events_real(pc_real);
             }
         }
 
         if (exec_flags) {
+            if constexpr (time_type == virt && exec_type != debug) {
+                if (timer_polled) [[unlikely]] {
+                    timer_polled = false;
+                    if (exec_flags == EXEF_BRANCH && g_busy_wait_skip) {
+                        virt_time = busy_wait_skip(pc_real, virt_time, event_deadline,
+                                                   instruction_period);
+                        g_virt_time = virt_time;
+                    }
+                }
+            }
             if ((exec_flags & EXEF_SLEEP) && !(exec_flags & EXEF_EXCEPTION)) [[unlikely]] {
                 while (power_on && (exec_flags & EXEF_SLEEP)) {
                     if constexpr (time_type == virt) {
@@ -850,7 +1172,7 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
                         instruction_period = g_instruction_period;
                     }
                     if constexpr (time_type == real) {
-                        process_events_real();
+                        process_events_real(pc_real);
                     }
                     if (!(exec_flags & EXEF_SLEEP)) {
                         break;
@@ -870,6 +1192,8 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
             }
             // define next execution block
             eb_start = ppc_next_instruction_address;
+            if constexpr (exec_type == trace)
+                trace_va_page = 1; // translation may have changed
             if (!(exec_flags & EXEF_RFI) &&
                 (eb_start & PPC_PAGE_MASK) == (eb_end & PPC_PAGE_MASK)) {
                 if constexpr (endian == big_end)
@@ -878,7 +1202,12 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
                     pc_real = mmu_translate_imem(eb_start ATPCP); // &pcp
             } else {
                 eb_end = (eb_start & PPC_PAGE_MASK) + PPC_PAGE_SIZE - 1;
-                pc_real = mmu_translate_imem(eb_start ATPCP); // &pcp
+                if constexpr (endian == big_end)
+                    pc_real = block_chain_translate(ppc_state.pc, eb_start);
+                else
+                    pc_real = mmu_translate_imem(eb_start ATPCP); // &pcp
+                if (g_exec_bp_count) [[unlikely]]
+                    eb_end = 0; // let the block setup check the new page
             }
             ppc_state.pc = eb_start;
             exec_flags = 0;
@@ -903,6 +1232,8 @@ template void ppc_exec_inner<main, big_end   , virt>(uint32_t start_addr, uint32
 template void ppc_exec_inner<main, big_end   , real>(uint32_t start_addr, uint32_t size);
 template void ppc_exec_inner<main, little_end, virt>(uint32_t start_addr, uint32_t size);
 template void ppc_exec_inner<main, little_end, real>(uint32_t start_addr, uint32_t size);
+template void ppc_exec_inner<trace, big_end  , virt>(uint32_t start_addr, uint32_t size);
+template void ppc_exec_inner<trace, big_end  , real>(uint32_t start_addr, uint32_t size);
 
 // outer interpreter loop
 void ppc_exec()
@@ -922,7 +1253,13 @@ void ppc_exec()
                 ppc_exec_inner<main, little_end, virt>(0, 0);
         else
 #endif
-        [[likely]] {
+        if (g_trace.enabled) [[unlikely]] {
+            if (g_realtime)
+                ppc_exec_inner<trace, big_end, real>(0, 0);
+            else
+                ppc_exec_inner<trace, big_end, virt>(0, 0);
+        }
+        else [[likely]] {
             if (g_realtime)
                 ppc_exec_inner<main, big_end, real>(0, 0);
             else
@@ -952,7 +1289,7 @@ void ppc_exec_single()
         g_virt_time += g_instruction_period;
         process_events();
     } else {
-        process_events_real();
+        process_events_real(nullptr);
     }
 
     if (exec_flags) {
@@ -1151,7 +1488,7 @@ do { \
 #define OP4_ccccc10xxxx(subopcode, fn) \
 do { \
     for (uint32_t ccccc = 0; ccccc < 32; ccccc++) { \
-        OPr(4, (ccccc << 6) | (subopcode), fn); \
+        OPr(4, (ccccc << 6) | 0x20 | (subopcode), fn); \
     } \
 } while (0)
 
@@ -1602,6 +1939,7 @@ static uint32_t get_cpu_pll_value(const PPC_CPU_Config& config)
             return 9;  // 5.5:1 ratio
         break;
     case PPC_VER::MPC750:
+    case PPC_VER::MPC7400: // same PLL_CFG encoding as the 750
         if (config.core_freq_hz * 2 == config.bus_freq_hz * 7)
             return 14; // 3.5:1 ratio
         if (config.core_freq_hz == config.bus_freq_hz * 6)
@@ -1621,17 +1959,25 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, const PPC_CPU_Config& config)
 {
     if (!config.timebase_freq_hz || !config.bus_freq_hz || !config.core_freq_hz)
         ABORT_F("CPU clock frequencies must be non-zero");
+#ifndef DPPC_ALTIVEC
+    if (config.version == PPC_VER::MPC7400)
+        ABORT_F("MPC7400 requires a build with the DPPC_ALTIVEC option");
+#endif
 
     mem_ctrl_instance = mem_ctrl;
 
     int_pin = false;
     std::memset(&ppc_state, 0, sizeof(ppc_state));
     set_host_rounding_mode(0);
+#ifdef DPPC_ALTIVEC
+    ppc_state.vscr = VSCR::NJ;
+#endif
 
     ppc_state.spr[SPR::PVR] = config.version;
     switch (config.version) {
     case PPC_VER::MPC603EV:
     case PPC_VER::MPC750:
+    case PPC_VER::MPC7400:
         ppc_state.spr[SPR::HID1] = get_cpu_pll_value(config) << 28;
         break;
     default:
@@ -1647,6 +1993,7 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, const PPC_CPU_Config& config)
     case PPC_VER::MPC603E:
     case PPC_VER::MPC603EV:
     case PPC_VER::MPC750:
+    case PPC_VER::MPC7400:
         // 603/7xx enter power-saving modes through HID0 doze/nap/sleep
         // bits selected before MSR[POW] is set.
         ppc_pow_mode = PPCPowMode::HID0;
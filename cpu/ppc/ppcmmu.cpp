@@ -23,8 +23,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <core/memaccess.h>
 #include <devices/memctrl/bootrom.h>
+#include <devices/memctrl/dirtylog.h>
 #include <devices/memctrl/memctrlbase.h>
 #include <devices/common/mmiodevice.h>
+#include <utils/ramsnapshot.h>
+#include <utils/stats.h>
+#include "ppcbreakpoints.h"
 #include "ppcemu.h"
 #include "ppcmmu.h"
 
@@ -35,24 +39,15 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <vector>
 
 //#define MMU_PROFILING // uncomment this to enable MMU profiling
-//#define TLB_PROFILING // uncomment this to enable SoftTLB profiling
 //#define VERIFY_DATA_READ // uncomment this to verify TLB entries for read
 //#define VERIFY_DATA_WRITE // uncomment this to verify TLB entries for write
 //#define VERIFY_INSTRUCTION_READ // uncomment this to verify TLB entries for instructions
 //#define CHECK_THREAD // uncomment this to verify the thread
 //#define TRAP_READ_KEYMAP // uncomment this to log access to KeyMap
-//#define WATCH_POINT_WRITE // uncomment this to log writes to an address
-
-#ifdef WATCH_POINT_WRITE
-static uint32_t watch_point_write_address = 0xff808010;
-#endif
 
 /* pointer to exception handler to be called when a MMU exception is occurred. */
 void (*mmu_exception_handler)(Except_Type exception_type, uint32_t srr1_bits);
 
-/* counts guest accesses to memory-mapped devices; see ppcemu.h */
-uint64_t g_mmio_access_count = 0;
-
 /* pointers to BAT update functions. */
 BatUpdateCallback ibat_update;
 BatUpdateCallback dbat_update;
@@ -78,19 +73,6 @@ uint64_t    unaligned_crossp_w = 0; // counts unaligned crosspage writes
 
 #endif // MMU_PROFILING
 
-#ifdef TLB_PROFILING
-
-/* global variables for lightweight SoftTLB profiling */
-uint64_t    num_primary_itlb_hits   = 0; // number of hits in the primary ITLB
-uint64_t    num_secondary_itlb_hits = 0; // number of hits in the secondary ITLB
-uint64_t    num_itlb_refills        = 0; // number of ITLB refills
-uint64_t    num_primary_dtlb_hits   = 0; // number of hits in the primary DTLB
-uint64_t    num_secondary_dtlb_hits = 0; // number of hits in the secondary DTLB
-uint64_t    num_dtlb_refills        = 0; // number of DTLB refills
-uint64_t    num_entry_replacements  = 0; // number of entry replacements
-
-#endif // TLB_PROFILING
-
 /** remember recently used physical memory regions for quicker translation. */
 AddressMapEntry last_ptab_area;
 
@@ -473,6 +455,11 @@ MapDmaResult mmu_map_dma_mem(uint32_t addr, uint32_t size,
     if (cur_dma_rgn->type & (RT_ROM | RT_RAM)) {
         host_va  = cur_dma_rgn->mem_ptr + (addr - cur_dma_rgn->start);
         is_writable = cur_dma_rgn->type & RT_RAM;
+        ram_snapshot_touch(host_va, size);
+        // the direction of the transfer isn't known here,
+        // so every mapped RAM range is logged as dirty
+        if (is_writable && g_dirty_log_active && !is_dbg)
+            g_dirty_log.mark_range(addr, size);
     } else { // RT_MMIO
         devobj = cur_dma_rgn->devobj;
         dev_base = cur_dma_rgn->start;
@@ -507,6 +494,10 @@ enum TLBFlags : uint16_t {
     PAGE_WRITABLE = 1 << 5, // page is writable
     PTE_SET_C     = 1 << 6, // tells if C bit of the PTE needs to be updated
     TLBE_CTX_TRACKED = 1 << 7, // entry pointer is in gTrackedIEntries or gTrackedDEntries
+    PAGE_WATCHED  = 1 << 8, // page has watchpoints, never promote to the primary TLB
+    PAGE_WRITE_IO = 1 << 9, // memory page whose writes go to the device (flash ROM),
+                            // never promote to the primary TLB
+    PAGE_LOG_WRITE = 1 << 10, // next write must be recorded in the dirty page log
 };
 
 constexpr uint16_t TLBE_FROM_TRANSLATION =
@@ -530,6 +521,12 @@ typedef struct TLBEntry {
     uint32_t reserved;
 } TLBEntry;
 
+// Incremented whenever a primary ITLB entry is replaced or invalidated
+// and whenever the current ITLB changes. Translations cached outside of
+// the ITLB (see block chaining in ppcexec.cpp) are valid only as long as
+// the generation they were cached with is current.
+uint32_t g_itlb_generation = 0;
+
 // Track slots populated by either page or block address translation. Context
 // changes can then invalidate only populated slots without adding a generation
 // check to every TLB lookup.
@@ -571,6 +568,9 @@ static void tlb_invalidate_tracked_entries()
     if (!*pending_sources)
         return;
 
+    if (tlb_type == TLBType::ITLB)
+        g_itlb_generation++;
+
     size_t retained_count = 0;
     for (TLBEntry *tlb_entry : *tracked_entries) {
         uint16_t source = tlb_entry->flags & TLBE_FROM_TRANSLATION;
@@ -609,6 +609,8 @@ template <const TLBType tlb_type>
 static void promote_tlb_entry(TLBEntry *tlb1_entry, const TLBEntry *tlb2_entry)
 {
     uint16_t tracked = tlb1_entry->flags & TLBFlags::TLBE_CTX_TRACKED;
+    if (tlb_type == TLBType::ITLB)
+        g_itlb_generation++;
     *tlb1_entry = *tlb2_entry;
     tlb1_entry->flags &= ~TLBFlags::TLBE_CTX_TRACKED;
     tlb1_entry->flags |= tracked;
@@ -689,6 +691,7 @@ void mmu_change_mode()
                 break;
         }
         CurITLBMode = mmu_mode;
+        g_itlb_generation++;
     }
 
     // then switch DTLB tables
@@ -762,9 +765,7 @@ static TLBEntry* tlb2_target_entry(uint32_t gp_va)
         tlb2_touch_way<3>(tlb_entry);
         return &tlb_entry[3];
     } else { // no free entries, replace an existing one according with the hLRU policy
-#ifdef TLB_PROFILING
-        num_entry_replacements++;
-#endif
+        stat_inc(STAT_TLB_REPLACEMENTS);
         if (tlb_entry[0].lru_bits == 0) {
             tlb2_touch_way<0>(tlb_entry);
             return tlb_entry;
@@ -832,6 +833,8 @@ static TLBEntry* itlb2_refill(uint32_t guest_va)
                 ABORT_F("Instruction fetch from MMIO region at 0x%08X!\n", phys_addr);
             }
         }
+        ram_snapshot_touch(rgn_desc->mem_ptr + ((phys_addr & ~0xFFFUL) - rgn_desc->start),
+                           PPC_PAGE_SIZE);
         // refill the secondary TLB
         tlb_entry = tlb2_target_entry<TLBType::ITLB>(tag);
         tlb_entry->tag = tag;
@@ -923,18 +926,28 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
             tlb_entry->rgn_desc = rgn_desc;
             tlb_entry->dev_base_va = guest_va - (phys_addr - rgn_desc->start);
         } else { // memory region backed by host memory
+            ram_snapshot_touch(rgn_desc->mem_ptr + ((phys_addr & ~0xFFFUL) - rgn_desc->start),
+                               PPC_PAGE_SIZE);
             tlb_entry->flags = flags | TLBFlags::PAGE_MEM |
                 (tlb_entry->flags & TLBFlags::TLBE_CTX_TRACKED);
             tlb_entry->host_va_offs_r = (int64_t)rgn_desc->mem_ptr - guest_va +
                                         (phys_addr - rgn_desc->start);
-            if (rgn_desc->type == RT_ROM) {
+            if (rgn_desc->type & RT_FLASH) {
+                // reads come from host memory, writes are passed to the device
+                tlb_entry->flags |= TLBFlags::PAGE_WRITE_IO;
+                tlb_entry->host_va_offs_w = (int64_t)&dummy_page_w - tag;
+            } else if (rgn_desc->type == RT_ROM) {
                 // redirect writes to the dummy page for ROM regions
                 tlb_entry->host_va_offs_w = (int64_t)&dummy_page_w - tag;
             } else {
                 tlb_entry->host_va_offs_w = tlb_entry->host_va_offs_r;
+                if (g_dirty_log_active)
+                    tlb_entry->flags |= TLBFlags::PAGE_LOG_WRITE;
             }
         }
         tlb_entry->phys_tag = phys_addr & ~0xFFFUL;
+        if (g_watch_count && bp_watch_page(phys_addr))
+            tlb_entry->flags |= TLBFlags::PAGE_WATCHED;
         track_translated_entry<TLBType::DTLB>(tlb_entry);
         return tlb_entry;
     } else {
@@ -1100,8 +1113,9 @@ static inline TLBLookupResult lookup_tlb(uint32_t guest_va, uint32_t tag)
     };
 }
 
-// Returns true when the PTE.C bit was updated. Callers writing through a
-// primary entry use this to mirror the update into the secondary TLB.
+// Returns true when the PTE.C bit was updated or the page was logged as dirty.
+// Callers writing through a primary entry use this to mirror the update into
+// the secondary TLB.
 static inline bool prepare_dtlb_write(TLBEntry *tlb_entry, uint32_t guest_va)
 {
     if (!(tlb_entry->flags & TLBFlags::PAGE_WRITABLE)) {
@@ -1110,10 +1124,19 @@ static inline bool prepare_dtlb_write(TLBEntry *tlb_entry, uint32_t guest_va)
         mmu_exception_handler(Except_Type::EXC_DSI, 0);
     }
 
-    if (tlb_entry->flags & TLBFlags::PTE_SET_C) {
+    if ((tlb_entry->flags & (TLBFlags::PTE_SET_C | TLBFlags::PAGE_LOG_WRITE)) ==
+        TLBFlags::PTE_SET_C) {
         return false;
     }
 
+    if (tlb_entry->flags & TLBFlags::PAGE_LOG_WRITE) {
+        if (g_dirty_log_active)
+            g_dirty_log.mark(tlb_entry->phys_tag);
+        tlb_entry->flags &= ~TLBFlags::PAGE_LOG_WRITE;
+        if (tlb_entry->flags & TLBFlags::PTE_SET_C)
+            return true;
+    }
+
     // Perform full page address translation to update the PTE.C bit.
     page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true);
     tlb_entry->flags |= TLBFlags::PTE_SET_C;
@@ -1146,6 +1169,10 @@ void mmu_dcbz(uint32_t opcode, uint32_t guest_va)
     mmu_write_vmem<uint64_t>(opcode, guest_va +  8, 0);
     mmu_write_vmem<uint64_t>(opcode, guest_va + 16, 0);
     mmu_write_vmem<uint64_t>(opcode, guest_va + 24, 0);
+
+    if (mem_ctrl_instance->track_zero_pages && (guest_va & 0xFE0) == 0xFE0)
+        mem_ctrl_instance->note_zeroed_line(
+            (uint8_t *)(tlb_entry->host_va_offs_w + (guest_va & ~31)));
 }
 
 static void tlb_flush_primary_entry(TLBEntry *tlb1, uint32_t tag) {
@@ -1187,16 +1214,12 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::ITLB>(vaddr, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary ITLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_itlb_hits++;
-#endif
+        stat_inc(STAT_ITLB_PRIMARY_HITS);
         host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + vaddr);
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_itlb_refills++;
-#endif
+            stat_inc(STAT_ITLB_REFILLS);
             // secondary ITLB miss ->
             // perform full address translation and refill the secondary ITLB
             tlb2_entry = itlb2_refill(vaddr);
@@ -1204,11 +1227,9 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
             verify = false;
 #endif
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_itlb_hits++;
+            stat_inc(STAT_ITLB_SECONDARY_HITS);
         }
-#endif
         // refill the primary ITLB
         promote_tlb_entry<TLBType::ITLB>(tlb1_entry, tlb2_entry);
         host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + vaddr);
@@ -1217,6 +1238,7 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
 #ifdef VERIFY_INSTRUCTION_READ
     if (verify) {
         uint32_t savedphys = tlb1_entry->phys_tag;
+        g_itlb_generation++;
         tlb_flush_primary_entry(pCurITLB1, tag);
         tlb_flush_secondary_entry(pCurITLB2, tag);
         tlb2_entry = itlb2_refill(vaddr);
@@ -1257,6 +1279,7 @@ static void tlb_flush_secondary_entry(std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> &
 void tlb_flush_entry(uint32_t ea)
 {
     const uint32_t tag = ea & TLB_VPS_MASK;
+    g_itlb_generation++;
     tlb_flush_primary_entry(itlb1_mode1, tag);
     tlb_flush_secondary_entry(itlb2_mode1, tag);
     tlb_flush_primary_entry(itlb1_mode2, tag);
@@ -1271,6 +1294,81 @@ void tlb_flush_entry(uint32_t ea)
     tlb_flush_secondary_entry(dtlb2_mode3, tag);
 }
 
+template <std::size_t N>
+static void tlb_flush_phys_entries(std::array<TLBEntry, N> &tlb, uint32_t phys_page)
+{
+    for (auto &tlb_entry : tlb) {
+        if (tlb_entry.tag != TLB_INVALID_TAG && tlb_entry.phys_tag == phys_page)
+            tlb_entry.tag = TLB_INVALID_TAG;
+    }
+}
+
+/** Invalidate all data TLB entries mapping the given physical page
+    regardless of the virtual address they were translated from. */
+void mmu_flush_phys_page(uint32_t phys_page)
+{
+    phys_page &= ~0xFFFUL;
+    tlb_flush_phys_entries(dtlb1_mode1, phys_page);
+    tlb_flush_phys_entries(dtlb2_mode1, phys_page);
+    tlb_flush_phys_entries(dtlb1_mode2, phys_page);
+    tlb_flush_phys_entries(dtlb2_mode2, phys_page);
+    tlb_flush_phys_entries(dtlb1_mode3, phys_page);
+    tlb_flush_phys_entries(dtlb2_mode3, phys_page);
+}
+
+template <std::size_t N>
+static void tlb_flush_phys_range(std::array<TLBEntry, N> &tlb, uint32_t start, uint32_t size)
+{
+    for (auto &tlb_entry : tlb) {
+        if (tlb_entry.tag != TLB_INVALID_TAG && tlb_entry.phys_tag - start < size)
+            tlb_entry.tag = TLB_INVALID_TAG;
+    }
+}
+
+template <std::size_t N>
+static void tlb_rearm_dirty_log(std::array<TLBEntry, N> &tlb)
+{
+    // only RAM pages write to the host memory they read from,
+    // writes to ROM go to the dummy page
+    for (auto &tlb_entry : tlb) {
+        if (tlb_entry.tag != TLB_INVALID_TAG && (tlb_entry.flags & TLBFlags::PAGE_MEM) &&
+            tlb_entry.host_va_offs_w == tlb_entry.host_va_offs_r)
+            tlb_entry.flags |= TLBFlags::PAGE_LOG_WRITE;
+    }
+}
+
+/** Make the next write through each cached RAM translation
+    mark its page in the dirty page log. */
+void mmu_dirty_log_rearm()
+{
+    tlb_rearm_dirty_log(dtlb1_mode1);
+    tlb_rearm_dirty_log(dtlb2_mode1);
+    tlb_rearm_dirty_log(dtlb1_mode2);
+    tlb_rearm_dirty_log(dtlb2_mode2);
+    tlb_rearm_dirty_log(dtlb1_mode3);
+    tlb_rearm_dirty_log(dtlb2_mode3);
+}
+
+/** Invalidate all instruction and data TLB entries mapping physical
+    addresses in the given range, e.g. after the type of a region changed. */
+void mmu_flush_phys_range(uint32_t start, uint32_t size)
+{
+    start &= ~0xFFFUL;
+    g_itlb_generation++;
+    tlb_flush_phys_range(itlb1_mode1, start, size);
+    tlb_flush_phys_range(itlb2_mode1, start, size);
+    tlb_flush_phys_range(itlb1_mode2, start, size);
+    tlb_flush_phys_range(itlb2_mode2, start, size);
+    tlb_flush_phys_range(itlb1_mode3, start, size);
+    tlb_flush_phys_range(itlb2_mode3, start, size);
+    tlb_flush_phys_range(dtlb1_mode1, start, size);
+    tlb_flush_phys_range(dtlb2_mode1, start, size);
+    tlb_flush_phys_range(dtlb1_mode2, start, size);
+    tlb_flush_phys_range(dtlb2_mode2, start, size);
+    tlb_flush_phys_range(dtlb1_mode3, start, size);
+    tlb_flush_phys_range(dtlb2_mode3, start, size);
+}
+
 static void mpc601_bat_update(uint32_t bat_reg)
 {
     PPC_BAT_entry *ibat_entry, *dbat_entry;
@@ -1423,9 +1521,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::DTLB>(guest_va, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary TLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_dtlb_hits++;
-#endif
+        stat_inc(STAT_DTLB_PRIMARY_HITS);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
         needs_swap = mem_ctrl_instance->needs_swap_endian(false);
@@ -1439,9 +1535,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_dtlb_refills++;
-#endif
+            stat_inc(STAT_DTLB_REFILLS);
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 0);
@@ -1452,15 +1546,21 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
             verify = false;
 #endif
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_dtlb_hits++;
+            stat_inc(STAT_DTLB_SECONDARY_HITS);
         }
+
+        if (tlb2_entry->flags & TLBFlags::PAGE_WATCHED) [[unlikely]] {
+            bp_watch_check(guest_va, tlb2_entry->phys_tag | (guest_va & 0xFFF), sizeof(T), false);
+#ifdef VERIFY_DATA_READ
+            verify = false;
 #endif
+        }
 
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
-            // refill the primary TLB
-            promote_tlb_entry<TLBType::DTLB>(tlb1_entry, tlb2_entry);
+            // refill the primary TLB unless every access must be checked
+            if (!(tlb2_entry->flags & (TLBFlags::PAGE_WATCHED | TLBFlags::PAGE_WRITE_IO)))
+                promote_tlb_entry<TLBType::DTLB>(tlb1_entry, tlb2_entry);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(false);
@@ -1470,13 +1570,13 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
             }
 #endif
 
-            host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + guest_va);
+            host_va = (uint8_t *)(tlb2_entry->host_va_offs_r + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
 #ifdef MMU_PROFILING
             iomem_reads_total++;
 #endif
-            g_mmio_access_count++;
-
+            stat_inc(STAT_MMIO_READS);
+            stat_inc(tlb2_entry->rgn_desc->stat_reads);
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(tlb2_entry->rgn_desc);
             if (needs_swap) {
@@ -1587,6 +1687,29 @@ template uint16_t mmu_read_vmem<uint16_t>(uint32_t opcode, uint32_t guest_va);
 template uint32_t mmu_read_vmem<uint32_t>(uint32_t opcode, uint32_t guest_va);
 template uint64_t mmu_read_vmem<uint64_t>(uint32_t opcode, uint32_t guest_va);
 
+// Pass a write to a flash ROM page to the device. The TLB entry only holds
+// the host memory of the page so the region is looked up again. Flash
+// writes are rare: command sequences and the programmed data.
+template <class T>
+static void flash_write(uint32_t opcode, uint32_t guest_va, uint32_t phys_addr, T value)
+{
+    AddressMapEntry* rgn_desc = mem_ctrl_instance->find_range(phys_addr);
+    if (!rgn_desc || !rgn_desc->write)
+        return;
+
+    stat_inc(STAT_MMIO_WRITES);
+
+    uint32_t offset = phys_addr - rgn_desc->start;
+    if (sizeof(T) == 8) {
+        if (guest_va & 3)
+            ppc_alignment_exception(opcode, guest_va);
+        rgn_desc->write(rgn_desc->start, offset, uint32_t(uint64_t(value) >> 32), 4);
+        rgn_desc->write(rgn_desc->start, offset + 4, uint32_t(value), 4);
+    } else {
+        rgn_desc->write(rgn_desc->start, offset, uint32_t(value), sizeof(T));
+    }
+}
+
 template <class T>
 inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
 {
@@ -1615,13 +1738,12 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::DTLB>(guest_va, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary TLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_dtlb_hits++;
-#endif
+        stat_inc(STAT_DTLB_PRIMARY_HITS);
         if (prepare_dtlb_write(tlb1_entry, guest_va)) {
             // don't forget to update the secondary TLB as well
             tlb2_entry = lookup_secondary_tlb<TLBType::DTLB>(guest_va, tag);
             if (tlb2_entry != nullptr) {
+                tlb2_entry->flags &= ~TLBFlags::PAGE_LOG_WRITE;
                 tlb2_entry->flags |= TLBFlags::PTE_SET_C;
             }
         }
@@ -1636,9 +1758,7 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_dtlb_refills++;
-#endif
+            stat_inc(STAT_DTLB_REFILLS);
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 1);
@@ -1649,16 +1769,27 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
             verify = false;
 #endif
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_dtlb_hits++;
+            stat_inc(STAT_DTLB_SECONDARY_HITS);
         }
-#endif
         prepare_dtlb_write(tlb2_entry, guest_va);
 
+        if (tlb2_entry->flags & TLBFlags::PAGE_WATCHED) [[unlikely]] {
+            bp_watch_check(guest_va, tlb2_entry->phys_tag | (guest_va & 0xFFF), sizeof(T), true);
+#ifdef VERIFY_DATA_WRITE
+            verify = false;
+#endif
+        }
+
+        if (tlb2_entry->flags & TLBFlags::PAGE_WRITE_IO) [[unlikely]] {
+            flash_write<T>(opcode, guest_va, tlb2_entry->phys_tag | (guest_va & 0xFFF), value);
+            return;
+        }
+
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
-            // refill the primary TLB
-            promote_tlb_entry<TLBType::DTLB>(tlb1_entry, tlb2_entry);
+            // refill the primary TLB unless every access must be checked
+            if (!(tlb2_entry->flags & TLBFlags::PAGE_WATCHED))
+                promote_tlb_entry<TLBType::DTLB>(tlb1_entry, tlb2_entry);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(false);
@@ -1668,13 +1799,13 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
             }
 #endif
 
-            host_va = (uint8_t *)(tlb1_entry->host_va_offs_w + guest_va);
+            host_va = (uint8_t *)(tlb2_entry->host_va_offs_w + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
 #ifdef MMU_PROFILING
             iomem_writes_total++;
 #endif
-            g_mmio_access_count++;
-
+            stat_inc(STAT_MMIO_WRITES);
+            stat_inc(tlb2_entry->rgn_desc->stat_writes);
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(tlb2_entry->rgn_desc);
             if (needs_swap) {
@@ -1738,14 +1869,6 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     }
 #endif
 
-#ifdef WATCH_POINT_WRITE
-    if (guest_va >= watch_point_write_address && guest_va < watch_point_write_address + 4) {
-        LOG_F(WARNING, "Writing to 0x%08X", watch_point_write_address);
-        dump_backtrace();
-        power_off(po_enter_debugger);
-    }
-#endif
-
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
     // swap now if needed
     if (needs_swap && sizeof(T) > 1) {
@@ -2028,57 +2151,6 @@ public:
 };
 #endif
 
-/* SoftTLB profiling. */
-#ifdef TLB_PROFILING
-
-#include "utils/profiler.h"
-#include <memory>
-
-class TLBProfile : public BaseProfile {
-public:
-    TLBProfile() : BaseProfile("PPC:MMU:TLB") {}
-
-    void populate_variables(std::vector<ProfileVar>& vars) {
-        vars.clear();
-
-        vars.push_back({.name = "Number of hits in the primary ITLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_primary_itlb_hits});
-
-        vars.push_back({.name = "Number of hits in the secondary ITLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_secondary_itlb_hits});
-
-        vars.push_back({.name = "Number of ITLB refills",
-            .format = ProfileVarFmt::DEC,
-            .value = num_itlb_refills});
-
-        vars.push_back({.name = "Number of hits in the primary DTLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_primary_dtlb_hits});
-
-        vars.push_back({.name = "Number of hits in the secondary DTLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_secondary_dtlb_hits});
-
-        vars.push_back({.name = "Number of DTLB refills",
-            .format = ProfileVarFmt::DEC,
-            .value = num_dtlb_refills});
-
-        vars.push_back({.name = "Number of replaced TLB entries",
-            .format = ProfileVarFmt::DEC,
-            .value = num_entry_replacements});
-    }
-
-    void reset() {
-        num_primary_dtlb_hits   = 0;
-        num_secondary_dtlb_hits = 0;
-        num_dtlb_refills        = 0;
-        num_entry_replacements = 0;
-    }
-};
-#endif
-
 uint64_t mem_read_dbg(uint32_t virt_addr, uint32_t size) {
     uint32_t save_dsisr, save_dar;
     uint64_t ret_val;
@@ -2204,7 +2276,9 @@ bool mmu_translate_dbg(uint32_t guest_va, uint32_t &guest_pa, int is_write) {
                     }
                 }
 
-                if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
+                if ((tlb2_entry->flags & (TLBFlags::PAGE_MEM | TLBFlags::PAGE_WATCHED |
+                                          TLBFlags::PAGE_WRITE_IO)) ==
+                    TLBFlags::PAGE_MEM) { // is it a real, unwatched memory region?
                     // refill the primary TLB
                     promote_tlb_entry<TLBType::DTLB>(tlb1_entry, tlb2_entry);
                 }
@@ -2274,6 +2348,7 @@ void ppc_mmu_init()
         dbat_update(reg);
 
     // invalidate all IDTLB entries
+    g_itlb_generation++;
     invalidate_tlb_entries(itlb1_mode1);
     invalidate_tlb_entries(itlb1_mode2);
     invalidate_tlb_entries(itlb1_mode3);
@@ -2302,9 +2377,4 @@ void ppc_mmu_init()
     gProfilerObj->register_profile("PPC:MMU",
         std::unique_ptr<BaseProfile>(new MMUProfile()));
 #endif
-
-#ifdef TLB_PROFILING
-    gProfilerObj->register_profile("PPC:MMU:TLB",
-    std::unique_ptr<BaseProfile>(new TLBProfile()));
-#endif
 }
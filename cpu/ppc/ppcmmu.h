@@ -102,11 +102,15 @@ extern MapDmaResult mmu_map_dma_mem(uint32_t addr, uint32_t size,
 
 extern uint8_t CurITLBMode;
 extern uint8_t CurDTLBMode;
+extern uint32_t g_itlb_generation;
 
 extern void mmu_change_mode(void);
 extern void mmu_pat_ctx_changed();
 extern void tlb_flush_entry(uint32_t ea);
+extern void mmu_flush_phys_page(uint32_t phys_page);
+extern void mmu_flush_phys_range(uint32_t start, uint32_t size);
 extern void mmu_dcbz(uint32_t opcode, uint32_t guest_va);
+extern void mmu_dirty_log_rearm();
 
 extern uint64_t mem_read_dbg(uint32_t virt_addr, uint32_t size);
 extern void mem_write_dbg(uint32_t virt_addr, uint64_t value, int size);
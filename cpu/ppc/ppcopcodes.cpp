@@ -925,6 +925,7 @@ static inline void calc_rtcl_value()
 #else
 static inline void calc_rtcl_value()
 {
+    timer_polled = true;
     uint64_t adj;
     uint32_t adj_lo;
     uint64_t new_ts = get_virt_time_ns();
@@ -946,6 +947,7 @@ static inline void calc_rtcl_value()
 
 static inline uint64_t calc_tbr_value()
 {
+    timer_polled = true;
     uint64_t adj;
     uint32_t adj_lo;
     uint64_t diff = get_virt_time_ns() - tbr_wr_timestamp;
@@ -956,6 +958,7 @@ static inline uint64_t calc_tbr_value()
 }
 
 static inline uint32_t calc_dec_value() {
+    timer_polled = true;
     uint64_t adj;
     uint32_t adj_lo;
     uint64_t diff = get_virt_time_ns() - dec_wr_timestamp;
@@ -1599,7 +1602,12 @@ void dppc_interpreter::ppc_rfi(uint32_t opcode) {
     }
 
     // keep 0, 5-9, 16-23, 25-27, 30-31 bits; exclude POW, ILE, and Reserved bits.
+#ifdef DPPC_ALTIVEC
+    // bit 6 (VEC) is restored as well
+    const uint32_t msr_bits_to_replace = 0x87C0FF73UL | MSR::VEC;
+#else
     const uint32_t msr_bits_to_replace = 0x87C0FF73UL;
+#endif
     const uint32_t msr_bits_to_clear   = MSR::POW;
 
     uint32_t bits_from_srr1 =  ppc_state.spr[SPR::SRR1] &
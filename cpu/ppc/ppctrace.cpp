@@ -0,0 +1,182 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Runtime-enabled instruction trace ring. */
+
+#include "ppctrace.h"
+#include "ppcemu.h"
+
+#include <loguru.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32) && \
+    (defined(__APPLE__) || defined(__linux__) || defined(__unix__))
+#define DPPC_HAS_MMAP 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+TraceState g_trace = {};
+
+static TraceHeader* trace_hdr  = nullptr;
+static size_t       trace_size = 0;
+static std::string  trace_path;
+#if DPPC_HAS_MMAP
+static int          trace_fd   = -1;
+#endif
+
+bool trace_start(const std::string& path, uint64_t size_mb, bool gprs) {
+    if (g_trace.ring)
+        trace_stop();
+
+    // round the ring down to a power of two number of records
+    uint64_t capacity = 1;
+    uint64_t max_recs = (size_mb << 20) / sizeof(TraceRec);
+    if (!max_recs) {
+        LOG_F(ERROR, "Trace: ring size must be at least 1 MB");
+        return false;
+    }
+    while (capacity * 2 <= max_recs)
+        capacity *= 2;
+
+    trace_size = sizeof(TraceHeader) + capacity * sizeof(TraceRec);
+
+#if DPPC_HAS_MMAP
+    trace_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (trace_fd < 0) {
+        LOG_F(ERROR, "Trace: could not create %s: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    if (ftruncate(trace_fd, trace_size) < 0) {
+        LOG_F(ERROR, "Trace: could not resize %s: %s", path.c_str(), std::strerror(errno));
+        close(trace_fd);
+        trace_fd = -1;
+        return false;
+    }
+    void* addr = mmap(nullptr, trace_size, PROT_READ | PROT_WRITE, MAP_SHARED, trace_fd, 0);
+    if (addr == MAP_FAILED) {
+        LOG_F(ERROR, "Trace: could not map %s: %s", path.c_str(), std::strerror(errno));
+        close(trace_fd);
+        trace_fd = -1;
+        return false;
+    }
+    trace_hdr = static_cast<TraceHeader*>(addr);
+#else
+    // the ring is written to the file when tracing stops
+    trace_hdr = static_cast<TraceHeader*>(std::calloc(1, trace_size));
+    if (!trace_hdr) {
+        LOG_F(ERROR, "Trace: could not allocate %llu bytes", (unsigned long long)trace_size);
+        return false;
+    }
+#endif
+
+    std::memcpy(trace_hdr->magic, TRACE_MAGIC, sizeof(trace_hdr->magic));
+    trace_hdr->version  = TRACE_VERSION;
+    trace_hdr->rec_size = sizeof(TraceRec);
+    trace_hdr->capacity = capacity;
+    trace_hdr->count    = 0;
+    trace_hdr->flags    = gprs ? TRACE_GPRS : 0;
+
+    trace_path = path;
+
+    g_trace.ring  = reinterpret_cast<TraceRec*>(trace_hdr + 1);
+    g_trace.mask  = capacity - 1;
+    g_trace.count = 0;
+    g_trace.gprs  = gprs;
+    std::memcpy(g_trace.last_gprs, ppc_state.gpr, sizeof(g_trace.last_gprs));
+    g_trace.enabled = true;
+
+    // switch ppc_exec to the tracing loop
+    if (power_on)
+        power_off(po_exec_switch);
+
+    LOG_F(INFO, "Trace: recording up to %llu instructions into %s",
+        (unsigned long long)capacity, path.c_str());
+    return true;
+}
+
+void trace_sync() {
+    if (trace_hdr)
+        trace_hdr->count = g_trace.count;
+}
+
+void trace_stop() {
+    if (!g_trace.ring)
+        return;
+
+    g_trace.enabled = false;
+    if (power_on)
+        power_off(po_exec_switch);
+
+    trace_sync();
+
+#if DPPC_HAS_MMAP
+    munmap(trace_hdr, trace_size);
+    close(trace_fd);
+    trace_fd = -1;
+#else
+    FILE* f = std::fopen(trace_path.c_str(), "wb");
+    if (!f || std::fwrite(trace_hdr, 1, trace_size, f) != trace_size)
+        LOG_F(ERROR, "Trace: could not write %s", trace_path.c_str());
+    if (f)
+        std::fclose(f);
+    std::free(trace_hdr);
+#endif
+
+    LOG_F(INFO, "Trace: %llu records written to %s",
+        (unsigned long long)g_trace.count, trace_path.c_str());
+
+    trace_hdr     = nullptr;
+    g_trace.ring  = nullptr;
+    g_trace.count = 0;
+}
+
+void trace_print_status() {
+    if (!g_trace.ring) {
+        printf("Tracing is off.\n");
+        return;
+    }
+    trace_sync();
+    printf("Tracing into %s: %llu records, ring of %llu%s\n", trace_path.c_str(),
+        (unsigned long long)g_trace.count, (unsigned long long)(g_trace.mask + 1),
+        g_trace.gprs ? ", with GPR deltas" : "");
+}
+
+void trace_gpr_deltas() {
+    if (!std::memcmp(g_trace.last_gprs, ppc_state.gpr, sizeof(g_trace.last_gprs)))
+        return;
+
+    for (uint32_t reg = 0; reg < 32; reg++) {
+        if (g_trace.last_gprs[reg] == ppc_state.gpr[reg])
+            continue;
+        TraceRec* rec = &g_trace.ring[g_trace.count++ & g_trace.mask];
+        rec->addr  = ppc_state.pc | TRACE_REC_GPR;
+        rec->paddr = reg;
+        rec->ins   = ppc_state.gpr[reg];
+        rec->msr   = 0;
+        g_trace.last_gprs[reg] = ppc_state.gpr[reg];
+    }
+}
@@ -0,0 +1,94 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Runtime-enabled instruction trace.
+
+    While tracing is on, ppc_exec runs a separate instantiation of the
+    interpreter loop that appends a fixed-size record for every executed
+    instruction to a ring buffer. The ring is a memory-mapped file so it
+    can be decoded offline (see tools/tracedecode.cpp) while or after the
+    emulator runs. The normal interpreter loop contains no tracing code.
+ */
+
+#ifndef PPC_TRACE_H
+#define PPC_TRACE_H
+
+#include <cinttypes>
+#include <string>
+
+#define TRACE_MAGIC     "DPPCTRC1"
+#define TRACE_VERSION   1
+
+/** Trace flags. */
+enum : uint32_t {
+    TRACE_GPRS = 1 << 0, // GPR delta records follow instruction records
+};
+
+/** Trace file header, followed by capacity records. */
+typedef struct {
+    char     magic[8];  // TRACE_MAGIC
+    uint32_t version;
+    uint32_t rec_size;  // size of a TraceRec
+    uint64_t capacity;  // number of records in the ring, a power of two
+    uint64_t count;     // number of records written so far
+    uint32_t flags;
+    uint32_t reserved[7];
+} TraceHeader; // 64 bytes
+
+/** A trace record.
+
+    Instruction records hold the effective and physical address,
+    the opcode and the MSR value before the instruction was executed.
+    Bit 0 of addr is set in GPR delta records which follow the record
+    of the instruction that changed the register: paddr holds
+    the register number and ins its new value.
+ */
+typedef struct {
+    uint32_t addr;
+    uint32_t paddr;
+    uint32_t ins;
+    uint32_t msr;
+} TraceRec; // 16 bytes
+
+#define TRACE_REC_GPR 1
+
+typedef struct {
+    bool        enabled;
+    bool        gprs;
+    TraceRec*   ring;
+    uint64_t    mask;
+    uint64_t    count;
+    uint32_t    last_gprs[32];
+} TraceState;
+
+extern TraceState g_trace;
+
+/** Start tracing into a ring of size_mb megabytes mapped to file path. */
+extern bool trace_start(const std::string& path, uint64_t size_mb, bool gprs);
+extern void trace_stop();
+/** Update the record count in the file header. */
+extern void trace_sync();
+extern void trace_print_status();
+
+/** Append GPR delta records for the registers changed by the last instruction. */
+extern void trace_gpr_deltas();
+
+#endif // PPC_TRACE_H
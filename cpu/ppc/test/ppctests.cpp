@@ -21,6 +21,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "../ppcdisasm.h"
 #include "../ppcemu.h"
+#include <array>
+#include <bit>
 #include <cfenv>
 #include <cmath>
 #include <cstring>
@@ -324,7 +326,139 @@ static void read_test_float_data() {
     }
 }
 
+#ifdef DPPC_ALTIVEC
+typedef std::array<uint8_t, 16> vec_bytes; // in PPC (big-endian) element order
+
+static void set_vr(int reg, const vec_bytes& val) {
+    for (int i = 0; i < 16; i++)
+        ppc_state.vr[reg].u8[std::endian::native == std::endian::little ? 15 - i : i] = val[i];
+}
+
+static vec_bytes get_vr(int reg) {
+    vec_bytes val;
+    for (int i = 0; i < 16; i++)
+        val[i] = ppc_state.vr[reg].u8[std::endian::native == std::endian::little ? 15 - i : i];
+    return val;
+}
+
+static vec_bytes vec_words(uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+    vec_bytes val;
+    uint32_t w[4] = {w0, w1, w2, w3};
+    for (int i = 0; i < 16; i++)
+        val[i] = (w[i >> 2] >> (24 - (i & 3) * 8)) & 0xFF;
+    return val;
+}
+
+static vec_bytes vec_fill(uint8_t start, int step = 1) {
+    vec_bytes val;
+    for (int i = 0; i < 16; i++)
+        val[i] = uint8_t(start + i * step);
+    return val;
+}
+
+static vec_bytes vec_splat8(uint8_t b) {
+    vec_bytes val;
+    val.fill(b);
+    return val;
+}
+
+static uint32_t vec_float(float f) {
+    uint32_t w;
+    memcpy(&w, &f, 4);
+    return w;
+}
+
+// runs opcode with vA = v1, vB = v2, vC = v3 and checks vD = v0
+static void vec_test(string mnem, uint32_t opcode, const vec_bytes& a, const vec_bytes& b,
+                     const vec_bytes& c, const vec_bytes& expected, uint32_t exp_vscr = VSCR::NJ,
+                     uint32_t exp_cr = 0) {
+    ppc_state.vscr = VSCR::NJ;
+    ppc_state.cr   = 0;
+    set_vr(0, vec_splat8(0x55));
+    set_vr(1, a);
+    set_vr(2, b);
+    set_vr(3, c);
+
+    ppc_main_opcode(ppc_opcode_grabber, opcode);
+
+    ntested++;
+
+    if (get_vr(0) != expected || ppc_state.vscr != exp_vscr || ppc_state.cr != exp_cr) {
+        cout << "Mismatch: instr=" << mnem << ", vD=0x";
+        for (uint8_t byte : get_vr(0))
+            cout << hex << setw(2) << setfill('0') << unsigned(byte);
+        cout << ", VSCR=0x" << hex << ppc_state.vscr << ", CR=0x" << hex << ppc_state.cr
+             << endl;
+        nfailed++;
+    }
+}
+
+#define VA_FORM(xo)  ((4U << 26) | (0 << 21) | (1 << 16) | (2 << 11) | (3 << 6) | (xo))
+#define VX_FORM(xo)  ((4U << 26) | (0 << 21) | (1 << 16) | (2 << 11) | (xo))
+#define VXR_FORM(xo) (VX_FORM(xo) | (1 << 10))
+
+static void vector_test() {
+    vec_bytes zero = {};
+
+    vec_test("VADDUBM", VX_FORM(0), vec_splat8(0xF0), vec_splat8(0x20), zero,
+             vec_splat8(0x10));
+    vec_test("VADDUBS", VX_FORM(512), vec_splat8(0xF0), vec_splat8(0x20), zero,
+             vec_splat8(0xFF), VSCR::NJ | VSCR::SAT);
+    vec_test("VADDUBS", VX_FORM(512), vec_splat8(0x70), vec_splat8(0x0F), zero,
+             vec_splat8(0x7F));
+    vec_test("VSUBSHS", VX_FORM(1856), vec_words(0x80000001, 0, 0, 0),
+             vec_words(0x00010002, 0, 0, 0), zero, vec_words(0x8000FFFF, 0, 0, 0),
+             VSCR::NJ | VSCR::SAT);
+    vec_test("VPERM", VA_FORM(43), vec_fill(0x00), vec_fill(0x10),
+             vec_words(0x1F00110F, 0x10203040, 0x00000000, 0x01020304),
+             vec_words(0x1F00110F, 0x10001000, 0x00000000, 0x01020304));
+    vec_test("VMRGHB", VX_FORM(12), vec_fill(0x00), vec_fill(0x10), zero,
+             vec_words(0x00100111, 0x02120313, 0x04140515, 0x06160717));
+    vec_test("VMRGLW", VX_FORM(396), vec_fill(0x00), vec_fill(0x10), zero,
+             vec_words(0x08090A0B, 0x18191A1B, 0x0C0D0E0F, 0x1C1D1E1F));
+    vec_test("VPKUHUS", VX_FORM(142), vec_words(0x00010100, 0x00FF0002, 0, 0),
+             vec_words(0, 0, 0, 0x12340005), zero,
+             vec_words(0x01FFFF02, 0x00000000, 0x00000000, 0x0000FF05),
+             VSCR::NJ | VSCR::SAT);
+    vec_test("VSLDOI", (VA_FORM(44) & ~(0xF << 6)) | (4 << 6), vec_fill(0x00), vec_fill(0x10),
+             zero, vec_fill(0x04));
+    vec_test("VSUMSWS", VX_FORM(1928), vec_words(1, 2, 3, 0xFFFFFFFF),
+             vec_words(0x11111111, 0x22222222, 0x33333333, 10), zero,
+             vec_words(0, 0, 0, 15));
+    vec_test("VSUMSWS", VX_FORM(1928), vec_words(0x7FFFFFFF, 1, 0, 0), zero, zero,
+             vec_words(0, 0, 0, 0x7FFFFFFF), VSCR::NJ | VSCR::SAT);
+    vec_test("VCMPEQUW", VX_FORM(134), vec_words(1, 2, 3, 4), vec_words(1, 0, 3, 0), zero,
+             vec_words(0xFFFFFFFF, 0, 0xFFFFFFFF, 0));
+    vec_test("VCMPEQUW.", VXR_FORM(134), vec_words(1, 2, 3, 4), vec_words(1, 2, 3, 4), zero,
+             vec_splat8(0xFF), VSCR::NJ, 0x80);
+    vec_test("VCMPGTSB.", VXR_FORM(774), vec_splat8(0x80), vec_splat8(0x00), zero,
+             zero, VSCR::NJ, 0x20);
+    vec_test("VMADDFP", VA_FORM(46),
+             vec_words(vec_float(2.0f), vec_float(-1.5f), vec_float(0.0f), vec_float(3.0f)),
+             vec_words(vec_float(1.0f), vec_float(1.0f), vec_float(-2.0f), vec_float(0.5f)),
+             vec_words(vec_float(4.0f), vec_float(2.0f), vec_float(7.0f), vec_float(-1.0f)),
+             vec_words(vec_float(9.0f), vec_float(-2.0f), vec_float(-2.0f), vec_float(-2.5f)));
+    vec_test("VCTSXS", (VX_FORM(970) & ~(0x1F << 16)) | (1 << 16), zero,
+             vec_words(vec_float(1.75f), vec_float(-3.0f), vec_float(3e9f), 0x7FC00000),
+             zero, vec_words(3, 0xFFFFFFFA, 0x7FFFFFFF, 0), VSCR::NJ | VSCR::SAT);
+    vec_test("VSPLTISH", (VX_FORM(844) & ~(0x1F << 16)) | (0x1E << 16), zero, zero, zero,
+             vec_words(0xFFFEFFFE, 0xFFFEFFFE, 0xFFFEFFFE, 0xFFFEFFFE));
+    vec_test("VSRAW", VX_FORM(900), vec_words(0x80000000, 0x40, 0, 0xFFFFFFF0),
+             vec_words(4, 33, 0, 2), zero, vec_words(0xF8000000, 0x20, 0, 0xFFFFFFFC));
+
+    // lvsl v0,0,r4
+    ppc_state.gpr[4] = 0x1003;
+    ntested++;
+    ppc_main_opcode(ppc_opcode_grabber, 0x7C00200C);
+    if (get_vr(0) != vec_fill(0x03)) {
+        cout << "Mismatch: instr=LVSL" << endl;
+        nfailed++;
+    }
+}
+#endif
+
 extern "C" int risu_main(int argc, char **argv);
+extern int test_lz4_block();
 
 int main(int argc, char* argv[]) {
     if (argc > 2 && !strcmp(argv[1], "--risu")) {
@@ -359,11 +493,22 @@ int main(int argc, char* argv[]) {
 
     read_test_float_data();
 
+#ifdef DPPC_ALTIVEC
+    cout << endl << "Testing vector instructions:" << endl;
+
+    ppc_msr_did_change(ppc_state.msr, ppc_state.msr | MSR::VEC, false);
+    vector_test();
+#endif
+
     cout << "... completed." << endl;
     cout << "--> Tested instructions: " << dec << ntested << endl;
     cout << "--> Failed: " << dec << nfailed << endl << endl;
 
     cout << "Running PPC disassembler tests..." << endl << endl;
 
-    return test_ppc_disasm();
+    test_ppc_disasm();
+
+    cout << endl << "Running LZ4 block tests..." << endl << endl;
+
+    return test_lz4_block();
 }
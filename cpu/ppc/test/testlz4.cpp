@@ -0,0 +1,101 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file LZ4 block compressor round-trip tests. */
+
+#include <utils/lz4block.h>
+#include <cinttypes>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// same as a RAM snapshot chunk
+constexpr size_t LZ4_TEST_SIZE = 64 * 1024;
+
+static int ntested, nfailed;
+
+static void check(bool cond, const string& name, const string& what) {
+    ntested++;
+    if (!cond) {
+        cout << "Mismatch: " << name << ": " << what << endl;
+        nfailed++;
+    }
+}
+
+static void round_trip(const string& name, const vector<uint8_t>& src, size_t max_size) {
+    // worst case expansion of the LZ4 block format
+    vector<uint8_t> comp(src.size() + src.size() / 255 + 16);
+    vector<uint8_t> dst(src.size());
+
+    size_t comp_size = lz4_compress_block(src.data(), src.size(), comp.data(), comp.size());
+    check(comp_size != 0, name, "compression failed");
+    check(comp_size <= max_size, name, "compressed to " + to_string(comp_size) + " bytes");
+    if (!comp_size)
+        return;
+
+    check(lz4_decompress_block(comp.data(), comp_size, dst.data(), dst.size()),
+          name, "decompression failed");
+    check(dst == src, name, "contents differ after the round trip");
+
+    // a block must expand to exactly the expected size
+    vector<uint8_t> small(src.size() - 1);
+    check(!lz4_decompress_block(comp.data(), comp_size, small.data(), small.size()),
+          name, "accepted a too small destination");
+    check(!lz4_decompress_block(comp.data(), comp_size - 1, dst.data(), dst.size()),
+          name, "accepted a truncated block");
+}
+
+int test_lz4_block() {
+    ntested = 0;
+    nfailed = 0;
+
+    vector<uint8_t> zero(LZ4_TEST_SIZE, 0);
+    round_trip("zero", zero, LZ4_TEST_SIZE / 64);
+
+    // xorshift32 output doesn't compress
+    vector<uint8_t> noise(LZ4_TEST_SIZE);
+    uint32_t state = 0x2545F491;
+    for (auto& b : noise) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        b = uint8_t(state >> 24);
+    }
+    round_trip("incompressible", noise, noise.size() + noise.size() / 255 + 16);
+
+    // the snapshot falls back to raw storage if the block doesn't shrink
+    vector<uint8_t> comp(LZ4_TEST_SIZE - 1);
+    check(!lz4_compress_block(noise.data(), noise.size(), comp.data(), comp.size()),
+          "incompressible", "fit into less than its own size");
+
+    // short runs like tables of code and data, with an occasional change
+    vector<uint8_t> pattern(LZ4_TEST_SIZE);
+    const string text = "DingusPPC 0123456789 ";
+    for (size_t i = 0; i < pattern.size(); i++)
+        pattern[i] = uint8_t(text[i % text.size()] + (i % 4099 == 0 ? 1 : 0));
+    round_trip("repetitive", pattern, LZ4_TEST_SIZE / 8);
+
+    cout << "Tested " << ntested << " LZ4 checks. Failed: " << nfailed << "." << endl;
+
+    return nfailed ? 1 : 0;
+}
@@ -21,16 +21,20 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <core/memaccess.h>
 #include <core/timermanager.h>
+#include <cpu/ppc/ppcbreakpoints.h>
 #include <cpu/ppc/ppcdisasm.h>
 #include <cpu/ppc/ppcemu.h>
 #include <cpu/ppc/ppcmmu.h>
+#include <cpu/ppc/ppctrace.h>
 #include <debugger/backtrace.h>
 #include <debugger/debugger.h>
 #include <devices/common/dbdma.h>
 #include <devices/common/hwinterrupt.h>
 #include <devices/common/ofnvram.h>
 #include <devices/floppy/swim3.h>
+#include <utils/mmioprofile.h>
 #include <utils/profiler.h>
+#include <utils/ramsnapshot.h>
 #include "symbols.h"
 #include "atraps.h"
 #if INCLUDE_KGMACROS
@@ -93,6 +97,21 @@ static void show_help() {
     cout << "  ni             -- shortcut for next" << endl;
     cout << "  until X        -- execute until address X is reached" << endl;
     cout << "  go             -- exit debugger and continue emulator execution" << endl;
+    cout << "  break X        -- stop execution when address X is reached" << endl;
+    cout << "  watch X[,N]    -- stop after writes to N bytes at address X" << endl;
+    cout << "                    N defaults to 4 and mustn't cross a page" << endl;
+    cout << "  rwatch X[,N]   -- same as watch but for reads" << endl;
+    cout << "  awatch X[,N]   -- same as watch but for reads and writes" << endl;
+    cout << "  breakpoints    -- list breakpoints and watchpoints" << endl;
+    cout << "  delete N       -- delete breakpoint N or all of them if N is 'all'" << endl;
+    cout << "  trace start F [M] [gprs] -- record executed instructions into" << endl;
+    cout << "                    a ring of M megabytes (default 256) mapped" << endl;
+    cout << "                    to file F, optionally with GPR changes" << endl;
+    cout << "  trace stop     -- stop recording and close the trace file" << endl;
+    cout << "  trace          -- show trace status" << endl;
+    cout << "  snapshot save F -- save compressed guest RAM to file F" << endl;
+    cout << "  snapshot load F [lazy] -- restore guest RAM from file F," << endl;
+    cout << "                    with lazy, pages are restored on first access" << endl;
     cout << "  regs           -- dump content of the GPRs" << endl;
     cout << "  fregs          -- dump content of the FPRs" << endl;
     cout << "  mregs          -- dump content of the MMU registers" << endl;
@@ -115,6 +134,7 @@ static void show_help() {
     cout << "                    supported subcommands:" << endl;
     cout << "                    'show' - show profile report" << endl;
     cout << "                    'reset' - reset profile variables" << endl;
+    cout << "  mmioprof on|off -- time MMIO accesses for the 'MMIO' profile" << endl;
 #ifdef PROFILER
     cout << "  profiler       -- show stats related to the processor" << endl;
 #endif
@@ -1148,6 +1168,14 @@ void DppcDebugger::enter_debugger() {
             } else {
                 cout << "Unknown/empty subcommand " << sub_cmd << endl;
             }
+        } else if (cmd == "mmioprof") {
+            cmd = "";
+            ss >> sub_cmd;
+            if (sub_cmd == "on" || sub_cmd == "off") {
+                mmio_prof_enable(sub_cmd == "on");
+            } else {
+                cout << "MMIO profiling is " << (g_mmio_prof_enabled.load(std::memory_order_relaxed) ? "on" : "off") << endl;
+            }
         }
         else if (cmd == "regs") {
             cmd = "";
@@ -1279,6 +1307,95 @@ void DppcDebugger::enter_debugger() {
             } catch (invalid_argument& exc) {
                 cout << exc.what() << endl;
             }
+        } else if (cmd == "break") {
+            cmd = "";
+            expr_str = "";
+            ss >> expr_str;
+            try {
+                int num = bp_add_exec(str2addr(expr_str));
+                if (num > 0)
+                    cout << "Breakpoint " << num << " set" << endl;
+            } catch (invalid_argument& exc) {
+                cout << exc.what() << endl;
+            }
+        } else if (cmd == "watch" || cmd == "rwatch" || cmd == "awatch") {
+            BreakpointType type = cmd == "watch" ? BP_WATCH_WRITE :
+                                  cmd == "rwatch" ? BP_WATCH_READ : BP_WATCH_RW;
+            cmd = "";
+            expr_str = "";
+            ss >> expr_str;
+            separator_pos = expr_str.find_first_of(",");
+            try {
+                uint32_t len = 4;
+                if (separator_pos != std::string::npos) {
+                    string len_str = expr_str.substr(separator_pos + 1);
+                    len = str2num(len_str);
+                    expr_str = expr_str.substr(0, separator_pos);
+                }
+                int num = bp_add_watch(str2addr(expr_str), len, type);
+                if (num > 0)
+                    cout << "Watchpoint " << num << " set" << endl;
+            } catch (invalid_argument& exc) {
+                cout << exc.what() << endl;
+            }
+        } else if (cmd == "breakpoints") {
+            cmd = "";
+            bp_print_list();
+        } else if (cmd == "delete") {
+            cmd = "";
+            expr_str = "";
+            ss >> expr_str;
+            if (expr_str == "all") {
+                bp_delete_all();
+            } else {
+                try {
+                    if (!bp_delete(str2num(expr_str)))
+                        cout << "No breakpoint number " << expr_str << endl;
+                } catch (invalid_argument& exc) {
+                    cout << exc.what() << endl;
+                }
+            }
+        } else if (cmd == "trace") {
+            cmd = "";
+            string sub_cmd;
+            ss >> sub_cmd;
+            if (sub_cmd == "start") {
+                string path, arg;
+                uint64_t size_mb = 256;
+                bool gprs = false;
+                ss >> path;
+                try {
+                    while (ss >> arg) {
+                        if (arg == "gprs")
+                            gprs = true;
+                        else
+                            size_mb = str2num(arg);
+                    }
+                    if (path.empty())
+                        cout << "Missing trace file name" << endl;
+                    else
+                        trace_start(path, size_mb, gprs);
+                } catch (invalid_argument& exc) {
+                    cout << exc.what() << endl;
+                }
+            } else if (sub_cmd == "stop") {
+                trace_stop();
+            } else {
+                trace_print_status();
+            }
+        } else if (cmd == "snapshot") {
+            cmd = "";
+            string sub_cmd, path, arg;
+            ss >> sub_cmd >> path >> arg;
+            if (path.empty()) {
+                cout << "Missing snapshot file name" << endl;
+            } else if (sub_cmd == "save") {
+                ram_snapshot_save(path);
+            } else if (sub_cmd == "load") {
+                ram_snapshot_load(path, arg == "lazy");
+            } else {
+                cout << "Unknown/empty subcommand " << sub_cmd << endl;
+            }
         } else if (cmd == "go") {
             cmd = "";
             power_on = true;
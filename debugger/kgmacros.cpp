@@ -631,23 +631,31 @@ static void get_ipc_mqueue(uint32_t p, ipc_mqueue &s) {
 
 /* ==================================================================================== */
 
-vector<kmod_info_t> get_kmod_infos() {
+uint32_t get_kmod_list() {
     static uint32_t _kmod = 0;
-    kmod_info_t info;
-    vector<kmod_info_t> kmod_infos;
     if (!_kmod)
         lookup_name_kernel("_kmod", _kmod);
     if (_kmod) {
         try {
-            uint32_t kmod = (uint32_t)kernel_read(_kmod, 4);
-            while ((!(kmod & 3)) && kmod) {
-                get_kmod_info(kmod, info);
-                kmod = info.next;
-                kmod_infos.push_back(info);
-            }
+            return (uint32_t)kernel_read(_kmod, 4);
         } catch (invalid_argument& exc) {
         }
     }
+    return 0;
+}
+
+vector<kmod_info_t> get_kmod_infos() {
+    kmod_info_t info;
+    vector<kmod_info_t> kmod_infos;
+    try {
+        uint32_t kmod = get_kmod_list();
+        while ((!(kmod & 3)) && kmod) {
+            get_kmod_info(kmod, info);
+            kmod = info.next;
+            kmod_infos.push_back(info);
+        }
+    } catch (invalid_argument& exc) {
+    }
     return kmod_infos;
 }
 
@@ -42,6 +42,7 @@ typedef struct {
     uint32_t    kmod; // guest virtual address pointer to kmod info
 } kmod_info_t;
 
+uint32_t get_kmod_list();
 std::vector<kmod_info_t> get_kmod_infos();
 
 
@@ -27,6 +27,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/memaccess.h>
 #include <cpu/ppc/ppcmmu.h>
 #include <loguru.hpp>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <vector>
 #include <string>
@@ -38,6 +40,70 @@ using namespace std;
 
 std::vector<binary_t> binaries;
 
+#if INCLUDE_KGMACROS && defined(__APPLE__)
+static void invalidate_kext_cache();
+#endif
+
+/*
+Sort the intervals of a table by address so that lookups can use a binary
+search. Ties are ordered by end address so that the last of several entries
+sharing a start address is the widest one.
+*/
+template <class T>
+static void sort_intervals(std::vector<T> &items) {
+    std::stable_sort(items.begin(), items.end(), [](const T &a, const T &b) {
+        return a.start < b.start || (a.start == b.start && a.end < b.end);
+    });
+}
+
+/*
+Symbols end where the next one begins. This is what load_symbols does for
+symbols listed in address order; doing it again after sorting makes the
+symbols of a table disjoint for any listing order.
+*/
+static void index_symbols(std::vector<symbol_t> &symbols) {
+    sort_intervals(symbols);
+    for (size_t i = 1; i < symbols.size(); i++) {
+        symbol_t &prev = symbols[i - 1];
+        if (symbols[i].start > prev.start && symbols[i].start < prev.end)
+            prev.end = symbols[i].start;
+    }
+}
+
+static void index_binaries() {
+    for (auto &bin : binaries) {
+        sort_intervals(bin.segments);
+        for (auto &seg : bin.segments) {
+            sort_intervals(seg.sections);
+            for (auto &sec : seg.sections)
+                index_symbols(sec.symbols);
+            index_symbols(seg.symbols);
+        }
+        index_symbols(bin.symbols);
+    }
+}
+
+/* Find the interval containing addr in a table sorted by sort_intervals. */
+template <class T>
+static T* find_interval(std::vector<T> &items, uint32_t addr) {
+    auto it = std::upper_bound(items.begin(), items.end(), addr,
+        [](uint32_t addr, const T &item) { return addr < item.start; });
+    if (it == items.begin())
+        return nullptr;
+    --it;
+    return addr < it->end ? &*it : nullptr;
+}
+
+/*
+A symbol ends where the next one in the file begins. Symbols listed out of
+address order are left alone here and get their end in index_symbols.
+*/
+static void end_previous_symbol(symbol_t *previous_sym, uint32_t start) {
+    if (previous_sym && start > previous_sym->start &&
+        (previous_sym->end == 0 || start < previous_sym->end))
+        previous_sym->end = start;
+}
+
 void load_symbols(const std::string &path) {
     ifstream f;
     f.open(path, std::ios::in);
@@ -97,8 +163,7 @@ void load_symbols(const std::string &path) {
                 else
                     seg.name = name;
                 binaries.back().segments.push_back(seg);
-                if (previous_sym && (previous_sym->end == 0 || start < previous_sym->end))
-                    previous_sym->end = start;
+                end_previous_symbol(previous_sym, start);
                 previous_sym = nullptr;
             }
             else if (type == 2) {
@@ -111,8 +176,7 @@ void load_symbols(const std::string &path) {
                     sec.end = end;
                     sec.name = name;
                     binaries.back().segments.back().sections.push_back(sec);
-                    if (previous_sym && (previous_sym->end == 0 || start < previous_sym->end))
-                        previous_sym->end = start;
+                    end_previous_symbol(previous_sym, start);
                     previous_sym = nullptr;
                 }
             }
@@ -122,8 +186,7 @@ void load_symbols(const std::string &path) {
                 sym.end = end;
                 sym.name = name;
                 if (binaries.back().segments.empty() || start >= binaries.back().segments.back().end ) {
-                    if (previous_sym && (previous_sym->end == 0 || start < previous_sym->end))
-                        previous_sym->end = start;
+                    end_previous_symbol(previous_sym, start);
                     sym.end = binaries.back().end;
                     binaries.back().symbols.push_back(sym);
                     previous_sym = &binaries.back().symbols.back();
@@ -131,15 +194,13 @@ void load_symbols(const std::string &path) {
                 else if (binaries.back().segments.back().sections.empty() ||
                     start >= binaries.back().segments.back().sections.back().end
                 ) {
-                    if (previous_sym && (previous_sym->end == 0 || start < previous_sym->end))
-                        previous_sym->end = start;
+                    end_previous_symbol(previous_sym, start);
                     sym.end = binaries.back().segments.back().end;
                     binaries.back().segments.back().symbols.push_back(sym);
                     previous_sym = &binaries.back().segments.back().symbols.back();
                 }
                 else {
-                    if (previous_sym && (previous_sym->end == 0 || start < previous_sym->end))
-                        previous_sym->end = start;
+                    end_previous_symbol(previous_sym, start);
                     sym.end = binaries.back().segments.back().sections.back().end;
                     binaries.back().segments.back().sections.back().symbols.push_back(sym);
                     previous_sym = &binaries.back().segments.back().sections.back().symbols.back();
@@ -147,6 +208,11 @@ void load_symbols(const std::string &path) {
             }
         } // if binaries
     } // while line
+
+    index_binaries();
+#if INCLUDE_KGMACROS && defined(__APPLE__)
+    invalidate_kext_cache();
+#endif
 }
 
 binary_t* find_binary_kind(binary_kind_t kind) {
@@ -164,10 +230,7 @@ binary_t* find_binary_name(const std::string &name) {
 }
 
 symbol_t* find_symbol(vector<symbol_t> &symbols, uint32_t addr) {
-    for (auto &sym : symbols)
-        if (sym.start <= addr && sym.end > addr)
-            return &sym;
-    return nullptr;
+    return find_interval(symbols, addr);
 }
 
 std::string get_offset_string(const std::string &name, int offset, int *offset_out) {
@@ -193,21 +256,19 @@ std::string get_name(binary_t &bin, uint32_t addr, int *offset) {
     std::string str;
     symbol_t* sym;
     if (addr >= bin.start && addr < bin.end) {
-        for (auto &seg : bin.segments) {
-            if (addr < seg.start || addr >= seg.end)
-                continue;
-            for (auto &sec : seg.sections) {
-                if (addr < sec.start || addr >= sec.end)
-                    continue;
-                sym = find_symbol(sec.symbols, addr);
+        segment_t *seg = find_interval(bin.segments, addr);
+        if (seg) {
+            section_t *sec = find_interval(seg->sections, addr);
+            if (sec) {
+                sym = find_symbol(sec->symbols, addr);
                 if (sym)
                     return get_offset_string(nullptr, sym, addr, offset);
-                return get_offset_string(&bin, sec.name, addr - sec.start, offset);
+                return get_offset_string(&bin, sec->name, addr - sec->start, offset);
             }
-            sym = find_symbol(seg.symbols, addr);
+            sym = find_symbol(seg->symbols, addr);
             if (sym)
                 return get_offset_string(nullptr, sym, addr, offset);
-            return get_offset_string(&bin, seg.name, addr - seg.start, offset);
+            return get_offset_string(&bin, seg->name, addr - seg->start, offset);
         }
         sym = find_symbol(bin.symbols, addr);
         if (sym)
@@ -271,132 +332,217 @@ bool lookup_name_kernel(const std::string &name, uint32_t &addr) {
 }
 
 #if INCLUDE_KGMACROS
-std::string get_name_kext(uint32_t addr, int *offset) {
-    std::string str;
 #ifdef __APPLE__
-    symbol_t *sym;
+/*
+The load addresses of the kernel extensions and the layout of their mach-o
+headers are read from guest memory once and kept until the kmod list changes,
+i.e. until a kext gets loaded or unloaded, or until symbols get loaded.
+The list is walked on every lookup and identified by a hash of the address
+and size of each kmod, since kexts are added to and removed from anywhere in
+the list and a freed kmod_info may be reused for a different kext.
+*/
 
-    vector<kmod_info_t> kmod_infos = get_kmod_infos();
-    for (auto &info : kmod_infos) {
-        if (!(info.address && info.hdr_size >= 4096 && info.address <= addr && info.address + info.size > addr))
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    std::string name; // segname:sectname
+    section_t *sym_sec; // matching section of the symbols file
+} kext_section_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    std::string name;
+    segment_t *sym_seg; // matching segment of the symbols file
+    std::vector<kext_section_t> sections;
+} kext_segment_t;
+
+typedef struct {
+    uint32_t start; // kmod load address, this is where the mach-o header is
+    uint32_t end;
+    uint32_t hdr_size;
+    std::string name;
+    binary_t *bin; // binary of the symbols file with the kmod name
+    std::vector<kext_segment_t> segments;
+} kext_t;
+
+static std::vector<kext_t> kext_cache;
+static uint64_t kext_cache_key = 0;
+static bool     kext_cache_valid = false;
+
+static void invalidate_kext_cache() {
+    kext_cache.clear();
+    kext_cache_valid = false;
+}
+
+static std::string get_fixed_string(const char *str, size_t max_len) {
+    return std::string(str, strnlen(str, max_len));
+}
+
+static void read_kext_segments(kext_t &kext) {
+    mach_header hdr;
+    hdr.magic       = (uint32_t)mem_read_dbg(kext.start + offsetof(mach_header, magic     ), 4);
+    if (hdr.magic != MH_MAGIC)
+        return;
+    hdr.sizeofcmds  = (uint32_t)mem_read_dbg(kext.start + offsetof(mach_header, sizeofcmds), 4);
+    if (sizeof(hdr) + hdr.sizeofcmds > kext.hdr_size)
+        return;
+    hdr.ncmds       = (uint32_t)mem_read_dbg(kext.start + offsetof(mach_header, ncmds     ), 4);
+
+    segment_command seg;
+    uint32_t seg_addr = kext.start + sizeof(hdr);
+    int seg_num = 0;
+    for (int ncmd = 0; ncmd < hdr.ncmds; ncmd++, seg_addr += seg.cmdsize) {
+        seg.cmd      = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, cmd     ), 4);
+        seg.cmdsize  = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, cmdsize ), 4);
+        if (seg.cmd != LC_SEGMENT)
             continue;
-        binary_t* bin = find_binary_name(info.name);
-
-        /*
-        Sections are not necessarily loaded where the macho-o binary says they will be loaded so
-        find the section of the kmod containing the address and match that section to one from the
-        macho-o binary info.
-        */
-
-        do {
-            mach_header hdr;
-            hdr.magic       = (uint32_t)mem_read_dbg(info.address + offsetof(mach_header, magic     ), 4);
-            if (hdr.magic != MH_MAGIC)
-                break;
-            hdr.sizeofcmds  = (uint32_t)mem_read_dbg(info.address + offsetof(mach_header, sizeofcmds), 4);
-            if (sizeof(hdr) + hdr.sizeofcmds > info.hdr_size)
-                break;
-            hdr.ncmds       = (uint32_t)mem_read_dbg(info.address + offsetof(mach_header, ncmds     ), 4);
-
-            segment_command seg;
-            int seg_addr = info.address + sizeof(hdr);
-            int seg_num = 0;
-            for (int ncmd = 0; ncmd < hdr.ncmds; ncmd++, seg_addr += seg.cmdsize) {
-                seg.cmd      = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, cmd     ), 4);
-                seg.cmdsize  = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, cmdsize ), 4);
-                if (seg.cmd != LC_SEGMENT)
-                    continue;
-                seg.vmaddr   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, vmaddr  ), 4);
-                if (addr < seg.vmaddr)
-                    continue;
-                seg.vmsize   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, vmsize  ), 4);
-                if (addr >= seg.vmaddr + seg.vmsize)
-                    continue;
-                seg.nsects   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, nsects  ), 4);
-                uint64_t val;
-                for (int i = 0; i < 2; i++) {
-                    val = mem_read_dbg(seg_addr + offsetof(segment_command, segname) + i * 8, 8);
-                    WRITE_QWORD_BE_A(&(((uint64_t*)(&seg.segname))[i]), val);
-                    if (!val) break;
+        seg.vmaddr   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, vmaddr  ), 4);
+        seg.vmsize   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, vmsize  ), 4);
+        seg.nsects   = (uint32_t)mem_read_dbg(seg_addr + offsetof(segment_command, nsects  ), 4);
+        uint64_t val;
+        for (int i = 0; i < 2; i++) {
+            val = mem_read_dbg(seg_addr + offsetof(segment_command, segname) + i * 8, 8);
+            WRITE_QWORD_BE_A(&(((uint64_t*)(&seg.segname))[i]), val);
+            if (!val) break;
+        }
+
+        kext_segment_t kseg;
+        kseg.start = seg.vmaddr;
+        kseg.end = seg.vmaddr + seg.vmsize;
+        if (seg.segname[0])
+            kseg.name = get_fixed_string(seg.segname, sizeof(seg.segname));
+        else
+            kseg.name = "seg#" + std::to_string(seg_num);
+        seg_num++;
+        kseg.sym_seg = nullptr;
+        if (kext.bin) {
+            for (auto &loop_seg : kext.bin->segments) {
+                if (loop_seg.name == kseg.name) {
+                    kseg.sym_seg = &loop_seg;
+                    break;
                 }
+            }
+        }
 
-                std::string segname;
-                if (seg.segname[0])
-                    segname = seg.segname;
-                else
-                    segname = "seg#" + std::to_string(seg_num);
-                segment_t *found_seg = nullptr;
-                if (bin) {
-                    for (auto &loop_seg : bin->segments) {
-                        if (loop_seg.name == segname) {
-                            found_seg = &loop_seg;
-                            break;
-                        }
+        section sec;
+        uint32_t sec_addr = seg_addr + sizeof(seg);
+        for (int nsect = 0; nsect < seg.nsects; nsect++, sec_addr += sizeof(sec)) {
+            sec.addr      = (uint32_t)mem_read_dbg(sec_addr + offsetof(section, addr     ), 4);
+            sec.size      = (uint32_t)mem_read_dbg(sec_addr + offsetof(section, size     ), 4);
+            for (int i = 0; i < 2; i++) {
+                val = mem_read_dbg(sec_addr + offsetof(section, sectname) + i * 8, 8);
+                WRITE_QWORD_BE_A(&(((uint64_t*)(&sec.sectname))[i]), val);
+                if (!val) break;
+            }
+            for (int i = 0; i < 2; i++) {
+                val = mem_read_dbg(sec_addr + offsetof(section, segname ) + i * 8, 8);
+                WRITE_QWORD_BE_A(&(((uint64_t*)(&sec.segname ))[i]), val);
+                if (!val) break;
+            }
+
+            kext_section_t ksec;
+            ksec.start = sec.addr;
+            ksec.end = sec.addr + sec.size;
+            ksec.name = get_fixed_string(sec.segname, sizeof(sec.segname)) + ":" +
+                        get_fixed_string(sec.sectname, sizeof(sec.sectname));
+            ksec.sym_sec = nullptr;
+            if (kseg.sym_seg) {
+                for (auto &loop_sec : kseg.sym_seg->sections) {
+                    if (loop_sec.end - loop_sec.start == sec.size && loop_sec.name == ksec.name) {
+                        ksec.sym_sec = &loop_sec;
+                        break;
                     }
                 }
-                seg_num++;
-
-                section sec;
-                int sec_addr = seg_addr + sizeof(seg);
-                for (int nsect = 0; nsect < seg.nsects; nsect++, sec_addr += sizeof(sec)) {
-                    sec.addr      = (uint32_t)mem_read_dbg(sec_addr + offsetof(section, addr     ), 4);
-                    if (addr < sec.addr)
-                        continue;
-                    sec.size      = (uint32_t)mem_read_dbg(sec_addr + offsetof(section, size     ), 4);
-                    if (addr >= sec.addr + sec.size)
-                        continue;
-                    for (int i = 0; i < 2; i++) {
-                        val = mem_read_dbg(sec_addr + offsetof(section, sectname) + i * 8, 8);
-                        WRITE_QWORD_BE_A(&(((uint64_t*)(&sec.sectname))[i]), val);
-                        if (!val) break;
-                    }
-                    for (int i = 0; i < 2; i++) {
-                        val = mem_read_dbg(sec_addr + offsetof(section, segname ) + i * 8, 8);
-                        WRITE_QWORD_BE_A(&(((uint64_t*)(&sec.segname ))[i]), val);
-                        if (!val) break;
-                    }
+            }
+            kseg.sections.push_back(ksec);
+        }
+        sort_intervals(kseg.sections);
+        kext.segments.push_back(kseg);
+    }
+    sort_intervals(kext.segments);
+}
 
-                    section_t *found_sec = nullptr;
-                    if (found_seg) {
-                        for (auto &loop_sec : found_seg->sections) {
-                            if (loop_sec.end - loop_sec.start == sec.size &&
-                                loop_sec.name == std::string(sec.segname) + ":" + sec.sectname
-                            ) {
-                                found_sec = &loop_sec;
-                                break;
-                            }
-                        }
-                    }
+static void update_kext_cache() {
+    std::vector<kmod_info_t> kmod_infos = get_kmod_infos();
 
-                    if (found_sec) {
-                        sym = find_symbol(found_sec->symbols, addr - sec.addr + found_sec->start);
-                        if (sym)
-                            return get_offset_string(nullptr, sym, addr - sec.addr + found_sec->start, offset);
-                        return get_offset_string(bin, found_sec->name, addr - sec.addr, offset);
-                    }
-                    return get_offset_string(bin, std::string(sec.segname) + ":" + sec.sectname, addr - sec.addr, offset);
-                } // for section
+    // FNV-1a over the address and size of each kmod
+    uint64_t key = 0xCBF29CE484222325ULL;
+    for (auto &info : kmod_infos) {
+        key = (key ^ info.address) * 0x100000001B3ULL;
+        key = (key ^ info.size) * 0x100000001B3ULL;
+    }
+    if (kext_cache_valid && key == kext_cache_key)
+        return;
 
-                if (found_seg) {
-                    sym = find_symbol(found_seg->symbols, addr - seg.vmaddr + found_seg->start);
-                    if (sym)
-                        return get_offset_string(nullptr, sym, addr - seg.vmaddr + found_seg->start, offset);
-                }
-                return get_offset_string(bin, segname, addr - seg.vmaddr, offset);
-            } // for segment command
+    kext_cache.clear();
+    for (auto &info : kmod_infos) {
+        if (!(info.address && info.hdr_size >= 4096))
+            continue;
+        kext_t kext;
+        kext.start = info.address;
+        kext.end = info.address + info.size;
+        kext.hdr_size = info.hdr_size;
+        kext.name = get_fixed_string(info.name, sizeof(info.name));
+        kext.bin = find_binary_name(kext.name);
+        read_kext_segments(kext);
+        kext_cache.push_back(std::move(kext));
+    }
+    sort_intervals(kext_cache);
+    kext_cache_key = key;
+    kext_cache_valid = true;
+}
+#endif
 
-        } while(0);
+std::string get_name_kext(uint32_t addr, int *offset) {
+    std::string str;
+#ifdef __APPLE__
+    symbol_t *sym;
 
-        if (bin && addr >= info.address + info.hdr_size && addr < info.address + info.hdr_size + bin->end - bin->start) {
-            sym = find_symbol(bin->symbols, addr - (info.address + info.hdr_size) + bin->start);
+    update_kext_cache();
+    kext_t *kext = find_interval(kext_cache, addr);
+    if (!kext)
+        return str;
+    binary_t *bin = kext->bin;
+
+    /*
+    Sections are not necessarily loaded where the macho-o binary says they will be loaded so
+    find the section of the kmod containing the address and match that section to one from the
+    macho-o binary info.
+    */
+
+    kext_segment_t *seg = find_interval(kext->segments, addr);
+    if (seg) {
+        kext_section_t *sec = find_interval(seg->sections, addr);
+        if (sec) {
+            if (sec->sym_sec) {
+                uint32_t sym_addr = addr - sec->start + sec->sym_sec->start;
+                sym = find_symbol(sec->sym_sec->symbols, sym_addr);
+                if (sym)
+                    return get_offset_string(nullptr, sym, sym_addr, offset);
+                return get_offset_string(bin, sec->sym_sec->name, addr - sec->start, offset);
+            }
+            return get_offset_string(bin, sec->name, addr - sec->start, offset);
+        }
+
+        if (seg->sym_seg) {
+            uint32_t sym_addr = addr - seg->start + seg->sym_seg->start;
+            sym = find_symbol(seg->sym_seg->symbols, sym_addr);
             if (sym)
-                return get_offset_string(nullptr, sym, addr - (info.address + info.hdr_size) + bin->start, offset);
-            return get_offset_string(nullptr, bin->name, addr - (info.address + info.hdr_size), offset);
+                return get_offset_string(nullptr, sym, sym_addr, offset);
         }
+        return get_offset_string(bin, seg->name, addr - seg->start, offset);
+    }
 
-        return get_offset_string(nullptr, info.name, addr - (info.address + info.hdr_size), offset);
-    } // for kmod
+    uint32_t body_addr = kext->start + kext->hdr_size;
+    if (bin && addr >= body_addr && addr < body_addr + bin->end - bin->start) {
+        sym = find_symbol(bin->symbols, addr - body_addr + bin->start);
+        if (sym)
+            return get_offset_string(nullptr, sym, addr - body_addr + bin->start, offset);
+        return get_offset_string(nullptr, bin->name, addr - body_addr, offset);
+    }
 
+    return get_offset_string(nullptr, kext->name, addr - body_addr, offset);
 #endif
     return str;
 }
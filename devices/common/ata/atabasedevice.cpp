@@ -34,6 +34,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 using namespace ata_interface;
 
+// how late command completion may be signaled so it can share a wakeup
+// with other timers, drivers poll or wait for the interrupt anyway
+constexpr uint64_t ATA_COMPLETION_SLACK = USECS_TO_NSECS(1);
+
 AtaBaseDevice::AtaBaseDevice(const std::string name, uint8_t type)
     : HWComponent(name)
 {
@@ -143,14 +147,14 @@ void AtaBaseDevice::write(const uint8_t reg_addr, const uint16_t value) {
                     TimerManager::get_instance()->add_oneshot_timer(USECS_TO_NSECS(100), [this](uint64_t, uint64_t) {
                         this->r_status &= ~BSY;
                         this->update_intrq(1);
-                    });
+                    }, ATA_COMPLETION_SLACK);
                 } else {
                     this->cur_data_ptr = this->data_ptr;
                     this->chunk_cnt = std::min(this->xfer_cnt, this->chunk_size);
                     //LOG_F(INFO, "%s: write needs more data (left: 0x%x)", this->get_name_and_unit_address().c_str(), xfer_cnt);
                     TimerManager::get_instance()->add_oneshot_timer(USECS_TO_NSECS(100), [this](uint64_t, uint64_t) {
                         this->signal_data_ready();
-                    });
+                    }, ATA_COMPLETION_SLACK);
                 }
             }
         }
@@ -243,7 +247,7 @@ int AtaBaseDevice::pull_data(uint8_t *buf, int len) {
         TimerManager::get_instance()->add_oneshot_timer(500, [this](uint64_t, uint64_t) {
             this->r_status &= ~(BSY | DRQ);
             this->update_intrq(1);
-        });
+        }, ATA_COMPLETION_SLACK);
     } else {
         this->r_status &= ~BSY;
         this->r_status |= DRQ;
@@ -270,7 +274,7 @@ int AtaBaseDevice::push_data(uint8_t *buf, int len) {
         TimerManager::get_instance()->add_oneshot_timer(500, [this](uint64_t, uint64_t) {
             this->r_status &= ~(BSY | DRQ);
             this->update_intrq(1);
-        });
+        }, ATA_COMPLETION_SLACK);
     } else {
         this->r_status &= ~BSY;
         this->r_status |= DRQ;
@@ -30,6 +30,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/common/hwinterrupt.h>
 #include <devices/common/mmiodevice.h>
 #include <devices/common/pci/pcibase.h>
+#include <devices/memctrl/dirtylog.h>
+#include <utils/stats.h>
 
 #include <cinttypes>
 #include <cstring>
@@ -43,6 +45,10 @@ namespace loguru {
 
 extern std::string hex_string(const uint8_t *p, int len);
 
+// the command interpreter latency isn't observable by the guest, let its
+// timer be batched with other wakeups
+constexpr uint64_t DBDMA_INTERPRET_SLACK = 500;
+
 void DMAChannel::set_callbacks(DbdmaCallback start_cb, DbdmaCallback stop_cb) {
     this->start_cb = start_cb;
     this->stop_cb  = stop_cb;
@@ -72,13 +78,24 @@ void DMAChannel::init_cmd() {
     this->is_flushing = false;
 }
 
+void DMAChannel::map_data_cmd(const DMACmd& cmd_struct) {
+    MapDmaResult res = mmu_map_dma_mem(cmd_struct.address, cmd_struct.req_count, false);
+    this->queue_data = res.host_va;
+    this->queue_addr = cmd_struct.address;
+    this->res_count  = cmd_struct.req_count;
+    this->queue_len  = cmd_struct.req_count; // don't set queue_len until all the other fields are set
+    LOG_F(DBDMA, "%s: Will transfer %d bytes %s 0x%08x (host:0x%llx)", this->get_name().c_str(), this->queue_len,
+        this->cur_cmd > DBDMA_Cmd::OUTPUT_LAST ? "to" : "from", cmd_struct.address, (uint64_t)(this->queue_data));
+}
+
 void DMAChannel::interpret_cmd() {
     DMACmd cmd_struct;
-    MapDmaResult res;
 
     init_cmd();
 
     this->cur_host = fetch_cmd(this->cmd_ptr, &cmd_struct, &this->cur_is_writable);
+    this->cur_addr = this->cmd_ptr;
+    stat_inc(STAT_DBDMA_COMMANDS);
 
     this->ch_stat &= ~CH_STAT_WAKE; // clear wake bit (DMA spec, 5.5.3.4)
 
@@ -100,12 +117,7 @@ void DMAChannel::interpret_cmd() {
             break;
         }
         if (cmd_struct.req_count) {
-            res = mmu_map_dma_mem(cmd_struct.address, cmd_struct.req_count, false);
-            this->queue_data = res.host_va;
-            this->res_count  = cmd_struct.req_count;
-            this->queue_len  = cmd_struct.req_count; // don't set queue_len until all the other fields are set
-            LOG_F(DBDMA, "%s: Will transfer %d bytes %s 0x%08x (host:0x%llx)", this->get_name().c_str(), this->queue_len,
-                this->cur_cmd > DBDMA_Cmd::OUTPUT_LAST ? "to" : "from", cmd_struct.address, (uint64_t)(this->queue_data));
+            this->map_data_cmd(cmd_struct);
             switch (this->cur_cmd) {
             case DBDMA_Cmd::OUTPUT_MORE:
             case DBDMA_Cmd::OUTPUT_LAST:
@@ -156,6 +168,7 @@ void DMAChannel::update_cmd() {
         // all INPUT and OUTPUT commands including LOAD_QUAD and STORE_QUAD update cmd.resCount
         if (this->cur_cmd < DBDMA_Cmd::NOP)
             WRITE_WORD_LE_A(&this->cur_host->res_count, this->res_count);
+        dirty_log_dma_write(this->cur_addr, 16);
     }
     this->ch_stat &= ~(CH_STAT_FLUSH | CH_STAT_BT);
     this->is_flushing = false;
@@ -275,7 +288,7 @@ void DMAChannel::dbdma_loop_timed(bool is_immediate) {
         if (continue_loop)
             this->interpret_timer_id = TimerManager::get_instance()->add_oneshot_timer(500, [this](uint64_t, uint64_t) {
                 this->dbdma_loop_timed();
-            });
+            }, DBDMA_INTERPRET_SLACK);
         else
             this->interpret_timer_id = 0;
     }
@@ -295,7 +308,7 @@ void DMAChannel::schedule_cmd(bool is_immediate) {
     }
     this->interpret_timer_id = TimerManager::get_instance()->add_oneshot_timer(500, [this](uint64_t, uint64_t) {
         this->dbdma_loop_timed();
-    });
+    }, DBDMA_INTERPRET_SLACK);
 }
 
 void DMAChannel::xfer_quad(bool is_store) {
@@ -333,6 +346,7 @@ void DMAChannel::xfer_quad(bool is_store) {
                 case 2: WRITE_WORD_LE_A(res.host_va, cmd_arg); break;
                 case 4: WRITE_DWORD_LE_A(res.host_va, cmd_arg); break;
             }
+            dirty_log_dma_write(addr, xfer_size);
             LOG_F(DBDMA, "%s: STORE_QUAD 0x%08x.%c = %0*x", this->get_name().c_str(), addr,
                 SIZE_ARG(xfer_size), xfer_size * 2,
                 uint32_t(cmd_arg & ((uint64_t(1) << (xfer_size * 8)) - 1))
@@ -354,8 +368,10 @@ void DMAChannel::xfer_quad(bool is_store) {
         }
         if (!this->cur_is_writable)
             LOG_F(ERROR, "%s: DMACmd is not writeable!", this->get_name().c_str());
-        else
+        else {
             WRITE_DWORD_LE_A(&this->cur_host->cmd_arg, value);
+            dirty_log_dma_write(this->cur_addr, 16);
+        }
     }
 
     if (this->cur_host->cmd_bits & 0xC)
@@ -609,6 +625,12 @@ void DMAChannel::xfer_from_device() {
     VLOG_SCOPE_F(loguru::Verbosity_DBDMA, "%s: xfer_from_device() (ChannelStatus 0x%04x)",
         this->get_name().c_str(), this->ch_stat);
 
+    int bulk_len = this->dev_obj->bulk_xfer_size(this);
+    if (bulk_len > this->queue_len) {
+        this->bulk_device_xfer(DMA_DIR_FROM_DEV, bulk_len);
+        return;
+    }
+
     int got_bytes = this->dev_obj->xfer_from(this, this->queue_data, this->queue_len);
     if (got_bytes > this->queue_len)
         ABORT_F("%s: got_bytes > this->queue_len", this->get_name().c_str());
@@ -617,10 +639,13 @@ void DMAChannel::xfer_from_device() {
     else
         LOG_F(DBDMA, "%s: Return queue_len = %d data", this->get_name().c_str(), this->queue_len);
 
+    dirty_log_dma_write(this->queue_addr, got_bytes);
+
     uint8_t* p_data = this->queue_data;
     this->res_count -= got_bytes;
     this->queue_len -= got_bytes;
     this->queue_data += got_bytes;
+    this->queue_addr += got_bytes;
 
     LOG_F(DBDMA, "%s: Transferred %d bytes from 0x%llx (next:0x%llx, count:%d, queue:%d) : %s",
         this->get_name().c_str(), got_bytes, (uint64_t)(p_data), (uint64_t)(this->queue_data),
@@ -637,6 +662,12 @@ void DMAChannel::xfer_to_device() {
     VLOG_SCOPE_F(loguru::Verbosity_DBDMA, "%s: xfer_to_device() (ChannelStatus 0x%04x)",
         this->get_name().c_str(), this->ch_stat);
 
+    int bulk_len = this->dev_obj->bulk_xfer_size(this);
+    if (bulk_len > this->queue_len) {
+        this->bulk_device_xfer(DMA_DIR_TO_DEV, bulk_len);
+        return;
+    }
+
     int got_bytes = this->dev_obj->xfer_to(this, this->queue_data, this->queue_len);
     if (got_bytes > this->queue_len)
         ABORT_F("%s: got_bytes > this->queue_len", this->get_name().c_str());
@@ -649,6 +680,7 @@ void DMAChannel::xfer_to_device() {
     this->res_count -= got_bytes;
     this->queue_len -= got_bytes;
     this->queue_data += got_bytes;
+    this->queue_addr += got_bytes;
 
     LOG_F(DBDMA, "%s: Transferred %d bytes to 0x%llx (next:0x%llx, count:%d, queue:%d) : %s",
         this->get_name().c_str(), got_bytes, (uint64_t)(p_data), (uint64_t)(this->queue_data),
@@ -673,6 +705,103 @@ void DMAChannel::xfer_retry() {
     this->schedule_cmd();
 }
 
+// Can a bulk transfer continue from a data command into the next one?
+static bool bulk_continues(DBDMA_Cmd cmd, uint8_t cmd_bits, const DMACmd& next, XferDir dir) {
+    // *_LAST ends the transfer, wait and branch bits need the interpreter
+    if (cmd == DBDMA_Cmd::OUTPUT_LAST || cmd == DBDMA_Cmd::INPUT_LAST || (cmd_bits & 0xF))
+        return false;
+
+    DBDMA_Cmd next_cmd = DBDMA_Cmd(next.cmd_key >> 4);
+    if (next_cmd > DBDMA_Cmd::INPUT_LAST || (next.cmd_key & 7) || !next.req_count)
+        return false;
+
+    return (next_cmd >= DBDMA_Cmd::INPUT_MORE) == (dir == DMA_DIR_FROM_DEV);
+}
+
+// Number of bytes, up to max_len, that can be moved in direction dir without
+// stopping the command interpreter: the rest of the current INPUT/OUTPUT
+// command plus the following ones of the same kind up to a *_LAST command
+// or a command that waits or branches.
+uint32_t DMAChannel::bulk_capacity(XferDir dir, uint32_t max_len) {
+    if (!this->is_active() || this->is_paused || !this->cmd_in_progress ||
+        this->queue_len <= 0 || this->xfer_dir != dir)
+        return 0;
+
+    uint32_t  avail    = this->queue_len;
+    DBDMA_Cmd cmd      = this->cur_cmd;
+    uint8_t   cmd_bits = this->cur_host->cmd_bits;
+
+    for (uint32_t cmd_addr = this->cmd_ptr + 16; avail < max_len; cmd_addr += 16) {
+        DMACmd next;
+        fetch_cmd(cmd_addr, &next, nullptr);
+        if (!bulk_continues(cmd, cmd_bits, next, dir))
+            break;
+        avail   += next.req_count;
+        cmd      = DBDMA_Cmd(next.cmd_key >> 4);
+        cmd_bits = next.cmd_bits;
+    }
+
+    return std::min(avail, max_len);
+}
+
+// Walk the descriptors the way the interpreter would. The caller makes sure
+// len doesn't exceed bulk_capacity() so every command entered is a data one.
+void DMAChannel::bulk_copy(XferDir dir, uint8_t* buf, uint32_t len) {
+    while (len) {
+        uint32_t chunk = std::min(len, uint32_t(this->queue_len));
+        if (dir == DMA_DIR_TO_DEV) {
+            std::memcpy(buf, this->queue_data, chunk);
+        } else {
+            std::memcpy(this->queue_data, buf, chunk);
+            dirty_log_dma_write(this->queue_addr, chunk);
+        }
+        this->queue_data += chunk;
+        this->queue_addr += chunk;
+        this->res_count  -= chunk;
+        this->queue_len  -= chunk;
+        buf += chunk;
+        len -= chunk;
+
+        // the interpreter completes the last command
+        if (!len)
+            break;
+
+        this->finish_cmd();
+
+        DMACmd cmd_struct;
+        init_cmd();
+        this->cur_host = fetch_cmd(this->cmd_ptr, &cmd_struct, &this->cur_is_writable);
+        this->cur_addr = this->cmd_ptr;
+        stat_inc(STAT_DBDMA_COMMANDS);
+        this->ch_stat &= ~CH_STAT_WAKE;
+        this->cur_cmd  = DBDMA_Cmd(cmd_struct.cmd_key >> 4);
+        this->xfer_dir = dir;
+        this->map_data_cmd(cmd_struct);
+    }
+}
+
+// Hand everything the device asked for to it in one call.
+void DMAChannel::bulk_device_xfer(XferDir dir, uint32_t len) {
+    len = this->bulk_capacity(dir, len);
+    this->bulk_buf.resize(len);
+
+    if (dir == DMA_DIR_TO_DEV) {
+        this->bulk_copy(dir, this->bulk_buf.data(), len);
+        int got_bytes = this->dev_obj->xfer_to(this, this->bulk_buf.data(), len);
+        if (got_bytes != int(len))
+            LOG_F(ERROR, "%s: device took %d of %d bulk bytes", this->get_name().c_str(),
+                got_bytes, len);
+    } else {
+        int got_bytes = this->dev_obj->xfer_from(this, this->bulk_buf.data(), len);
+        if (got_bytes > int(len))
+            ABORT_F("%s: got_bytes > bulk length", this->get_name().c_str());
+        this->bulk_copy(dir, this->bulk_buf.data(), got_bytes);
+    }
+
+    LOG_F(DBDMA, "%s: Bulk transfer of %d bytes %s device", this->get_name().c_str(), len,
+        dir == DMA_DIR_TO_DEV ? "to" : "from");
+}
+
 bool DMAChannel::dma_is_ready() {
     if (!this->is_active() ||
         this->xfer_dir == DMA_DIR_UNDEF || this->cur_cmd >= DBDMA_Cmd::NOP
@@ -710,6 +839,7 @@ DmaPullResult DMAChannel::pull_data(uint32_t req_len, uint32_t *avail_len, uint8
         this->queue_len -= req_len;
         this->res_count -= req_len;
         this->queue_data += req_len;
+        this->queue_addr += req_len;
         LOG_F(DBDMA, "%s: Will pull %d bytes from 0x%llx (next:0x%llx, count:%d, queue:%d) : %s",
             this->get_name().c_str(), *avail_len, (uint64_t)(*p_data), (uint64_t)(this->queue_data),
             this->res_count, this->queue_len, hex_string(*p_data, *avail_len).c_str()
@@ -736,7 +866,9 @@ DmaPushResult DMAChannel::push_data(const char* src_ptr, int len) {
     if (this->queue_len > 0) {
         len = std::min((int)this->queue_len, len);
         std::memcpy(this->queue_data, src_ptr, len);
+        dirty_log_dma_write(this->queue_addr, len);
         this->queue_data += len;
+        this->queue_addr += len;
         this->res_count  -= len;
         this->queue_len  -= len;
         if ((uint64_t)(this->queue_data - len) < 5 || (uint64_t)(this->queue_data) < 5) {
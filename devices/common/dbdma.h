@@ -34,6 +34,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <cinttypes>
 #include <functional>
 #include <mutex>
+#include <vector>
 
 class InterruptCtrl;
 
@@ -158,6 +159,10 @@ protected:
     void xfer_from_device();
     void xfer_to_device();
     void xfer_retry_internal();
+    void map_data_cmd(const DMACmd& cmd_struct);
+    uint32_t bulk_capacity(XferDir dir, uint32_t max_len);
+    void bulk_copy(XferDir dir, uint8_t* buf, uint32_t len);
+    void bulk_device_xfer(XferDir dir, uint32_t len);
 
     void start(void);
     void resume(void);
@@ -177,6 +182,7 @@ private:
     uint32_t cmd_ptr        = 0;
     int32_t  queue_len      = 0;
     uint8_t* queue_data     = 0;
+    uint32_t queue_addr     = 0; // guest address of queue_data
     uint32_t res_count      = 0;
     uint32_t int_select     = 0;
     uint32_t branch_select  = 0;
@@ -187,8 +193,11 @@ private:
     bool     is_flushing     = false;
     DBDMA_Cmd cur_cmd;
     DMACmd * cur_host = nullptr;   // host virtual address of current command
+    uint32_t cur_addr = 0;         // guest address of current command
     bool     cur_is_writable = false;  // current command is writable
 
+    std::vector<uint8_t> bulk_buf;     // staging buffer for bulk device transfers
+
     // Interrupt related stuff
     InterruptCtrl* int_ctrl = nullptr;
     uint64_t       irq_id   = 0;
@@ -116,6 +116,9 @@ public:
     virtual int  xfer_from(DmaChannel */*ch_obj*/, uint8_t */*buf*/, int len) { return len; }
     virtual int  xfer_to(DmaChannel */*ch_obj*/, uint8_t */*buf*/, int len) { return len; }
     virtual int  tell_xfer_size(DmaChannel */*ch_obj*/) { return 0; }
+    // Bytes the device accepts or delivers in a single xfer_to/xfer_from call
+    // right now, the channel may gather or scatter them across descriptors.
+    virtual int  bulk_xfer_size(DmaChannel */*ch_obj*/) { return 0; }
 
 protected:
     DmaChannel* channel_obj = nullptr;
@@ -26,6 +26,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/common/hwcomponent.h>
 #include <devices/common/nvram.h>
 #include <devices/common/ofnvram.h>
+#include <devices/memctrl/dirtylog.h>
 #include <devices/deviceregistry.h>
 
 #include <cinttypes>
@@ -90,8 +91,10 @@ void NVram::prepare_read() {
 void NVram::finish_write() {
     if (this->copland_nvram_host) {
         OfConfigHdrAppl *hdr_copland = (OfConfigHdrAppl *)this->copland_nvram_host;
-        if (OfConfigAppl::validate_header(*hdr_copland))
+        if (OfConfigAppl::validate_header(*hdr_copland)) {
             memcpy(this->copland_nvram_host, this->storage.get(), this->ram_size);
+            dirty_log_dma_write(this->copland_nvram_phys, this->ram_size);
+        }
     }
 }
 
@@ -138,6 +141,7 @@ void NVram::save() {
 void NVram::set_copland_nvram(uint32_t phys) {
     MapDmaResult res = mmu_map_dma_mem(phys, this->ram_size, false);
     this->copland_nvram_host = res.host_va;
+    this->copland_nvram_phys = phys;
     OfConfigHdrAppl *hdr_dingus = (OfConfigHdrAppl *)this->storage.get();
 
     if (OfConfigAppl::validate_header(*hdr_dingus)) {
@@ -65,6 +65,7 @@ private:
     std::unique_ptr<uint8_t[]>  storage;
     uint32_t of_nvram_offset = 0;
     uint8_t* copland_nvram_host = nullptr;
+    uint32_t copland_nvram_phys = 0;
 
     void init();
     void save();
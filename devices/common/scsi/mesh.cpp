@@ -321,8 +321,12 @@ static const DeviceDescription MeshDev_Descriptor = {
 
 REGISTER_DEVICE(MeshDev, MeshDev_Descriptor);
 
+static const PropMap ScsiMesh_Properties = {
+    {"scsi_fast", new BinProperty(0)},
+};
+
 static const DeviceDescription ScsiMesh_Descriptor = {
-    ScsiBus::create, {"MeshDev@7"}, {}, HWCompType::SCSI_BUS
+    ScsiBus::create, {"MeshDev@7"}, ScsiMesh_Properties, HWCompType::SCSI_BUS
 };
 
 REGISTER_DEVICE(ScsiMesh, ScsiMesh_Descriptor);
@@ -21,16 +21,22 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 /** @file NCR53C825 SCSI controller emulation. */
 
+#include <core/memaccess.h>
 #include <core/timermanager.h>
+#include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <devices/common/dmacore.h>
 #include <devices/common/hwcomponent.h>
 #include <devices/common/hwinterrupt.h>
 #include <devices/common/scsi/sc53c825.h>
 #include <devices/deviceregistry.h>
+#include <devices/memctrl/memctrlbase.h>
 #include <loguru.hpp>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
+#include <vector>
 
 namespace loguru {
     enum : Verbosity {
@@ -292,6 +298,21 @@ enum reg53C825 {
         GPIO4   = 1,                                // GPIO4_EN–GPIO2_EN (GPIO Enable)
 //        GPIO
         GPIO10  = 0,                                // GPIO1_EN–GPIO0_EN (GPIO Enable)
+    STIME0      = 0x48,                     // RW   // SCSI Timer Zero
+        HTH     = 4, HTH_mask = 15,                 // Handshake-to-Handshake Timer Period
+        SEL_TO  = 0, SEL_mask = 15,                 // Selection Time-Out
+    STIME1      = 0x49,                     // RW   // SCSI Timer One
+    RESPID0     = 0x4A,                     // RW   // Response ID Zero
+    RESPID1     = 0x4B,                     // RW   // Response ID One
+    STEST0      = 0x4C,                     // RO   // SCSI Test Zero
+    STEST1      = 0x4D,                     // RW   // SCSI Test One
+    STEST2      = 0x4E,                     // RW   // SCSI Test Two
+    STEST3      = 0x4F,                     // RW   // SCSI Test Three
+    SIDL        = 0x50,                     // RO   // SCSI Input Data Latch
+    SODL        = 0x54,                     // RW   // SCSI Output Data Latch
+    SBDL        = 0x58,                     // RO   // SCSI Bus Data Lines
+    SCRATCHB    = 0x5C,                     // RW   // Scratch Register B
+    SCRATCHB1, SCRATCHB2, SCRATCHB3,
         
 
 
@@ -386,17 +407,25 @@ Sc53C825::Sc53C825(const std::string &dev_name, uint8_t chip_id, uint8_t my_id)
 
     this->chip_id = chip_id;
     reset_device();
+
+    this->scripts_ram = std::unique_ptr<uint8_t[]>(new uint8_t[SCRIPTS_RAM_SIZE]());
+    this->scripts_reset();
 }
 
 void Sc53C825::change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new, int bar_num) {
-    if (bar_num && aperture != aperture_new) {
-        if (aperture)
+    if (aperture != aperture_new) {
+        // BAR 0 is in I/O space, see io_access_allowed()
+        if (bar_num && aperture)
             this->host_instance->pci_unregister_mmio_region(aperture, aperture_size, this);
 
         aperture = aperture_new;
         if (bar_num && aperture)
             this->host_instance->pci_register_mmio_region(aperture, aperture_size, this);
 
+        // decoded scripts may refer to the old location of the SCRIPTS RAM
+        if (bar_num == 2)
+            this->scripts_cache.flush();
+
         LOG_F(INFO, "%s: aperture[%d] set to 0x%08X", this->name.c_str(), bar_num, aperture);
     }
 }
@@ -450,8 +479,10 @@ void Sc53C825::pci_cfg_write(uint32_t reg_offs, uint32_t value, const AccessDeta
 }
 
 int Sc53C825::io_access_allowed(uint32_t offset) {
-    for (int bar = 0; bar < 5; bar++ ) {
-        if (offset >= aperture_base[bar] && offset <= aperture_size[bar]) {
+    for (uint32_t bar = 0; bar < this->aperture_count; bar++ ) {
+        if (!(aperture_flag[bar] & 1) || !aperture_base[bar])
+            continue;
+        if (offset >= aperture_base[bar] && offset < aperture_base[bar] + aperture_size[bar]) {
             if (this->command & 1) {
                 return bar;
             }
@@ -467,11 +498,7 @@ bool Sc53C825::pci_io_read(uint32_t offset, uint32_t size, uint32_t* res) {
     if (bar < 0) {
         return false;
     }
-    LOG_F(
-        WARNING, "%s: read  aperture_base[%d] @%08x.%c", this->name.c_str(), bar, offset,
-        SIZE_ARG(size)
-    );
-    *res = 0;
+    *res = this->regs_read(offset - this->aperture_base[bar], size);
     return true;
 }
 
@@ -480,15 +507,18 @@ bool Sc53C825::pci_io_write(uint32_t offset, uint32_t value, uint32_t size) {
     if (bar < 0) {
         return false;
     }
-    LOG_F(
-        WARNING, "%s: write aperture_base[%d] @%08x.%c = %0*x", this->name.c_str(), bar, offset,
-        SIZE_ARG(size), size * 2, BYTESWAP_SIZED(value, size)
-    );
+    this->regs_write(offset - this->aperture_base[bar], value, size);
     return true;
 }
 
 uint32_t Sc53C825::read(uint32_t rgn_start, uint32_t offset, int size)
 {
+    if (rgn_start == this->aperture_base[1] && offset < aperture_size[1])
+        return this->regs_read(offset, size);
+
+    if (rgn_start == this->aperture_base[2] && offset < aperture_size[2])
+        return read_mem(&this->scripts_ram[offset], size);
+
     if (rgn_start == this->aperture_base[5] && offset < aperture_size[5]) {
         LOG_F(
             WARNING, "%s: read  aperture_base[5] @%08x.%c", this->name.c_str(), offset,
@@ -502,7 +532,13 @@ uint32_t Sc53C825::read(uint32_t rgn_start, uint32_t offset, int size)
 
 void Sc53C825::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size)
 {
-    if (rgn_start == this->aperture_base[5] && offset < aperture_size[5]) {
+    if (rgn_start == this->aperture_base[1] && offset < aperture_size[1]) {
+        this->regs_write(offset, value, size);
+    }
+    else if (rgn_start == this->aperture_base[2] && offset < aperture_size[2]) {
+        write_mem(&this->scripts_ram[offset], value, size);
+    }
+    else if (rgn_start == this->aperture_base[5] && offset < aperture_size[5]) {
         LOG_F(
             WARNING, "%s: write aperture_base[5] @%08x.%c = %0*x", this->name.c_str(), offset,
             SIZE_ARG(size), size * 2, BYTESWAP_SIZED(value, size)
@@ -1393,57 +1429,11 @@ void Sc53C825::update_phase_latch() {
 
 void Sc53C825Dev::notify(ScsiNotification notif_type, int param)
 {
-    switch (notif_type) {
-    case ScsiNotification::CONFIRM_SEL:
-        SCSIDEV_LOG_F(CURIO, "%s: CONFIRM_SEL", this->name.c_str());
-        if (this->ctrl_obj->target_id == param) {
-            // cancel selection timeout timer
-            TimerManager::get_instance()->cancel_timer(this->ctrl_obj->seq_timer_id);
-            this->ctrl_obj->seq_timer_id = 0;
-            this->ctrl_obj->cur_state = SeqState::SEL_END;
-            SCSIDEV_LOG_F(CURIO, "%s: state changed to %s in %s CONFIRM_SEL",
-                this->name.c_str(), get_name_sequence(this->ctrl_obj->cur_state), __func__);
-            this->ctrl_obj->sequencer();
-        } else {
-            SCSIDEV_LOG_F(WARNING, "%s: invalid selection confirmation message ignored",
-                this->name.c_str());
-        }
-        break;
-    case ScsiNotification::BUS_PHASE_CHANGE:
-        SCSIDEV_LOG_F(CURIO, "%s: BUS_PHASE_CHANGE", this->name.c_str());
+    if (notif_type == ScsiNotification::BUS_PHASE_CHANGE)
         this->ctrl_obj->cur_bus_phase = param;
-        if (param == ScsiPhase::BUS_FREE) { // target want to disconnect
-            this->ctrl_obj->int_status = INTSTAT_DIS;
-            SCSIDEV_LOG_IF_F(CURIO, "int_status = INTSTAT_DIS = %02x in %s BUS_PHASE_CHANGE.1",
-                this->ctrl_obj->int_status, __func__);
-            this->ctrl_obj->update_irq();
-            this->ctrl_obj->cur_state = SeqState::IDLE;
-            SCSIDEV_LOG_F(CURIO, "%s: state changed to %s in %s BUS_PHASE_CHANGE",
-                this->name.c_str(), get_name_sequence(this->ctrl_obj->cur_state), __func__);
-        }
-        if (this->ctrl_obj->cmd_steps != nullptr) {
-            if (this->ctrl_obj->cur_bus_phase == this->ctrl_obj->cmd_steps->expected_phase) {
-                this->ctrl_obj->next_state = this->ctrl_obj->cmd_steps->next_state;
-                this->ctrl_obj->cmd_steps++;
-                this->ctrl_obj->seq_defer_state(0);
-            } else {
-                this->ctrl_obj->cur_step   = this->ctrl_obj->cmd_steps->step_num;
-                this->ctrl_obj->seq_step   = this->ctrl_obj->cur_step;
-                this->ctrl_obj->int_status = this->ctrl_obj->cmd_steps->status;
-                SCSIDEV_LOG_IF_F(CURIO, "int_status = %02x in %s BUS_PHASE_CHANGE.2",
-                    this->ctrl_obj->int_status, __func__);
-                this->ctrl_obj->update_irq();
-                if (this->ctrl_obj->cmd_steps->next_state == SeqState::CMD_COMPLETE) {
-                    this->ctrl_obj->update_phase_latch();
-                    this->ctrl_obj->exec_next_command();
-                }
-            }
-        }
-        break;
-    default:
-        SCSIDEV_LOG_F(WARNING, "%s: ignore notification message, type: %d", this->name.c_str(),
-            notif_type);
-    }
+
+    // the bus is driven by the SCRIPTS processor
+    this->ctrl_obj->scripts_notify(notif_type, param);
 }
 
 int Sc53C825Dev::send_data(uint8_t* dst_ptr, int count)
@@ -1747,14 +1737,852 @@ int Sc53C825::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
     return bytes_moved;
 }
 
+//============================ SCRIPTS processor ============================
+
+static inline uint32_t sext24(uint32_t val) {
+    return (val & 0x800000U) ? (val | 0xFF000000U) : (val & 0xFFFFFFU);
+}
+
+/** Convert a bus phase to its SCRIPTS encoding, -1 if not an information phase. */
+static int scripts_phase(int bus_phase) {
+    switch (bus_phase) {
+    case ScsiPhase::DATA_OUT:       return SP_DATA_OUT;
+    case ScsiPhase::DATA_IN:        return SP_DATA_IN;
+    case ScsiPhase::COMMAND:        return SP_COMMAND;
+    case ScsiPhase::STATUS:         return SP_STATUS;
+    case ScsiPhase::MESSAGE_OUT:    return SP_MSG_OUT;
+    case ScsiPhase::MESSAGE_IN:     return SP_MSG_IN;
+    default:                        return -1;
+    }
+}
+
+// Operational registers are accessed in memory byte order,
+// i.e. the lowest register address is the most significant byte of value.
+uint32_t Sc53C825::regs_read(uint32_t offset, int size)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < size; i++)
+        value = (value << 8) | this->reg_read((offset + i) & 0xFF, true);
+
+    return value;
+}
+
+void Sc53C825::regs_write(uint32_t offset, uint32_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+        this->reg_write((offset + i) & 0xFF, (value >> ((size - 1 - i) * 8)) & 0xFF, true);
+}
+
+uint8_t Sc53C825::reg_read(uint8_t reg, bool from_host)
+{
+    uint8_t value;
+
+    if (reg >= SCRIPTS_REGS_SIZE)
+        return 0;
+
+    switch (reg) {
+    case SBCL: {
+        uint16_t lines = this->bus_obj->test_ctrl_lines(0xFFFFU);
+        value = lines & (SCSI_CTRL_IO | SCSI_CTRL_CD | SCSI_CTRL_MSG | SCSI_CTRL_ATN);
+        if (lines & SCSI_CTRL_ACK)
+            value |= 1 << ACK;
+        if (lines & SCSI_CTRL_SEL)
+            value |= 1 << SEL;
+        if ((lines & SCSI_CTRL_BSY) || this->scripts_connected)
+            value |= 1 << BSY;
+        if (this->scripts_bus_phase() >= 0)
+            value |= 1 << REQ;
+        return value;
+    }
+    case DSTAT:
+        value = this->regs[DSTAT] | (1 << DFE);
+        if (from_host) {
+            this->regs[DSTAT] = 0;
+            this->scripts_update_irq();
+        }
+        return value;
+    case SSTAT1:
+        return std::max(this->scripts_bus_phase(), 0);
+    case ISTAT:
+        value = this->regs[ISTAT];
+        if (this->regs[DSTAT])
+            value |= 1 << DIP;
+        if (this->regs[SIST0] | this->regs[SIST1])
+            value |= 1 << SIP;
+        if (this->scripts_connected)
+            value |= 1 << CON_IS;
+        return value;
+    case CTEST2:
+        value = this->regs[CTEST2] & ~(1 << SIGP_C2);
+        if (this->regs[ISTAT] & (1 << SIGP))
+            value |= 1 << SIGP_C2;
+        if (from_host)
+            this->regs[ISTAT] &= ~(1 << SIGP);
+        return value;
+    case SIST0:
+    case SIST1:
+        value = this->regs[reg];
+        if (from_host) {
+            this->regs[reg] = 0;
+            this->scripts_update_irq();
+        }
+        return value;
+    default:
+        return this->regs[reg];
+    }
+}
+
+void Sc53C825::reg_write(uint8_t reg, uint8_t value, bool from_host)
+{
+    if (reg >= SCRIPTS_REGS_SIZE)
+        return;
+
+    switch (reg) {
+    case SCNTL1: {
+        uint8_t changed = this->regs[SCNTL1] ^ value;
+        this->regs[SCNTL1] = value;
+        if (changed & (1 << RST)) {
+            if (value & (1 << RST)) {
+                this->bus_obj->assert_ctrl_line(this->my_bus_id, SCSI_CTRL_RST);
+                this->scripts_connected = false;
+                this->scripts_scsi_int(1 << IS_RST, 0);
+            } else {
+                this->bus_obj->release_ctrl_line(this->my_bus_id, SCSI_CTRL_RST);
+            }
+        }
+        break;
+    }
+    case SSID:
+    case SBCL:
+    case DSTAT:
+    case SSTAT0:
+    case SSTAT1:
+    case SSTAT2:
+    case ADDER: case ADDER1: case ADDER2: case ADDER3:
+    case SIST0:
+    case SIST1:
+        break; // read-only
+    case ISTAT:
+        if (value & (1 << SRST)) {
+            this->scripts_reset();
+            break;
+        }
+        if (value & (1 << ABRT_IS))
+            this->scripts_dma_int(1 << ABRT);
+        this->regs[ISTAT] = (this->regs[ISTAT] & ~((1 << SIGP) | (1 << SEM))) |
+                            (value & ((1 << SIGP) | (1 << SEM)));
+        if (value & (1 << INTF))
+            this->regs[ISTAT] &= ~(1 << INTF);
+        if (value & (1 << SIGP))
+            this->scripts_wake(ScriptsState::WaitReselect);
+        this->scripts_update_irq();
+        break;
+    case DSP3:
+        this->regs[DSP3] = value;
+        if (from_host && !(this->regs[DMODE] & (1 << MAN)))
+            this->scripts_start();
+        break;
+    case DCNTL:
+        this->regs[DCNTL] = value & ~((1 << PFF) | (1 << STD));
+        if (value & (1 << PFF))
+            this->scripts_cache.flush();
+        if (from_host && (value & (1 << STD)))
+            this->scripts_start();
+        this->scripts_update_irq();
+        break;
+    case DIEN:
+    case SIEN0:
+    case SIEN1:
+        this->regs[reg] = value;
+        this->scripts_update_irq();
+        break;
+    default:
+        this->regs[reg] = value;
+    }
+}
+
+uint32_t Sc53C825::reg_read32(uint8_t reg)
+{
+    return READ_DWORD_LE_U(&this->regs[reg]);
+}
+
+void Sc53C825::reg_write32(uint8_t reg, uint32_t value)
+{
+    WRITE_DWORD_LE_U(&this->regs[reg], value);
+}
+
+void Sc53C825::scripts_reset()
+{
+    if (this->scripts_timer_id) {
+        TimerManager::get_instance()->cancel_timer(this->scripts_timer_id);
+        this->scripts_timer_id = 0;
+    }
+    if (this->scripts_sel_timer_id) {
+        TimerManager::get_instance()->cancel_timer(this->scripts_sel_timer_id);
+        this->scripts_sel_timer_id = 0;
+    }
+    if (this->bus_obj != nullptr)
+        this->bus_obj->release_ctrl_lines(this->my_bus_id);
+
+    std::memset(this->regs, 0, sizeof(this->regs));
+    this->regs[CTEST1] = 0xF0; // DMA FIFO empty
+    this->regs[CTEST3] = (this->class_rev & 0xF) << V;
+
+    this->scripts_state     = ScriptsState::Halted;
+    this->scripts_connected = false;
+    this->scripts_carry     = false;
+    this->scripts_cache.flush();
+    this->scripts_update_irq();
+}
+
+void Sc53C825::scripts_start()
+{
+    if (this->scripts_state != ScriptsState::Halted) {
+        LOG_F(WARNING, "%s: SCRIPTS already running, new DSP=0x%08X ignored",
+              this->name.c_str(), this->reg_read32(DSP));
+        return;
+    }
+
+    SCSI_LOG_F(CURIO, "%s: SCRIPTS started at 0x%08X", this->name.c_str(), this->reg_read32(DSP));
+    this->scripts_state = ScriptsState::Running;
+    this->scripts_schedule();
+}
+
+void Sc53C825::scripts_schedule()
+{
+    if (this->scripts_timer_id)
+        return;
+
+    this->scripts_timer_id = TimerManager::get_instance()->add_immediate_timer(
+        [this](uint64_t, uint64_t) {
+            this->scripts_timer_id = 0;
+            this->scripts_run();
+    });
+}
+
+void Sc53C825::scripts_wake(ScriptsState from)
+{
+    if (this->scripts_state != from)
+        return;
+
+    this->scripts_state = ScriptsState::Running;
+    this->scripts_schedule();
+}
+
+void Sc53C825::scripts_run()
+{
+    for (int i = 0; i < SCRIPTS_SLICE && this->scripts_state == ScriptsState::Running; i++) {
+        uint32_t addr = this->reg_read32(DSP);
+
+        const ScriptsInsn* cached = this->scripts_cache.fetch(addr);
+        if (cached == nullptr) {
+            LOG_F(ERROR, "%s: SCRIPTS fetch from unusable address 0x%08X",
+                  this->name.c_str(), addr);
+            this->scripts_dma_int(1 << BF);
+            return;
+        }
+
+        // instructions may flush the cache so execute a copy
+        ScriptsInsn insn = *cached;
+
+        this->reg_write32(DBC, insn.words[0]); // DBC + DCMD
+        this->reg_write32(DSPS, insn.words[1]);
+        this->reg_write32(DSP, addr + insn.len);
+
+        this->scripts_exec(insn, addr);
+
+        if ((this->regs[DCNTL] & (1 << SSM)) && this->scripts_state == ScriptsState::Running)
+            this->scripts_dma_int(1 << SSI);
+    }
+
+    if (this->scripts_state == ScriptsState::Running)
+        this->scripts_schedule();
+}
+
+void Sc53C825::scripts_exec(const ScriptsInsn& insn, uint32_t insn_addr)
+{
+    switch (insn.op) {
+    case SOP_BLOCK_MOVE:
+        this->scripts_block_move(insn, insn_addr);
+        break;
+    case SOP_SELECT:
+        this->scripts_select(insn, insn_addr);
+        break;
+    case SOP_WAIT_DISCONNECT:
+        if (this->scripts_connected) {
+            this->reg_write32(DSP, insn_addr);
+            this->scripts_state = ScriptsState::WaitDisconnect;
+        }
+        break;
+    case SOP_WAIT_RESELECT:
+        if (this->scripts_connected) {
+            this->scripts_dma_int(1 << IID);
+        } else if (this->regs[ISTAT] & (1 << SIGP)) {
+            // signaled by the host, continue at the alternate address
+            this->reg_write32(DSP, (insn.flags & SF_RELATIVE) ?
+                this->reg_read32(DSP) + sext24(insn.words[1]) : insn.words[1]);
+        } else {
+            // reselection isn't supported by the SCSI bus so only SIGP can end this
+            this->reg_write32(DSP, insn_addr);
+            this->scripts_state = ScriptsState::WaitReselect;
+        }
+        break;
+    case SOP_SET:
+    case SOP_CLEAR:
+        this->scripts_set_clear(insn);
+        break;
+    case SOP_MOVE_FROM_SFBR:
+    case SOP_MOVE_TO_SFBR:
+    case SOP_READ_MODIFY_WRITE:
+        this->scripts_reg_op(insn);
+        break;
+    case SOP_JUMP:
+    case SOP_CALL:
+    case SOP_RETURN:
+    case SOP_INT:
+        this->scripts_transfer_ctrl(insn, insn_addr);
+        break;
+    case SOP_MEMORY_MOVE: {
+        uint8_t  buf[256];
+        uint32_t src = insn.words[1];
+        uint32_t dst = insn.words[2];
+
+        for (uint32_t left = insn.count; left;) {
+            uint32_t len = std::min(left, (uint32_t)sizeof(buf));
+            if (!this->scripts_mem_read(src, buf, len) ||
+                !this->scripts_mem_write(dst, buf, len))
+                return;
+            src += len;
+            dst += len;
+            left -= len;
+        }
+        break;
+    }
+    case SOP_LOAD:
+    case SOP_STORE: {
+        uint8_t  buf[4];
+        uint32_t addr = insn.words[1];
+
+        if (!insn.count || insn.count > 4) {
+            this->scripts_dma_int(1 << IID);
+            break;
+        }
+        if (insn.flags & SF_DSA_REL)
+            addr = this->reg_read32(DSA) + sext24(insn.words[1]);
+
+        if (insn.op == SOP_LOAD) {
+            if (this->scripts_mem_read(addr, buf, insn.count))
+                for (uint32_t i = 0; i < insn.count; i++)
+                    this->reg_write(insn.reg + i, buf[i], false);
+        } else {
+            for (uint32_t i = 0; i < insn.count; i++)
+                buf[i] = this->reg_read(insn.reg + i, false);
+            this->scripts_mem_write(addr, buf, insn.count);
+        }
+        break;
+    }
+    default:
+        LOG_F(ERROR, "%s: illegal SCRIPTS instruction 0x%08X at 0x%08X",
+              this->name.c_str(), insn.words[0], insn_addr);
+        this->scripts_dma_int(1 << IID);
+    }
+}
+
+int Sc53C825::scripts_bus_phase()
+{
+    return this->scripts_connected ? scripts_phase(this->bus_obj->current_phase()) : -1;
+}
+
+int Sc53C825::scripts_wait_phase(uint32_t insn_addr)
+{
+    int phase = this->scripts_bus_phase();
+
+    if (phase < 0) {
+        if (!this->scripts_connected) {
+            this->scripts_scsi_int(1 << IS_UDC, 0);
+        } else {
+            // re-execute this instruction once the target requests a phase
+            this->reg_write32(DSP, insn_addr);
+            this->scripts_state = ScriptsState::WaitPhase;
+        }
+    }
+
+    return phase;
+}
+
+void Sc53C825::scripts_block_move(const ScriptsInsn& insn, uint32_t insn_addr)
+{
+    uint32_t count = insn.count;
+    uint32_t addr  = insn.words[1];
+
+    if (insn.flags & SF_TABLE) {
+        uint8_t entry[8];
+        if (!this->scripts_mem_read(this->reg_read32(DSA) + sext24(insn.words[1]), entry, 8))
+            return;
+        count = READ_DWORD_LE_U(entry) & 0xFFFFFFU;
+        addr  = READ_DWORD_LE_U(&entry[4]);
+    } else if (insn.flags & SF_INDIRECT) {
+        uint8_t ptr[4];
+        if (!this->scripts_mem_read(insn.words[1], ptr, 4))
+            return;
+        addr = READ_DWORD_LE_U(ptr);
+    }
+
+    this->reg_write32(DNAD, addr);
+
+    int phase = this->scripts_wait_phase(insn_addr);
+    if (phase < 0)
+        return;
+
+    if (phase != insn.phase) {
+        SCSI_LOG_F(CURIO, "%s: SCRIPTS phase mismatch, expected %d got %d",
+                   this->name.c_str(), insn.phase, phase);
+        this->scripts_scsi_int(1 << IS_M_A, 0);
+        return;
+    }
+
+    if (!count) {
+        this->scripts_dma_int(1 << IID);
+        return;
+    }
+
+    this->scripts_xfer(phase, addr, count);
+
+    // clear the byte counter, keep DCMD
+    this->regs[DBC] = this->regs[DBC1] = this->regs[DBC2] = 0;
+}
+
+void Sc53C825::scripts_xfer(int phase, uint32_t addr, uint32_t count)
+{
+    switch (phase) {
+    case SP_MSG_OUT:
+    case SP_COMMAND:
+        // the target pulls messages and commands from the data FIFO
+        while (count && this->scripts_bus_phase() == phase) {
+            int len = std::min(count, (uint32_t)DATA_FIFO_MAX);
+            if (!this->scripts_mem_read(addr, this->data_fifo, len))
+                return;
+            this->data_fifo_pos = len;
+            addr  += len;
+            count -= len;
+
+            // ATN is negated before the last message byte
+            if (phase == SP_MSG_OUT && !count)
+                this->bus_obj->release_ctrl_line(this->my_bus_id, SCSI_CTRL_ATN);
+
+            while (this->data_fifo_pos && this->scripts_bus_phase() == phase) {
+                int fifo_pos = this->data_fifo_pos;
+                this->bus_obj->target_xfer_data();
+                if (this->data_fifo_pos == fifo_pos)
+                    break;
+            }
+            this->data_fifo_pos = 0;
+        }
+        if (phase == SP_MSG_OUT)
+            this->bus_obj->target_next_step();
+        break;
+    case SP_DATA_OUT:
+        while (count) {
+            MapDmaResult res = this->scripts_map_dma(addr, count);
+            uint32_t len = std::min(res.size, count);
+            if (!len) {
+                this->scripts_dma_int(1 << BF);
+                return;
+            }
+            if (res.host_va) {
+                this->bus_obj->push_data(this->scripts_target, res.host_va, len);
+            } else {
+                std::vector<uint8_t> buf(len);
+                if (!this->scripts_mem_read(addr, buf.data(), len))
+                    return;
+                this->bus_obj->push_data(this->scripts_target, buf.data(), len);
+            }
+            addr  += len;
+            count -= len;
+        }
+        this->bus_obj->target_next_step();
+        break;
+    default: { // DATA_IN, STATUS, MESSAGE_IN
+        bool first = true;
+        while (count) {
+            MapDmaResult res = this->scripts_map_dma(addr, count);
+            uint32_t len = std::min(res.size, count);
+            if (!len) {
+                this->scripts_dma_int(1 << BF);
+                return;
+            }
+            uint8_t* dst;
+            std::vector<uint8_t> buf;
+            if (res.host_va && res.is_writable) {
+                dst = res.host_va;
+            } else {
+                buf.resize(len);
+                dst = buf.data();
+            }
+            this->bus_obj->pull_data(this->scripts_target, dst, len);
+            if (first) {
+                this->regs[SFBR] = dst[0];
+                first = false;
+            }
+            if (buf.empty())
+                this->scripts_cache.invalidate(addr, len);
+            else if (!this->scripts_mem_write(addr, dst, len))
+                return;
+            addr  += len;
+            count -= len;
+        }
+        if (phase == SP_MSG_IN)
+            this->bus_obj->assert_ctrl_line(this->my_bus_id, SCSI_CTRL_ACK);
+        else
+            this->bus_obj->target_next_step();
+    }
+    }
+}
+
+void Sc53C825::scripts_select(const ScriptsInsn& insn, uint32_t insn_addr)
+{
+    uint8_t id = insn.target_id;
+
+    if (insn.flags & SF_TABLE) {
+        uint8_t entry[4];
+        if (!this->scripts_mem_read(this->reg_read32(DSA) + sext24(insn.count), entry, 4))
+            return;
+        id = entry[2] & 0xF;
+        this->regs[SCNTL3] = entry[3];
+        this->regs[SXFER]  = entry[1];
+    }
+
+    if (this->scripts_connected) {
+        this->scripts_dma_int(1 << IID);
+        return;
+    }
+
+    if (this->bus_obj->current_phase() != ScsiPhase::BUS_FREE) {
+        this->reg_write32(DSP, insn_addr);
+        this->scripts_state = ScriptsState::WaitBusFree;
+        return;
+    }
+
+    this->regs[SDID]     = id;
+    this->scripts_target = id;
+    this->target_id      = id;
+
+    this->bus_obj->begin_arbitration(this->my_bus_id);
+    if (!this->bus_obj->end_arbitration(this->my_bus_id)) {
+        LOG_F(WARNING, "%s: lost arbitration", this->name.c_str());
+        this->bus_obj->disconnect(this->my_bus_id);
+        this->reg_write32(DSP, insn_addr);
+        this->scripts_state = ScriptsState::WaitBusFree;
+        return;
+    }
+
+    this->bus_obj->begin_selection(this->my_bus_id, id, insn.flags & SF_SEL_ATN);
+    this->scripts_state = ScriptsState::WaitSelect;
+
+    // STIME0 selection time-out: 0 - disabled, n - 125us * 2^(n - 1)
+    uint8_t sel_to = this->regs[STIME0] & SEL_mask;
+    if (sel_to) {
+        this->scripts_sel_timer_id = TimerManager::get_instance()->add_oneshot_timer(
+            USECS_TO_NSECS(125) << (sel_to - 1),
+            [this](uint64_t, uint64_t) {
+                this->scripts_sel_timer_id = 0;
+                this->scripts_sel_timeout();
+        });
+    }
+}
+
+void Sc53C825::scripts_sel_timeout()
+{
+    if (this->scripts_state != ScriptsState::WaitSelect)
+        return;
+
+    SCSI_LOG_F(CURIO, "%s: selection of target %d timed out", this->name.c_str(),
+               this->scripts_target);
+    this->bus_obj->disconnect(this->my_bus_id);
+    this->scripts_scsi_int(0, 1 << IS_STO);
+}
+
+void Sc53C825::scripts_set_clear(const ScriptsInsn& insn)
+{
+    bool set = insn.op == SOP_SET;
+
+    if (insn.data & SSC_ATN) {
+        if (set)
+            this->bus_obj->assert_ctrl_line(this->my_bus_id, SCSI_CTRL_ATN);
+        else
+            this->bus_obj->release_ctrl_line(this->my_bus_id, SCSI_CTRL_ATN);
+    }
+    if (insn.data & SSC_ACK) {
+        if (set) {
+            this->bus_obj->assert_ctrl_line(this->my_bus_id, SCSI_CTRL_ACK);
+        } else {
+            this->bus_obj->release_ctrl_line(this->my_bus_id, SCSI_CTRL_ACK);
+            // message accepted, let the target continue
+            if (this->scripts_bus_phase() == SP_MSG_IN)
+                this->bus_obj->target_next_step();
+        }
+    }
+    if (insn.data & SSC_TARGET)
+        this->regs[SCNTL0] = (this->regs[SCNTL0] & ~(1 << TRG)) | (set << TRG);
+    if (insn.data & SSC_CARRY)
+        this->scripts_carry = set;
+}
+
+void Sc53C825::scripts_reg_op(const ScriptsInsn& insn)
+{
+    uint8_t src = insn.op == SOP_MOVE_FROM_SFBR ? this->regs[SFBR] :
+                  this->reg_read(insn.reg, false);
+    uint8_t opd = (insn.flags & SF_USE_SFBR) ? this->regs[SFBR] : insn.data;
+    uint32_t res;
+
+    switch (insn.alu_op) {
+    case SALU_LOAD:
+        res = opd;
+        break;
+    case SALU_SHL:
+        res = (src << 1) | this->scripts_carry;
+        this->scripts_carry = src >> 7;
+        break;
+    case SALU_OR:
+        res = src | opd;
+        break;
+    case SALU_XOR:
+        res = src ^ opd;
+        break;
+    case SALU_AND:
+        res = src & opd;
+        break;
+    case SALU_SHR:
+        res = (src >> 1) | (this->scripts_carry << 7);
+        this->scripts_carry = src & 1;
+        break;
+    case SALU_ADD:
+        res = src + opd;
+        this->scripts_carry = res > 0xFF;
+        break;
+    default: // SALU_ADDC
+        res = src + opd + this->scripts_carry;
+        this->scripts_carry = res > 0xFF;
+    }
+
+    if (insn.op == SOP_MOVE_TO_SFBR)
+        this->regs[SFBR] = res & 0xFF;
+    else
+        this->reg_write(insn.reg, res & 0xFF, false);
+}
+
+void Sc53C825::scripts_transfer_ctrl(const ScriptsInsn& insn, uint32_t insn_addr)
+{
+    bool cond = true;
+
+    if (insn.flags & SF_CARRY_TEST) {
+        cond = this->scripts_carry;
+    } else {
+        int phase = this->scripts_bus_phase();
+        if (insn.flags & SF_WAIT_PHASE) {
+            phase = this->scripts_wait_phase(insn_addr);
+            if (phase < 0)
+                return;
+        }
+        if (insn.flags & SF_CMP_PHASE)
+            cond = phase == insn.phase;
+        if (insn.flags & SF_CMP_DATA)
+            cond = cond && !((this->regs[SFBR] ^ insn.data) & ~insn.mask);
+    }
+
+    if (cond != !!(insn.flags & SF_IF_TRUE))
+        return;
+
+    uint32_t next_addr = this->reg_read32(DSP);
+    uint32_t target    = (insn.flags & SF_RELATIVE) ? next_addr + sext24(insn.words[1]) :
+                         insn.words[1];
+
+    switch (insn.op) {
+    case SOP_JUMP:
+        this->reg_write32(DSP, target);
+        break;
+    case SOP_CALL:
+        this->reg_write32(TEMP, next_addr);
+        this->reg_write32(DSP, target);
+        break;
+    case SOP_RETURN:
+        this->reg_write32(DSP, this->reg_read32(TEMP));
+        break;
+    default: // SOP_INT
+        if (insn.flags & SF_INT_FLY) {
+            this->regs[ISTAT] |= 1 << INTF;
+            this->scripts_update_irq();
+        } else {
+            this->scripts_dma_int(1 << SIR);
+        }
+    }
+}
+
+void Sc53C825::scripts_notify(ScsiNotification notif_type, int param)
+{
+    switch (notif_type) {
+    case ScsiNotification::CONFIRM_SEL:
+        if (this->scripts_state != ScriptsState::WaitSelect || param != this->scripts_target) {
+            LOG_F(WARNING, "%s: unexpected selection confirmation from %d ignored",
+                  this->name.c_str(), param);
+            break;
+        }
+        if (this->scripts_sel_timer_id) {
+            TimerManager::get_instance()->cancel_timer(this->scripts_sel_timer_id);
+            this->scripts_sel_timer_id = 0;
+        }
+        this->bus_obj->end_selection(this->my_bus_id, param);
+        this->bus_obj->release_ctrl_line(this->my_bus_id, SCSI_CTRL_SEL);
+        this->scripts_connected = true;
+        this->regs[SCNTL2] |= 1 << SDU;
+        this->scripts_wake(ScriptsState::WaitSelect);
+        break;
+    case ScsiNotification::BUS_PHASE_CHANGE:
+        if (param == ScsiPhase::BUS_FREE || param == ScsiPhase::RESET) {
+            bool was_connected = this->scripts_connected;
+            this->scripts_connected = false;
+            this->bus_obj->release_ctrl_lines(this->my_bus_id);
+
+            switch (this->scripts_state) {
+            case ScriptsState::WaitDisconnect:
+            case ScriptsState::WaitBusFree:
+                this->scripts_wake(this->scripts_state);
+                break;
+            case ScriptsState::WaitPhase:
+                this->scripts_scsi_int(1 << IS_UDC, 0);
+                break;
+            case ScriptsState::Running:
+                // SDU is cleared by scripts expecting the disconnect
+                if (was_connected && (this->regs[SCNTL2] & (1 << SDU)))
+                    this->scripts_scsi_int(1 << IS_UDC, 0);
+                break;
+            default:
+                break;
+            }
+        } else if (scripts_phase(param) >= 0) {
+            this->scripts_wake(ScriptsState::WaitPhase);
+        }
+        break;
+    default:
+        LOG_F(WARNING, "%s: ignore notification message, type: %d", this->name.c_str(),
+              notif_type);
+    }
+}
+
+void Sc53C825::scripts_dma_int(uint8_t dstat_bits)
+{
+    this->regs[DSTAT] |= dstat_bits;
+    this->scripts_state = ScriptsState::Halted;
+    this->scripts_update_irq();
+}
+
+void Sc53C825::scripts_scsi_int(uint8_t sist0_bits, uint8_t sist1_bits)
+{
+    // all SCSI interrupts raised here are fatal
+    this->regs[SIST0] |= sist0_bits;
+    this->regs[SIST1] |= sist1_bits;
+    this->scripts_state = ScriptsState::Halted;
+    this->scripts_update_irq();
+}
+
+void Sc53C825::scripts_update_irq()
+{
+    uint8_t new_irq = ((this->regs[DSTAT] & this->regs[DIEN]) ||
+                       (this->regs[SIST0] & this->regs[SIEN0]) ||
+                       (this->regs[SIST1] & this->regs[SIEN1]) ||
+                       (this->regs[ISTAT] & (1 << INTF))) &&
+                      !(this->regs[DCNTL] & (1 << IRQD));
+
+    if (new_irq != this->scripts_irq) {
+        this->scripts_irq = new_irq;
+        this->pci_interrupt(new_irq);
+    }
+}
+
+// SCRIPTS may point anywhere, an address nothing responds to is a bus fault
+// for the guest rather than an emulator error. Returns a zero size then.
+MapDmaResult Sc53C825::scripts_map_dma(uint32_t addr, uint32_t len)
+{
+    if (!mem_ctrl_instance->find_range(addr))
+        return MapDmaResult{.type = RT_NONE};
+
+    return mmu_map_dma_mem(addr, len, true, true);
+}
+
+uint8_t* Sc53C825::scripts_map_page(uint32_t page_addr)
+{
+    if (this->aperture_base[2] && page_addr >= this->aperture_base[2] &&
+        page_addr < this->aperture_base[2] + SCRIPTS_RAM_SIZE)
+        return &this->scripts_ram[page_addr - this->aperture_base[2]];
+
+    MapDmaResult res = this->scripts_map_dma(page_addr, SCRIPTS_PAGE_SIZE);
+    if (res.host_va == nullptr || res.size < SCRIPTS_PAGE_SIZE)
+        return nullptr;
+
+    return res.host_va;
+}
+
+bool Sc53C825::scripts_mem_read(uint32_t addr, uint8_t* buf, uint32_t len)
+{
+    while (len) {
+        MapDmaResult res = this->scripts_map_dma(addr, len);
+        uint32_t chunk = std::min(res.size, len);
+        if (!chunk) {
+            this->scripts_dma_int(1 << BF);
+            return false;
+        }
+        if (res.host_va) {
+            std::memcpy(buf, res.host_va, chunk);
+        } else {
+            for (uint32_t i = 0; i < chunk; i++)
+                buf[i] = res.dev_obj->read(res.dev_base, addr + i - res.dev_base, 1);
+        }
+        addr += chunk;
+        buf  += chunk;
+        len  -= chunk;
+    }
+    return true;
+}
+
+bool Sc53C825::scripts_mem_write(uint32_t addr, const uint8_t* buf, uint32_t len)
+{
+    while (len) {
+        MapDmaResult res = this->scripts_map_dma(addr, len);
+        uint32_t chunk = std::min(res.size, len);
+        if (!chunk) {
+            this->scripts_dma_int(1 << BF);
+            return false;
+        }
+        if (res.host_va) {
+            if (res.is_writable)
+                std::memcpy(res.host_va, buf, chunk);
+            else
+                LOG_F(WARNING, "%s: SCRIPTS write to ROM @%08X ignored", this->name.c_str(), addr);
+        } else {
+            for (uint32_t i = 0; i < chunk; i++)
+                res.dev_obj->write(res.dev_base, addr + i - res.dev_base, buf[i], 1);
+        }
+        this->scripts_cache.invalidate(addr, chunk);
+        addr += chunk;
+        buf  += chunk;
+        len  -= chunk;
+    }
+    return true;
+}
+
 static const DeviceDescription Sc53C825Dev_Descriptor = {
     Sc53C825Dev::create, {}, {}, HWCompType::SCSI_DEV
 };
 
 REGISTER_DEVICE(Sc53C825Dev, Sc53C825Dev_Descriptor);
 
+static const PropMap Scsi53C825_Properties = {
+    {"scsi_fast", new BinProperty(0)},
+};
+
 static const DeviceDescription Scsi53C825_Descriptor = {
-    ScsiBus::create, {"Sc53C825Dev@7"}, {}, HWCompType::SCSI_BUS
+    ScsiBus::create, {"Sc53C825Dev@7"}, Scsi53C825_Properties, HWCompType::SCSI_BUS
 };
 
 REGISTER_DEVICE(Scsi53C825, Scsi53C825_Descriptor);
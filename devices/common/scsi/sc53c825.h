@@ -26,6 +26,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <devices/common/pci/pcidevice.h>
 #include <devices/common/scsi/scsi.h>
+#include <devices/common/scsi/sc53c825scripts.h>
 #include <devices/common/dbdma.h>
 
 #include <cinttypes>
@@ -138,6 +139,21 @@ namespace SeqState {
 
 constexpr auto DATA_FIFO_MAX = 16;
 
+/** SCRIPTS processor states. */
+enum class ScriptsState : uint8_t {
+    Halted,
+    Running,
+    WaitSelect,     // waiting for the target to confirm selection
+    WaitBusFree,    // SELECT issued while the bus is busy
+    WaitPhase,      // waiting for the target to request an information phase
+    WaitDisconnect,
+    WaitReselect,
+};
+
+constexpr auto SCRIPTS_REGS_SIZE = 0x80;
+constexpr auto SCRIPTS_RAM_SIZE  = 0x1000;
+constexpr auto SCRIPTS_SLICE     = 1024; // max instructions executed per timer callback
+
 /** Sequence descriptor for multistep commands. */
 typedef struct {
     int step_num;
@@ -228,6 +244,39 @@ protected:
 
     void update_irq();
 
+    // SCRIPTS processor
+    uint32_t regs_read(uint32_t offset, int size);
+    void     regs_write(uint32_t offset, uint32_t value, int size);
+    uint8_t  reg_read(uint8_t reg, bool from_host);
+    void     reg_write(uint8_t reg, uint8_t value, bool from_host);
+    uint32_t reg_read32(uint8_t reg);
+    void     reg_write32(uint8_t reg, uint32_t value);
+
+    void scripts_reset();
+    void scripts_start();
+    void scripts_schedule();
+    void scripts_run();
+    void scripts_exec(const ScriptsInsn& insn, uint32_t insn_addr);
+    void scripts_block_move(const ScriptsInsn& insn, uint32_t insn_addr);
+    void scripts_select(const ScriptsInsn& insn, uint32_t insn_addr);
+    void scripts_set_clear(const ScriptsInsn& insn);
+    void scripts_reg_op(const ScriptsInsn& insn);
+    void scripts_transfer_ctrl(const ScriptsInsn& insn, uint32_t insn_addr);
+    void scripts_xfer(int phase, uint32_t addr, uint32_t count);
+    void scripts_sel_timeout();
+    void scripts_notify(ScsiNotification notif_type, int param);
+    int  scripts_wait_phase(uint32_t insn_addr);
+    int  scripts_bus_phase();
+    void scripts_wake(ScriptsState from);
+    void scripts_dma_int(uint8_t dstat_bits);
+    void scripts_scsi_int(uint8_t sist0_bits, uint8_t sist1_bits);
+    void scripts_update_irq();
+
+    MapDmaResult scripts_map_dma(uint32_t addr, uint32_t len);
+    uint8_t* scripts_map_page(uint32_t page_addr);
+    bool     scripts_mem_read(uint32_t addr, uint8_t* buf, uint32_t len);
+    bool     scripts_mem_write(uint32_t addr, const uint8_t* buf, uint32_t len);
+
 private:
     // PCI
     void change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new, int bar_num);
@@ -299,6 +348,21 @@ private:
 
     ScsiBus* bus_obj = nullptr;
     ScsiPhysDevice* dev_obj = nullptr;
+
+    // SCRIPTS processor state
+    uint8_t         regs[SCRIPTS_REGS_SIZE] = {};
+    std::unique_ptr<uint8_t[]> scripts_ram;
+    ScriptsCache    scripts_cache{[this](uint32_t page_addr) {
+                        return this->scripts_map_page(page_addr);
+                    }};
+    ScriptsState    scripts_state = ScriptsState::Halted;
+    uint32_t        scripts_timer_id = 0;
+    uint32_t        scripts_sel_timer_id = 0;
+    uint8_t         scripts_target = 0;
+    bool            scripts_on_bus = false;     // SCRIPTS owns the bus
+    bool            scripts_connected = false;
+    bool            scripts_carry = false;
+    uint8_t         scripts_irq = 0;
 };
 
 class Sc53C825Dev : public ScsiPhysDevice {
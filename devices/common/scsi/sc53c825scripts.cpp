@@ -0,0 +1,229 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file SCRIPTS instruction decoder and decoded script cache. */
+
+#include <core/memaccess.h>
+#include <devices/common/scsi/sc53c825scripts.h>
+
+#include <algorithm>
+#include <cstring>
+
+void scripts_decode(ScriptsInsn& insn, uint32_t w0, uint32_t w1, uint32_t w2)
+{
+    std::memset(&insn, 0, sizeof(insn));
+
+    insn.words[0] = w0;
+    insn.words[1] = w1;
+    insn.words[2] = w2;
+    insn.len      = 8;
+    insn.phase    = (w0 >> 24) & 7;
+
+    switch (w0 >> 30) {
+    case 0: // block move
+        insn.op    = SOP_BLOCK_MOVE;
+        insn.count = w0 & 0xFFFFFFU;
+        if (w0 & (1 << 29))
+            insn.flags |= SF_INDIRECT;
+        if (w0 & (1 << 28))
+            insn.flags |= SF_TABLE;
+        break;
+    case 1: // I/O and register read/write
+        switch ((w0 >> 27) & 7) {
+        case 0:
+            insn.op        = SOP_SELECT;
+            insn.target_id = (w0 >> 16) & 0xF;
+            insn.count     = w0 & 0xFFFFFFU;
+            break;
+        case 1:
+            insn.op = SOP_WAIT_DISCONNECT;
+            break;
+        case 2:
+            insn.op = SOP_WAIT_RESELECT;
+            break;
+        case 3:
+        case 4:
+            insn.op   = ((w0 >> 27) & 7) == 3 ? SOP_SET : SOP_CLEAR;
+            insn.data = (w0 & (SSC_ATN | SSC_ACK)) | ((w0 >> 8) & (SSC_TARGET | SSC_CARRY));
+            break;
+        default:
+            insn.op     = SOP_MOVE_FROM_SFBR + ((w0 >> 27) & 7) - 5;
+            insn.alu_op = (w0 >> 24) & 7;
+            insn.reg    = ((w0 >> 16) & 0x7F) | (w0 & 0x80);
+            insn.data   = (w0 >> 8) & 0xFF;
+            if (w0 & (1 << 23))
+                insn.flags |= SF_USE_SFBR;
+            return;
+        }
+        if (w0 & (1 << 26))
+            insn.flags |= SF_RELATIVE;
+        if (w0 & (1 << 25))
+            insn.flags |= SF_TABLE;
+        if (w0 & (1 << 24))
+            insn.flags |= SF_SEL_ATN;
+        break;
+    case 2: // transfer control
+        switch ((w0 >> 27) & 7) {
+        case 0: insn.op = SOP_JUMP;   break;
+        case 1: insn.op = SOP_CALL;   break;
+        case 2: insn.op = SOP_RETURN; break;
+        case 3: insn.op = SOP_INT;    break;
+        default:
+            insn.op = SOP_ILLEGAL;
+            return;
+        }
+        insn.mask = (w0 >> 8) & 0xFF;
+        insn.data = w0 & 0xFF;
+        if (w0 & (1 << 23))
+            insn.flags |= SF_RELATIVE;
+        if (w0 & (1 << 21))
+            insn.flags |= SF_CARRY_TEST;
+        if (w0 & (1 << 20))
+            insn.flags |= SF_INT_FLY;
+        if (w0 & (1 << 19))
+            insn.flags |= SF_IF_TRUE;
+        if (w0 & (1 << 18))
+            insn.flags |= SF_CMP_DATA;
+        if (w0 & (1 << 17))
+            insn.flags |= SF_CMP_PHASE;
+        if (w0 & (1 << 16))
+            insn.flags |= SF_WAIT_PHASE;
+        break;
+    case 3: // memory move, load/store
+        if (!(w0 & (1 << 29))) {
+            insn.op    = SOP_MEMORY_MOVE;
+            insn.len   = 12;
+            insn.count = w0 & 0xFFFFFFU;
+        } else {
+            insn.op    = (w0 & (1 << 24)) ? SOP_LOAD : SOP_STORE;
+            insn.reg   = (w0 >> 16) & 0x7F;
+            insn.count = w0 & 7;
+            if (w0 & (1 << 28))
+                insn.flags |= SF_DSA_REL;
+        }
+        break;
+    }
+}
+
+ScriptsCache::ScriptsPage* ScriptsCache::get_page(uint32_t page_addr)
+{
+    if (page_addr == this->last_page_addr)
+        return this->last_page;
+
+    ScriptsPage* page;
+
+    auto it = this->pages.find(page_addr);
+    if (it != this->pages.end()) {
+        page = it->second.get();
+    } else {
+        uint8_t* host_va = this->map_cb(page_addr);
+        if (!host_va)
+            return nullptr;
+        page = new ScriptsPage;
+        page->host_va = host_va;
+        std::memset(page->valid, 0, sizeof(page->valid));
+        this->pages[page_addr] = std::unique_ptr<ScriptsPage>(page);
+    }
+
+    this->last_page_addr = page_addr;
+    this->last_page      = page;
+    return page;
+}
+
+const ScriptsInsn* ScriptsCache::fetch(uint32_t addr)
+{
+    uint32_t page_addr = addr & ~(SCRIPTS_PAGE_SIZE - 1);
+    uint32_t offset    = addr & (SCRIPTS_PAGE_SIZE - 1);
+
+    ScriptsPage* page = this->get_page(page_addr);
+    if (!page)
+        return nullptr;
+
+    const uint8_t* src  = page->host_va + offset;
+    ScriptsInsn&   insn = page->insns[offset >> 2];
+
+    // Scripts may be patched by the host at any time. Comparing the raw
+    // words is still much cheaper than decoding them again.
+    if (page->valid[offset >> 2] && READ_DWORD_LE_A(src) == insn.words[0] &&
+        (offset + insn.len) <= SCRIPTS_PAGE_SIZE &&
+        READ_DWORD_LE_A(src + 4) == insn.words[1] &&
+        (insn.len < 12 || READ_DWORD_LE_A(src + 8) == insn.words[2])) {
+        this->hits++;
+        return &insn;
+    }
+
+    this->misses++;
+
+    uint32_t w[3] = {READ_DWORD_LE_A(src), 0, 0};
+    uint32_t len  = ((w[0] >> 29) == 6) ? 12 : 8;
+
+    if (offset + len > SCRIPTS_PAGE_SIZE) {
+        // fetch the remaining words from the next page
+        ScriptsPage* next = this->get_page(page_addr + SCRIPTS_PAGE_SIZE);
+        if (!next)
+            return nullptr;
+        for (uint32_t i = 1; i < len / 4; i++) {
+            uint32_t pos = offset + i * 4;
+            w[i] = pos < SCRIPTS_PAGE_SIZE ? READ_DWORD_LE_A(page->host_va + pos) :
+                READ_DWORD_LE_A(next->host_va + pos - SCRIPTS_PAGE_SIZE);
+        }
+        scripts_decode(this->split_insn, w[0], w[1], w[2]);
+        return &this->split_insn;
+    }
+
+    for (uint32_t i = 1; i < len / 4; i++)
+        w[i] = READ_DWORD_LE_A(src + i * 4);
+
+    scripts_decode(insn, w[0], w[1], w[2]);
+    page->valid[offset >> 2] = true;
+    return &insn;
+}
+
+void ScriptsCache::invalidate(uint32_t addr, uint32_t size)
+{
+    if (!size || this->pages.empty())
+        return;
+
+    // an instruction starting up to 8 bytes earlier may overlap the range
+    uint32_t start = addr >= 8 ? (addr - 8) & ~3U : 0;
+    uint64_t end   = uint64_t(addr) + size;
+
+    for (uint64_t pos = start; pos < end;) {
+        uint32_t page_addr = uint32_t(pos) & ~(SCRIPTS_PAGE_SIZE - 1);
+        uint64_t page_end  = std::min(end, uint64_t(page_addr) + SCRIPTS_PAGE_SIZE);
+
+        auto it = this->pages.find(page_addr);
+        if (it != this->pages.end()) {
+            bool* valid = it->second->valid;
+            for (uint64_t slot = (pos & (SCRIPTS_PAGE_SIZE - 1)) >> 2;
+                 slot < ((page_end - page_addr + 3) >> 2); slot++)
+                valid[slot] = false;
+        }
+        pos = page_end;
+    }
+}
+
+void ScriptsCache::flush()
+{
+    this->pages.clear();
+    this->last_page_addr = 1;
+    this->last_page      = nullptr;
+}
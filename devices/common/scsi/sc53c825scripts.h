@@ -0,0 +1,175 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file SCRIPTS instruction decoder and decoded script cache
+    for the NCR/Symbios 53C8xx SCSI controllers.
+
+    SCRIPTS programs live in guest memory. Instead of decoding every
+    instruction each time it's executed, instructions are decoded once
+    and kept in per-page tables indexed by physical address. A cached
+    instruction is re-checked against its raw words on each fetch so
+    that scripts patched by the host driver are picked up, writes made
+    by the SCRIPTS processor itself invalidate the affected entries.
+ */
+
+#ifndef SC_53C825_SCRIPTS_H
+#define SC_53C825_SCRIPTS_H
+
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+/** Decoded SCRIPTS operations. */
+enum ScriptsOp : uint8_t {
+    SOP_BLOCK_MOVE = 0,
+    SOP_SELECT,
+    SOP_WAIT_DISCONNECT,
+    SOP_WAIT_RESELECT,
+    SOP_SET,
+    SOP_CLEAR,
+    SOP_MOVE_FROM_SFBR,     // register = SFBR op data8
+    SOP_MOVE_TO_SFBR,       // SFBR = register op data8
+    SOP_READ_MODIFY_WRITE,  // register = register op data8
+    SOP_JUMP,
+    SOP_CALL,
+    SOP_RETURN,
+    SOP_INT,
+    SOP_MEMORY_MOVE,
+    SOP_LOAD,
+    SOP_STORE,
+    SOP_ILLEGAL,
+};
+
+/** Operators of register read/write instructions. */
+enum ScriptsAluOp : uint8_t {
+    SALU_LOAD = 0,
+    SALU_SHL,
+    SALU_OR,
+    SALU_XOR,
+    SALU_AND,
+    SALU_SHR,
+    SALU_ADD,
+    SALU_ADDC,
+};
+
+/** Instruction flags. */
+enum : uint16_t {
+    SF_INDIRECT     = 1 << 0,   // block move: address points to the data address
+    SF_TABLE        = 1 << 1,   // table indirect addressing relative to DSA
+    SF_RELATIVE     = 1 << 2,   // jump address is relative to DSP
+    SF_SEL_ATN      = 1 << 3,   // select with ATN
+    SF_IF_TRUE      = 1 << 4,   // transfer control if the condition is true
+    SF_CMP_DATA     = 1 << 5,   // compare SFBR with data
+    SF_CMP_PHASE    = 1 << 6,   // compare SCSI phase
+    SF_WAIT_PHASE   = 1 << 7,   // wait for a valid phase before comparing
+    SF_CARRY_TEST   = 1 << 8,   // condition is the carry bit
+    SF_INT_FLY      = 1 << 9,   // interrupt on the fly
+    SF_USE_SFBR     = 1 << 10,  // register instructions use SFBR instead of data8
+    SF_DSA_REL      = 1 << 11,  // load/store address is relative to DSA
+};
+
+/** Bits of set/clear instructions kept in ScriptsInsn::data. */
+enum : uint8_t {
+    SSC_ATN     = 1 << 3,
+    SSC_ACK     = 1 << 6,
+    SSC_TARGET  = 1 << 1,   // bit 9 of the instruction
+    SSC_CARRY   = 1 << 2,   // bit 10 of the instruction
+};
+
+/** SCSI phases as encoded in SCRIPTS instructions (MSG/C_D/I_O). */
+enum : uint8_t {
+    SP_DATA_OUT = 0,
+    SP_DATA_IN  = 1,
+    SP_COMMAND  = 2,
+    SP_STATUS   = 3,
+    SP_MSG_OUT  = 6,
+    SP_MSG_IN   = 7,
+};
+
+/** Pre-decoded SCRIPTS instruction. */
+typedef struct ScriptsInsn {
+    uint32_t    words[3];   // raw instruction words
+    uint32_t    count;      // block move/memory move byte count, table offset
+    uint16_t    flags;
+    uint8_t     op;         // ScriptsOp
+    uint8_t     len;        // instruction size in bytes
+    uint8_t     phase;      // SCSI phase as MSG/C_D/I_O
+    uint8_t     alu_op;     // ScriptsAluOp
+    uint8_t     reg;        // register address
+    uint8_t     data;       // data8, compare data, set/clear bits
+    uint8_t     mask;       // compare mask, set bits are not compared
+    uint8_t     target_id;  // select destination ID
+} ScriptsInsn;
+
+/** Decode one instruction from its raw words. */
+extern void scripts_decode(ScriptsInsn& insn, uint32_t w0, uint32_t w1, uint32_t w2);
+
+/** Returns the host address of a guest page or nullptr if it can't be used
+    as SCRIPTS memory. */
+typedef std::function<uint8_t*(uint32_t page_addr)> ScriptsMapCb;
+
+constexpr uint32_t SCRIPTS_PAGE_BITS = 12;
+constexpr uint32_t SCRIPTS_PAGE_SIZE = 1 << SCRIPTS_PAGE_BITS;
+
+/** Decoded SCRIPTS cache indexed by physical address. */
+class ScriptsCache {
+public:
+    ScriptsCache(ScriptsMapCb map_cb) : map_cb(map_cb) {}
+    ~ScriptsCache() = default;
+
+    /** Return the decoded instruction at a physical address or nullptr
+        if that address isn't backed by memory. */
+    const ScriptsInsn* fetch(uint32_t addr);
+
+    /** Drop decoded instructions overlapping the given range. */
+    void invalidate(uint32_t addr, uint32_t size);
+
+    /** Drop all decoded instructions. */
+    void flush();
+
+    uint64_t    hits   = 0;
+    uint64_t    misses = 0;
+
+private:
+    static constexpr uint32_t SLOTS = SCRIPTS_PAGE_SIZE / 4;
+
+    typedef struct {
+        uint8_t*    host_va;
+        bool        valid[SLOTS];
+        ScriptsInsn insns[SLOTS];
+    } ScriptsPage;
+
+    ScriptsPage* get_page(uint32_t page_addr);
+
+    ScriptsMapCb    map_cb;
+
+    std::unordered_map<uint32_t, std::unique_ptr<ScriptsPage>> pages;
+
+    // last page used, scripts rarely leave their page
+    uint32_t        last_page_addr = 1;
+    ScriptsPage*    last_page = nullptr;
+
+    // instructions crossing a page boundary aren't cached
+    ScriptsInsn     split_insn;
+};
+
+#endif // SC_53C825_SCRIPTS_H
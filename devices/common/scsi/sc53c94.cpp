@@ -706,6 +706,26 @@ void Sc53C94::seq_defer_state(uint64_t delay_ns)
     }
 }
 
+// Advance to next_state along the arbitration/selection path. With the bus
+// fast path enabled, the bus timing delay is skipped and the next state is
+// entered right away because nobody else can observe the bus meanwhile.
+void Sc53C94::seq_next_state(uint64_t delay_ns)
+{
+    if (!this->bus_obj->fast_path()) {
+        this->seq_defer_state(delay_ns);
+        return;
+    }
+
+    if (this->seq_timer_id) {
+        TimerManager::get_instance()->cancel_timer(this->seq_timer_id);
+        this->seq_timer_id = 0;
+    }
+    this->cur_state = this->next_state;
+    SCSI_LOG_F(CURIO, "%s: state changed to %s in %s",
+        this->name.c_str(), get_name_sequence(this->cur_state), __func__);
+    this->sequencer();
+}
+
 extern std::string hex_string(const uint8_t *p, int len);
 
 void Sc53C94::sequencer()
@@ -720,7 +740,7 @@ void Sc53C94::sequencer()
     case SeqState::BUS_FREE:
         if (this->bus_obj->current_phase() == ScsiPhase::BUS_FREE) {
             this->next_state = SeqState::ARB_BEGIN;
-            this->seq_defer_state(BUS_FREE_DELAY + BUS_SETTLE_DELAY);
+            this->seq_next_state(BUS_FREE_DELAY + BUS_SETTLE_DELAY);
         } else { // continue waiting
             this->next_state = SeqState::BUS_FREE;
             this->seq_defer_state(BUS_FREE_DELAY);
@@ -735,12 +755,12 @@ void Sc53C94::sequencer()
             break;
         }
         this->next_state = SeqState::ARB_END;
-        this->seq_defer_state(ARB_DELAY);
+        this->seq_next_state(ARB_DELAY);
         break;
     case SeqState::ARB_END:
         if (this->bus_obj->end_arbitration(this->my_bus_id)) { // arbitration won
             this->next_state = SeqState::SEL_BEGIN;
-            this->seq_defer_state(BUS_CLEAR_DELAY + BUS_SETTLE_DELAY);
+            this->seq_next_state(BUS_CLEAR_DELAY + BUS_SETTLE_DELAY);
         } else { // arbitration lost
             SCSI_LOG_F(CURIO, "%s: arbitration lost!", this->name.c_str());
             this->bus_obj->release_ctrl_lines(this->my_bus_id);
@@ -1151,14 +1171,34 @@ int Sc53C94::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
     return bytes_moved;
 }
 
+// With the bus fast path, a data phase is moved in a single xfer_from/xfer_to
+// call spanning all DBDMA descriptors so it completes with one interrupt.
+int Sc53C94::bulk_xfer_size(DmaChannel *ch_obj) {
+    if (!this->bus_obj->fast_path() || this->data_fifo_pos || !this->xfer_count)
+        return 0;
+
+    if (this->cur_bus_phase == ScsiPhase::DATA_OUT && this->is_dma_xfer)
+        return this->xfer_count;
+
+    if (this->cur_bus_phase == ScsiPhase::DATA_IN && this->cur_cmd == CMD_XFER &&
+        this->is_dma_cmd)
+        return this->xfer_count;
+
+    return 0;
+}
+
 static const DeviceDescription Sc53C94Dev_Descriptor = {
     Sc53C94Dev::create, {}, {}, HWCompType::SCSI_DEV
 };
 
 REGISTER_DEVICE(Sc53C94Dev, Sc53C94Dev_Descriptor);
 
+static const PropMap ScsiCurio_Properties = {
+    {"scsi_fast", new BinProperty(0)},
+};
+
 static const DeviceDescription ScsiCurio_Descriptor = {
-    ScsiBus::create, {"Sc53C94Dev@7"}, {}, HWCompType::SCSI_BUS
+    ScsiBus::create, {"Sc53C94Dev@7"}, ScsiCurio_Properties, HWCompType::SCSI_BUS
 };
 
 REGISTER_DEVICE(ScsiCurio, ScsiCurio_Descriptor);
@@ -225,6 +225,7 @@ public:
     int tell_xfer_size(DmaChannel *ch_obj) override {
         return this->xfer_count;
     }
+    int bulk_xfer_size(DmaChannel *ch_obj) override;
 
 protected:
     void reset_device();
@@ -237,6 +238,7 @@ protected:
 
     void sequencer();
     void seq_defer_state(uint64_t delay_ns);
+    void seq_next_state(uint64_t delay_ns);
 
     bool rcv_data();
 
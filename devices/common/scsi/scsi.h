@@ -402,6 +402,11 @@ public:
         return this->target_id;
     }
 
+    // fast path: skip bus timing delays that the guest cannot observe
+    bool fast_path() const {
+        return this->fast_xfer;
+    }
+
     // reading/writing control lines
     void        assert_ctrl_line(int id, uint16_t mask);
     void        release_ctrl_line(int id, uint16_t mask);
@@ -440,6 +445,7 @@ private:
     int         initiator_id;
     int         target_id;
     uint8_t     data_lines;
+    bool        fast_xfer = false;
 };
 
 #endif // SCSI_H
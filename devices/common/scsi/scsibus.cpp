@@ -52,6 +52,8 @@ ScsiBus::ScsiBus(const std::string name) : HWComponent(name)
     this->arb_winner_id = -1;
     this->initiator_id  = -1;
     this->target_id     = -1;
+
+    this->fast_xfer = GET_BIN_PROP("scsi_fast");
 }
 
 template <class T>
@@ -45,25 +45,29 @@ void ScsiPhysDevice::notify(ScsiNotification notif_type, int param)
             // check if something tries to select us
             if (this->bus_obj->get_data_lines() & (1 << scsi_id)) {
                 LOG_F(SCSIDEVICE, "%s selected", this->get_name_and_unit_address().c_str());
-                TimerManager::get_instance()->add_oneshot_timer(
-                    BUS_SETTLE_DELAY,
-                    [this](uint64_t, uint64_t) {
-                        // don't confirm selection if BSY or I/O are asserted
-                        if (this->bus_obj->test_ctrl_lines(SCSI_CTRL_BSY | SCSI_CTRL_IO))
-                            return;
-                        LOG_F(SCSIDEVICE, "%s: assert SCSI_CTRL_BSY", this->get_name_and_unit_address().c_str());
-                        this->bus_obj->assert_ctrl_line(this->scsi_id, SCSI_CTRL_BSY);
-                        this->bus_obj->confirm_selection(this->scsi_id);
-                        this->seq_steps = nullptr;
-                        this->initiator_id = this->bus_obj->get_initiator_id();
-                        if (this->bus_obj->test_ctrl_lines(SCSI_CTRL_ATN)) {
-                            this->last_selection_has_attention = true;
-                            this->switch_phase(ScsiPhase::MESSAGE_OUT);
-                        } else {
-                            this->last_selection_has_attention = false;
-                            this->switch_phase(ScsiPhase::COMMAND);
-                        }
-                });
+                auto confirm_cb = [this](uint64_t, uint64_t) {
+                    // don't confirm selection if BSY or I/O are asserted
+                    if (this->bus_obj->test_ctrl_lines(SCSI_CTRL_BSY | SCSI_CTRL_IO))
+                        return;
+                    LOG_F(SCSIDEVICE, "%s: assert SCSI_CTRL_BSY", this->get_name_and_unit_address().c_str());
+                    this->bus_obj->assert_ctrl_line(this->scsi_id, SCSI_CTRL_BSY);
+                    this->bus_obj->confirm_selection(this->scsi_id);
+                    this->seq_steps = nullptr;
+                    this->initiator_id = this->bus_obj->get_initiator_id();
+                    if (this->bus_obj->test_ctrl_lines(SCSI_CTRL_ATN)) {
+                        this->last_selection_has_attention = true;
+                        this->switch_phase(ScsiPhase::MESSAGE_OUT);
+                    } else {
+                        this->last_selection_has_attention = false;
+                        this->switch_phase(ScsiPhase::COMMAND);
+                    }
+                };
+                // the confirmation must still be deferred because the
+                // initiator arms its selection timeout after this call
+                if (this->bus_obj->fast_path())
+                    TimerManager::get_instance()->add_immediate_timer(confirm_cb);
+                else
+                    TimerManager::get_instance()->add_oneshot_timer(BUS_SETTLE_DELAY, confirm_cb);
             }
             break;
         default:
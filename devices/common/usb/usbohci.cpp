@@ -21,10 +21,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <core/endianswap.h>
 #include <core/memaccess.h>
+#include <core/timermanager.h>
 #include <cpu/ppc/ppcmmu.h>
 #include <devices/common/usb/usbohci.h>
+#include <devices/memctrl/dirtylog.h>
 #include <loguru.hpp>
 
+#include <algorithm>
 #include <map>
 
 // Host Controller Operational Registers
@@ -178,6 +181,12 @@ USBHostOHCI::USBHostOHCI(const std::string name)
     HcOp.HcControl.HostControllerFunctionalState = HCFS_UsbReset;
 }
 
+USBHostOHCI::~USBHostOHCI()
+{
+    if (this->frame_timer_id)
+        TimerManager::get_instance()->cancel_timer(this->frame_timer_id);
+}
+
 void USBHostOHCI::change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new, int bar_num) {
     if (aperture != aperture_new) {
         if (aperture)
@@ -265,6 +274,7 @@ uint32_t USBHostOHCI::read(uint32_t rgn_start, uint32_t offset, int size)
     uint32_t value = 0;
     uint32_t value2 = 0;
     if (rgn_start == this->aperture_base && offset < 0x1000) {
+        CatchUpFrames();
         value = this->read_hcop_reg(offset & ~3);
         if ((offset & 3) + size > 4) {
             value2 = this->read_hcop_reg((offset & ~3) + 4);
@@ -298,6 +308,8 @@ void USBHostOHCI::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int
             return;
         }
 
+        CatchUpFrames();
+
         value = BYTESWAP_32(value);
         LOG_F(
             WARNING, "%s: write %-30s @%02x.%c = %0*x", this->name.c_str(), get_reg_name(offset), offset,
@@ -501,6 +513,8 @@ void USBHostOHCI::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int
         } // switch offset
         #undef WR_REG
         #undef WR_REG_PORT
+
+        UpdateFrameTimer();
     }
     else {
         LOG_F(
@@ -1186,6 +1200,7 @@ void USBHostOHCI::SetHcFunctionalState(HCFS_t v, bool soft_reset) {
             LargestDataPacketCounter = HcOp.HcFmInterval.FSLargestDataPacket;
             HcOp.HcFmRemaining.FrameRemaining = HcOp.HcFmInterval.FrameInterval;
             BroadcastState(v);
+            frame_start_ns = TimerManager::get_instance()->current_time_ns();
             NewFrame();
             break;
         case HCFS_UsbSuspend:
@@ -1318,10 +1333,148 @@ void USBHostOHCI::RemoteWakeup() {
     USBHostOHCI::SetHcFunctionalState(HCFS_UsbResume, false);
 }
 
+bool USBHostOHCI::IsRunning() {
+    return !UnrecoverableError && !HcOp.HcInterruptStatus.UnrecoverableError &&
+        HcOp.HcControl.HostControllerFunctionalState == HCFS_UsbOperational;
+}
+
+uint64_t USBHostOHCI::FrameDurationNs() {
+    // FrameInterval counts 12 MHz bit times minus one
+    return (uint64_t(HcOp.HcFmInterval.FrameInterval) + 1) * 1000 / 12;
+}
+
+// Returns true if the next frame has anything to do besides bumping the frame
+// number: a list to service, a done queue to write back, latched events that
+// become interrupt status at the start of a frame or an enabled SOF interrupt.
+bool USBHostOHCI::FrameWorkPending() {
+    if (HcOp.HcControl.ControlListEnable &&
+            (HcOp.HcCommandStatus.ControlListFilled || HcOp.HcControlCurrentED))
+        return true;
+    if (HcOp.HcControl.BulkListEnable &&
+            (HcOp.HcCommandStatus.BulkListFilled || HcOp.HcBulkCurrentED))
+        return true;
+    if (HcOp.HcDoneHead)
+        return true;
+    if (SchedulingOverrun || ResumeDetected || RootHubStatusChange || OwnershipChange)
+        return true;
+    if (HcOp.HcInterruptEnable.MasterInterruptEnable && HcOp.HcInterruptEnable.StartOfFrameEnable)
+        return true;
+    if (HcOp.HcControl.PeriodicListEnable && hcca) {
+        // Drivers keep their interrupt EDs linked in even without pending
+        // transfers, so only an ED that ServiceEd would act on counts.
+        for (int i = 0; i < 32; i++) {
+            uint32_t ed = READ_DWORD_LE_A(&hcca->HccaInterrruptTable[i]) & ~15;
+            // the chains form a tree a few levels deep; the bound guards
+            // against a guest that linked an ED to itself
+            for (int n = 0; ed && n < 64; n++) {
+                EndpointDescriptor_t *edh = (EndpointDescriptor_t *)mmu_get_dma_mem(ed, sizeof(*edh));
+                ed0_t ed0; ed0.val = READ_DWORD_LE_A(&edh->ed0);
+                if (ed0.Format == FormatIsochronous && !HcOp.HcControl.IsochronousEnable)
+                    break;
+                ed2_t ed2; ed2.val = READ_DWORD_LE_A(&edh->ed2);
+                if (!ed0.sKip && !ed2.Halted &&
+                        (READ_DWORD_LE_A(&edh->TDQueueHeadPointer) & ~15) !=
+                        (READ_DWORD_LE_A(&edh->TDQueueTailPointer) & ~15))
+                    return true;
+                ed = READ_DWORD_LE_A(&edh->NextED) & ~15;
+            }
+        }
+    }
+    return false;
+}
+
+// Bring the frame counter up to the current guest time. Idle frames are
+// advanced in one step; frames with work are run one by one.
+void USBHostOHCI::CatchUpFrames() {
+    if (!IsRunning())
+        return;
+
+    uint64_t now_ns   = TimerManager::get_instance()->current_time_ns();
+    uint64_t frame_ns = FrameDurationNs();
+
+    if (now_ns >= frame_start_ns + frame_ns) {
+        uint64_t frames = (now_ns - frame_start_ns) / frame_ns;
+        frame_start_ns += frames * frame_ns;
+
+        // after a long stall (debugger etc.) only the latest frames are run
+        int busy_budget = 32;
+        while (frames && IsRunning()) {
+            if (!FrameWorkPending() || !busy_budget) {
+                SkipIdleFrames(frames);
+                break;
+            }
+            HcOp.HcFmRemaining.FrameRemaining = HcOp.HcFmInterval.FrameInterval;
+            HcOp.HcFmRemaining.FrameRemainingToggle = HcOp.HcFmInterval.FrameIntervalToggle;
+            StartOfFrame = true;
+            NewFrame();
+            busy_budget--;
+            frames--;
+        }
+    }
+
+    uint64_t bits = (now_ns - frame_start_ns) * 12 / 1000;
+    HcOp.HcFmRemaining.FrameRemaining = HcOp.HcFmInterval.FrameInterval -
+        std::min<uint64_t>(bits, HcOp.HcFmInterval.FrameInterval);
+}
+
+// Equivalent to running count frames with empty lists: only the last frame
+// needs the full bookkeeping, the others just bump the counters.
+void USBHostOHCI::SkipIdleFrames(uint64_t count) {
+    uint64_t skipped = count - 1;
+
+    if ((HcOp.HcFmNumber.FrameNumber & 0x7fff) + skipped > 0x7fff)
+        FrameNumberOverflow = true;
+    HcOp.HcFmNumber.FrameNumber = (HcOp.HcFmNumber.FrameNumber + skipped) & 0xffff;
+
+    if (DoneQueueInterruptCounter != 7)
+        DoneQueueInterruptCounter -= std::min<uint64_t>(skipped, DoneQueueInterruptCounter);
+
+    HcOp.HcFmRemaining.FrameRemainingToggle = HcOp.HcFmInterval.FrameIntervalToggle;
+    StartOfFrame = true;
+    IncrementFrameNumber();
+}
+
+// Arm the frame timer for the next frame with work or, when idle, for the
+// next frame number overflow if that interrupt is enabled.
+void USBHostOHCI::UpdateFrameTimer() {
+    uint64_t deadline = 0;
+
+    if (IsRunning()) {
+        uint64_t frame_ns = FrameDurationNs();
+        if (FrameWorkPending()) {
+            deadline = frame_start_ns + frame_ns;
+        }
+        else if (HcOp.HcInterruptEnable.MasterInterruptEnable &&
+                 HcOp.HcInterruptEnable.FrameNumberOverflowEnable) {
+            uint32_t to_overflow = 0x8000 - (HcOp.HcFmNumber.FrameNumber & 0x7fff);
+            deadline = frame_start_ns + to_overflow * frame_ns;
+        }
+    }
+
+    if (deadline == frame_timer_deadline && (frame_timer_id || !deadline))
+        return;
+
+    if (frame_timer_id) {
+        TimerManager::get_instance()->cancel_timer(frame_timer_id);
+        frame_timer_id = 0;
+    }
+
+    frame_timer_deadline = deadline;
+    if (!deadline)
+        return;
+
+    frame_timer_id = TimerManager::get_instance()->add_absolute_timer(deadline, 0,
+        [this](uint64_t, uint64_t) {
+            frame_timer_id = 0;
+            frame_timer_deadline = 0;
+            CatchUpFrames();
+            UpdateFrameTimer();
+        }
+    );
+}
+
 void USBHostOHCI::NewFrame() {
-    if (!UnrecoverableError && !HcOp.HcInterruptStatus.UnrecoverableError &&
-        HcOp.HcControl.HostControllerFunctionalState == HCFS_UsbOperational
-    ) {
+    if (IsRunning()) {
         IncrementFrameNumber();
         ServiceLists();
     }
@@ -1341,6 +1494,8 @@ void USBHostOHCI::IncrementFrameNumber () {
 
     WRITE_WORD_LE_A(&hcca->HccaFrameNumber, HcOp.HcFmNumber.FrameNumber);
     WRITE_WORD_LE_A(&hcca->HccaPad1, 0);
+    // the HCCA stays mapped for as long as the driver doesn't move it
+    dirty_log_dma_write(HcOp.HcHCCA, sizeof(*hcca));
 
     // update interrupts
     if (FrameNumberOverflow) {
@@ -1389,6 +1544,7 @@ void USBHostOHCI::IncrementFrameNumber () {
     if (DoneQueueInterruptCounter == 0) {
         if (HcOp.HcDoneHead & !HcOp.HcInterruptStatus.WritebackDoneHead) {
             WRITE_DWORD_LE_A(&hcca->HccaDoneHead, HcOp.HcDoneHead);
+            dirty_log_dma_write(HcOp.HcHCCA, sizeof(*hcca));
             HcOp.HcDoneHead = 0;
             HcOp.HcInterruptStatus.WritebackDoneHead = true;
             DoneQueueInterruptCounter = 7;
@@ -1489,20 +1645,31 @@ void USBHostOHCI::TriggerInterrupt() {
     } // if MasterInterruptEnable
 }
 
+// Packets aren't timed yet (see TransmitPacket), so every serviced ED is
+// charged this many bit times of the frame. Without it the list walk would
+// never run out of frame time.
+constexpr uint32_t OHCI_ED_BIT_TIME = 64;
+
 void USBHostOHCI::ServiceLists() {
     // FIXME: finish me
 
-    LOG_F(WARNING, "%s: [ ServiceLists", this->get_name().c_str());
+    LOG_F(9, "%s: [ ServiceLists", this->get_name().c_str());
 
     uint32_t ed;
     EndpointDescriptor_t *edh;
 
     uint32_t end_bit_time = HcOp.HcPeriodicStart.PeriodicStart;
 
-    int numProcessedEds = 0;
+    // bit times left in this frame
+    uint32_t frame_left = HcOp.HcFmRemaining.FrameRemaining;
+    auto charge_ed = [&frame_left]() {
+        frame_left -= std::min(frame_left, OHCI_ED_BIT_TIME);
+    };
 
     while (1) {
-        while (HcOp.HcFmRemaining.FrameRemaining > end_bit_time) {
+        while (frame_left > end_bit_time) {
+            // a pass over both lists that finds no ED ends the list walk
+            int numProcessedEds = 0;
 
             if (CurrentNonPeriodicList == ListType_Control) {
 
@@ -1515,15 +1682,16 @@ void USBHostOHCI::ServiceLists() {
                     }
                     if ((ed = HcOp.HcControlCurrentED)) {
                         edh = (EndpointDescriptor_t *)mmu_get_dma_mem(ed, sizeof(*edh));
-                        LOG_F(WARNING, "%s: [ Control Ed %08x", this->get_name().c_str(), ed);
+                        LOG_F(9, "%s: [ Control Ed %08x", this->get_name().c_str(), ed);
                         ServiceEd(ed, *edh, ListType_Control);
                         numProcessedEds++;
+                        charge_ed();
                         HcOp.HcControlCurrentED = READ_DWORD_LE_A(&edh->NextED) & ~15;
                         ProcessedNonemptyControlEDs++;
                         if (ProcessedNonemptyControlEDs > HcOp.HcControl.ControlBulkServiceRatio) {
                             CurrentNonPeriodicList = ListType_Bulk;
                         }
-                        LOG_F(WARNING, "%s: ] Control Ed %08x", this->get_name().c_str(), ed);
+                        LOG_F(9, "%s: ] Control Ed %08x", this->get_name().c_str(), ed);
                     } // if HcControlCurrentED
                     else {
                         CurrentNonPeriodicList = ListType_Bulk;
@@ -1546,12 +1714,13 @@ void USBHostOHCI::ServiceLists() {
                     }
                     if ((ed = HcOp.HcBulkCurrentED)) {
                         edh = (EndpointDescriptor_t *)mmu_get_dma_mem(ed, sizeof(*edh));
-                        LOG_F(WARNING, "%s: [ Bulk Ed %08x", this->get_name().c_str(), ed);
+                        LOG_F(9, "%s: [ Bulk Ed %08x", this->get_name().c_str(), ed);
                         ServiceEd(ed, *edh, ListType_Bulk);
                         numProcessedEds++;
+                        charge_ed();
                         HcOp.HcBulkCurrentED = READ_DWORD_LE_A(&edh->NextED) & ~15;
                         CurrentNonPeriodicList = ListType_Control;
-                        LOG_F(WARNING, "%s: ] Bulk Ed %08x", this->get_name().c_str(), ed);
+                        LOG_F(9, "%s: ] Bulk Ed %08x", this->get_name().c_str(), ed);
                     } // if HcBulkCurrentED
                     else {
                         CurrentNonPeriodicList = ListType_Control;
@@ -1565,39 +1734,40 @@ void USBHostOHCI::ServiceLists() {
             if (numProcessedEds == 0) {
                 break;
             }
-        } // while HcOp.HcFmRemaining.FrameRemaining > end_bit_time
+        } // while frame_left > end_bit_time
 
         if (end_bit_time == 0) {
             break;
         }
         end_bit_time = 0;
 
-        // FIXME: must finish before remaining is 0
-        // periodic lists
+        // periodic lists, a guest that linked an ED to itself
+        // is stopped by the end of the frame
         if (FrameControl.PeriodicListEnable) {
             DoingPeriodicList = true;
             // The Host Controller Driver ensures that all Interrupt Endpoint Descriptors are placed
             // on the list in front of any Isochronous Endpoint Descriptors
             ed = READ_DWORD_LE_A(&hcca->HccaInterrruptTable[HcOp.HcFmNumber.FrameNumber & 31]);
-            while (ed) {
-                LOG_F(WARNING, "%s: [ Periodic Ed %08x", this->get_name().c_str(), ed);
+            while (ed && frame_left) {
+                LOG_F(9, "%s: [ Periodic Ed %08x", this->get_name().c_str(), ed);
                 edh = (EndpointDescriptor_t *)mmu_get_dma_mem(ed, sizeof(*edh));
                 // FIXME: does this auto actually work to read Format ?
                 ed0_t ed0; ed0.val = READ_DWORD_LE_A(&edh->ed0);
                 if (ed0.Format == FormatIsochronous && !FrameControl.IsochronousEnable) {
-                    LOG_F(WARNING, "%s: ] Periodic Ed %08x IsochronousEnable disabled", this->get_name().c_str(), ed);
+                    LOG_F(9, "%s: ] Periodic Ed %08x IsochronousEnable disabled", this->get_name().c_str(), ed);
                     break;
                 }
                 ServiceEd(ed, *edh, ListType_Periodic);
+                charge_ed();
                 HcOp.HcPeriodCurrentED = ed;
                 ed = READ_DWORD_LE_A(&edh->NextED) & ~15;
-                LOG_F(WARNING, "%s: ] Periodic Ed %08x", this->get_name().c_str(), ed);
+                LOG_F(9, "%s: ] Periodic Ed %08x", this->get_name().c_str(), ed);
             }
             DoingPeriodicList = false;
         } // if PeriodicListEnable
     } // while
 
-    LOG_F(WARNING, "%s: ] ServiceLists", this->get_name().c_str());
+    LOG_F(9, "%s: ] ServiceLists", this->get_name().c_str());
 } // ServiceLists
 
 void USBHostOHCI::ServiceEd(uint32_t ed, EndpointDescriptor_t &edh, ListType_t list_type) {
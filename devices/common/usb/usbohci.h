@@ -414,7 +414,7 @@ typedef struct {
 class USBHostOHCI : public PCIDevice {
 public:
     USBHostOHCI(const std::string name);
-    ~USBHostOHCI() = default;
+    ~USBHostOHCI();
 
     // MMIODevice methods
     uint32_t read(uint32_t rgn_start, uint32_t offset, int size);
@@ -573,12 +573,25 @@ protected:
     HcRhDescriptorA_t    RhDescriptorA = { 0 }; // for reset
     HcRhDescriptorB_t    RhDescriptorB = { 0 }; // for reset
 
+    // Frames are not ticked every millisecond. The frame counter is brought
+    // up to date from the guest clock whenever the guest can observe it and
+    // the frame timer only runs while there is per-frame work to do.
+    uint64_t frame_start_ns       = 0; // guest time the current frame began
+    uint64_t frame_timer_deadline = 0;
+    uint32_t frame_timer_id       = 0;
+
     void SetHcFunctionalState(HCFS_t v, bool soft_reset);
     void ResetRegisters(bool soft_reset);
     void BroadcastState(HCFS_t v);
     void HardwareReset();
     void SoftwareReset();
     void RemoteWakeup();
+    bool IsRunning();
+    uint64_t FrameDurationNs();
+    bool FrameWorkPending();
+    void CatchUpFrames();
+    void SkipIdleFrames(uint64_t count);
+    void UpdateFrameTimer();
     void NewFrame();
     void IncrementFrameNumber ();
     void SendStartOfFrame();
@@ -411,6 +411,7 @@ void ViaCuda::write(int reg, uint8_t value) {
 uint16_t ViaCuda::calc_counter_val(const uint16_t last_val, const uint64_t &start_time)
 {
     // calculate current counter value based on elapsed time and timer frequency
+    timer_polled = true;
     uint64_t cur_time = TimerManager::get_instance()->current_time_ns();
     uint64_t diff_hi;
     uint32_t diff_lo;
@@ -426,6 +426,15 @@ uint64_t MacSuperDrive::sector_data_delay()
     return MFM_SECT_DATA_DELAY;
 }
 
+/** Turbo mode: let the next address mark be the one of the given sector. */
+void MacSuperDrive::seek_sector(uint8_t sector_num)
+{
+    int sect = sector_num - ((this->rec_method == RecMethod::MFM) ? 1 : 0);
+
+    if (sect >= 0 && sect < this->sectors_per_track[this->cur_track])
+        this->next_sector = sect;
+}
+
 MacSuperDrive::SectorHdr MacSuperDrive::current_sector_header()
 {
     this->cur_sector = this->next_sector;
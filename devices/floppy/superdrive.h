@@ -121,6 +121,7 @@ static std::string get_status_name(uint8_t addr);
     SectorHdr current_sector_header();
     char* get_sector_data_ptr(int sector_num);
     uint64_t sector_data_delay();
+    void seek_sector(uint8_t sector_num);
 
     double get_current_track_delay();
     double get_address_mark_delay();
@@ -44,6 +44,12 @@ namespace loguru {
 
 using namespace Swim3;
 
+// In turbo mode, seeks complete all at once and sector searches go straight
+// to the requested sector. Completion is still reported through a timer and
+// the usual interrupts so that drivers see the normal register protocol.
+constexpr uint64_t TURBO_STEP_DELAY   = USECS_TO_NSECS(10);
+constexpr uint64_t TURBO_ACCESS_DELAY = USECS_TO_NSECS(10);
+
 static std::string get_reg_name(uint8_t reg_offset)
 {
     switch (reg_offset) {
@@ -75,6 +81,8 @@ Swim3Ctrl::Swim3Ctrl(const std::string &dev_name)
 
     this->reset();
 
+    this->turbo = GET_BIN_PROP("fdd_turbo");
+
     // Attach virtual Superdrive(s) to the internal drive connector
     int num_drives = GET_INT_PROP("fdd_drives");
     if (num_drives > 0)
@@ -336,6 +344,18 @@ void Swim3Ctrl::start_stepping()
 
     this->mode_reg |= SWIM3_GO_STEP;
 
+    if (this->turbo) {
+        this->step_timer_id = TimerManager::get_instance()->add_oneshot_timer(
+            TURBO_STEP_DELAY,
+            [this](uint64_t, uint64_t) {
+                this->step_timer_id = 0;
+                while (this->step_count && (this->mode_reg & SWIM3_GO_STEP))
+                    this->do_step();
+            }
+        );
+        return;
+    }
+
     // step count > 1 requires periodic task
     if (this->step_count > 1) {
         this->step_timer_id = TimerManager::get_instance()->add_cyclic_timer(
@@ -387,8 +407,17 @@ void Swim3Ctrl::start_disk_access()
         return;
     }
 
+    uint64_t delay;
+
+    if (this->turbo) {
+        this->selected_drive->seek_sector(this->target_sect);
+        delay = TURBO_ACCESS_DELAY;
+    } else {
+        delay = this->selected_drive->sync_to_disk();
+    }
+
     this->access_timer_id = TimerManager::get_instance()->add_oneshot_timer(
-        this->selected_drive->sync_to_disk(),
+        delay,
         [this](uint64_t, uint64_t) {
             this->cur_state = SWIM3_ADDR_MARK_SEARCH;
             this->disk_access();
@@ -426,6 +455,8 @@ void Swim3Ctrl::disk_access()
             // move to next address mark
             this->cur_state = SWIM3_ADDR_MARK_SEARCH;
             delay = this->selected_drive->next_sector_delay();
+            if (this->turbo)
+                this->selected_drive->seek_sector(this->target_sect);
         }
         break;
     case SWIM3_DATA_XFER:
@@ -446,6 +477,11 @@ void Swim3Ctrl::disk_access()
         return;
     }
 
+    // consecutive sectors follow each other as fast as the DMA channel
+    // moves them
+    if (this->turbo)
+        delay = TURBO_ACCESS_DELAY;
+
     this->access_timer_id = TimerManager::get_instance()->add_oneshot_timer(
         delay,
         [this](uint64_t, uint64_t) {
@@ -482,7 +518,8 @@ void Swim3Ctrl::init_timer(const uint8_t start_val)
             this->timer_val = 0;
             this->int_flags |= INT_TIMER_DONE;
             update_irq();
-        }
+        },
+        NS_PER_USEC // the timer counts in microseconds
     );
 }
 
@@ -580,6 +617,8 @@ void Swim3Ctrl::mode_change(uint8_t new_mode)
 static const PropMap Swim3_Properties = {
     {"fdd_drives",
         new IntProperty(1, std::vector<uint32_t>({0, 1, 2}))},
+    {"fdd_turbo",
+        new BinProperty(0)},
 };
 
 static const DeviceDescription Swim3_Descriptor = {
@@ -144,6 +144,7 @@ private:
     uint8_t gap_size;
     uint8_t rd_line;
     int     cur_state;
+    bool    turbo;      // skip rotational and step latencies
 
     int     one_us_timer_id = 0;
     int     step_timer_id   = 0;
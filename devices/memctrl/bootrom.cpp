@@ -22,6 +22,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 /** BootRom emulation. */
 
 #include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <devices/deviceregistry.h>
 #include <devices/memctrl/bootrom.h>
 #include <machines/machinefactory.h>
@@ -597,11 +598,86 @@ int BootRom::set_data(const uint8_t* data, uint32_t size)
     return 0;
 }
 
+/* Share the ROM image with other instances by mapping it from the file. */
+int BootRom::map_data(const std::string& file_path, const uint8_t* data, uint32_t size)
+{
+    MemCtrlBase *mem_ctrl = dynamic_cast<MemCtrlBase *>
+        (gMachineObj->get_comp_by_type(HWCompType::MEM_CTRL));
+
+    if (!mem_ctrl || size > this->rom_size ||
+        !mem_ctrl->map_file_into_region(this->rom_entry, this->rom_size - size, file_path, size))
+        return this->set_data(data, size);
+
+    // the file may have changed since it was read
+    if (std::memcmp(this->rom_entry->mem_ptr + this->rom_size - size, data, size)) {
+        LOG_F(WARNING, "%s: ROM file changed on disk, using the copy read at startup.",
+            this->name.c_str());
+        return this->set_data(data, size);
+    }
+
+    if (size < this->rom_size)
+        LOG_F(ERROR, "%s: ROM source is smaller than expected.", this->name.c_str());
+    return 0;
+}
+
+/*
+    While ROM writes are enabled, the region stays RT_ROM | RT_FLASH as long as
+    all flash chips are in read array mode: reads are served from memory and
+    only writes are routed to the device. Once a command puts a chip into
+    another mode, the whole region becomes RT_MMIO so that status/ID reads reach
+    the chips. It returns to memory mode after FLASH_IDLE_READS consecutive reads
+    with every chip back in read array mode; this avoids flushing the TLBs twice
+    for every programmed byte.
+*/
+constexpr uint32_t FLASH_IDLE_READS = 64;
+
+void BootRom::set_rom_type(uint32_t type)
+{
+    if (this->rom_entry->type != type) {
+        this->rom_entry->type = type;
+        mmu_flush_phys_range(this->rom_entry->start, this->rom_size);
+    }
+}
+
+bool BootRom::flash_reads_memory()
+{
+    for (auto &child : this->children) {
+        FlashChip *flash_chip = dynamic_cast<FlashChip*>(child.second.get());
+        if (flash_chip && !flash_chip->reads_memory())
+            return false;
+    }
+    return true;
+}
+
+void BootRom::flash_accessed(bool is_write)
+{
+    if (!this->rom_we)
+        return;
+
+    if (is_write) {
+        this->flash_idle_reads = 0;
+        if (!this->flash_reads_memory())
+            this->set_rom_type(RT_MMIO);
+    } else if (this->rom_entry->type == RT_MMIO) {
+        if (!this->flash_reads_memory())
+            this->flash_idle_reads = 0;
+        else if (++this->flash_idle_reads >= FLASH_IDLE_READS)
+            this->set_rom_type(RT_ROM | RT_FLASH);
+    }
+}
+
 void BootRom::set_rom_write_enable(const bool enable)
 {
     if (this->has_flash) {
         LOG_F(WARNING, "%s: ROM write %s", this->name.c_str(), enable ? "enabled" : "disabled");
-        this->rom_entry->type = enable ? RT_MMIO : RT_ROM;
+        this->rom_we = enable;
+        this->flash_idle_reads = 0;
+        if (!enable)
+            this->set_rom_type(RT_ROM);
+        else if (this->flash_reads_memory())
+            this->set_rom_type(RT_ROM | RT_FLASH);
+        else
+            this->set_rom_type(RT_MMIO);
     }
 }
 
@@ -643,6 +719,7 @@ uint32_t BootRomOW::read(uint32_t /*rgn_start*/, uint32_t offset, int size)
         LOG_F(BOOTROM, "%s: read  ROM offset @%06x.%c = %0*x",
             this->name.c_str(), offset, SIZE_ARG(size), size * 2, value);
 
+    this->flash_accessed(false);
     return value;
 }
 
@@ -664,6 +741,7 @@ void BootRomOW::write(uint32_t /*rgn_start*/, uint32_t offset, uint32_t value, i
         dynamic_cast<FlashChip *>(
             this->children[((offset >> 18) & 8) + (offset & 7) + i].get())->write((offset & 0x1FFFFF) / 8, val);
     }
+    this->flash_accessed(true);
 }
 
 uint16_t BootRomOW::rom_read(FlashChip *chip, uint32_t addr)
@@ -711,6 +789,7 @@ uint32_t BootRomNW::read(uint32_t /*rgn_start*/, uint32_t offset, int size)
             this->name.c_str(), offset, SIZE_ARG(size));
     }
 
+    this->flash_accessed(false);
     return value;
 }
 
@@ -735,6 +814,7 @@ void BootRomNW::write(uint32_t /*rgn_start*/, uint32_t offset, uint32_t value, i
         LOG_F(WARNING, "%s: write unknown ROM offset @%06x.%c = %0*x",
             this->name.c_str(), offset, SIZE_ARG(size), size * 2, value);
     }
+    this->flash_accessed(true);
 }
 
 uint16_t BootRomNW::rom_read(FlashChip *chip, uint32_t addr)
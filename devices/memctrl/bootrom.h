@@ -59,6 +59,7 @@ public:
     virtual void set_controller(FlashController* controller);
     virtual uint16_t read(uint32_t addr) = 0;
     virtual void write(uint32_t addr, uint16_t value) = 0;
+    virtual bool reads_memory() = 0; // true while in read array mode
 
     FlashController *controller = nullptr;
 };
@@ -85,6 +86,9 @@ public:
     // FlashChip methods
     virtual uint16_t read(uint32_t addr);
     virtual void write(uint32_t addr, uint16_t value);
+    virtual bool reads_memory() {
+        return state == Flash::ReadMemory || state == Flash::Reset;
+    }
 
 private:
 #if 1
@@ -115,6 +119,9 @@ public:
     // FlashChip methods
     virtual uint16_t read(uint32_t addr);
     virtual void write(uint32_t addr, uint16_t value);
+    virtual bool reads_memory() {
+        return state == Flash::ReadMemory || state == Flash::Reset;
+    }
 
 private:
     uint8_t         vendor_id  = 0x89;  // Micron
@@ -141,6 +148,7 @@ public:
     // BootRom methods
     virtual void set_rom_write_enable(const bool enable);
     virtual int set_data(const uint8_t* data, uint32_t size);
+    virtual int map_data(const std::string& file_path, const uint8_t* data, uint32_t size);
     virtual uint8_t* get_data() { return rom_entry->mem_ptr; };
     virtual void identify_rom();
     virtual void fix_rom();
@@ -149,8 +157,15 @@ public:
 
     static std::vector<std::string> rom_patches;
 
+protected:
+    void flash_accessed(bool is_write);
+
 private:
+    bool flash_reads_memory();
+    void set_rom_type(uint32_t type);
+
     bool                rom_we = false;
+    uint32_t            flash_idle_reads = 0;
     bool                has_flash = true;
     AddressMapEntry*    rom_entry;
     uint32_t            rom_addr;
@@ -0,0 +1,125 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Guest physical memory dirty page log. */
+
+#include <cpu/ppc/ppcmmu.h>
+#include <devices/memctrl/dirtylog.h>
+
+#include <bit>
+
+DirtyPageLog g_dirty_log;
+bool g_dirty_log_active = false;
+
+DirtyPageLog::~DirtyPageLog() {
+    for (auto& shard : this->shards)
+        delete[] shard.load();
+}
+
+std::atomic<uint64_t>* DirtyPageLog::alloc_shard(uint32_t index) {
+    std::atomic<uint64_t>* shard = new std::atomic<uint64_t>[SHARD_WORDS];
+    for (uint32_t i = 0; i < SHARD_WORDS; i++)
+        shard[i].store(0, std::memory_order_relaxed);
+
+    // another thread may have won the race
+    std::atomic<uint64_t>* expected = nullptr;
+    if (!this->shards[index].compare_exchange_strong(expected, shard,
+                                                     std::memory_order_acq_rel)) {
+        delete[] shard;
+        return expected;
+    }
+    return shard;
+}
+
+void DirtyPageLog::mark_range(uint32_t phys_addr, uint32_t size) {
+    if (!size)
+        return;
+
+    uint64_t last = (uint64_t(phys_addr) + size - 1) >> PAGE_BITS;
+    for (uint64_t page = phys_addr >> PAGE_BITS; page <= last; page++)
+        this->mark(uint32_t(page << PAGE_BITS));
+}
+
+size_t DirtyPageLog::collect(std::vector<uint32_t>& pages) {
+    size_t found = 0;
+
+    for (uint32_t s = 0; s < NUM_SHARDS; s++) {
+        std::atomic<uint64_t>* shard = this->shards[s].load(std::memory_order_acquire);
+        if (!shard)
+            continue;
+        for (uint32_t w = 0; w < SHARD_WORDS; w++) {
+            if (!shard[w].load(std::memory_order_relaxed))
+                continue;
+            uint64_t bits = shard[w].exchange(0, std::memory_order_relaxed);
+            uint32_t base = (s << SHARD_BITS) | (w << 6);
+            while (bits) {
+                int bit = std::countr_zero(bits);
+                pages.push_back((base + bit) << PAGE_BITS);
+                bits &= bits - 1;
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+size_t DirtyPageLog::count() const {
+    size_t total = 0;
+
+    for (auto& entry : this->shards) {
+        std::atomic<uint64_t>* shard = entry.load(std::memory_order_acquire);
+        if (!shard)
+            continue;
+        for (uint32_t w = 0; w < SHARD_WORDS; w++)
+            total += std::popcount(shard[w].load(std::memory_order_relaxed));
+    }
+
+    return total;
+}
+
+void DirtyPageLog::clear() {
+    for (auto& entry : this->shards) {
+        std::atomic<uint64_t>* shard = entry.load(std::memory_order_acquire);
+        if (!shard)
+            continue;
+        for (uint32_t w = 0; w < SHARD_WORDS; w++)
+            shard[w].store(0, std::memory_order_relaxed);
+    }
+}
+
+void dirty_log_start() {
+    g_dirty_log.clear();
+    g_dirty_log_active = true;
+    mmu_dirty_log_rearm();
+}
+
+void dirty_log_stop() {
+    g_dirty_log_active = false;
+    g_dirty_log.clear();
+}
+
+size_t dirty_log_sync(std::vector<uint32_t>& pages) {
+    size_t found = g_dirty_log.collect(pages);
+    // the next write to each page must be logged again
+    mmu_dirty_log_rearm();
+    return found;
+}
@@ -0,0 +1,107 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Guest physical memory dirty page log.
+
+    Tracks which 4 KiB pages of the guest physical address space have been
+    written since the log was last collected. The bitmap is split into
+    shards of 128 MiB that are only allocated once a page inside them gets
+    dirty so that the sparse physical address space of a Power Macintosh
+    costs a few KiB only. Pages are marked with an atomic OR, collecting
+    exchanges each word with zero so that a DMA engine running on another
+    thread never loses a write.
+
+    The CPU marks a page on the first write through a DTLB entry only, see
+    mmu_dirty_log_rearm(), so tracking doesn't slow down the write fast path.
+ */
+
+#ifndef DIRTY_PAGE_LOG_H
+#define DIRTY_PAGE_LOG_H
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <vector>
+
+class DirtyPageLog {
+public:
+    static constexpr uint32_t PAGE_BITS  = 12;
+    static constexpr uint32_t PAGE_SIZE  = 1 << PAGE_BITS;
+    static constexpr uint32_t SHARD_BITS = 15; // pages per shard = 128 MiB
+    static constexpr uint32_t NUM_SHARDS = 1 << (32 - PAGE_BITS - SHARD_BITS);
+    static constexpr uint32_t SHARD_WORDS = (1 << SHARD_BITS) / 64;
+
+    DirtyPageLog() = default;
+    ~DirtyPageLog();
+
+    DirtyPageLog(const DirtyPageLog&) = delete;
+    DirtyPageLog& operator=(const DirtyPageLog&) = delete;
+
+    void mark(uint32_t phys_addr) {
+        uint32_t page = phys_addr >> PAGE_BITS;
+        std::atomic<uint64_t>* shard = this->shards[page >> SHARD_BITS].load(
+            std::memory_order_acquire);
+        if (!shard)
+            shard = this->alloc_shard(page >> SHARD_BITS);
+        shard[(page & ((1 << SHARD_BITS) - 1)) >> 6].fetch_or(
+            uint64_t(1) << (page & 63), std::memory_order_relaxed);
+    }
+
+    /** Mark all pages touched by a physical address range. */
+    void mark_range(uint32_t phys_addr, uint32_t size);
+
+    /** Append the physical addresses of all dirty pages in ascending order
+        to the vector and clear them. Returns the number of pages added. */
+    size_t collect(std::vector<uint32_t>& pages);
+
+    /** Number of dirty pages without clearing them. */
+    size_t count() const;
+
+    void clear();
+
+private:
+    std::atomic<uint64_t>* alloc_shard(uint32_t index);
+
+    std::array<std::atomic<std::atomic<uint64_t>*>, NUM_SHARDS> shards = {};
+};
+
+extern DirtyPageLog g_dirty_log;
+
+/** Checked by the DTLB refill before it lets RAM writes bypass the log. */
+extern bool g_dirty_log_active;
+
+/** Log a device write to guest RAM. Devices that keep a DMA mapping
+    around call it after each write because the pages marked by
+    mmu_map_dma_mem() may have been collected in the meantime. */
+inline void dirty_log_dma_write(uint32_t phys_addr, uint32_t size) {
+    if (g_dirty_log_active)
+        g_dirty_log.mark_range(phys_addr, size);
+}
+
+/** Start logging writes to guest RAM with an empty log. */
+extern void dirty_log_start();
+extern void dirty_log_stop();
+
+/** Collect the pages dirtied since the previous call and re-arm
+    write tracking for them. */
+extern size_t dirty_log_sync(std::vector<uint32_t>& pages);
+
+#endif // DIRTY_PAGE_LOG_H
@@ -21,6 +21,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <devices/memctrl/memctrlbase.h>
 #include <devices/common/mmiodevice.h>
+#include <utils/mmioprofile.h>
+#include <utils/stats.h>
 
 #include <algorithm>
 #include <cstring>
@@ -28,6 +30,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <vector>
 #include <loguru.hpp>
 
+#if !defined(_WIN32) && \
+    (defined(__APPLE__) || defined(__linux__) || defined(__unix__))
+#define DPPC_HAS_MMAP 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 MemCtrlBase::~MemCtrlBase() {
     for (auto& entry : address_map) {
         if (entry)
@@ -38,7 +50,12 @@ MemCtrlBase::~MemCtrlBase() {
         if (reg)
             delete (reg);
     }
+#if DPPC_HAS_MMAP
+    for (auto& reg : mapped_regions)
+        munmap(reg.ptr, reg.size);
+#endif
     this->mem_regions.clear();
+    this->mapped_regions.clear();
     this->address_map.clear();
 }
 
@@ -210,13 +227,8 @@ AddressMapEntry* MemCtrlBase::add_mem_region(
         if (!is_range_free(start_addr, size))
             return nullptr;
 
-        if (!mem_ptr && (type & (RT_RAM | RT_ROM))) {
-            mem_ptr = new uint8_t[size](); // allocate and clear to zero
-            //mem_ptr = new(std::align_val_t(8)) uint8_t[size](); // allocate and clear to zero
-            if (((uintptr_t)mem_ptr & 7) != 0)
-                ABORT_F("not aligned!");
-            this->mem_regions.push_back(mem_ptr);
-        }
+        if (!mem_ptr && (type & (RT_RAM | RT_ROM)))
+            mem_ptr = alloc_region_mem(size, type);
     }
 
     entry = new AddressMapEntry;
@@ -229,11 +241,31 @@ AddressMapEntry* MemCtrlBase::add_mem_region(
     entry->devobj  = dev_instance;
     entry->mem_ptr = mem_ptr;
 
+    entry->stat_reads = entry->stat_writes = STAT_INVALID;
+    if (type & RT_MMIO) {
+        std::string stat_name = "mmio_" + (dev_instance ? dev_instance->get_name() : "other");
+        entry->stat_reads  = stats_add_counter(stat_name + "_reads");
+        entry->stat_writes = stats_add_counter(stat_name + "_writes");
+    }
+
     if (dev_instance) {
+        uint32_t prof_id = mmio_prof_add_region(dev_instance->get_name(), start_addr);
         entry->read = [=](uint32_t rgn_start, uint32_t offset, int size) {
+            if (g_mmio_prof_enabled.load(std::memory_order_relaxed)) [[unlikely]] {
+                uint64_t start_ns = mmio_prof_now();
+                uint32_t value = dev_instance->read(rgn_start, offset, size);
+                mmio_prof_record(prof_id, offset, false, mmio_prof_now() - start_ns);
+                return value;
+            }
             return dev_instance->read(rgn_start, offset, size);
         };
         entry->write = [=](uint32_t rgn_start, uint32_t offset, uint32_t value, int size) {
+            if (g_mmio_prof_enabled.load(std::memory_order_relaxed)) [[unlikely]] {
+                uint64_t start_ns = mmio_prof_now();
+                dev_instance->write(rgn_start, offset, value, size);
+                mmio_prof_record(prof_id, offset, true, mmio_prof_now() - start_ns);
+                return;
+            }
             dev_instance->write(rgn_start, offset, value, size);
         };
     }
@@ -264,6 +296,51 @@ AddressMapEntry* MemCtrlBase::add_mem_region(
 }
 
 
+/*
+    Allocate zero-filled, page-aligned memory that can be remapped later.
+    Host pages are committed on first touch so guest RAM costs nothing
+    until the guest actually uses it.
+*/
+uint8_t* MemCtrlBase::alloc_mapped_mem(uint32_t size, uint32_t type) {
+#if DPPC_HAS_MMAP
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        LOG_F(WARNING, "Anonymous mmap of 0x%X bytes failed: %s", size,
+              std::strerror(errno));
+        return nullptr;
+    }
+    this->mapped_regions.push_back({static_cast<uint8_t*>(addr), size, type});
+    return static_cast<uint8_t*>(addr);
+#else
+    return nullptr;
+#endif
+}
+
+
+/* Allocate zero-filled host memory for a RAM or ROM region. */
+uint8_t* MemCtrlBase::alloc_region_mem(uint32_t size, uint32_t type) {
+    uint8_t* mem_ptr = alloc_mapped_mem(size, type);
+    if (!mem_ptr) {
+        mem_ptr = new uint8_t[size](); // allocate and clear to zero
+        //mem_ptr = new(std::align_val_t(8)) uint8_t[size](); // allocate and clear to zero
+        if (((uintptr_t)mem_ptr & 7) != 0)
+            ABORT_F("not aligned!");
+        this->mem_regions.push_back(mem_ptr);
+    }
+    return mem_ptr;
+}
+
+
+MappedRegion* MemCtrlBase::find_mapped_region(const uint8_t* host_ptr) {
+    for (auto& reg : mapped_regions) {
+        if (host_ptr >= reg.ptr && host_ptr < reg.ptr + reg.size)
+            return &reg;
+    }
+    return nullptr;
+}
+
+
 AddressMapEntry* MemCtrlBase::add_rom_region(uint32_t start_addr, uint32_t size,
                                              MMIODevice* dev_instance) {
     return add_mem_region(start_addr, size, 0, RT_ROM, nullptr, dev_instance, 0);
@@ -311,6 +388,22 @@ void MemCtrlBase::delete_address_map_entry(AddressMapEntry* entry) {
 
     int found = 0;
 
+#if DPPC_HAS_MMAP
+    mapped_regions.erase(std::remove_if(mapped_regions.begin(), mapped_regions.end(),
+        [entry, &found](const MappedRegion& reg) {
+            if (entry->mem_ptr == reg.ptr) {
+                if (!found) {
+                    munmap(reg.ptr, reg.size);
+                    entry->mem_ptr = nullptr;
+                }
+                found++;
+                return true;
+            }
+            return false;
+        }
+    ), mapped_regions.end());
+#endif
+
     mem_regions.erase(std::remove_if(mem_regions.begin(), mem_regions.end(),
         [entry, &found](const uint8_t* mem_ptr) {
             if (entry->mem_ptr == mem_ptr) {
@@ -391,6 +484,115 @@ AddressMapEntry* MemCtrlBase::remove_region(AddressMapEntry* entry)
 }
 
 
+/*
+    Map a file over part of a ROM region. The mapping is private so patches and
+    flash writes still work, but pages the guest never writes stay in the host
+    page cache and are shared by every process that maps the same file.
+*/
+bool MemCtrlBase::map_file_into_region(AddressMapEntry* entry, uint32_t offset,
+                                       const std::string& file_path, uint32_t size)
+{
+#if DPPC_HAS_MMAP
+    if (!entry || !(entry->type & RT_ROM) || !size)
+        return false;
+
+    MappedRegion* reg = find_mapped_region(entry->mem_ptr);
+    if (!reg || reg->ptr != entry->mem_ptr)
+        return false;
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if ((offset % page_size) || (size % page_size) || offset + size > reg->size)
+        return false;
+
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || st.st_size != size) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(entry->mem_ptr + offset, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        LOG_F(WARNING, "Could not map %s: %s", file_path.c_str(), std::strerror(errno));
+        // MAP_FIXED may have already discarded the old pages, restore them
+        mmap(entry->mem_ptr + offset, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        return false;
+    }
+
+    // This is the size of the file mapping, not the memory actually saved:
+    // pages are only shared once faulted in and until they're written.
+    LOG_F(INFO, "Mapped %u KB of %s into mem region %s for sharing with other instances",
+        size >> 10, file_path.c_str(), get_entry_str(entry).c_str());
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void MemCtrlBase::note_zeroed_line(uint8_t* host_ptr) {
+#if DPPC_HAS_MMAP
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+
+    // Mac OS clears memory in ascending order, so a page becomes a candidate
+    // once its last cache line has been cleared.
+    uintptr_t line_end = (uintptr_t)host_ptr + 32;
+    if ((line_end & (page_size - 1)) || this->zeroed_pages.size() >= 65536)
+        return;
+
+    this->zeroed_pages.push_back((uint8_t*)(line_end - page_size));
+#endif
+}
+
+
+/* Give all candidate pages that are still zero back to the host. */
+size_t MemCtrlBase::release_zero_pages() {
+    size_t released = 0;
+
+#if DPPC_HAS_MMAP
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+
+    for (uint8_t* page : this->zeroed_pages) {
+        MappedRegion* reg = find_mapped_region(page);
+        if (!reg || reg->type != RT_RAM || page + page_size > reg->ptr + reg->size)
+            continue;
+
+        const uint64_t* p = (const uint64_t*)page;
+        size_t i;
+        for (i = 0; i < page_size / 8 && !p[i]; i++);
+        if (i < page_size / 8)
+            continue;
+
+#ifdef __linux__
+        // anonymous private pages read back as zeros after MADV_DONTNEED
+        if (madvise(page, page_size, MADV_DONTNEED) == 0)
+            released++;
+#else
+        if (mmap(page, page_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+            released++;
+#endif
+    }
+
+    this->zeroed_pages.clear();
+
+    if (released)
+        LOG_F(1, "Released %zu zeroed RAM pages (%zu KB) to the host",
+              released, (released * page_size) >> 10);
+#endif
+
+    return released;
+}
+
+
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
 bool MemCtrlBase::needs_swap_endian(bool /*is_mmio*/) {
     return false;
@@ -408,6 +610,17 @@ uint8_t *MemCtrlBase::get_region_hostmem_ptr(const uint32_t addr) {
         return (addr - reg_desc->start) + reg_desc->mem_ptr;
 }
 
+std::vector<AddressMapEntry*> MemCtrlBase::get_ram_regions() {
+    std::vector<AddressMapEntry*> regions;
+
+    for (auto& entry : address_map) {
+        if ((entry->type & (RT_RAM | RT_MIRROR)) == RT_RAM)
+            regions.push_back(entry);
+    }
+
+    return regions;
+}
+
 
 void MemCtrlBase::dump_regions()
 {
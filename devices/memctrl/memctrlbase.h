@@ -50,6 +50,8 @@ enum RangeType {
     RT_MMIO   = 4, // memory mapped I/O
     RT_MIRROR = 8, // region mirror (content of another region acessible at some
                    // other address)
+    RT_FLASH  = 16, // combined with RT_ROM: reads come from memory, writes go
+                    // to the device (write-enabled flash ROM)
 };
 
 /** Defines the format for the address map entry. */
@@ -62,9 +64,18 @@ typedef struct AddressMapEntry {
     std::function<uint32_t(uint32_t rgn_start, uint32_t offset, int size)> read;
     std::function<void(uint32_t rgn_start, uint32_t offset, uint32_t value, int size)> write;
     unsigned char* mem_ptr; // direct pointer to data for memory objects
+    uint32_t stat_reads;    // runtime counter IDs for MMIO accesses
+    uint32_t stat_writes;
 } AddressMapEntry;
 
 
+/** Describes host memory mapped for a RAM or ROM region. */
+typedef struct MappedRegion {
+    uint8_t*    ptr;    // page-aligned host address
+    uint32_t    size;   // size in bytes
+    uint32_t    type;   // RT_RAM or RT_ROM
+} MappedRegion;
+
 /** Base class for memory controllers. */
 class MemCtrlBase {
 public:
@@ -104,16 +115,38 @@ public:
 
     uint8_t *get_region_hostmem_ptr(const uint32_t addr);
 
+    // RAM regions owning their host memory, mirrors excluded
+    std::vector<AddressMapEntry*> get_ram_regions();
+
+    // Replace the content of a ROM region with a copy-on-write mapping of a file
+    // so that identical ROM pages are shared by all emulator instances.
+    bool map_file_into_region(AddressMapEntry* entry, uint32_t offset,
+                              const std::string& file_path, uint32_t size);
+
+    // Remember a cache line cleared by dcbz so that the host page containing
+    // it can be given back to the host once it has been completely zeroed.
+    void note_zeroed_line(uint8_t* host_ptr);
+    size_t release_zero_pages();
+
+    bool track_zero_pages = false;
+
     void dump_regions();
 
 protected:
+    uint8_t* alloc_region_mem(uint32_t size, uint32_t type);
+
     AddressMapEntry* add_mem_region(
         uint32_t start_addr, uint32_t size, uint32_t dest_addr, uint32_t type,
         uint8_t  *mem_ptr, MMIODevice* dev_instance, uint32_t offset
     );
 
 private:
+    uint8_t* alloc_mapped_mem(uint32_t size, uint32_t type);
+    MappedRegion* find_mapped_region(const uint8_t* host_ptr);
+
     std::vector<uint8_t*> mem_regions;
+    std::vector<MappedRegion> mapped_regions;
+    std::vector<uint8_t*> zeroed_pages; // host pages that may be all zeros
     std::vector<AddressMapEntry*> address_map;
 };
 
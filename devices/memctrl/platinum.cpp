@@ -479,7 +479,7 @@ void PlatinumCtrl::map_phys_ram() {
     }
 
     if (!this->dram_ptr) {
-        this->dram_ptr = std::unique_ptr<uint8_t[]> (new uint8_t[total_ram]()); /* () intializer clears the memory to zero */
+        this->dram_ptr = this->alloc_region_mem(total_ram, RT_RAM);
         if (!this->dram_ptr) {
             ABORT_F("%s: could not allocate RAM storage", this->name.c_str());
         }
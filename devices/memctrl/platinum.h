@@ -369,7 +369,7 @@ private:
     std::unique_ptr<uint8_t[]>      vram_ptr = nullptr;
     DisplayID*                      disp_id = nullptr;
     AppleRamdac*                    dacula = nullptr;
-    std::unique_ptr<uint8_t[]>      dram_ptr = nullptr;
+    uint8_t*                        dram_ptr = nullptr; // owned by MemCtrlBase
     std::vector<AddressMapEntry*>   ram_map;
 };
 
@@ -101,7 +101,7 @@ private:
     uint32_t    flash_cfg;
     uint32_t    pages_cfg[5] = {0x88888888,0x88888888,0x88888888,0x88888888,0x88888888};
     uint32_t    bank_size[5] = {};
-    std::unique_ptr<uint8_t[]>      dram_ptr = nullptr;
+    uint8_t*                        dram_ptr = nullptr; // owned by MemCtrlBase
     std::vector<AddressMapEntry*>   ram_map;
 };
 
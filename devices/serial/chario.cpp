@@ -22,8 +22,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 /** Character I/O backend implementations. */
 
 #include <devices/serial/chario.h>
+#include <utils/inputlog.h>
 #include <loguru.hpp>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
 #include <memory>
@@ -40,6 +42,128 @@ CharIoBackEnd::~CharIoBackEnd()
     LOG_F(INFO, "Deleted %s", this->name.c_str());
 }
 
+int CharIoBackEnd::xmit_buf(const uint8_t *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        this->xmit_char(buf[i]);
+    return len;
+}
+
+int CharIoBackEnd::rcv_buf(uint8_t *buf, int len)
+{
+    int count = 0;
+
+    while (count < len && this->rcv_char_available_now())
+        this->rcv_char(&buf[count++]);
+
+    return count;
+}
+
+//======================== Ring buffer ========================
+int CharIoRing::put(const uint8_t *buf, int len)
+{
+    uint32_t head = this->head.load(std::memory_order_relaxed);
+    uint32_t tail = this->tail.load(std::memory_order_acquire);
+    uint32_t count = std::min(uint32_t(len), RING_SIZE - (head - tail));
+
+    for (uint32_t i = 0; i < count; i++)
+        this->data[(head + i) & (RING_SIZE - 1)] = buf[i];
+
+    this->head.store(head + count, std::memory_order_release);
+    return count;
+}
+
+int CharIoRing::get(uint8_t *buf, int len)
+{
+    uint32_t tail = this->tail.load(std::memory_order_relaxed);
+    uint32_t head = this->head.load(std::memory_order_acquire);
+    uint32_t count = std::min(uint32_t(len), head - tail);
+
+    for (uint32_t i = 0; i < count; i++)
+        buf[i] = this->data[(tail + i) & (RING_SIZE - 1)];
+
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+//======================== Input recording/replay wrapper ========================
+CharIoReplay::CharIoReplay(const std::string &name, std::unique_ptr<CharIoBackEnd> backend,
+                           uint8_t stream) : CharIoBackEnd(name)
+{
+    this->backend = std::move(backend);
+    this->stream  = stream;
+}
+
+// Refill the pending bytes once they are consumed. Each refill is one log
+// record so that replay hands out the bytes in the same chunks.
+void CharIoReplay::fetch(bool now)
+{
+    if (!this->pending.empty())
+        return;
+
+    if (input_log_replaying()) {
+        InputLogPayload p;
+        uint8_t source;
+        if (input_log_next(this->stream, source, p))
+            this->pending.insert(this->pending.end(), p.data.begin(), p.data.end());
+        return;
+    }
+
+    if (!(now ? this->backend->rcv_char_available_now() : this->backend->rcv_char_available()))
+        return;
+
+    uint8_t buf[256];
+    int len = this->backend->rcv_buf(buf, sizeof(buf));
+    if (len <= 0)
+        return;
+
+    this->pending.insert(this->pending.end(), buf, buf + len);
+    if (input_log_recording()) {
+        InputLogPayload p;
+        p.put_bytes(buf, len);
+        input_log_record(INPUT_LOG_SERIAL, this->stream, p);
+    }
+}
+
+bool CharIoReplay::rcv_char_available()
+{
+    this->fetch(false);
+    return !this->pending.empty();
+}
+
+bool CharIoReplay::rcv_char_available_now()
+{
+    this->fetch(true);
+    return !this->pending.empty();
+}
+
+int CharIoReplay::rcv_char(uint8_t *c)
+{
+    this->fetch(true);
+    if (this->pending.empty()) {
+        *c = 0;
+    } else {
+        *c = this->pending.front();
+        this->pending.pop_front();
+    }
+    return 0;
+}
+
+int CharIoReplay::rcv_buf(uint8_t *buf, int len)
+{
+    int count = 0;
+
+    while (count < len) {
+        this->fetch(true);
+        if (this->pending.empty())
+            break;
+        buf[count++] = this->pending.front();
+        this->pending.pop_front();
+    }
+
+    return count;
+}
+
 //======================== NULL character I/O backend ========================
 bool CharIoNull::rcv_char_available()
 {
@@ -149,6 +273,15 @@ int CharIoStdin::rcv_char(uint8_t* c) {
     return 0;
 }
 
+int CharIoStdin::xmit_buf(const uint8_t* buf, int len) {
+    _write(_fileno(stdout), buf, len);
+    return len;
+}
+
+int CharIoStdin::rcv_buf(uint8_t* buf, int len) {
+    return CharIoBackEnd::rcv_buf(buf, len);
+}
+
 #else // non-Windows OS (Linux, mac OS etc.)
 
 #include <stdio.h>
@@ -268,6 +401,22 @@ int CharIoStdin::rcv_char(uint8_t *c)
     return 0;
 }
 
+int CharIoStdin::xmit_buf(const uint8_t *buf, int len)
+{
+    write(STDOUT_FILENO, buf, len);
+    return len;
+}
+
+int CharIoStdin::rcv_buf(uint8_t *buf, int len)
+{
+    if (len <= 0 || !this->rcv_char_available_now())
+        return 0;
+
+    // reads whatever is available up to len without blocking
+    int count = (int)read(STDIN_FILENO, buf, len);
+    return count > 0 ? count : 0;
+}
+
 #endif
 
 //======================== SOCKET character I/O backend ========================
@@ -277,6 +426,8 @@ SocketCache::~SocketCache() {}
 
 #else // non-Windows OS (Linux, mac OS etc.)
 
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/errno.h>
@@ -336,10 +487,34 @@ CharIoSocket::CharIoSocket(const std::string &name, const std::string &path) : C
         SocketCache::get_instance()->sockets[path].sockfd = this->sockfd;
         SocketCache::get_instance()->sockets[path].acceptfd = -1;
     } while (0);
+
+    if (pipe(this->wake_fds) == -1) {
+        LOG_F(ERROR, "socket \"%s\" pipe err: %s", this->path.c_str(), strerror(errno));
+        this->wake_fds[0] = this->wake_fds[1] = -1;
+        return;
+    }
+    for (int fd : this->wake_fds)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    this->io_thread = std::thread(&CharIoSocket::io_thread_fn, this);
 }
 
 
 CharIoSocket::~CharIoSocket() {
+    if (this->io_thread.joinable()) {
+        this->io_stop.store(true);
+        this->wake_io_thread();
+        this->io_thread.join();
+    }
+    for (int fd : this->wake_fds) {
+        if (fd != -1)
+            close(fd);
+    }
+
+    // the connection survives machine restarts
+    if (this->sockfd != -1)
+        SocketCache::get_instance()->sockets[this->path].acceptfd = this->acceptfd;
+
     this->sockfd = -1;
 }
 
@@ -375,159 +550,151 @@ bool CharIoSocket::rcv_char_available()
 
 bool CharIoSocket::rcv_char_available_now()
 {
-    int sel_rv = 0;
-    bool havechars = false;
-    fd_set readfds;
-    fd_set writefds;
-    fd_set errorfds;
-
-    int sockmax = 0;
-    if (this->sockfd != -1) {
-        FD_ZERO(&readfds);
-        FD_SET(this->sockfd, &readfds);
-        if (this->sockfd > sockmax) sockmax = this->sockfd;
-        if (this->acceptfd != -1) {
-            FD_SET(this->acceptfd, &readfds);
-            if (this->acceptfd > sockmax) sockmax = this->acceptfd;
-        }
-        writefds = readfds;
-        errorfds = readfds;
+    bool havechars = !this->rx_ring.empty();
 
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 0;
+    if (havechars)
+        consecutivechars++;
+    else
+        consecutivechars = 0;
+    return havechars;
+}
 
-        sel_rv = select(sockmax + 1, &readfds, &writefds, &errorfds, &timeout);
-        if (sel_rv == -1) {
-            LOG_F(INFO, "socket \"%s\" select err: %s", this->path.c_str(), strerror(errno));
-        }
+int CharIoSocket::xmit_char(uint8_t c)
+{
+    this->xmit_buf(&c, 1);
+    return 0;
+}
+
+int CharIoSocket::rcv_char(uint8_t *c)
+{
+    if (!this->rcv_buf(c, 1))
+        *c = 0;
+    return 0;
+}
+
+int CharIoSocket::xmit_buf(const uint8_t *buf, int len)
+{
+    if (!this->io_thread.joinable()) {
+        write(STDOUT_FILENO, buf, len);
+        return len;
     }
 
-    if (sel_rv > 0) {
-        if (this->sockfd != -1) {
-             if (FD_ISSET(this->sockfd, &readfds)) {
-                uint8_t c;
-                int received = (int)recv(this->sockfd, &c, 1, 0);
-                if (received == -1) {
-                    if (this->acceptfd == -1) {
-                        #if 0
-                            LOG_F(INFO, "socket \"%s\" sock read (not accepted yet) err: %s",
-                                this->path.c_str(), strerror(errno)); // this happens once before accept
-                        #endif
-                    }
-                    else {
-                        LOG_F(INFO, "socket \"%s\" sock read err: %s",
-                            this->path.c_str(), strerror(errno)); // should never happen
-                    }
-                }
-                else if (received == 1) {
-                    LOG_F(INFO, "socket \"%s\" sock read '%c'", this->path.c_str(), c); // should never happen
-                }
-                else {
-                    LOG_F(INFO, "socket \"%s\" sock read %d", this->path.c_str(), received); // should never happen
-                }
+    int queued = 0;
 
-                if (this->acceptfd == -1) {
-                    sockaddr_un acceptfdaddr;
-                    memset(&acceptfdaddr, 0, sizeof(acceptfdaddr));
-                    socklen_t len = sizeof(acceptfdaddr);
-                    this->acceptfd = accept(this->sockfd, (struct sockaddr *) &acceptfdaddr, &len);
-                    if (this->acceptfd == -1) {
-                        LOG_F(INFO, "socket \"%s\" accept err: %s", this->path.c_str(), strerror(errno));
-                    }
-                    else {
-                        LOG_F(INFO, "socket \"%s\" accept %d", this->path.c_str(), this->acceptfd);
-                        SocketCache::get_instance()->sockets[this->path].acceptfd = this->acceptfd;
-                    }
-                }
-            } // if read
+    while (true) {
+        queued += this->tx_ring.put(buf + queued, len - queued);
+        this->wake_io_thread();
+        if (queued >= len)
+            break;
+        // the ring is full, let the I/O thread catch up
+        std::this_thread::yield();
+    }
 
-            if (FD_ISSET(this->sockfd, &writefds)) {
-                LOG_F(INFO, "socket \"%s\" sock write", this->path.c_str());
-            }
+    return len;
+}
 
-            if (FD_ISSET(this->sockfd, &errorfds)) {
-                LOG_F(INFO, "socket \"%s\" sock error", this->path.c_str());
-            }
-        } // if this->sockfd
+int CharIoSocket::rcv_buf(uint8_t *buf, int len)
+{
+    bool was_full = this->rx_ring.full();
+    int  count = this->rx_ring.get(buf, len);
 
-        if (this->acceptfd != -1) {
-            if (FD_ISSET(this->acceptfd, &readfds)) {
-                // LOG_F(INFO, "socket \"%s\" accept read havechars", this->path.c_str());
-                havechars = true;
-                consecutivechars++;
-            } // if read
+    // the I/O thread stops reading from the socket while the ring is full
+    if (was_full && count)
+        this->wake_io_thread();
 
-            if (FD_ISSET(this->acceptfd, &writefds)) {
-                // LOG_F(INFO, "socket \"%s\" accept write", this->path.c_str()); // this is usually always true
-            }
+    return count;
+}
 
-            if (FD_ISSET(this->acceptfd, &errorfds)) {
-                LOG_F(INFO, "socket \"%s\" accept error", this->path.c_str());
-            }
-        } // if this->acceptfd
+void CharIoSocket::wake_io_thread()
+{
+    // one pending wakeup is enough, the I/O thread always drains everything
+    if (!this->io_wake_pending.exchange(true)) {
+        uint8_t c = 0;
+        write(this->wake_fds[1], &c, 1);
     }
-    else
-        consecutivechars = 0;
-    return havechars;
 }
 
-int CharIoSocket::xmit_char(uint8_t c)
+void CharIoSocket::accept_connection()
 {
-    write(STDOUT_FILENO, &c, 1);
-
-    if (this->acceptfd == -1)
-        this->rcv_char_available_now();
-
-    if (this->acceptfd != -1) {
-        int sent = (int)send(this->acceptfd, &c, 1, 0);
-        if (sent == -1) {
-            LOG_F(INFO, "socket \"%s\" accept write err: %s", this->path.c_str(), strerror(errno));
-        }
-        if (sent == 1) {
-            /*
-            if (c < ' ') {
-                LOG_F(INFO, "socket \"%s\" accept write '\\x%02X'", this->path.c_str(), c);
-            } else {
-                LOG_F(INFO, "socket \"%s\" accept write '%c'", this->path.c_str(), c);
-            }
-            */
-        }
-        else {
-            LOG_F(INFO, "socket \"%s\" accept write %d", this->path.c_str(), sent);
-        }
+    sockaddr_un acceptfdaddr;
+    memset(&acceptfdaddr, 0, sizeof(acceptfdaddr));
+    socklen_t len = sizeof(acceptfdaddr);
+    this->acceptfd = accept(this->sockfd, (struct sockaddr *) &acceptfdaddr, &len);
+    if (this->acceptfd == -1) {
+        LOG_F(INFO, "socket \"%s\" accept err: %s", this->path.c_str(), strerror(errno));
+    }
+    else {
+        LOG_F(INFO, "socket \"%s\" accept %d", this->path.c_str(), this->acceptfd);
     }
-    return 0;
 }
 
-int CharIoSocket::rcv_char(uint8_t *c)
+void CharIoSocket::io_thread_fn()
 {
-    if (this->acceptfd == -1)
-        this->rcv_char_available_now();
+#ifdef MSG_NOSIGNAL
+    const int send_flags = MSG_NOSIGNAL;
+#else
+    const int send_flags = 0;
+#endif
+    uint8_t buf[1024];
+
+    while (!this->io_stop.load()) {
+        pollfd fds[2];
+        int    num_fds = 1;
 
-    if (this->acceptfd != -1) {
-        int received = (int)recv(this->acceptfd, c, 1, 0);
-        if (received == -1) {
-            LOG_F(INFO, "socket \"%s\" accept read err: %s", this->path.c_str(), strerror(errno));
+        fds[0] = {this->wake_fds[0], POLLIN, 0};
+
+        // wait for a connection or for received data if there's room for it
+        if (this->acceptfd == -1 && this->sockfd != -1)
+            fds[num_fds++] = {this->sockfd, POLLIN, 0};
+        else if (this->acceptfd != -1 && !this->rx_ring.full())
+            fds[num_fds++] = {this->acceptfd, POLLIN, 0};
+
+        if (poll(fds, num_fds, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            LOG_F(ERROR, "socket \"%s\" poll err: %s", this->path.c_str(), strerror(errno));
+            break;
         }
-        else if (received == 1) {
-            /*
-            if (c) {
-                if (*c < ' ') {
-                    LOG_F(INFO, "socket \"%s\" accept write '\\x%02X'", this->path.c_str(), *c);
-                } else {
-                    LOG_F(INFO, "socket \"%s\" accept read '%c'", this->path.c_str(), *c);
-                }
+
+        if (fds[0].revents & POLLIN) {
+            this->io_wake_pending.store(false);
+            read(this->wake_fds[0], buf, sizeof(buf));
+        }
+
+        if (num_fds > 1 && fds[1].revents) {
+            if (fds[1].fd == this->sockfd) {
+                this->accept_connection();
             } else {
-                LOG_F(INFO, "socket \"%s\" accept read %d", this->path.c_str(), received);
+                int received = (int)recv(this->acceptfd, buf,
+                    std::min(int(sizeof(buf)), this->rx_ring.space()), 0);
+                if (received > 0) {
+                    this->rx_ring.put(buf, received);
+                } else if (received == 0 || (errno != EINTR && errno != EAGAIN)) {
+                    LOG_F(INFO, "socket \"%s\" connection closed", this->path.c_str());
+                    close(this->acceptfd);
+                    this->acceptfd = -1;
+                }
             }
-            */
         }
-        else {
-            LOG_F(INFO, "socket \"%s\" accept read %d", this->path.c_str(), received);
+
+        // transmit everything the emulator has queued so far
+        int count;
+        while ((count = this->tx_ring.get(buf, sizeof(buf))) > 0) {
+            write(STDOUT_FILENO, buf, count);
+
+            for (int offset = 0; this->acceptfd != -1 && offset < count; ) {
+                int sent = (int)send(this->acceptfd, buf + offset, count - offset, send_flags);
+                if (sent == -1) {
+                    if (errno == EINTR)
+                        continue;
+                    LOG_F(INFO, "socket \"%s\" accept write err: %s", this->path.c_str(),
+                        strerror(errno));
+                    break;
+                }
+                offset += sent;
+            }
         }
     }
-    return 0;
 }
 
 SocketCache::SocketCache()
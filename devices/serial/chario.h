@@ -24,10 +24,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef CHAR_IO_H
 #define CHAR_IO_H
 
+#include <atomic>
 #include <cinttypes>
+#include <deque>
 #include <string>
 #include <map>
 #include <memory>
+#include <thread>
 
 #ifdef _WIN32
 #else
@@ -54,10 +57,40 @@ public:
     virtual int xmit_char(uint8_t c) = 0;
     virtual int rcv_char(uint8_t *c) = 0;
 
+    // block transfers, return the number of bytes moved
+    virtual int xmit_buf(const uint8_t *buf, int len);
+    virtual int rcv_buf(uint8_t *buf, int len);
+
 private:
     std::string name;
 };
 
+/** Lock-free byte ring buffer for one producer and one consumer thread. */
+class CharIoRing {
+public:
+    CharIoRing() = default;
+    ~CharIoRing() = default;
+
+    int  put(const uint8_t *buf, int len); // returns the number of bytes stored
+    int  get(uint8_t *buf, int len);       // returns the number of bytes fetched
+    bool empty() const {
+        return this->head.load(std::memory_order_acquire) ==
+               this->tail.load(std::memory_order_acquire);
+    }
+    bool full() const { return !this->space(); }
+    int  space() const {
+        return RING_SIZE - (this->head.load(std::memory_order_acquire) -
+                            this->tail.load(std::memory_order_acquire));
+    }
+
+private:
+    static constexpr uint32_t RING_SIZE = 4096; // must be a power of two
+
+    uint8_t                 data[RING_SIZE];
+    std::atomic<uint32_t>   head = 0; // advanced by the producer
+    std::atomic<uint32_t>   tail = 0; // advanced by the consumer
+};
+
 /** Null character I/O backend. */
 class CharIoNull : public CharIoBackEnd {
 public:
@@ -82,6 +115,8 @@ public:
     bool rcv_char_available_now();
     int xmit_char(uint8_t c);
     int rcv_char(uint8_t *c);
+    int xmit_buf(const uint8_t *buf, int len);
+    int rcv_buf(uint8_t *buf, int len);
 
 private:
     static void mysig_handler(int signum);
@@ -89,7 +124,13 @@ private:
     int     consecutivechars = 0;
 };
 
-/** Socket character I/O backend. */
+/** Socket character I/O backend.
+
+    All socket I/O is done by a dedicated thread that waits for the socket
+    with poll(). The emulation thread only exchanges data with it through
+    the RX and TX ring buffers so receiving and transmitting characters
+    cost no system calls there.
+ */
 class CharIoSocket : public CharIoBackEnd  {
 public:
     CharIoSocket(const std::string &name, const std::string &path);
@@ -101,13 +142,56 @@ public:
     bool rcv_char_available_now();
     int xmit_char(uint8_t c);
     int rcv_char(uint8_t *c);
+    int xmit_buf(const uint8_t *buf, int len);
+    int rcv_buf(uint8_t *buf, int len);
 
 private:
+    void io_thread_fn();
+    void wake_io_thread();
+    void accept_connection();
+
     bool    socket_inited = false;
     int     sockfd = -1;
     int     acceptfd = -1;
     std::string path;
     int     consecutivechars = 0;
+
+    CharIoRing          rx_ring;
+    CharIoRing          tx_ring;
+    std::thread         io_thread;
+    std::atomic<bool>   io_stop = false;
+    std::atomic<bool>   io_wake_pending = false;
+    int                 wake_fds[2] = {-1, -1}; // pipe used to wake up the I/O thread
+};
+
+/** Character I/O backend wrapper used for input recording and replay.
+
+    Received bytes are pulled from the wrapped backend when the emulator
+    polls for them and logged with the virtual time of that poll. During
+    replay, they come from the input log at the same virtual instants and
+    the wrapped backend only transmits.
+ */
+class CharIoReplay : public CharIoBackEnd {
+public:
+    CharIoReplay(const std::string &name, std::unique_ptr<CharIoBackEnd> backend,
+                 uint8_t stream);
+    ~CharIoReplay() = default;
+
+    int rcv_enable() { return this->backend->rcv_enable(); }
+    void rcv_disable() { this->backend->rcv_disable(); }
+    bool rcv_char_available();
+    bool rcv_char_available_now();
+    int xmit_char(uint8_t c) { return this->backend->xmit_char(c); }
+    int rcv_char(uint8_t *c);
+    int xmit_buf(const uint8_t *buf, int len) { return this->backend->xmit_buf(buf, len); }
+    int rcv_buf(uint8_t *buf, int len);
+
+private:
+    void fetch(bool now);
+
+    std::unique_ptr<CharIoBackEnd>  backend;
+    std::deque<uint8_t>             pending;
+    uint8_t                         stream;
 };
 
 /** Socket cache which servives machine shutdown/restart. */
@@ -30,6 +30,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <loguru.hpp>
 #include <machines/machinefactory.h>
 #include <machines/machineproperties.h>
+#include <utils/inputlog.h>
 
 #include <cinttypes>
 #include <memory>
@@ -335,6 +336,10 @@ void EsccChannel::attach_backend(int id)
         LOG_F(ERROR, "%s: unknown backend ID %d, using NULL instead", this->get_name_and_unit_address().c_str(), id);
         this->chario = std::unique_ptr<CharIoBackEnd> (new CharIoNull(this->get_name() + "_CharIoNull"));
     }
+
+    if (g_input_log_mode != InputLogMode::Off)
+        this->chario = std::unique_ptr<CharIoBackEnd> (new CharIoReplay(
+            this->get_name() + "_CharIoReplay", std::move(this->chario), uint8_t(this->unit_address)));
 }
 
 void EsccChannel::reset(bool hw_reset)
@@ -1045,12 +1050,11 @@ int EsccChannel::xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) {
         return 0;
     }
 
-    int bytes_moved = 0;
+    int bytes_moved = this->chario->rcv_buf(buf, len);
 
-    while (this->chario->rcv_char_available_now()) {
-        *buf++ = this->receive_byte();
-        len--;
-        bytes_moved++;
+    if (bytes_moved) {
+        this->read_regs[RR0] &= ~RR0_RX_CHARACTER_AVAILABLE;
+        this->read_regs[RR8] = buf[bytes_moved - 1];
     }
 
     return bytes_moved;
@@ -1063,13 +1067,11 @@ int EsccChannel::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
         return 0;
     }
 
-    int bytes_moved = 0;
-
-    for (; len > 0; len--, bytes_moved++) {
-        this->send_byte(*buf++);
-    }
+    if (len <= 0)
+        return 0;
 
-    return bytes_moved;
+    this->write_regs[WR8] = buf[len - 1];
+    return this->chario->xmit_buf(buf, len);
 }
 
 static const std::vector<std::string> CharIoBackends = {"null", "stdio", "socket"};
@@ -36,6 +36,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define FB_READ     READ_DWORD_NE_A
 
 class VideoCtrlBase;
+class HeadlessDisplay;
 
 class Display {
 public:
@@ -87,6 +88,7 @@ public:
 private:
     class Impl; // Holds private fields
     std::unique_ptr<Impl> impl;
+    std::unique_ptr<HeadlessDisplay> headless; // set when no window is wanted
     VideoCtrlBase* video_ctrl = nullptr;
     int full_screen_mode = not_full_screen;
     int full_screen_mode_forward = not_full_screen;
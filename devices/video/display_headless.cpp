@@ -0,0 +1,350 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Headless display backend. */
+
+#include <devices/video/display_headless.h>
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+bool        g_headless_display       = false;
+std::string g_frame_dump_dir;
+uint32_t    g_frame_dump_interval_ms = 0;
+
+static int headless_display_count = 0;
+
+// ================================ XXH64 =====================================
+// Plain C++ implementation of xxHash64 (seed 0). The result matches the
+// reference implementation so dumped frames can be checked with xxhsum.
+
+static constexpr uint64_t XXH_P1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t XXH_P2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t XXH_P3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t XXH_P4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t XXH_P5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read_le64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_P2;
+    return rotl64(acc, 31) * XXH_P1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+static uint64_t xxh64(const uint8_t* p, size_t len) {
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = XXH_P1 + XXH_P2;
+        uint64_t v2 = XXH_P2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - XXH_P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = xxh_round(v1, read_le64(p));
+            v2 = xxh_round(v2, read_le64(p + 8));
+            v3 = xxh_round(v3, read_le64(p + 16));
+            v4 = xxh_round(v4, read_le64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = XXH_P5;
+    }
+
+    h += len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh_round(0, read_le64(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+    }
+    if (p + 4 <= end) {
+        h ^= uint64_t(read_le32(p)) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ============================= PNG writer ===================================
+// Minimal writer using stored (uncompressed) deflate blocks, so no zlib is
+// needed. Files are large but trivially produced.
+
+static uint32_t crc32_table[256];
+
+static void init_crc32_table() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        crc32_table[n] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* buf, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        crc = crc32_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(std::vector<uint8_t>& out, uint32_t val) {
+    out.push_back(val >> 24);
+    out.push_back(val >> 16);
+    out.push_back(val >> 8);
+    out.push_back(val);
+}
+
+static void write_png_chunk(FILE* f, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> hdr;
+    put_be32(hdr, uint32_t(data.size()));
+    hdr.insert(hdr.end(), type, type + 4);
+
+    uint32_t crc = crc32_update(0xFFFFFFFFU, hdr.data() + 4, 4);
+    crc = crc32_update(crc, data.data(), data.size()) ^ 0xFFFFFFFFU;
+
+    std::vector<uint8_t> tail;
+    put_be32(tail, crc);
+
+    fwrite(hdr.data(), 1, hdr.size(), f);
+    fwrite(data.data(), 1, data.size(), f);
+    fwrite(tail.data(), 1, tail.size(), f);
+}
+
+static bool write_png(const std::string& path, const uint32_t* pixels, int width, int height) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+
+    static const uint8_t png_sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(png_sig, 1, sizeof(png_sig), f);
+
+    std::vector<uint8_t> ihdr;
+    put_be32(ihdr, width);
+    put_be32(ihdr, height);
+    ihdr.push_back(8); // bit depth
+    ihdr.push_back(2); // color type: truecolor RGB
+    ihdr.push_back(0); // compression
+    ihdr.push_back(0); // filter
+    ihdr.push_back(0); // interlace
+    write_png_chunk(f, "IHDR", ihdr);
+
+    // raw scanlines: filter byte 0 followed by RGB triplets
+    std::vector<uint8_t> raw;
+    raw.reserve(size_t(height) * (width * 3 + 1));
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        for (int x = 0; x < width; x++) {
+            uint32_t argb = pixels[y * width + x];
+            raw.push_back((argb >> 16) & 0xFF);
+            raw.push_back((argb >>  8) & 0xFF);
+            raw.push_back( argb        & 0xFF);
+        }
+    }
+
+    std::vector<uint8_t> idat = {0x78, 0x01}; // zlib header, no compression
+    size_t pos = 0;
+    do {
+        size_t blk = std::min<size_t>(raw.size() - pos, 65535);
+        bool last = pos + blk == raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(blk & 0xFF);
+        idat.push_back(blk >> 8);
+        idat.push_back(~blk & 0xFF);
+        idat.push_back((~blk >> 8) & 0xFF);
+        idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + blk);
+        pos += blk;
+    } while (pos < raw.size());
+
+    uint32_t s1 = 1, s2 = 0; // Adler-32 of the uncompressed data
+    for (uint8_t b : raw) {
+        s1 = (s1 + b) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    put_be32(idat, (s2 << 16) | s1);
+    write_png_chunk(f, "IDAT", idat);
+
+    write_png_chunk(f, "IEND", {});
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// =========================== HeadlessDisplay ================================
+
+static uint64_t host_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HeadlessDisplay::HeadlessDisplay() {
+    this->disp_id = headless_display_count++;
+    if (!this->disp_id)
+        init_crc32_table();
+}
+
+bool HeadlessDisplay::configure(int width, int height) {
+    bool is_initialization = this->width == 0;
+
+    this->width  = width;
+    this->height = height;
+    this->fb.assign(size_t(width) * height, 0);
+    this->have_hash = false;
+
+    LOG_F(INFO, "Headless display %d configured to %d x %d", this->disp_id, width, height);
+
+    return is_initialization;
+}
+
+void HeadlessDisplay::blank() {
+    std::fill(this->fb.begin(), this->fb.end(), 0);
+    this->cursor_on = false;
+    this->frame_done();
+}
+
+void HeadlessDisplay::update(std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb,
+                             std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb,
+                             bool do_render_hw_cursor, int cursor_x, int cursor_y) {
+    uint8_t* dst_buf   = reinterpret_cast<uint8_t*>(this->fb.data());
+    int      dst_pitch = this->width * 4;
+
+    convert_fb_cb(dst_buf, dst_pitch);
+
+    if (cursor_ovl_cb != nullptr)
+        cursor_ovl_cb(dst_buf, dst_pitch);
+
+    this->cursor_on = do_render_hw_cursor;
+    this->cursor_x  = cursor_x;
+    this->cursor_y  = cursor_y;
+
+    this->frame_done();
+}
+
+void HeadlessDisplay::setup_hw_cursor(
+    std::function<void(uint8_t *dst_buf, int dst_pitch)> draw_hw_cursor,
+    int cursor_width, int cursor_height)
+{
+    this->cursor_width  = cursor_width;
+    this->cursor_height = cursor_height;
+    this->cursor.assign(size_t(cursor_width) * cursor_height, 0);
+    draw_hw_cursor(reinterpret_cast<uint8_t*>(this->cursor.data()), cursor_width * 4);
+}
+
+// The hash covers the guest framebuffer only. A hardware cursor is kept out
+// of it so that mouse movement does not disturb screen state checks.
+void HeadlessDisplay::frame_done() {
+    this->frame_count++;
+
+    uint64_t hash = xxh64(reinterpret_cast<const uint8_t*>(this->fb.data()),
+                          this->fb.size() * sizeof(uint32_t));
+    bool changed = !this->have_hash || hash != this->frame_hash;
+    this->frame_hash = hash;
+    this->have_hash  = true;
+
+    if (changed)
+        LOG_F(INFO, "Headless display %d: frame %llu hash %016llx", this->disp_id,
+              (unsigned long long)this->frame_count, (unsigned long long)hash);
+
+    if (g_frame_dump_dir.empty())
+        return;
+
+    if (g_frame_dump_interval_ms) {
+        uint64_t now_ms = host_time_ms();
+        if (this->last_dump_ms && now_ms - this->last_dump_ms < g_frame_dump_interval_ms)
+            return;
+        this->last_dump_ms = now_ms;
+    } else if (!changed) {
+        return;
+    }
+
+    this->dump_png();
+}
+
+void HeadlessDisplay::dump_png() {
+    std::vector<uint32_t> img = this->fb;
+
+    // composite the HW cursor so the dump shows what a window would show
+    if (this->cursor_on) {
+        for (int cy = 0; cy < this->cursor_height; cy++) {
+            int y = this->cursor_y + cy;
+            if (y < 0 || y >= this->height)
+                continue;
+            for (int cx = 0; cx < this->cursor_width; cx++) {
+                int x = this->cursor_x + cx;
+                if (x < 0 || x >= this->width)
+                    continue;
+                uint32_t src = this->cursor[cy * this->cursor_width + cx];
+                uint32_t a = src >> 24;
+                if (!a)
+                    continue;
+                uint32_t dst = img[y * this->width + x];
+                uint32_t out = 0;
+                for (int sh = 0; sh < 24; sh += 8) {
+                    uint32_t s = (src >> sh) & 0xFF;
+                    uint32_t d = (dst >> sh) & 0xFF;
+                    out |= ((s * a + d * (255 - a)) / 255) << sh;
+                }
+                img[y * this->width + x] = out;
+            }
+        }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/display%d_%06u_%016llx.png", this->disp_id,
+             this->dump_count++, (unsigned long long)this->frame_hash);
+    std::string path = g_frame_dump_dir + name;
+
+    if (!write_png(path, img.data(), this->width, this->height))
+        LOG_F(ERROR, "Headless display %d: could not write %s", this->disp_id, path.c_str());
+}
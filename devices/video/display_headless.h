@@ -0,0 +1,80 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Headless display backend.
+
+    Keeps the converted guest framebuffer in host memory instead of a window.
+    Every frame is hashed so scripted runs can check which screen the guest
+    has reached, and frames can optionally be dumped as PNG files.
+ */
+
+#ifndef DISPLAY_HEADLESS_H
+#define DISPLAY_HEADLESS_H
+
+#include <cinttypes>
+#include <functional>
+#include <string>
+#include <vector>
+
+extern bool        g_headless_display;       // select the headless backend
+extern std::string g_frame_dump_dir;         // PNG dump directory, empty = off
+extern uint32_t    g_frame_dump_interval_ms; // 0 = dump each changed frame
+
+class HeadlessDisplay {
+public:
+    HeadlessDisplay();
+    ~HeadlessDisplay() = default;
+
+    bool configure(int width, int height);
+    void blank();
+    void update(std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb,
+                std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb,
+                bool do_render_hw_cursor, int cursor_x, int cursor_y);
+    void setup_hw_cursor(std::function<void(uint8_t *dst_buf, int dst_pitch)> draw_hw_cursor,
+                         int cursor_width, int cursor_height);
+
+    uint64_t get_frame_hash() const { return this->frame_hash; }
+    uint64_t get_frame_count() const { return this->frame_count; }
+
+private:
+    void frame_done();
+    void dump_png();
+
+    int                     disp_id;
+    int                     width  = 0;
+    int                     height = 0;
+    std::vector<uint32_t>   fb;     // ARGB8888, host endian, pitch = width * 4
+
+    std::vector<uint32_t>   cursor; // ARGB8888 HW cursor image
+    int                     cursor_width  = 0;
+    int                     cursor_height = 0;
+    bool                    cursor_on = false;
+    int                     cursor_x  = 0;
+    int                     cursor_y  = 0;
+
+    uint64_t    frame_count = 0;
+    uint64_t    frame_hash  = 0;
+    bool        have_hash   = false;
+    uint64_t    last_dump_ms = 0;
+    uint32_t    dump_count   = 0;
+};
+
+#endif // DISPLAY_HEADLESS_H
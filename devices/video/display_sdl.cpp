@@ -20,14 +20,76 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <devices/video/display.h>
+#include <devices/video/display_headless.h>
 #include <devices/video/videoctrl.h>
 #include <SDL3/SDL.h>
 #include <loguru.hpp>
+#include <utils/profiler.h>
+
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 bool g_auto_grab_mouse = false;
 
+// Present frames on the emulation thread instead of a dedicated render thread.
+bool g_sync_present = false;
+
+// SDL only guarantees rendering on the main thread, which is also the thread
+// running the emulation and creating the window. The Windows (Direct3D) and
+// X11/Wayland (OpenGL, EGL, Vulkan) backends also work with a renderer that a
+// single other thread creates, uses and destroys, so only those get a render
+// thread. Cocoa, UIKit, Android and Emscripten need the main thread and present
+// synchronously.
+static bool render_thread_supported() {
+    const char* driver = SDL_GetCurrentVideoDriver();
+    if (!driver)
+        return false;
+    for (const char* name : {"windows", "x11", "wayland"}) {
+        if (!std::strcmp(driver, name))
+            return true;
+    }
+    return false;
+}
+
+// presentation statistics shared by all displays
+static std::atomic<uint64_t> frames_presented{0};
+static std::atomic<uint64_t> frames_dropped{0};
+static std::atomic<uint64_t> frames_late{0};
+
+class DisplayProfile : public BaseProfile {
+public:
+    DisplayProfile() : BaseProfile("Display") {}
+
+    void populate_variables(std::vector<ProfileVar>& vars) {
+        vars.clear();
+
+        vars.push_back({.name = "Frames Presented",
+                        .format = ProfileVarFmt::DEC,
+                        .value = frames_presented.load()});
+
+        vars.push_back({.name = "Frames Dropped (overwritten before present)",
+                        .format = ProfileVarFmt::DEC,
+                        .value = frames_dropped.load()});
+
+        vars.push_back({.name = "Frames Late (presented after the next was due)",
+                        .format = ProfileVarFmt::DEC,
+                        .value = frames_late.load()});
+    }
+
+    void reset() {
+        frames_presented = 0;
+        frames_dropped = 0;
+        frames_late = 0;
+    }
+};
+
 static const char * get_full_screen_mode_string(int scale_mode) {
 #define onemode(x) case Display::x: return #x ;
     switch(scale_mode) {
@@ -61,25 +123,214 @@ public:
     double          drawable_h;
     SDL_FRect       dest_rect;
     SDL_ScaleMode   scale_mode = SDL_SCALEMODE_NEAREST;
+
+    // Triple-buffered handoff between the emulation thread (converting guest
+    // frames) and the render thread (texture upload and present). The writer
+    // owns back_idx, the render thread owns front_idx and shared_slot holds
+    // the most recently published frame, tagged with SLOT_NEW until consumed.
+    struct HostFrame {
+        std::vector<uint8_t> pixels;
+        bool        draw_cursor = false;
+        int         cursor_x = 0;
+        int         cursor_y = 0;
+        uint64_t    publish_ns = 0;  // host time the frame was handed off
+        uint64_t    interval_ns = 0; // time since the previous handoff
+    };
+
+    static constexpr int SLOT_INDEX = 3;
+    static constexpr int SLOT_NEW   = 4;
+
+    HostFrame           frames[3];
+    int                 frame_pitch = 0;
+    int                 back_idx = 0;
+    int                 front_idx = 2;
+    std::atomic<int>    shared_slot{1};
+    uint64_t            last_publish_ns = 0;
+    bool                front_valid = false;
+
+    // The renderer and its textures are created, used and destroyed by the
+    // render thread only, if there is one (see render_thread_supported());
+    // the emulation thread hands it that work through run_on_renderer().
+    // The window stays with the emulation thread, which also processes its
+    // events.
+    // render_mutex guards the presentation geometry the render thread reads.
+    std::mutex              render_mutex;
+    std::mutex              wake_mutex;
+    std::condition_variable wake_cv;
+    std::condition_variable task_done_cv;
+    std::thread             render_thread;
+    bool                    stop_thread = false;
+    const std::function<void()>* render_task = nullptr;
+    std::atomic<bool>       blank_pending{false};
+    std::atomic<bool>       repaint_pending{false};
+
+    static uint64_t host_time_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void alloc_frames(int width, int height);
+    void publish_frame();
+    void present_pending();
+    void wake_render_thread();
+    void run_on_renderer(const std::function<void()>& task);
+    void render_thread_fn();
 };
 
-Display::Display(): impl(std::make_unique<Impl>()) {
+void Display::Impl::alloc_frames(int width, int height) {
+    this->frame_pitch = width * 4;
+    for (auto& frame : this->frames)
+        frame.pixels.assign(size_t(this->frame_pitch) * height, 0);
+    this->back_idx    = 0;
+    this->front_idx   = 2;
+    this->front_valid = false;
+    this->shared_slot.store(1);
 }
 
-Display::~Display() {
-    if (impl->cursor_texture) {
-        SDL_DestroyTexture(impl->cursor_texture);
-        impl->cursor_texture = 0;
+void Display::Impl::publish_frame() {
+    HostFrame& frame = this->frames[this->back_idx];
+    frame.publish_ns = host_time_ns();
+    frame.interval_ns = this->last_publish_ns ? frame.publish_ns - this->last_publish_ns : 0;
+    this->last_publish_ns = frame.publish_ns;
+
+    int prev = this->shared_slot.exchange(this->back_idx | SLOT_NEW);
+    if (prev & SLOT_NEW)
+        frames_dropped++; // the render thread never picked the previous one up
+    this->back_idx = prev & SLOT_INDEX;
+}
+
+// Called with render_mutex held.
+void Display::Impl::present_pending() {
+    if (!this->renderer)
+        return;
+
+    if (this->blank_pending.exchange(false)) {
+        SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, 255);
+        SDL_RenderClear(this->renderer);
+        SDL_RenderPresent(this->renderer);
+        if (!(this->shared_slot.load() & SLOT_NEW))
+            return;
+    }
+
+    HostFrame* frame = nullptr;
+    if (this->shared_slot.load() & SLOT_NEW) {
+        this->front_idx = this->shared_slot.exchange(this->front_idx) & SLOT_INDEX;
+        frame = &this->frames[this->front_idx];
+        SDL_UpdateTexture(this->disp_texture, NULL, frame->pixels.data(), this->frame_pitch);
+        this->front_valid = true;
+    } else if (this->repaint_pending.exchange(false) && this->front_valid) {
+        // window exposed, the texture still holds the last frame
+    } else {
+        return;
+    }
+
+    const HostFrame& shown = this->frames[this->front_idx];
+
+    SDL_RenderClear(this->renderer);
+    SDL_RenderTexture(this->renderer, this->disp_texture, NULL, &this->dest_rect);
+
+    if (shown.draw_cursor && this->cursor_texture) {
+        this->cursor_rect.x = shown.cursor_x * this->renderer_scale_x + this->dest_rect.x;
+        this->cursor_rect.y = shown.cursor_y * this->renderer_scale_y + this->dest_rect.y;
+        SDL_RenderTexture(this->renderer, this->cursor_texture, NULL, &this->cursor_rect);
     }
 
-    if (impl->disp_texture) {
-        SDL_DestroyTexture(impl->disp_texture);
-        impl->disp_texture = 0;
+    SDL_RenderPresent(this->renderer);
+
+    if (frame) {
+        frames_presented++;
+        if (frame->interval_ns && host_time_ns() - frame->publish_ns > frame->interval_ns)
+            frames_late++;
+    }
+}
+
+void Display::Impl::wake_render_thread() {
+    if (!this->render_thread.joinable()) {
+        std::lock_guard<std::mutex> lk(this->render_mutex);
+        this->present_pending();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(this->wake_mutex);
+    }
+    this->wake_cv.notify_one();
+}
+
+// Run a task on the thread owning the renderer and wait for it to finish.
+// Must not be called with render_mutex held.
+void Display::Impl::run_on_renderer(const std::function<void()>& task) {
+    if (!this->render_thread.joinable()) {
+        task();
+        return;
+    }
+    std::unique_lock<std::mutex> lk(this->wake_mutex);
+    this->render_task = &task;
+    this->wake_cv.notify_one();
+    this->task_done_cv.wait(lk, [this] { return !this->render_task; });
+}
+
+void Display::Impl::render_thread_fn() {
+    while (true) {
+        const std::function<void()>* task;
+        {
+            std::unique_lock<std::mutex> lk(this->wake_mutex);
+            this->wake_cv.wait(lk, [this] {
+                return this->stop_thread || this->render_task ||
+                    (this->shared_slot.load() & SLOT_NEW) ||
+                    this->blank_pending.load() || this->repaint_pending.load();
+            });
+            if (this->stop_thread)
+                break;
+            task = this->render_task;
+        }
+        if (task) {
+            (*task)();
+            {
+                std::lock_guard<std::mutex> lk(this->wake_mutex);
+                this->render_task = nullptr;
+            }
+            this->task_done_cv.notify_one();
+        }
+        std::lock_guard<std::mutex> lk(this->render_mutex);
+        this->present_pending();
     }
+}
+
+Display::Display(): impl(std::make_unique<Impl>()) {
+    if (g_headless_display)
+        this->headless = std::make_unique<HeadlessDisplay>();
+}
+
+Display::~Display() {
+    impl->run_on_renderer([this] {
+        if (impl->cursor_texture) {
+            SDL_DestroyTexture(impl->cursor_texture);
+            impl->cursor_texture = 0;
+        }
+
+        if (impl->disp_texture) {
+            SDL_DestroyTexture(impl->disp_texture);
+            impl->disp_texture = 0;
+        }
+
+        if (impl->renderer) {
+            SDL_DestroyRenderer(impl->renderer);
+            impl->renderer = 0;
+        }
+    });
+
+    if (impl->render_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(impl->wake_mutex);
+            impl->stop_thread = true;
+        }
+        impl->wake_cv.notify_one();
+        impl->render_thread.join();
 
-    if (impl->renderer) {
-        SDL_DestroyRenderer(impl->renderer);
-        impl->renderer = 0;
+        LOG_F(INFO, "Display: %llu frames presented, %llu dropped, %llu late",
+            (unsigned long long)frames_presented.load(),
+            (unsigned long long)frames_dropped.load(),
+            (unsigned long long)frames_late.load());
     }
 
     if (impl->display_wnd) {
@@ -91,6 +342,9 @@ Display::~Display() {
 const double scale_step = std::pow(2.0, 1.0/8.0);
 
 bool Display::configure(int width, int height) {
+    if (this->headless)
+        return this->headless->configure(width, height);
+
     bool is_initialization = false;
 
     impl->display_w = width;
@@ -107,19 +361,31 @@ bool Display::configure(int width, int height) {
         if (impl->display_wnd == NULL)
             ABORT_F("Display: SDL_CreateWindow failed with %s", SDL_GetError());
 
-        impl->renderer = SDL_CreateRenderer(impl->display_wnd, NULL);
-        if (impl->renderer == NULL)
-            ABORT_F("Display: SDL_CreateRenderer failed with %s", SDL_GetError());
+        if (!g_sync_present) {
+            if (render_thread_supported())
+                impl->render_thread = std::thread(&Display::Impl::render_thread_fn, impl.get());
+            else
+                LOG_F(INFO, "Display: video driver \"%s\" renders on the main thread only",
+                    SDL_GetCurrentVideoDriver());
+        }
+
+        impl->run_on_renderer([this] {
+            impl->renderer = SDL_CreateRenderer(impl->display_wnd, NULL);
+            if (impl->renderer == NULL)
+                ABORT_F("Display: SDL_CreateRenderer failed with %s", SDL_GetError());
 
-        const char *renderer_name = SDL_GetRendererName(impl->renderer);
-        int max_w, max_h;
-        SDL_GetRenderOutputSize(impl->renderer, &max_w, &max_h);
-        LOG_F(INFO, "Renderer \"%s\" output size: %d x %d", renderer_name ? renderer_name : "unknown", max_w, max_h);
+            const char *renderer_name = SDL_GetRendererName(impl->renderer);
+            int max_w, max_h;
+            SDL_GetRenderOutputSize(impl->renderer, &max_w, &max_h);
+            LOG_F(INFO, "Renderer \"%s\" output size: %d x %d", renderer_name ? renderer_name : "unknown", max_w, max_h);
+        });
 
+        // The renderer draws to the whole window, so its output size is the
+        // window size in pixels, which can be queried without the renderer.
         int w, h;
         double scale = 1.0;
         while (1) {
-            SDL_GetRenderOutputSize(impl->renderer, &w, &h);
+            SDL_GetWindowSizeInPixels(impl->display_wnd, &w, &h);
             if (w == 0 || h == 0) {
                 scale /= scale_step;
                 LOG_F(INFO, "Invalid renderer size. Reducing scale to %.3f.", scale);
@@ -145,11 +411,15 @@ bool Display::configure(int width, int height) {
 
     configure_texture();
 
+    if (is_initialization && gProfilerObj)
+        gProfilerObj->register_profile("Display",
+            std::unique_ptr<BaseProfile>(new DisplayProfile()));
+
     return is_initialization;
 }
 
 void Display::update_window_size() {
-    if (this->full_screen_mode != not_full_screen)
+    if (this->headless || this->full_screen_mode != not_full_screen)
         return;
 
     int w, h;
@@ -162,7 +432,7 @@ void Display::update_window_size() {
             std::round(impl->drawable_w / impl->default_scale_x),
             std::round(impl->drawable_h / impl->default_scale_y));
 
-        SDL_GetRenderOutputSize(impl->renderer, &w, &h);
+        SDL_GetWindowSizeInPixels(impl->display_wnd, &w, &h);
 
         w_err = std::abs(impl->drawable_w - w);
         h_err = std::abs(impl->drawable_h - h);
@@ -183,12 +453,15 @@ void Display::update_window_size() {
 }
 
 void Display::configure_dest() {
+    if (this->headless)
+        return;
+
     bool should_set_full_screen = this->full_screen_mode > not_full_screen;
     if (this->is_set_full_screen != should_set_full_screen) {
         if (should_set_full_screen) {
             int w, h;
             SDL_SetWindowFullscreen(impl->display_wnd, true);
-            SDL_GetRenderOutputSize(impl->renderer, &w, &h);
+            SDL_GetWindowSizeInPixels(impl->display_wnd, &w, &h);
             impl->drawable_w = w;
             impl->drawable_h = h;
         } else {
@@ -249,12 +522,15 @@ void Display::configure_dest() {
             this->full_screen_mode_reverse = full_screen_no_bars;
     }
 
-    impl->dest_rect.w = std::round(scale * impl->display_w);
-    impl->dest_rect.h = std::round(scale * impl->display_h);
-    impl->dest_rect.x = std::round((impl->drawable_w - impl->dest_rect.w) / 2.0);
-    impl->dest_rect.y = std::round((impl->drawable_h - impl->dest_rect.h) / 2.0);
-    impl->renderer_scale_x = scale;
-    impl->renderer_scale_y = scale;
+    {
+        std::lock_guard<std::mutex> lk(impl->render_mutex);
+        impl->dest_rect.w = std::round(scale * impl->display_w);
+        impl->dest_rect.h = std::round(scale * impl->display_h);
+        impl->dest_rect.x = std::round((impl->drawable_w - impl->dest_rect.w) / 2.0);
+        impl->dest_rect.y = std::round((impl->drawable_h - impl->dest_rect.h) / 2.0);
+        impl->renderer_scale_x = scale;
+        impl->renderer_scale_y = scale;
+    }
 
     LOG_F(INFO, "configure_dest         drawable: %4.0f x %-4.0f  display: %4d x %-4d  scale: %.3f"
         " (int: %.3f  full: %.3f  nobars: %.3f)  mode: %s  forward: %s  reverse: %s",
@@ -267,23 +543,35 @@ void Display::configure_dest() {
 }
 
 void Display::configure_texture() {
-    if (impl->disp_texture)
-        SDL_DestroyTexture(impl->disp_texture);
-
-    impl->disp_texture = SDL_CreateTexture(
-        impl->renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        impl->display_w, impl->display_h
-    );
+    if (this->headless)
+        return;
+
+    // the frame buffers are resized on the render thread too so that it
+    // never uploads a buffer while it changes size
+    impl->run_on_renderer([this] {
+        if (impl->disp_texture)
+            SDL_DestroyTexture(impl->disp_texture);
+
+        impl->disp_texture = SDL_CreateTexture(
+            impl->renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            impl->display_w, impl->display_h
+        );
 
-    if (impl->disp_texture == NULL)
-        ABORT_F("Display: SDL_CreateTexture failed with %s", SDL_GetError());
+        if (impl->disp_texture == NULL)
+            ABORT_F("Display: SDL_CreateTexture failed with %s", SDL_GetError());
 
-    SDL_SetTextureScaleMode(impl->disp_texture, impl->scale_mode);
+        SDL_SetTextureScaleMode(impl->disp_texture, impl->scale_mode);
+
+        impl->alloc_frames(impl->display_w, impl->display_h);
+    });
 }
 
 void Display::handle_events(const WindowEvent& wnd_event) {
+    if (this->headless)
+        return;
+
     switch (wnd_event.sub_type) {
 
     case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
@@ -291,7 +579,7 @@ void Display::handle_events(const WindowEvent& wnd_event) {
             int ww, wh;
             SDL_GetWindowSize(impl->display_wnd, &ww, &wh);
             int w, h;
-            SDL_GetRenderOutputSize(impl->renderer, &w, &h);
+            SDL_GetWindowSizeInPixels(impl->display_wnd, &w, &h);
             double new_default_scale_x = w / ww;
             double new_default_scale_y = h / wh;
             if (new_default_scale_x != impl->default_scale_x || new_default_scale_y != impl->default_scale_y) {
@@ -311,7 +599,8 @@ void Display::handle_events(const WindowEvent& wnd_event) {
 
     case SDL_EVENT_WINDOW_EXPOSED:
         if (wnd_event.window_id == impl->disp_wnd_id) {
-            SDL_RenderPresent(impl->renderer);
+            impl->repaint_pending = true;
+            impl->wake_render_thread();
         }
         break;
 
@@ -408,6 +697,9 @@ if (g_auto_grab_mouse) {
 
 void Display::toggle_mouse_grab()
 {
+    if (this->headless)
+        return;
+
     if (SDL_GetWindowRelativeMouseMode(impl->display_wnd)) {
         SDL_SetWindowRelativeMouseMode(impl->display_wnd, false);
         impl->manual_grab = false;
@@ -420,6 +712,9 @@ void Display::toggle_mouse_grab()
 
 void Display::update_mouse_grab(bool will_be_grabbed)
 {
+    if (this->headless)
+        return;
+
     bool is_grabbed = SDL_GetWindowRelativeMouseMode(impl->display_wnd);
     if (will_be_grabbed || is_grabbed) {
         // If the mouse is initially outside the window, move it to the middle,
@@ -443,6 +738,9 @@ void Display::update_mouse_grab(bool will_be_grabbed)
 
 void Display::update_window_title()
 {
+    if (this->headless)
+        return;
+
     std::string old_window_title = SDL_GetWindowTitle(impl->display_wnd);
 
     int width, height;
@@ -462,19 +760,24 @@ void Display::update_window_title()
 }
 
 void Display::blank() {
-    SDL_SetRenderDrawColor(impl->renderer, 0, 0, 0, 255);
-    SDL_RenderClear(impl->renderer);
-    SDL_RenderPresent(impl->renderer);
+    if (this->headless)
+        return this->headless->blank();
+
+    impl->blank_pending = true;
+    impl->wake_render_thread();
 }
 
 void Display::update(std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb,
                      std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb,
                      bool do_render_hw_cursor, int cursor_x, int cursor_y,
                      bool /*fb_known_to_be_changed*/) {
-    uint8_t*    dst_buf = nullptr;
-    int         dst_pitch;
+    if (this->headless)
+        return this->headless->update(convert_fb_cb, cursor_ovl_cb,
+                                      do_render_hw_cursor, cursor_x, cursor_y);
 
-    SDL_LockTexture(impl->disp_texture, NULL, (void **)&dst_buf, &dst_pitch);
+    Impl::HostFrame& frame = impl->frames[impl->back_idx];
+    uint8_t*    dst_buf = frame.pixels.data();
+    int         dst_pitch = impl->frame_pitch;
 
     // texture update callback to get ARGB data from guest framebuffer
     convert_fb_cb(dst_buf, dst_pitch);
@@ -483,9 +786,9 @@ void Display::update(std::function<void(uint8_t *dst_buf, int dst_pitch)> conver
     if (cursor_ovl_cb != nullptr)
         cursor_ovl_cb(dst_buf, dst_pitch);
 
-    SDL_UnlockTexture(impl->disp_texture);
-    SDL_RenderClear(impl->renderer);
-    SDL_RenderTexture(impl->renderer, impl->disp_texture, NULL, &impl->dest_rect);
+    frame.draw_cursor = do_render_hw_cursor;
+    frame.cursor_x    = cursor_x;
+    frame.cursor_y    = cursor_y;
 
 if (g_auto_grab_mouse) {
     bool is_grabbed = SDL_GetWindowRelativeMouseMode(impl->display_wnd);
@@ -531,14 +834,10 @@ if (g_auto_grab_mouse) {
     }
 }
 
-    // draw HW cursor if enabled
-    if (do_render_hw_cursor) {
-        impl->cursor_rect.x = cursor_x * impl->renderer_scale_x + impl->dest_rect.x;
-        impl->cursor_rect.y = cursor_y * impl->renderer_scale_y + impl->dest_rect.y;
-        SDL_RenderTexture(impl->renderer, impl->cursor_texture, NULL, &impl->cursor_rect);
-    }
-
-    SDL_RenderPresent(impl->renderer);
+    // hand the frame off; texture upload, HW cursor and present happen on
+    // the render thread so the CPU never waits for the driver or vsync
+    impl->publish_frame();
+    impl->wake_render_thread();
 }
 
 void Display::update_skipped() {
@@ -549,30 +848,38 @@ void Display::disp_setup_hw_cursor(
     std::function<void(uint8_t *dst_buf, int dst_pitch)> vidc_draw_hw_cursor,
     int cursor_width, int cursor_height
 ) {
-    uint8_t*    dst_buf = nullptr;
-    int         dst_pitch;
-
-    if (impl->cursor_texture)
-        SDL_DestroyTexture(impl->cursor_texture);
-
-    impl->cursor_texture = SDL_CreateTexture(
-        impl->renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        cursor_width, cursor_height
-    );
+    if (this->headless)
+        return this->headless->setup_hw_cursor(vidc_draw_hw_cursor,
+                                               cursor_width, cursor_height);
+
+    // the emulation thread waits, so the cursor can be drawn from guest
+    // state on the render thread
+    impl->run_on_renderer([&] {
+        uint8_t*    dst_buf = nullptr;
+        int         dst_pitch;
+
+        if (impl->cursor_texture)
+            SDL_DestroyTexture(impl->cursor_texture);
+
+        impl->cursor_texture = SDL_CreateTexture(
+            impl->renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            cursor_width, cursor_height
+        );
 
-    if (impl->cursor_texture == NULL)
-        ABORT_F("SDL_CreateTexture for HW cursor failed with %s", SDL_GetError());
+        if (impl->cursor_texture == NULL)
+            ABORT_F("SDL_CreateTexture for HW cursor failed with %s", SDL_GetError());
 
-    SDL_SetTextureScaleMode(impl->cursor_texture, impl->scale_mode);
-    SDL_LockTexture(impl->cursor_texture, NULL, (void **)&dst_buf, &dst_pitch);
-    SDL_SetTextureBlendMode(impl->cursor_texture, SDL_BLENDMODE_BLEND);
-    vidc_draw_hw_cursor(dst_buf, dst_pitch);
-    SDL_UnlockTexture(impl->cursor_texture);
+        SDL_SetTextureScaleMode(impl->cursor_texture, impl->scale_mode);
+        SDL_LockTexture(impl->cursor_texture, NULL, (void **)&dst_buf, &dst_pitch);
+        SDL_SetTextureBlendMode(impl->cursor_texture, SDL_BLENDMODE_BLEND);
+        vidc_draw_hw_cursor(dst_buf, dst_pitch);
+        SDL_UnlockTexture(impl->cursor_texture);
 
-    impl->cursor_rect.x = 0;
-    impl->cursor_rect.y = 0;
-    impl->cursor_rect.w = cursor_width * impl->renderer_scale_x;
-    impl->cursor_rect.h = cursor_height * impl->renderer_scale_y;
+        impl->cursor_rect.x = 0;
+        impl->cursor_rect.y = 0;
+        impl->cursor_rect.w = cursor_width * impl->renderer_scale_x;
+        impl->cursor_rect.h = cursor_height * impl->renderer_scale_y;
+    });
 }
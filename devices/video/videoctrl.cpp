@@ -104,6 +104,9 @@ void VideoCtrlBase::set_cursor_enable(bool enable) {
     this->vidc_cursor_on = enable;
 }
 
+// how late the refresh task may run to share a wakeup with other timers
+constexpr uint64_t REFRESH_SLACK_NS = USECS_TO_NSECS(100);
+
 void VideoCtrlBase::start_refresh_task() {
     if (this->vert_blank == 0) {
         LOG_F(ERROR, "Vertical blank is 0. Using 25 instead.");
@@ -136,7 +139,9 @@ void VideoCtrlBase::start_refresh_task() {
                     this->vbl_cb(0);
                 }
             );
-        }
+        },
+        // VBL stays asserted for vbl_duration wherever the frame starts
+        REFRESH_SLACK_NS
     );
 }
 
@@ -69,6 +69,7 @@ const map<string, PropHelpItem> gPropHelp = {
     {"gfxmem_size",       {PropertyDevice , "specifies video memory size in MB"}},
     {"num_displays",      {PropertyDevice , "specifies the number of displays supported by a graphics controller"}},
     {"fdd_drives",        {PropertyMachine, "specifies the number of floppy drives"}},
+    {"fdd_turbo",         {PropertyMachine, "skips floppy rotational and head step latencies"}},
     {"fdd_img",           {PropertyDevice , "specifies path to floppy disk image"}},
     {"fdd_fmt",           {PropertyDevice , "specifies floppy disk format (use before fdd_img)"}},
     {"fdd_wr_prot",       {PropertyDevice , "specifies floppy disk's write protection setting"}},
@@ -76,6 +77,7 @@ const map<string, PropHelpItem> gPropHelp = {
     {"hdd_part",          {PropertyDevice , "specifies path to a disk image to be appended to a hard disk"}},
     {"cdr_config",        {PropertyMachine, "CD-ROM device path in [bus]:[device#] format"}},
     {"hdd_config",        {PropertyMachine, "HD device path in [bus]:[device#] format"}},
+    {"scsi_fast",         {PropertyMachine, "skips SCSI bus timing delays between transfer phases"}},
     {"cdr_img",           {PropertyDevice , "specifies path to CD-ROM image"}},
     {"mon_id",            {PropertyDevice , "specifies which monitor to emulate"}},
     {"edid",              {PropertyDevice , "specifies an EDID for a display"}},
@@ -1263,7 +1265,7 @@ string MachineFactory::machine_name_from_rom(char *rom_data, size_t rom_size, bo
 }
 
 /* Read ROM file content and transfer it to the dedicated ROM region */
-int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size) {
+int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size, const string& rom_filepath) {
     if (rom_size != 0x400000 && rom_size != 0x100000) {
         LOG_F(ERROR, "Unexpected ROM File size: %zu bytes.", rom_size);
         return -1;
@@ -1276,14 +1278,18 @@ int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size) {
         return -1;
     }
 
+    if (!rom_filepath.empty())
+        return boot_rom->map_data(rom_filepath, (uint8_t*)rom_data, (uint32_t)rom_size);
+
     return boot_rom->set_data((uint8_t*)rom_data, (uint32_t)rom_size);
 }
 
-int MachineFactory::create_machine_for_id(string& id, char *rom_data, size_t rom_size, vector<std::string> &app_args) {
+int MachineFactory::create_machine_for_id(string& id, char *rom_data, size_t rom_size, vector<std::string> &app_args,
+                                          const string& rom_filepath) {
     if (MachineFactory::create(id, app_args) < 0) {
         return -1;
     }
-    if (load_boot_rom(rom_data, rom_size) < 0) {
+    if (load_boot_rom(rom_data, rom_size, rom_filepath) < 0) {
         return -1;
     }
     return 0;
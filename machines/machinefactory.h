@@ -85,7 +85,8 @@ public:
     static std::string machine_name_from_rom(char *rom_data, size_t rom_size, bool fix_checksums = false);
 
     static int create(std::string& mach_id, std::vector<std::string> &app_args);
-    static int create_machine_for_id(std::string& id, char *rom_data, size_t rom_size, std::vector<std::string> &app_args);
+    static int create_machine_for_id(std::string& id, char *rom_data, size_t rom_size, std::vector<std::string> &app_args,
+                                     const std::string& rom_filepath = "");
     static HWComponent* create_device(HWComponent *parent, std::string dev_name,
         HWCompType supported_types = HWCompType::UNKNOWN);
 
@@ -106,7 +107,7 @@ private:
         std::string path, std::string device, std::set<std::string> *properties);
     static void list_device_settings(DeviceDescription& dev, PropScope scope, int indent,
         std::string path, std::string device, std::set<std::string> *properties);
-    static int  load_boot_rom(char *rom_data, size_t rom_size);
+    static int  load_boot_rom(char *rom_data, size_t rom_size, const std::string& rom_filepath);
     static void register_settings(const std::string& dev_name, const PropMap& p);
     static HWComponent* set_property(const std::string &property, const std::string &value);
     static bool find_path(std::string path, HWComponent *&hwc, int32_t &unit_address, bool &is_leaf_match);
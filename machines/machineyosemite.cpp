@@ -114,9 +114,10 @@ int MachineYosemite::initialize(const std::string &id) {
     uint64_t timebase_freq = bus_freq / 4;
     uint64_t core_freq     = bus_freq * 7 / 2; // 350 MHz (CPU PLL ratio of 3.5)
 
-    // initialize virtual CPU and request MPC750 CPU aka G3
+    // initialize virtual CPU and request MPC750 CPU aka G3, or MPC7400 aka G4
+    // as in the Power Macintosh G4 (PCI Graphics) built on this board
     ppc_cpu_init(grackle_obj, {
-        .version = PPC_VER::MPC750,
+        .version = GET_STR_PROP("cpu") == "7400" ? PPC_VER::MPC7400 : PPC_VER::MPC750,
         .timebase_freq_hz = timebase_freq,
         .bus_freq_hz = bus_freq,
         .core_freq_hz = core_freq,
@@ -136,6 +137,13 @@ static const PropMap yosemite_settings = {
         new IntProperty(  0, std::vector<uint32_t>({0, 8, 16, 32, 64, 128, 256, 512}))},
     {"emmo",
         new BinProperty(0)},
+#ifdef DPPC_ALTIVEC
+    {"cpu",
+        new StrProperty("750", std::vector<std::string>({"750", "7400"}))},
+#else
+    {"cpu",
+        new StrProperty("750", std::vector<std::string>({"750"}))},
+#endif
     {"hdd_config",
         new StrProperty("CmdAta0/@0")},
     {"cdr_config",
@@ -34,8 +34,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <debugger/symbols.h>
 #include <devices/common/hwcomponent.h>
 #include <devices/serial/chario.h>
+#include <devices/video/display_headless.h>
 #include <machines/machinefactory.h>
+#include <utils/checkpoint.h>
+#include <utils/mmioprofile.h>
+#include <utils/inputlog.h>
 #include <utils/profiler.h>
+#include <utils/stats.h>
 #include <main.h>
 
 #include <cinttypes>
@@ -54,6 +59,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 using namespace std;
 
 extern bool g_auto_grab_mouse;
+extern bool g_sync_present;
 extern bool g_swap_command_option;
 
 static void sigint_handler(int /*signum*/) {
@@ -78,6 +84,12 @@ static string appDescription = string(
 );
 
 static uint32_t keyboard_id = 0;
+static bool release_zero_pages = false;
+static std::string checkpoint_path;
+static uint32_t checkpoint_interval_ms = 1000;
+static std::string precopy_path;
+static std::vector<std::string> restore_checkpoint_args;
+static std::string precopy_receive_path;
 
 #ifdef CHECK_THREAD
 pthread_t main_thread_id = 0;
@@ -127,9 +139,11 @@ int main(int argc, char** argv) {
     bool deterministic_interactive = false;
     bool start_realtime = false;
     bool start_idle_cpu_save = false;
+    bool no_busy_wait_skip = false;
     string deterministic_mode = "strict";
     string keyboard_string = "Eng_USA";
     string cpu_timing_mode = "fixed";
+    string display_backend = "sdl";
 
     const std::map<std::string, int> kbd_map{
         {"Eng_USA", 0}, {"Eng_GBR", 1}, {"Fra_FRA", 10}, {"Deu_DEU", 20},
@@ -159,10 +173,24 @@ int main(int argc, char** argv) {
         "Select deterministic features (strict or interactive)")
         ->needs(deterministic_opt)
         ->check(CLI::IsMember({"strict", "interactive"}));
+    string record_input_path;
+    string replay_input_path;
+    auto record_input_opt = emu->add_option("--record-input", record_input_path,
+        "Record guest input with its virtual time to this file (enables input)")
+        ->needs(deterministic_opt);
+    emu->add_option("--replay-input", replay_input_path,
+        "Replay guest input recorded with --record-input, quit at its end")
+        ->needs(deterministic_opt)
+        ->excludes(record_input_opt)
+        ->check(CLI::ExistingFile);
     emu->add_flag("--realtime", start_realtime,
         "Start in realtime mode (guest time follows the wall clock)");
     emu->add_flag("--idle-cpu-save", start_idle_cpu_save,
         "Sleep an idle guest in realtime mode to save host CPU");
+    emu->add_flag("--no-busy-wait-skip", no_busy_wait_skip,
+        "Execute timer busy-wait loops instead of fast-forwarding virtual time");
+    emu->add_flag("--release-zero-pages", release_zero_pages,
+        "Periodically return guest RAM pages cleared by the guest to the host");
     emu->add_option("--cpu-timing", cpu_timing_mode,
         "Select CPU instruction timing (fixed: 16 ns/instruction; "
         "per-machine: derive from core frequency)")
@@ -201,6 +229,44 @@ int main(int argc, char** argv) {
         "Specifies periodic interval (in ms) at which to output CPU profiling information");
 #endif
 
+    string   stats_file;
+    string   stats_format = "json";
+    uint32_t stats_interval_ms = 1000;
+    string   stats_socket;
+    bool     mmio_profile = false;
+    emu->add_option("--stats-file", stats_file,
+        "Periodically write runtime counters to this file");
+    emu->add_option("--stats-format", stats_format, "Format of the stats file")
+        ->check(CLI::IsMember({"json", "csv"}))
+        ->capture_default_str();
+    emu->add_option("--stats-interval-ms", stats_interval_ms,
+        "Specifies interval (in ms) at which the stats file is updated")
+        ->check(CLI::Range(10, 3600000))
+        ->capture_default_str();
+    emu->add_option("--stats-socket", stats_socket,
+        "Serve runtime counters as JSON on this UNIX domain socket");
+    emu->add_flag("--mmio-profile", mmio_profile,
+        "Time MMIO accesses per device and register (see 'profile show MMIO')");
+
+    auto checkpoint_opt = emu->add_option("--checkpoint", checkpoint_path,
+        "Write a full RAM checkpoint to this file followed by incremental ones");
+    emu->add_option("--checkpoint-interval-ms", checkpoint_interval_ms,
+        "Specifies interval (in ms of guest time) between incremental checkpoints")
+        ->needs(checkpoint_opt)
+        ->check(CLI::Range(10, 3600000))
+        ->capture_default_str();
+    emu->add_option("--precopy", precopy_path,
+        "Stream guest RAM to this file or FIFO while the guest keeps running")
+        ->excludes(checkpoint_opt);
+    auto restore_checkpoint_opt = emu->add_option("--restore-checkpoint",
+        restore_checkpoint_args,
+        "Rebuild guest RAM from a checkpoint file, up to checkpoint SEQ if given")
+        ->expected(1, 2)
+        ->type_name("FILE [SEQ]");
+    emu->add_option("--precopy-receive", precopy_receive_path,
+        "Load guest RAM from a pre-copy stream before starting the guest")
+        ->excludes(restore_checkpoint_opt);
+
     string       machine_str;
     CLI::Option* machine_opt = emu->add_option("-m,--machine",
         machine_str, "Specify machine ID");
@@ -209,6 +275,17 @@ int main(int argc, char** argv) {
         "The guest cursor causes mouse to be grabbed");
     emu->add_flag("--swap-command-option", g_swap_command_option,
         "Swap the Command and Option keys (physical Alt/AltGr becomes Command)");
+    emu->add_flag("--sync-present", g_sync_present,
+        "Present frames on the emulation thread instead of a render thread");
+    emu->add_option("--display", display_backend,
+        "Select the display backend (sdl: host window; headless: frames stay in memory)")
+        ->check(CLI::IsMember({"sdl", "headless"}))
+        ->capture_default_str();
+    emu->add_option("--frame-dump-dir", g_frame_dump_dir,
+        "Headless display: directory receiving PNG frame dumps")
+        ->check(CLI::ExistingDirectory);
+    emu->add_option("--frame-dump-interval-ms", g_frame_dump_interval_ms,
+        "Headless display: PNG dump interval (0 dumps every changed frame)");
 
     emu->add_option("-s,--symbols", symbols_path, "Specifies symbols path")
         ->check(CLI::ExistingFile);
@@ -236,7 +313,8 @@ int main(int argc, char** argv) {
     if (log_to_file)
         loguru::add_file("dingusppc.log", loguru::Append, log_verbosity);
 
-    deterministic_interactive = deterministic_mode == "interactive";
+    deterministic_interactive = deterministic_mode == "interactive" || !record_input_path.empty();
+    g_headless_display = display_backend == "headless";
 
     if (*list_cmd) {
         if (*machines)
@@ -328,13 +406,22 @@ int main(int argc, char** argv) {
     cout << "CPU timing: " << cpu_timing_mode << endl;
     if (is_deterministic) {
         cout << "Using deterministic execution mode; disk, NVRAM, and PRAM changes will not be saved." << endl;
-        if (deterministic_interactive) {
+        if (!record_input_path.empty()) {
+            cout << "Recording mouse, keyboard and serial input to " << record_input_path << "." << endl;
+        } else if (!replay_input_path.empty()) {
+            cout << "Replaying mouse, keyboard and serial input from " << replay_input_path << "." << endl;
+        } else if (deterministic_interactive) {
             cout << "Mouse and keyboard input enabled; execution will not be fully deterministic." << endl;
         } else {
             cout << "Mouse and keyboard input will be ignored." << endl;
         }
     }
 
+    if (!record_input_path.empty() && !input_log_start_recording(record_input_path))
+        return 1;
+    if (!replay_input_path.empty() && !input_log_start_replay(replay_input_path))
+        return 1;
+
     if (!init()) {
         LOG_F(ERROR, "Cannot initialize");
         return 1;
@@ -342,6 +429,18 @@ int main(int argc, char** argv) {
 
     // initialize global profiler object
     gProfilerObj.reset(new Profiler());
+    stats_register_profile();
+    mmio_prof_register_profile();
+    TimerManager::get_instance()->register_profile();
+
+    if (mmio_profile)
+        mmio_prof_enable(true);
+
+    if (!stats_file.empty())
+        stats_start_export(stats_file,
+            stats_format == "csv" ? StatsFormat::CSV : StatsFormat::JSON, stats_interval_ms);
+    if (!stats_socket.empty())
+        stats_start_socket(stats_socket);
 
     // graceful handling of fatal errors
     loguru::set_fatal_handler([](const loguru::Message& message) {
@@ -373,11 +472,15 @@ int main(int argc, char** argv) {
     if (start_idle_cpu_save) {
         set_g_idle_cpu_save(true);
     }
+    if (no_busy_wait_skip) {
+        set_busy_wait_skip(false);
+    }
 
     while (true) {
         {
             app_args = app.remaining_for_passthrough();
-            if (MachineFactory::create_machine_for_id(machine_str, &rom_data[0], rom_size, app_args) < 0) {
+            if (MachineFactory::create_machine_for_id(machine_str, &rom_data[0], rom_size, app_args,
+                                                     bootrom_path) < 0) {
                 break;
             }
         }
@@ -406,6 +509,9 @@ int main(int argc, char** argv) {
     delete gMachineObj.release();
     SocketCache::delete_instance();
 
+    stats_stop_export();
+    input_log_stop();
+
     cleanup();
 
     return 0;
@@ -424,7 +530,9 @@ void run_machine(
 
     uint32_t deterministic_timer = 0;
     if (is_deterministic && !deterministic_interactive) {
-        EventManager::get_instance()->disable_input_handlers();
+        // replayed input is delivered, live input is dropped by the replay
+        if (!input_log_replaying())
+            EventManager::get_instance()->disable_input_handlers();
         // Log the PC and instruction every second to make it easier to validate
         // that execution is the same every time.
         deterministic_timer = TimerManager::get_instance()->add_cyclic_timer(MSECS_TO_NSECS(1000), [](uint64_t, uint64_t) {
@@ -452,7 +560,49 @@ void run_machine(
     // default Macintosh polling rate of 11 ms
     uint32_t event_timer = TimerManager::get_instance()->add_cyclic_timer(MSECS_TO_NSECS(11), [](uint64_t, uint64_t) {
         EventManager::get_instance()->poll_events();
-    });
+    }, MSECS_TO_NSECS(1));
+
+    uint32_t zero_page_timer = 0;
+    if (release_zero_pages) {
+        mem_ctrl_instance->track_zero_pages = true;
+        zero_page_timer = TimerManager::get_instance()->add_cyclic_timer(MSECS_TO_NSECS(1000), [](uint64_t, uint64_t) {
+            mem_ctrl_instance->release_zero_pages();
+        });
+    }
+
+    // restored RAM only makes sense for the first run
+    if (!restore_checkpoint_args.empty()) {
+        uint32_t seq = UINT32_MAX;
+        try {
+            if (restore_checkpoint_args.size() > 1)
+                seq = uint32_t(std::stoul(restore_checkpoint_args[1]));
+            checkpoint_restore(restore_checkpoint_args[0], seq);
+        } catch (std::exception&) {
+            LOG_F(ERROR, "Invalid checkpoint number %s", restore_checkpoint_args[1].c_str());
+        }
+        restore_checkpoint_args.clear();
+    }
+    if (!precopy_receive_path.empty()) {
+        precopy_receive(precopy_receive_path);
+        precopy_receive_path.clear();
+    }
+
+    uint32_t checkpoint_timer = 0;
+    if (!checkpoint_path.empty() && checkpoint_start(checkpoint_path)) {
+        checkpoint_timer = TimerManager::get_instance()->add_cyclic_timer(
+            MSECS_TO_NSECS(checkpoint_interval_ms), [](uint64_t, uint64_t) {
+            checkpoint_take();
+        });
+    }
+
+    // copy a slice of the RAM every 10 ms, the guest runs in between
+    uint32_t precopy_timer = 0;
+    if (!precopy_path.empty() && precopy_start(precopy_path)) {
+        precopy_timer = TimerManager::get_instance()->add_cyclic_timer(
+            MSECS_TO_NSECS(10), [](uint64_t, uint64_t) {
+            precopy_step();
+        });
+    }
 
 #ifdef CPU_PROFILING
     uint32_t profiling_timer;
@@ -485,6 +635,17 @@ void run_machine(
 
     LOG_F(INFO, "Cleaning up...");
     TimerManager::get_instance()->cancel_timer(event_timer);
+    if (release_zero_pages) {
+        TimerManager::get_instance()->cancel_timer(zero_page_timer);
+    }
+    if (checkpoint_timer) {
+        TimerManager::get_instance()->cancel_timer(checkpoint_timer);
+    }
+    if (precopy_timer) {
+        TimerManager::get_instance()->cancel_timer(precopy_timer);
+    }
+    checkpoint_stop();
+    precopy_stop();
 #ifdef CPU_PROFILING
     if (profiling_interval_ms > 0) {
         TimerManager::get_instance()->cancel_timer(profiling_timer);
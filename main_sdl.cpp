@@ -23,6 +23,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <main.h>
 #include <cpu/ppc/ppcemu.h>
+#include <devices/video/display_headless.h>
 #include <loguru.hpp>
 #include <SDL3/SDL.h>
 
@@ -31,11 +32,17 @@ extern "C" void remap_appkit_menu_shortcuts();
 #endif
 
 bool init() {
-    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD)) {
+    // the headless display needs no window system, only the event queue
+    SDL_InitFlags init_flags = g_headless_display ? SDL_INIT_EVENTS :
+        SDL_INIT_VIDEO | SDL_INIT_GAMEPAD;
+    if (!SDL_Init(init_flags)) {
         LOG_F(ERROR, "SDL_Init error: %s", SDL_GetError());
         return false;
     }
 
+    if (g_headless_display)
+        return true;
+
     SDL_EnableScreenSaver();
 
     int num_joysticks;
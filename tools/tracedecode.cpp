@@ -0,0 +1,179 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** Offline decoder for instruction traces recorded with "trace start".
+
+    Disassembles and symbolizes the records of a trace file in parallel
+    and prints them in execution order.
+ */
+
+#include <cpu/ppc/ppcdisasm.h>
+#include <cpu/ppc/ppctrace.h>
+#include <debugger/symbols.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CLI11.hpp>
+#include <loguru.hpp>
+
+static bool symbolize = false;
+
+static void decode_record(const TraceRec& rec, std::string& out) {
+    char buf[64];
+
+    if (rec.addr & TRACE_REC_GPR) {
+        // GPR delta, goes to the line of the preceding instruction
+        if (!out.empty() && out.back() == '\n')
+            out.pop_back();
+        snprintf(buf, sizeof(buf), " r%u=%08X\n", rec.paddr & 31, rec.ins);
+        out += buf;
+        return;
+    }
+
+    PPCDisasmContext ctx;
+    ctx.instr_addr = rec.addr;
+    ctx.instr_code = rec.ins;
+    ctx.simplified = true;
+    ctx.kinds = 0;
+    ctx.level = 0;
+
+    if (rec.paddr != rec.addr)
+        snprintf(buf, sizeof(buf), "%08X->%08X", rec.addr, rec.paddr);
+    else
+        snprintf(buf, sizeof(buf), "%08X", rec.addr);
+    out += buf;
+
+    if (symbolize) {
+        // open firmware and kext names need the guest memory
+        std::string name = get_name(rec.addr, rec.paddr, nullptr, nullptr,
+                                    1 << kind_darwin_kernel);
+        if (!name.empty()) {
+            snprintf(buf, sizeof(buf), " %-27s", name.c_str());
+            out += buf;
+        }
+    }
+
+    snprintf(buf, sizeof(buf), ": %08X    ", rec.ins);
+    out += buf;
+    out += disassemble_single(&ctx);
+    snprintf(buf, sizeof(buf), " ; msr:%X\n", rec.msr);
+    out += buf;
+}
+
+int main(int argc, char** argv) {
+    std::string trace_path, symbols_path;
+    unsigned num_threads = std::max(1U, std::thread::hardware_concurrency());
+    uint64_t last = 0;
+
+    CLI::App app("DingusPPC instruction trace decoder");
+    app.add_option("trace", trace_path, "Trace file")->required()->check(CLI::ExistingFile);
+    app.add_option("-s,--symbols", symbols_path, "Symbols file used for kernel names")
+        ->check(CLI::ExistingFile);
+    app.add_option("-j,--jobs", num_threads, "Number of decoding threads");
+    app.add_option("-n,--last", last, "Decode only the last N records");
+    CLI11_PARSE(app, argc, argv);
+
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+    loguru::g_preamble = false;
+    loguru::init(argc, argv);
+
+    std::ifstream f(trace_path, std::ios::binary);
+    TraceHeader hdr;
+    if (!f.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) ||
+        std::memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.rec_size != sizeof(TraceRec) || !hdr.capacity ||
+        (hdr.capacity & (hdr.capacity - 1))) {
+        LOG_F(ERROR, "%s is not a trace file", trace_path.c_str());
+        return 1;
+    }
+
+    // unroll the ring into execution order
+    uint64_t num_recs = std::min(hdr.count, hdr.capacity);
+    if (last && last < num_recs)
+        num_recs = last;
+    uint64_t first = hdr.count - num_recs;
+
+    std::vector<TraceRec> recs(num_recs);
+    uint64_t pos = first & (hdr.capacity - 1);
+    uint64_t head = std::min(num_recs, hdr.capacity - pos);
+    f.seekg(sizeof(hdr) + pos * sizeof(TraceRec));
+    f.read(reinterpret_cast<char*>(recs.data()), head * sizeof(TraceRec));
+    if (head < num_recs) {
+        f.seekg(sizeof(hdr));
+        f.read(reinterpret_cast<char*>(recs.data() + head), (num_recs - head) * sizeof(TraceRec));
+    }
+    if (!f) {
+        LOG_F(ERROR, "Could not read the records of %s", trace_path.c_str());
+        return 1;
+    }
+
+    if (!symbols_path.empty()) {
+        load_symbols(symbols_path);
+        symbolize = true;
+    }
+
+    printf("Decoding %" PRIu64 " of %" PRIu64 " records\n", num_recs, hdr.count);
+    if (!num_recs)
+        return 0;
+
+    // Decode a window of records at a time: the window is split between
+    // the worker threads and their output is printed in order before the
+    // next window is decoded, which keeps memory use bounded.
+    // Split points are moved past GPR deltas so they stay with their
+    // instruction; deltas the ring cut from their instruction are dropped.
+    constexpr uint64_t chunk_size = 1 << 16;
+    num_threads = std::max(1U, num_threads);
+    std::vector<std::string> outs(num_threads);
+
+    auto skip_deltas = [&](uint64_t i) {
+        while (i < num_recs && (recs[i].addr & TRACE_REC_GPR))
+            i++;
+        return i;
+    };
+
+    uint64_t win_start = skip_deltas(0);
+    while (win_start < num_recs) {
+        std::vector<std::thread> workers;
+        uint64_t chunk_start = win_start;
+        for (unsigned t = 0; t < num_threads && chunk_start < num_recs; t++) {
+            uint64_t chunk_end = skip_deltas(std::min(chunk_start + chunk_size, num_recs));
+            workers.emplace_back([&recs, &outs, t, chunk_start, chunk_end]() {
+                outs[t].clear();
+                for (uint64_t i = chunk_start; i < chunk_end; i++)
+                    decode_record(recs[i], outs[t]);
+            });
+            chunk_start = chunk_end;
+        }
+        for (unsigned t = 0; t < workers.size(); t++) {
+            workers[t].join();
+            fputs(outs[t].c_str(), stdout);
+        }
+        win_start = chunk_start;
+    }
+
+    return 0;
+}
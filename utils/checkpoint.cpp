@@ -0,0 +1,589 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Incremental guest RAM checkpoints and pre-copy streaming. */
+
+#include "checkpoint.h"
+
+#include <core/memaccess.h>
+#include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
+#include <devices/memctrl/dirtylog.h>
+#include <devices/memctrl/memctrlbase.h>
+#include <utils/ramsnapshot.h>
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const char checkpoint_sig[8] = {'D', 'P', 'P', 'C', 'C', 'K', 'P', '1'};
+
+constexpr uint32_t CKP_PAGE_SIZE = DirtyPageLog::PAGE_SIZE;
+
+// pages sent per pre-copy step, the guest runs between two steps
+constexpr size_t PRECOPY_SLICE = 1024;
+
+// stop the guest once a round has no more dirty pages than this
+constexpr size_t PRECOPY_STOP_PAGES = 256;
+
+// give up waiting for convergence after this many rounds
+constexpr uint32_t PRECOPY_MAX_ROUNDS = 30;
+
+class CheckpointWriter {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    /** All RAM pages in ascending order. */
+    std::vector<uint32_t> all_pages();
+
+    /** Map dirty pages seen through mirrors to their origin. */
+    void canonicalize(std::vector<uint32_t>& pages);
+
+    void begin(uint8_t kind, uint32_t num_pages);
+    void write_page(uint32_t phys_addr);
+
+    /** Complete the checkpoint. Returns false if any write
+        to the file failed since it was opened. */
+    bool end();
+
+    bool is_open() { return this->file != nullptr; }
+    bool has_failed() { return this->failed; }
+    const std::string& get_path() { return this->path; }
+
+    uint32_t    seq = 0;
+    uint64_t    pages_written = 0;
+
+private:
+    void put(const void* buf, size_t size) {
+        if (!this->failed && fwrite(buf, 1, size, this->file) != size)
+            this->failed = true;
+    }
+
+    FILE*       file = nullptr;
+    bool        failed = false;
+    std::string path;
+    std::vector<AddressMapEntry*> regions;
+};
+
+bool CheckpointWriter::open(const std::string& path) {
+    this->file = fopen(path.c_str(), "wb");
+    if (!this->file) {
+        LOG_F(ERROR, "Checkpoint: cannot create %s", path.c_str());
+        return false;
+    }
+    setvbuf(this->file, nullptr, _IOFBF, 1 << 20);
+    this->failed = false;
+    this->path   = path;
+    this->put(checkpoint_sig, sizeof(checkpoint_sig));
+
+    this->regions = mem_ctrl_instance->get_ram_regions();
+    for (auto& rgn : this->regions) {
+        uint8_t rec[9] = {'R'};
+        WRITE_DWORD_LE_U(&rec[1], rgn->start);
+        WRITE_DWORD_LE_U(&rec[5], rgn->end - rgn->start + 1);
+        this->put(rec, sizeof(rec));
+    }
+
+    this->seq = 0;
+    this->pages_written = 0;
+    return true;
+}
+
+void CheckpointWriter::close() {
+    if (this->file) {
+        fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+std::vector<uint32_t> CheckpointWriter::all_pages() {
+    std::vector<uint32_t> pages;
+
+    for (auto& rgn : this->regions) {
+        for (uint64_t addr = rgn->start; addr <= rgn->end; addr += CKP_PAGE_SIZE)
+            pages.push_back(uint32_t(addr));
+    }
+
+    return pages;
+}
+
+void CheckpointWriter::canonicalize(std::vector<uint32_t>& pages) {
+    for (auto& page : pages) {
+        AddressMapEntry* entry = mem_ctrl_instance->find_range(page);
+        if (!entry || !(entry->type & RT_RAM)) {
+            page = UINT32_MAX; // ROM or a region removed meanwhile
+            continue;
+        }
+        if (!(entry->type & RT_MIRROR))
+            continue;
+
+        const uint8_t* host_ptr = entry->mem_ptr + (page - entry->start);
+        uint32_t origin = UINT32_MAX;
+        for (auto& rgn : this->regions) {
+            if (host_ptr >= rgn->mem_ptr && host_ptr <= rgn->mem_ptr + (rgn->end - rgn->start)) {
+                origin = rgn->start + uint32_t(host_ptr - rgn->mem_ptr);
+                break;
+            }
+        }
+        page = origin;
+    }
+
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    if (!pages.empty() && pages.back() == UINT32_MAX)
+        pages.pop_back();
+}
+
+void CheckpointWriter::begin(uint8_t kind, uint32_t num_pages) {
+    uint8_t rec[18] = {'B'};
+    WRITE_DWORD_LE_U(&rec[1], this->seq);
+    rec[5] = kind;
+    WRITE_QWORD_LE_U(&rec[6], get_virt_time_ns());
+    WRITE_DWORD_LE_U(&rec[14], num_pages);
+    this->put(rec, sizeof(rec));
+}
+
+void CheckpointWriter::write_page(uint32_t phys_addr) {
+    uint8_t rec[5] = {'P'};
+    WRITE_DWORD_LE_U(&rec[1], phys_addr);
+    this->put(rec, sizeof(rec));
+
+    AddressMapEntry* entry = mem_ctrl_instance->find_range(phys_addr);
+    uint32_t avail = entry->end - phys_addr + 1;
+    ram_snapshot_touch(entry->mem_ptr + (phys_addr - entry->start),
+                       std::min(avail, CKP_PAGE_SIZE));
+    if (avail >= CKP_PAGE_SIZE) {
+        this->put(entry->mem_ptr + (phys_addr - entry->start), CKP_PAGE_SIZE);
+    } else {
+        // pad the last page of a region that isn't page-sized
+        uint8_t buf[CKP_PAGE_SIZE] = {};
+        std::memcpy(buf, entry->mem_ptr + (phys_addr - entry->start), avail);
+        this->put(buf, CKP_PAGE_SIZE);
+    }
+    this->pages_written++;
+}
+
+bool CheckpointWriter::end() {
+    uint8_t rec[5] = {'E'};
+    WRITE_DWORD_LE_U(&rec[1], this->seq);
+    this->put(rec, sizeof(rec));
+    if (fflush(this->file) || ferror(this->file))
+        this->failed = true;
+    this->seq++;
+    return !this->failed;
+}
+
+//======================== Incremental checkpoints ========================
+static CheckpointWriter ckp_writer;
+
+static void checkpoint_close() {
+    dirty_log_stop();
+    ckp_writer.close();
+}
+
+// A failed write (e.g. a full disk) ends checkpointing, the file keeps
+// all checkpoints completed so far.
+static bool checkpoint_write(uint8_t kind, const std::vector<uint32_t>& pages) {
+    ckp_writer.begin(kind, uint32_t(pages.size()));
+    for (uint32_t page : pages)
+        ckp_writer.write_page(page);
+    if (ckp_writer.end())
+        return true;
+
+    LOG_F(ERROR, "Checkpoint: cannot write to %s, checkpoints stopped after #%u",
+          ckp_writer.get_path().c_str(), ckp_writer.seq - 1);
+    checkpoint_close();
+    return false;
+}
+
+bool checkpoint_start(const std::string& path) {
+    if (!ckp_writer.open(path))
+        return false;
+
+    dirty_log_start();
+    std::vector<uint32_t> pages = ckp_writer.all_pages();
+    if (!checkpoint_write(CKP_FULL, pages))
+        return false;
+    LOG_F(INFO, "Checkpoint: full checkpoint of %zu pages written to %s",
+          pages.size(), path.c_str());
+    return true;
+}
+
+void checkpoint_take() {
+    if (!ckp_writer.is_open())
+        return;
+
+    std::vector<uint32_t> pages;
+    dirty_log_sync(pages);
+    ckp_writer.canonicalize(pages);
+    if (!checkpoint_write(CKP_INCREMENTAL, pages))
+        return;
+    LOG_F(9, "Checkpoint: #%u, %zu dirty pages", ckp_writer.seq - 1, pages.size());
+}
+
+void checkpoint_stop() {
+    if (!ckp_writer.is_open())
+        return;
+
+    checkpoint_take();
+    if (!ckp_writer.is_open())
+        return;
+
+    LOG_F(INFO, "Checkpoint: %u checkpoints, %llu pages written", ckp_writer.seq,
+          (unsigned long long)ckp_writer.pages_written);
+    checkpoint_close();
+}
+
+//======================== Pre-copy stream ========================
+static CheckpointWriter         precopy_writer;
+static std::vector<uint32_t>    precopy_pending; // pages of the current round
+static size_t                   precopy_pos = 0;
+
+static void precopy_begin_round(uint8_t kind) {
+    precopy_writer.begin(kind, uint32_t(precopy_pending.size()));
+    precopy_pos = 0;
+}
+
+// The receiving end of a FIFO may go away at any time.
+static bool precopy_check_write() {
+    if (!precopy_writer.has_failed())
+        return true;
+
+    LOG_F(ERROR, "Pre-copy: cannot write to %s, streaming stopped",
+          precopy_writer.get_path().c_str());
+    precopy_stop();
+    return false;
+}
+
+bool precopy_start(const std::string& path) {
+#ifndef _WIN32
+    // a closed FIFO must fail the write instead of terminating us
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (!precopy_writer.open(path))
+        return false;
+
+    dirty_log_start();
+    precopy_pending = precopy_writer.all_pages();
+    precopy_begin_round(CKP_FULL);
+    LOG_F(INFO, "Pre-copy: streaming %zu pages to %s", precopy_pending.size(),
+          path.c_str());
+    return true;
+}
+
+bool precopy_step() {
+    if (!precopy_writer.is_open())
+        return false;
+
+    size_t last = std::min(precopy_pending.size(), precopy_pos + PRECOPY_SLICE);
+    for (; precopy_pos < last; precopy_pos++)
+        precopy_writer.write_page(precopy_pending[precopy_pos]);
+
+    if (!precopy_check_write())
+        return false;
+    if (precopy_pos < precopy_pending.size())
+        return true;
+
+    if (!precopy_writer.end())
+        return precopy_check_write();
+
+    precopy_pending.clear();
+    dirty_log_sync(precopy_pending);
+    precopy_writer.canonicalize(precopy_pending);
+
+    if (precopy_pending.size() > PRECOPY_STOP_PAGES &&
+        precopy_writer.seq < PRECOPY_MAX_ROUNDS) {
+        LOG_F(9, "Pre-copy: round %u, %zu pages dirtied meanwhile",
+              precopy_writer.seq, precopy_pending.size());
+        precopy_begin_round(CKP_INCREMENTAL);
+        return true;
+    }
+
+    // Stop and copy: the guest doesn't run until this callback returns,
+    // so the remaining pages are consistent with each other.
+    auto start = std::chrono::steady_clock::now();
+    precopy_begin_round(CKP_FINAL);
+    for (uint32_t page : precopy_pending)
+        precopy_writer.write_page(page);
+    if (!precopy_writer.end())
+        return precopy_check_write();
+    auto pause_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    LOG_F(INFO, "Pre-copy: done after %u rounds, %llu pages sent, "
+          "final round of %zu pages paused the guest for %lld us",
+          precopy_writer.seq, (unsigned long long)precopy_writer.pages_written,
+          precopy_pending.size(), (long long)pause_us);
+    precopy_stop();
+    return false;
+}
+
+void precopy_stop() {
+    if (!precopy_writer.is_open())
+        return;
+
+    dirty_log_stop();
+    precopy_writer.close();
+    precopy_pending.clear();
+}
+
+//======================== Restore ========================
+typedef struct {
+    uint8_t     type;
+    uint8_t     kind;
+    uint32_t    seq;
+    uint32_t    phys_addr;
+} CheckpointRecord;
+
+class CheckpointReader {
+public:
+    ~CheckpointReader() { this->close(); }
+
+    /** Open the file and check that its RAM layout matches this machine. */
+    bool open(const std::string& path);
+    void close();
+
+    /** Go back to the first checkpoint. */
+    bool rewind();
+
+    /** Read the next 'B', 'P' or 'E' record. The contents of a page go to
+        page_buf or are skipped if it's null. Returns false at the end of
+        the stream, after a truncated record or an unknown one. */
+    bool next(CheckpointRecord& rec, uint8_t* page_buf);
+
+private:
+    bool get(void* buf, size_t size) {
+        return fread(buf, 1, size, this->file) == size;
+    }
+
+    FILE*       file = nullptr;
+    long        data_start = 0;
+    std::string path;
+};
+
+bool CheckpointReader::open(const std::string& path) {
+    this->path = path;
+    this->file = fopen(path.c_str(), "rb");
+    if (!this->file) {
+        LOG_F(ERROR, "Checkpoint: cannot open %s", path.c_str());
+        return false;
+    }
+
+    char sig[sizeof(checkpoint_sig)];
+    if (!this->get(sig, sizeof(sig)) || std::memcmp(sig, checkpoint_sig, sizeof(sig))) {
+        LOG_F(ERROR, "Checkpoint: %s: not a checkpoint file", path.c_str());
+        return false;
+    }
+
+    // the RAM regions are written up front
+    std::vector<AddressMapEntry*> regions = mem_ctrl_instance->get_ram_regions();
+    size_t num_regions = 0;
+    int    type;
+    while ((type = fgetc(this->file)) == 'R') {
+        uint8_t rec[8];
+        if (!this->get(rec, sizeof(rec)) || num_regions >= regions.size() ||
+            uint32_t(READ_DWORD_LE_U(&rec[0])) != regions[num_regions]->start ||
+            uint32_t(READ_DWORD_LE_U(&rec[4])) != regions[num_regions]->end - regions[num_regions]->start + 1)
+            break;
+        num_regions++;
+    }
+    if (type != 'B' || num_regions != regions.size()) {
+        LOG_F(ERROR, "Checkpoint: %s: RAM layout doesn't match this machine", path.c_str());
+        return false;
+    }
+    ungetc(type, this->file);
+
+    this->data_start = ftell(this->file);
+    return true;
+}
+
+void CheckpointReader::close() {
+    if (this->file) {
+        fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+bool CheckpointReader::rewind() {
+    return fseek(this->file, this->data_start, SEEK_SET) == 0;
+}
+
+bool CheckpointReader::next(CheckpointRecord& rec, uint8_t* page_buf) {
+    uint8_t buf[17];
+
+    int type = fgetc(this->file);
+    if (type == EOF)
+        return false;
+    rec.type = uint8_t(type);
+
+    switch (type) {
+    case 'B':
+        // the virtual time and the page count aren't needed for replaying
+        if (!this->get(buf, 17))
+            return false;
+        rec.seq  = READ_DWORD_LE_U(&buf[0]);
+        rec.kind = buf[4];
+        return true;
+    case 'P':
+        if (!this->get(buf, 4))
+            return false;
+        rec.phys_addr = READ_DWORD_LE_U(&buf[0]);
+        if (page_buf)
+            return this->get(page_buf, CKP_PAGE_SIZE);
+        return fseek(this->file, CKP_PAGE_SIZE, SEEK_CUR) == 0;
+    case 'E':
+        if (!this->get(buf, 4))
+            return false;
+        rec.seq = READ_DWORD_LE_U(&buf[0]);
+        return true;
+    default:
+        LOG_F(ERROR, "Checkpoint: %s: unknown record 0x%02X", this->path.c_str(), type);
+        return false;
+    }
+}
+
+static bool restore_page(uint32_t phys_addr, const uint8_t* page_buf) {
+    AddressMapEntry* entry = mem_ctrl_instance->find_range(phys_addr);
+    if (!entry || !(entry->type & RT_RAM)) {
+        LOG_F(ERROR, "Checkpoint: page 0x%08X isn't in RAM", phys_addr);
+        return false;
+    }
+
+    uint32_t len = std::min(entry->end - phys_addr + 1, CKP_PAGE_SIZE);
+    uint8_t* dst = entry->mem_ptr + (phys_addr - entry->start);
+
+    // a lazily restored snapshot must not overwrite the page later
+    ram_snapshot_touch(dst, len);
+    std::memcpy(dst, page_buf, len);
+
+    if (g_dirty_log_active)
+        g_dirty_log.mark_range(phys_addr, len);
+
+    return true;
+}
+
+bool checkpoint_restore(const std::string& path, uint32_t seq) {
+    if (!mem_ctrl_instance) {
+        LOG_F(ERROR, "Checkpoint: no machine");
+        return false;
+    }
+
+    CheckpointReader reader;
+    if (!reader.open(path))
+        return false;
+
+    // Checkpoints are written in order and only the last one
+    // may be incomplete, find the last one that isn't.
+    CheckpointRecord rec;
+    uint32_t cur_seq = 0;
+    int64_t  last_complete = -1;
+    while (reader.next(rec, nullptr)) {
+        if (rec.type == 'B')
+            cur_seq = rec.seq;
+        else if (rec.type == 'E' && rec.seq == cur_seq)
+            last_complete = rec.seq;
+    }
+    if (last_complete < 0) {
+        LOG_F(ERROR, "Checkpoint: %s has no complete checkpoint", path.c_str());
+        return false;
+    }
+    if (seq > last_complete) {
+        if (seq != UINT32_MAX)
+            LOG_F(WARNING, "Checkpoint: %s ends with #%lld, restoring that one",
+                  path.c_str(), (long long)last_complete);
+        seq = uint32_t(last_complete);
+    }
+
+    if (!reader.rewind()) {
+        LOG_F(ERROR, "Checkpoint: cannot rewind %s", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> page_buf(CKP_PAGE_SIZE);
+    uint64_t num_pages = 0;
+    while (reader.next(rec, page_buf.data())) {
+        if (rec.type == 'P') {
+            if (!restore_page(rec.phys_addr, page_buf.data()))
+                return false;
+            num_pages++;
+        } else if (rec.type == 'E' && rec.seq == seq) {
+            break;
+        }
+    }
+
+    // cached translations may point to stale contents
+    mmu_flush_phys_range(0, UINT32_MAX);
+
+    LOG_F(INFO, "Checkpoint: restored #%u from %s, %llu pages replayed", seq,
+          path.c_str(), (unsigned long long)num_pages);
+    return true;
+}
+
+bool precopy_receive(const std::string& path) {
+    if (!mem_ctrl_instance) {
+        LOG_F(ERROR, "Pre-copy: no machine");
+        return false;
+    }
+
+    // opening a FIFO blocks until the sender opens it too
+    CheckpointReader reader;
+    if (!reader.open(path))
+        return false;
+
+    CheckpointRecord rec;
+    std::vector<uint8_t> page_buf(CKP_PAGE_SIZE);
+    uint64_t num_pages = 0;
+    uint8_t  kind      = CKP_FULL;
+    bool     is_done   = false;
+    while (!is_done && reader.next(rec, page_buf.data())) {
+        switch (rec.type) {
+        case 'B':
+            kind = rec.kind;
+            break;
+        case 'P':
+            if (!restore_page(rec.phys_addr, page_buf.data()))
+                return false;
+            num_pages++;
+            break;
+        case 'E':
+            is_done = kind == CKP_FINAL;
+            break;
+        }
+    }
+
+    mmu_flush_phys_range(0, UINT32_MAX);
+
+    if (!is_done) {
+        LOG_F(ERROR, "Pre-copy: %s ended before the final round, guest RAM is inconsistent",
+              path.c_str());
+        return false;
+    }
+
+    LOG_F(INFO, "Pre-copy: received %llu pages in %u rounds from %s",
+          (unsigned long long)num_pages, rec.seq + 1, path.c_str());
+    return true;
+}
@@ -0,0 +1,88 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Incremental guest RAM checkpoints and pre-copy streaming.
+
+    Both modes are built on the dirty page log. A checkpoint file starts
+    with a full copy of guest RAM and then receives, at a fixed interval
+    of virtual time, only the pages written since the previous checkpoint.
+    Replaying the checkpoints in order up to a given one rebuilds the RAM
+    contents at that point.
+
+    The pre-copy stream sends the RAM of a running machine to another local
+    process through a file or a FIFO. Pages are copied in small slices
+    between which the guest keeps running. Pages dirtied meanwhile are sent
+    again in the next round, until the remaining set is small enough to be
+    sent in one final round with the guest stopped. Only guest RAM is
+    transferred; the receiver also needs the CPU and device state to resume
+    execution, which isn't serialized yet.
+
+    File format: the 8 byte signature "DPPCCKP1" followed by records, all
+    fields little-endian:
+        'R' <u32 start> <u32 size>          RAM region, written once up front
+        'B' <u32 seq> <u8 kind> <u64 virtual time ns> <u32 page count>
+        'P' <u32 physical address> <4096 bytes>
+        'E' <u32 seq>                       the checkpoint/round is complete
+    A reader must ignore pages of a checkpoint lacking its 'E' record.
+
+    checkpoint_restore() replays a checkpoint file into the RAM of a machine
+    with the same layout, precopy_receive() does the same with a pre-copy
+    stream as it arrives and returns once its final round is complete.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cinttypes>
+#include <string>
+
+enum CheckpointKind : uint8_t {
+    CKP_FULL        = 0, // every RAM page
+    CKP_INCREMENTAL = 1, // pages written since the previous checkpoint
+    CKP_FINAL       = 2, // last pre-copy round, taken with the guest stopped
+};
+
+/** Write a full checkpoint to the file and start logging dirty pages. */
+extern bool checkpoint_start(const std::string& path);
+
+/** Append the pages dirtied since the previous checkpoint. */
+extern void checkpoint_take();
+
+/** Take a last incremental checkpoint and close the file. */
+extern void checkpoint_stop();
+
+/** Start streaming guest RAM to the file or FIFO. */
+extern bool precopy_start(const std::string& path);
+
+/** Send the next slice of the current round. Returns false
+    once the final round has been sent. */
+extern bool precopy_step();
+
+extern void precopy_stop();
+
+/** Rebuild guest RAM by replaying the checkpoints of the file up to and
+    including seq, by default up to the last complete one. */
+extern bool checkpoint_restore(const std::string& path, uint32_t seq = UINT32_MAX);
+
+/** Load guest RAM from a pre-copy stream, waiting for its final round. */
+extern bool precopy_receive(const std::string& path);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,229 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Deterministic input recording and replay. */
+
+#include "inputlog.h"
+
+#include <cpu/ppc/ppcemu.h>
+#include <loguru.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+
+static const char input_log_sig[8] = {'D', 'P', 'P', 'C', 'I', 'N', 'P', '1'};
+
+InputLogMode g_input_log_mode = InputLogMode::Off;
+
+typedef struct {
+    uint64_t                time_ns;
+    uint8_t                 source;
+    std::vector<uint8_t>    data;
+} ReplayEvent;
+
+static FILE*    log_file = nullptr;
+static uint64_t last_time_ns = 0;
+static uint64_t num_events = 0;
+
+// replayed events queued per stream
+static std::map<uint8_t, std::deque<ReplayEvent>> replay_queues;
+
+//======================== Payload encoding ========================
+void InputLogPayload::put(uint32_t val)
+{
+    while (val >= 0x80) {
+        this->data.push_back(uint8_t(val | 0x80));
+        val >>= 7;
+    }
+    this->data.push_back(uint8_t(val));
+}
+
+void InputLogPayload::put_signed(int32_t val)
+{
+    // zigzag encoding keeps small negative values short
+    this->put((uint32_t(val) << 1) ^ uint32_t(val >> 31));
+}
+
+void InputLogPayload::put_bytes(const uint8_t* buf, uint32_t len)
+{
+    this->data.insert(this->data.end(), buf, buf + len);
+}
+
+uint32_t InputLogPayload::get()
+{
+    uint32_t val = 0;
+    for (int shift = 0; shift < 35 && this->pos < this->data.size(); shift += 7) {
+        uint8_t b = this->data[this->pos++];
+        val |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return val;
+}
+
+int32_t InputLogPayload::get_signed()
+{
+    uint32_t val = this->get();
+    return int32_t((val >> 1) ^ -(val & 1));
+}
+
+static void write_uleb(FILE* f, uint64_t val)
+{
+    uint8_t buf[10];
+    int     len = 0;
+
+    while (val >= 0x80) {
+        buf[len++] = uint8_t(val | 0x80);
+        val >>= 7;
+    }
+    buf[len++] = uint8_t(val);
+    fwrite(buf, 1, len, f);
+}
+
+static bool read_uleb(const std::vector<uint8_t>& buf, size_t& pos, uint64_t& val)
+{
+    val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= buf.size())
+            return false;
+        uint8_t b = buf[pos++];
+        val |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+//======================== Recording ========================
+bool input_log_start_recording(const std::string& path)
+{
+    log_file = fopen(path.c_str(), "wb");
+    if (!log_file) {
+        LOG_F(ERROR, "InputLog: cannot create %s", path.c_str());
+        return false;
+    }
+    fwrite(input_log_sig, 1, sizeof(input_log_sig), log_file);
+
+    last_time_ns = 0;
+    num_events = 0;
+    g_input_log_mode = InputLogMode::Record;
+    LOG_F(INFO, "InputLog: recording input to %s", path.c_str());
+    return true;
+}
+
+void input_log_record(uint8_t source, uint8_t stream, const InputLogPayload& payload)
+{
+    if (!log_file)
+        return;
+
+    uint64_t now_ns = get_virt_time_ns();
+    write_uleb(log_file, now_ns - last_time_ns);
+    last_time_ns = now_ns;
+    fputc(source, log_file);
+    fputc(stream, log_file);
+    write_uleb(log_file, payload.data.size());
+    if (!payload.data.empty())
+        fwrite(payload.data.data(), 1, payload.data.size(), log_file);
+    num_events++;
+}
+
+//======================== Replay ========================
+bool input_log_start_replay(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOG_F(ERROR, "InputLog: cannot open %s", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    size_t  len;
+    while ((len = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        buf.insert(buf.end(), chunk, chunk + len);
+    fclose(f);
+
+    if (buf.size() < sizeof(input_log_sig) ||
+        std::memcmp(buf.data(), input_log_sig, sizeof(input_log_sig))) {
+        LOG_F(ERROR, "InputLog: %s is not an input log", path.c_str());
+        return false;
+    }
+
+    replay_queues.clear();
+    num_events = 0;
+
+    uint64_t time_ns = 0;
+    size_t   pos = sizeof(input_log_sig);
+    while (pos < buf.size()) {
+        uint64_t delta, size;
+        if (!read_uleb(buf, pos, delta) || pos + 2 > buf.size()) {
+            LOG_F(ERROR, "InputLog: truncated record @%zu", pos);
+            break;
+        }
+        uint8_t source = buf[pos++];
+        uint8_t stream = buf[pos++];
+        if (!read_uleb(buf, pos, size) || size > buf.size() - pos) {
+            LOG_F(ERROR, "InputLog: truncated record @%zu", pos);
+            break;
+        }
+        time_ns += delta;
+        replay_queues[stream].push_back(
+            {time_ns, source, std::vector<uint8_t>(buf.begin() + pos, buf.begin() + pos + size)});
+        pos += size;
+        num_events++;
+    }
+
+    g_input_log_mode = InputLogMode::Replay;
+    LOG_F(INFO, "InputLog: replaying %llu events (%.3f s) from %s",
+          (unsigned long long)num_events, time_ns / 1e9, path.c_str());
+    return true;
+}
+
+bool input_log_next(uint8_t stream, uint8_t& source, InputLogPayload& payload)
+{
+    auto it = replay_queues.find(stream);
+    if (it == replay_queues.end() || it->second.empty())
+        return false;
+
+    ReplayEvent& event = it->second.front();
+    if (event.time_ns > get_virt_time_ns())
+        return false;
+
+    source       = event.source;
+    payload.data = std::move(event.data);
+    payload.pos  = 0;
+    it->second.pop_front();
+    return true;
+}
+
+void input_log_stop()
+{
+    if (g_input_log_mode == InputLogMode::Record && log_file) {
+        input_log_record(INPUT_LOG_END, INPUT_LOG_HOST_STREAM, InputLogPayload());
+        fclose(log_file);
+        log_file = nullptr;
+        LOG_F(INFO, "InputLog: recorded %llu events", (unsigned long long)num_events);
+    }
+    replay_queues.clear();
+    g_input_log_mode = InputLogMode::Off;
+}
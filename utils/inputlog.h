@@ -0,0 +1,95 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Deterministic input recording and replay.
+
+    While recording, every external input delivered to the guest (host
+    mouse, keyboard and gamepad events, serial port bytes) is logged
+    together with the virtual time at which it was delivered. In replay
+    mode, live input is ignored and the logged events are handed out again
+    at the same virtual instants. Together with --deterministic this makes
+    an interactive session reproducible bit for bit.
+
+    File format: the 8 byte signature "DPPCINP1" followed by records of
+    <uleb128 time delta ns> <source> <stream> <uleb128 length> <payload>.
+ */
+
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+enum class InputLogMode { Off, Record, Replay };
+
+enum InputLogSource : uint8_t {
+    INPUT_LOG_END       = 0, // end of the recorded session
+    INPUT_LOG_MOUSE     = 1,
+    INPUT_LOG_KEYBOARD  = 2,
+    INPUT_LOG_GAMEPAD   = 3,
+    INPUT_LOG_SERIAL    = 4,
+};
+
+/** Events of one stream are replayed in their recorded order. Host events
+    share stream 0, serial channels use their own stream. */
+constexpr uint8_t INPUT_LOG_HOST_STREAM = 0;
+
+/** Event payload made of variable-length integers and raw bytes. */
+class InputLogPayload {
+public:
+    void put(uint32_t val);
+    void put_signed(int32_t val);
+    void put_bytes(const uint8_t* buf, uint32_t len);
+
+    uint32_t get();
+    int32_t  get_signed();
+
+    std::vector<uint8_t>    data;
+    size_t                  pos = 0;
+};
+
+extern InputLogMode g_input_log_mode;
+
+extern bool input_log_start_recording(const std::string& path);
+extern bool input_log_start_replay(const std::string& path);
+
+/** Finish the log. A recording is terminated with an INPUT_LOG_END record. */
+extern void input_log_stop();
+
+/** Append an event stamped with the current virtual time. */
+extern void input_log_record(uint8_t source, uint8_t stream,
+                             const InputLogPayload& payload);
+
+/** Fetch the next replayed event of a stream if it is due
+    at the current virtual time. */
+extern bool input_log_next(uint8_t stream, uint8_t& source,
+                           InputLogPayload& payload);
+
+static inline bool input_log_recording() {
+    return g_input_log_mode == InputLogMode::Record;
+}
+
+static inline bool input_log_replaying() {
+    return g_input_log_mode == InputLogMode::Replay;
+}
+
+#endif // INPUT_LOG_H
@@ -0,0 +1,172 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Minimal compressor and decompressor for the LZ4 block format. */
+
+#include "lz4block.h"
+
+#include <cstring>
+
+constexpr size_t   LZ4_MIN_MATCH    = 4;
+constexpr size_t   LZ4_LAST_LITERALS = 5;  // the block must end with literals
+constexpr size_t   LZ4_MF_LIMIT     = 12;  // no match may start this close to the end
+constexpr size_t   LZ4_MAX_OFFSET   = 65535;
+constexpr uint32_t LZ4_HASH_BITS    = 12;
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t val;
+    std::memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+static inline uint32_t lz4_hash(uint32_t seq) {
+    return (seq * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+static inline uint8_t* put_length(uint8_t* op, size_t len) {
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = uint8_t(len);
+    return op;
+}
+
+// Emit one sequence, a match length of 0 denotes the final literal run.
+static bool emit_sequence(uint8_t*& op, const uint8_t* op_end, const uint8_t* lit,
+                          size_t lit_len, size_t offset, size_t match_len)
+{
+    // token + length bytes + literals + offset
+    if (size_t(op_end - op) < 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1)
+        return false;
+
+    uint8_t* token = op++;
+    *token = uint8_t((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15)
+        op = put_length(op, lit_len - 15);
+    std::memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (!match_len)
+        return true;
+
+    *op++ = uint8_t(offset);
+    *op++ = uint8_t(offset >> 8);
+    match_len -= LZ4_MIN_MATCH;
+    *token |= uint8_t(match_len >= 15 ? 15 : match_len);
+    if (match_len >= 15)
+        op = put_length(op, match_len - 15);
+    return true;
+}
+
+size_t lz4_compress_block(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_cap)
+{
+    uint32_t table[1 << LZ4_HASH_BITS] = {};
+    uint8_t* op     = dst;
+    uint8_t* op_end = dst + dst_cap;
+    size_t   anchor = 0;
+
+    if (size > LZ4_MF_LIMIT) {
+        const size_t match_limit = size - LZ4_MF_LIMIT;
+        const size_t match_end   = size - LZ4_LAST_LITERALS;
+
+        for (size_t ip = 0; ip < match_limit;) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h   = lz4_hash(seq);
+            size_t   ref = table[h];
+            table[h] = uint32_t(ip);
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t len = LZ4_MIN_MATCH;
+            while (ip + len < match_end && src[ref + len] == src[ip + len])
+                len++;
+
+            if (!emit_sequence(op, op_end, src + anchor, ip - anchor, ip - ref, len))
+                return 0;
+            ip += len;
+            anchor = ip;
+        }
+    }
+
+    if (!emit_sequence(op, op_end, src + anchor, size - anchor, 0, 0))
+        return 0;
+
+    return size_t(op - dst);
+}
+
+bool lz4_decompress_block(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size)
+{
+    const uint8_t* ip     = src;
+    const uint8_t* ip_end = src + src_size;
+    uint8_t*       op     = dst;
+    uint8_t*       op_end = dst + dst_size;
+
+    auto get_length = [&](size_t len) -> size_t {
+        if (len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= ip_end)
+                    return SIZE_MAX;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        return len;
+    };
+
+    while (ip < ip_end) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = get_length(token >> 4);
+        if (lit_len > size_t(ip_end - ip) || lit_len > size_t(op_end - op))
+            return false;
+        std::memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == ip_end)
+            break; // final literal run
+
+        if (ip_end - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > size_t(op - dst))
+            return false;
+
+        size_t match_len = get_length(token & 15);
+        if (match_len == SIZE_MAX)
+            return false;
+        match_len += LZ4_MIN_MATCH;
+        if (match_len > size_t(op_end - op))
+            return false;
+
+        // matches may overlap their own output
+        const uint8_t* ref = op - offset;
+        for (size_t i = 0; i < match_len; i++)
+            op[i] = ref[i];
+        op += match_len;
+    }
+
+    return op == op_end;
+}
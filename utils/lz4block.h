@@ -0,0 +1,44 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Minimal compressor and decompressor for the LZ4 block format.
+
+    Produces plain LZ4 blocks that any LZ4 implementation can decode.
+    The compressor is a single pass greedy matcher that trades ratio for
+    speed, which suits guest RAM made of code, tables and zero fill.
+ */
+
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cinttypes>
+#include <cstddef>
+
+/** Compress size bytes from src into dst. Returns the compressed size
+    or 0 if the result doesn't fit into dst_cap bytes. */
+extern size_t lz4_compress_block(const uint8_t* src, size_t size,
+                                 uint8_t* dst, size_t dst_cap);
+
+/** Decompress a block that must expand to exactly dst_size bytes. */
+extern bool lz4_decompress_block(const uint8_t* src, size_t src_size,
+                                 uint8_t* dst, size_t dst_size);
+
+#endif // LZ4_BLOCK_H
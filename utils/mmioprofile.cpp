@@ -0,0 +1,181 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Per-device MMIO access profiling. */
+
+#include "mmioprofile.h"
+#include "profiler.h"
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+std::atomic<bool> g_mmio_prof_enabled{false};
+
+typedef struct MmioRegStats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t host_ns;
+} MmioRegStats;
+
+typedef struct MmioRegionProf {
+    std::string name;
+    uint32_t    start;
+    uint64_t    reads;
+    uint64_t    writes;
+    uint64_t    host_ns;
+    std::unordered_map<uint32_t, MmioRegStats> regs; // keyed by region offset
+} MmioRegionProf;
+
+// Accesses may come from DMA and timer threads as well, this path is only
+// taken while profiling so a lock is cheap enough.
+static std::mutex mmio_prof_mtx;
+static std::vector<std::unique_ptr<MmioRegionProf>> mmio_prof_regions;
+
+// number of registers listed in the ranking
+constexpr size_t MMIO_PROF_TOP_REGS = 20;
+
+uint32_t mmio_prof_add_region(const std::string& dev_name, uint32_t start) {
+    std::lock_guard<std::mutex> lk(mmio_prof_mtx);
+    auto rgn = std::make_unique<MmioRegionProf>();
+    rgn->name  = dev_name;
+    rgn->start = start;
+    mmio_prof_regions.push_back(std::move(rgn));
+    return uint32_t(mmio_prof_regions.size() - 1);
+}
+
+void mmio_prof_record(uint32_t rgn_id, uint32_t offset, bool is_write,
+                      uint64_t host_ns) {
+    std::lock_guard<std::mutex> lk(mmio_prof_mtx);
+    MmioRegionProf* rgn = mmio_prof_regions[rgn_id].get();
+    MmioRegStats& reg = rgn->regs[offset];
+    if (is_write) {
+        rgn->writes++;
+        reg.writes++;
+    } else {
+        rgn->reads++;
+        reg.reads++;
+    }
+    rgn->host_ns += host_ns;
+    reg.host_ns  += host_ns;
+}
+
+void mmio_prof_enable(bool enable) {
+    g_mmio_prof_enabled.store(enable, std::memory_order_relaxed);
+    LOG_F(INFO, "MMIO profiling %s", enable ? "enabled" : "disabled");
+}
+
+static std::string mmio_prof_label(const MmioRegionProf* rgn) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "@%08X", rgn->start);
+    return rgn->name + buf;
+}
+
+class MmioProfile : public BaseProfile {
+public:
+    MmioProfile() : BaseProfile("MMIO") {}
+
+    void populate_variables(std::vector<ProfileVar>& vars) {
+        std::lock_guard<std::mutex> lk(mmio_prof_mtx);
+
+        vars.clear();
+
+        if (!g_mmio_prof_enabled.load(std::memory_order_relaxed))
+            vars.push_back({.name = "(disabled, use 'mmioprof on')",
+                            .format = ProfileVarFmt::DEC, .value = 0});
+
+        std::vector<const MmioRegionProf*> rgns;
+        uint64_t total_ns = 0, total_accesses = 0;
+        for (auto& rgn : mmio_prof_regions) {
+            if (rgn->reads + rgn->writes) {
+                rgns.push_back(rgn.get());
+                total_ns       += rgn->host_ns;
+                total_accesses += rgn->reads + rgn->writes;
+            }
+        }
+
+        std::sort(rgns.begin(), rgns.end(), [](auto a, auto b) {
+            return a->host_ns > b->host_ns;
+        });
+
+        vars.push_back({.name = "Total MMIO accesses", .format = ProfileVarFmt::DEC,
+                        .value = total_accesses});
+        vars.push_back({.name = "Total host ns", .format = ProfileVarFmt::DEC,
+                        .value = total_ns});
+
+        // devices ranked by host time
+        for (auto rgn : rgns) {
+            std::string label = mmio_prof_label(rgn);
+            vars.push_back({.name = label + " ns", .format = ProfileVarFmt::COUNT,
+                            .value = rgn->host_ns, .count_total = total_ns});
+            vars.push_back({.name = label + " reads", .format = ProfileVarFmt::DEC,
+                            .value = rgn->reads});
+            vars.push_back({.name = label + " writes", .format = ProfileVarFmt::DEC,
+                            .value = rgn->writes});
+        }
+
+        // hottest registers over all devices
+        struct RegRef {
+            const MmioRegionProf* rgn;
+            uint32_t offset;
+            const MmioRegStats* stats;
+        };
+        std::vector<RegRef> regs;
+        for (auto rgn : rgns)
+            for (auto& reg : rgn->regs)
+                regs.push_back({rgn, reg.first, &reg.second});
+
+        size_t num_regs = std::min(regs.size(), MMIO_PROF_TOP_REGS);
+        std::partial_sort(regs.begin(), regs.begin() + num_regs, regs.end(),
+            [](const RegRef& a, const RegRef& b) {
+                return a.stats->host_ns > b.stats->host_ns;
+            });
+
+        for (size_t i = 0; i < num_regs; i++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "+0x%X", regs[i].offset);
+            std::string label = regs[i].rgn->name + buf;
+            vars.push_back({.name = label + " ns", .format = ProfileVarFmt::COUNT,
+                            .value = regs[i].stats->host_ns, .count_total = total_ns});
+            vars.push_back({.name = label + " r/w", .format = ProfileVarFmt::DEC,
+                            .value = regs[i].stats->reads + regs[i].stats->writes});
+        }
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lk(mmio_prof_mtx);
+        for (auto& rgn : mmio_prof_regions) {
+            rgn->reads = rgn->writes = rgn->host_ns = 0;
+            rgn->regs.clear();
+        }
+    }
+};
+
+void mmio_prof_register_profile() {
+    if (gProfilerObj)
+        gProfilerObj->register_profile("MMIO",
+            std::unique_ptr<BaseProfile>(new MmioProfile()));
+}
@@ -0,0 +1,57 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Per-device MMIO access profiling.
+
+    When enabled, every MMIO access dispatched through an AddressMapEntry
+    is counted per region and per register offset together with the host
+    time spent inside the device handler. The "MMIO" profile ranks devices
+    and registers by that time.
+ */
+
+#ifndef MMIO_PROFILE_H
+#define MMIO_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <string>
+
+/** Set by the debugger, read on every MMIO access by any thread. */
+extern std::atomic<bool> g_mmio_prof_enabled;
+
+/** Create a profile slot for an MMIO region and return its ID. */
+extern uint32_t mmio_prof_add_region(const std::string& dev_name, uint32_t start);
+
+extern void mmio_prof_record(uint32_t rgn_id, uint32_t offset, bool is_write,
+                             uint64_t host_ns);
+
+extern void mmio_prof_enable(bool enable);
+
+/** Register the "MMIO" profile with the profiler. */
+extern void mmio_prof_register_profile();
+
+static inline uint64_t mmio_prof_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // MMIO_PROFILE_H
@@ -0,0 +1,545 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Compressed guest RAM snapshots. */
+
+#include "ramsnapshot.h"
+#include "lz4block.h"
+
+#include <core/memaccess.h>
+#include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
+#include <devices/memctrl/dirtylog.h>
+#include <devices/memctrl/memctrlbase.h>
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char snapshot_sig[8] = {'D', 'P', 'P', 'C', 'S', 'N', 'P', '1'};
+
+constexpr uint32_t SNP_PAGE_SIZE   = 4096;
+constexpr uint32_t SNP_CHUNK_PAGES = 16;
+constexpr uint32_t SNP_CHUNK_SIZE  = SNP_PAGE_SIZE * SNP_CHUNK_PAGES;
+constexpr uint32_t SNP_HEADER_SIZE = 24;
+constexpr uint32_t SNP_INDEX_ENTRY_SIZE = 16;
+
+// chunks processed by the workers before their results are written
+constexpr size_t SNP_BATCH = 1024;
+
+constexpr unsigned SNP_MAX_WORKERS = 8;
+
+typedef struct {
+    uint8_t*    host_ptr;
+    uint32_t    phys_addr;
+    uint32_t    size;       // less than a chunk at the end of a region
+} SnapshotChunk;
+
+typedef struct {
+    uint64_t    offset;
+    uint32_t    stored_size;
+    uint16_t    page_mask;
+    uint8_t     method;
+} SnapshotIndexEntry;
+
+typedef struct {
+    std::vector<uint8_t>    data;
+    uint16_t                page_mask;
+    uint8_t                 method;
+} EncodedChunk;
+
+typedef struct {
+    const uint8_t*  host_ptr;
+    uint64_t        size;
+    size_t          first_chunk;
+} SnapshotRegion;
+
+std::atomic<bool> g_ram_snapshot_lazy{false};
+
+// state of a lazy restore
+static std::mutex                       lazy_mutex;
+static FILE*                            lazy_file = nullptr;
+static std::vector<SnapshotRegion>      lazy_regions;
+static std::vector<SnapshotChunk>       lazy_chunks;
+static std::vector<SnapshotIndexEntry>  lazy_index;
+static std::vector<bool>                lazy_pending;
+static size_t                           lazy_remaining = 0;
+
+static void run_parallel(size_t count, const std::function<void(size_t, std::vector<uint8_t>&)>& fn)
+{
+    unsigned num_workers = std::min<size_t>(
+        std::min(std::max(std::thread::hardware_concurrency(), 1U), SNP_MAX_WORKERS), count);
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        std::vector<uint8_t> scratch(SNP_CHUNK_SIZE);
+        for (size_t i; (i = next.fetch_add(1)) < count;)
+            fn(i, scratch);
+    };
+
+    if (num_workers <= 1) {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < num_workers; i++)
+        workers.emplace_back(worker);
+    for (auto& w : workers)
+        w.join();
+}
+
+static std::vector<SnapshotChunk> split_into_chunks(const std::vector<AddressMapEntry*>& regions)
+{
+    std::vector<SnapshotChunk> chunks;
+
+    for (auto& rgn : regions) {
+        uint64_t size = uint64_t(rgn->end) - rgn->start + 1;
+        for (uint64_t pos = 0; pos < size; pos += SNP_CHUNK_SIZE)
+            chunks.push_back({rgn->mem_ptr + pos, uint32_t(rgn->start + pos),
+                              uint32_t(std::min<uint64_t>(SNP_CHUNK_SIZE, size - pos))});
+    }
+
+    return chunks;
+}
+
+static bool is_zero_page(const uint8_t* ptr, uint32_t size)
+{
+    uint64_t acc = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= size; i += 8)
+        acc |= READ_QWORD_LE_U(ptr + i);
+    for (; i < size; i++)
+        acc |= ptr[i];
+    return !acc;
+}
+
+static void encode_chunk(const SnapshotChunk& chunk, EncodedChunk& out,
+                         std::vector<uint8_t>& scratch)
+{
+    uint32_t raw_size = 0;
+
+    out.page_mask = 0;
+    for (uint32_t page = 0; page * SNP_PAGE_SIZE < chunk.size; page++) {
+        const uint8_t* src = chunk.host_ptr + page * SNP_PAGE_SIZE;
+        uint32_t len = std::min(SNP_PAGE_SIZE, chunk.size - page * SNP_PAGE_SIZE);
+        if (is_zero_page(src, len))
+            continue;
+        out.page_mask |= 1 << page;
+        std::memcpy(&scratch[raw_size], src, len);
+        if (len < SNP_PAGE_SIZE)
+            std::memset(&scratch[raw_size + len], 0, SNP_PAGE_SIZE - len);
+        raw_size += SNP_PAGE_SIZE;
+    }
+
+    if (!out.page_mask) {
+        out.method = SNP_ZERO;
+        out.data.clear();
+        return;
+    }
+
+    out.data.resize(raw_size);
+    size_t comp_size = lz4_compress_block(scratch.data(), raw_size, out.data.data(),
+                                          raw_size - 1);
+    if (comp_size) {
+        out.method = SNP_LZ4;
+        out.data.resize(comp_size);
+    } else {
+        out.method = SNP_RAW;
+        std::memcpy(out.data.data(), scratch.data(), raw_size);
+    }
+}
+
+static bool decode_chunk(const SnapshotChunk& chunk, const SnapshotIndexEntry& entry,
+                         const uint8_t* stored, std::vector<uint8_t>& scratch)
+{
+    const uint8_t* src = stored;
+
+    if (entry.method == SNP_LZ4) {
+        uint32_t raw_size = std::popcount(entry.page_mask) * SNP_PAGE_SIZE;
+        if (!lz4_decompress_block(stored, entry.stored_size, scratch.data(), raw_size))
+            return false;
+        src = scratch.data();
+    } else if (entry.method == SNP_RAW) {
+        if (entry.stored_size != std::popcount(entry.page_mask) * SNP_PAGE_SIZE)
+            return false;
+    } else if (entry.method != SNP_ZERO) {
+        return false;
+    }
+
+    for (uint32_t page = 0; page * SNP_PAGE_SIZE < chunk.size; page++) {
+        uint8_t* dst = chunk.host_ptr + page * SNP_PAGE_SIZE;
+        uint32_t len = std::min(SNP_PAGE_SIZE, chunk.size - page * SNP_PAGE_SIZE);
+        if (entry.page_mask & (1 << page)) {
+            std::memcpy(dst, src, len);
+            src += SNP_PAGE_SIZE;
+        } else {
+            std::memset(dst, 0, len);
+        }
+    }
+
+    // restored contents count as guest writes for incremental checkpoints
+    if (g_dirty_log_active)
+        g_dirty_log.mark_range(chunk.phys_addr, chunk.size);
+
+    return true;
+}
+
+// snapshots of large machines exceed the range of long on some hosts
+static bool file_seek(FILE* f, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(f, int64_t(offset), SEEK_SET) == 0;
+#else
+    return fseeko(f, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+static bool file_size(FILE* f, uint64_t& size)
+{
+#ifdef _WIN32
+    if (_fseeki64(f, 0, SEEK_END))
+        return false;
+    int64_t pos = _ftelli64(f);
+#else
+    if (fseeko(f, 0, SEEK_END))
+        return false;
+    int64_t pos = ftello(f);
+#endif
+    if (pos < 0)
+        return false;
+    size = uint64_t(pos);
+    return true;
+}
+
+static bool read_stored(FILE* f, const SnapshotIndexEntry& entry, std::vector<uint8_t>& buf)
+{
+    buf.resize(entry.stored_size);
+    if (!entry.stored_size)
+        return true;
+    return file_seek(f, entry.offset) &&
+           fread(buf.data(), 1, entry.stored_size, f) == entry.stored_size;
+}
+
+//======================== Lazy restore ========================
+static void lazy_restore_finish()
+{
+    if (lazy_file)
+        fclose(lazy_file);
+    lazy_file = nullptr;
+    lazy_regions.clear();
+    lazy_chunks.clear();
+    lazy_index.clear();
+    lazy_pending.clear();
+    lazy_remaining = 0;
+    g_ram_snapshot_lazy = false;
+}
+
+static void lazy_restore_chunk(size_t idx)
+{
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> scratch(SNP_CHUNK_SIZE);
+
+    // The index was validated at load time, so this only happens if the
+    // file changed meanwhile. Losing one chunk beats losing the session.
+    if (!read_stored(lazy_file, lazy_index[idx], stored) ||
+        !decode_chunk(lazy_chunks[idx], lazy_index[idx], stored.data(), scratch)) {
+        const SnapshotChunk& chunk = lazy_chunks[idx];
+        LOG_F(ERROR, "RAMSnapshot: cannot restore chunk at 0x%08X, zero-filled",
+              chunk.phys_addr);
+        std::memset(chunk.host_ptr, 0, chunk.size);
+        if (g_dirty_log_active)
+            g_dirty_log.mark_range(chunk.phys_addr, chunk.size);
+    }
+
+    lazy_pending[idx] = false;
+    if (!--lazy_remaining) {
+        LOG_F(INFO, "RAMSnapshot: lazy restore complete");
+        lazy_restore_finish();
+    }
+}
+
+void ram_snapshot_fault(const uint8_t* host_ptr, uint32_t size)
+{
+    // DMA engines may run on their own threads
+    std::lock_guard<std::mutex> lock(lazy_mutex);
+
+    if (!g_ram_snapshot_lazy || !size)
+        return;
+
+    for (auto& rgn : lazy_regions) {
+        if (host_ptr + size <= rgn.host_ptr || host_ptr >= rgn.host_ptr + rgn.size)
+            continue;
+
+        uint64_t first = host_ptr > rgn.host_ptr ? host_ptr - rgn.host_ptr : 0;
+        uint64_t last  = std::min<uint64_t>(host_ptr + size - rgn.host_ptr, rgn.size) - 1;
+        for (uint64_t pos = first / SNP_CHUNK_SIZE; pos <= last / SNP_CHUNK_SIZE; pos++) {
+            size_t idx = rgn.first_chunk + pos;
+            if (lazy_pending[idx])
+                lazy_restore_chunk(idx);
+            if (!g_ram_snapshot_lazy)
+                return;
+        }
+    }
+}
+
+static void lazy_restore_all()
+{
+    std::lock_guard<std::mutex> lock(lazy_mutex);
+
+    for (size_t idx = 0; idx < lazy_chunks.size() && g_ram_snapshot_lazy; idx++) {
+        if (lazy_pending[idx])
+            lazy_restore_chunk(idx);
+    }
+}
+
+//======================== Save ========================
+bool ram_snapshot_save(const std::string& path)
+{
+    if (!mem_ctrl_instance) {
+        LOG_F(ERROR, "RAMSnapshot: no machine");
+        return false;
+    }
+
+    // pages of a pending lazy restore must be saved with their real contents
+    lazy_restore_all();
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        LOG_F(ERROR, "RAMSnapshot: cannot create %s", path.c_str());
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<AddressMapEntry*> regions = mem_ctrl_instance->get_ram_regions();
+    std::vector<SnapshotChunk>    chunks  = split_into_chunks(regions);
+
+    uint8_t hdr[SNP_HEADER_SIZE];
+    std::memcpy(hdr, snapshot_sig, sizeof(snapshot_sig));
+    WRITE_DWORD_LE_U(&hdr[8], SNP_CHUNK_PAGES);
+    WRITE_DWORD_LE_U(&hdr[12], uint32_t(regions.size()));
+    WRITE_QWORD_LE_U(&hdr[16], 0); // patched once the index is written
+    fwrite(hdr, 1, sizeof(hdr), f);
+
+    for (auto& rgn : regions) {
+        uint8_t rec[8];
+        WRITE_DWORD_LE_U(&rec[0], rgn->start);
+        WRITE_DWORD_LE_U(&rec[4], rgn->end - rgn->start + 1);
+        fwrite(rec, 1, sizeof(rec), f);
+    }
+
+    uint64_t offset = SNP_HEADER_SIZE + regions.size() * 8;
+    uint64_t ram_size = 0;
+    size_t   zero_pages = 0;
+    std::vector<SnapshotIndexEntry> index;
+    std::vector<EncodedChunk>       batch(std::min(SNP_BATCH, chunks.size()));
+
+    for (size_t first = 0; first < chunks.size(); first += SNP_BATCH) {
+        size_t count = std::min(SNP_BATCH, chunks.size() - first);
+
+        run_parallel(count, [&](size_t i, std::vector<uint8_t>& scratch) {
+            encode_chunk(chunks[first + i], batch[i], scratch);
+        });
+
+        for (size_t i = 0; i < count; i++) {
+            const EncodedChunk& enc = batch[i];
+            uint32_t chunk_pages = (chunks[first + i].size + SNP_PAGE_SIZE - 1) / SNP_PAGE_SIZE;
+            index.push_back({offset, uint32_t(enc.data.size()), enc.page_mask, enc.method});
+            fwrite(enc.data.data(), 1, enc.data.size(), f);
+            offset += enc.data.size();
+            ram_size += chunks[first + i].size;
+            zero_pages += chunk_pages - std::popcount(enc.page_mask);
+        }
+    }
+
+    for (auto& entry : index) {
+        uint8_t rec[SNP_INDEX_ENTRY_SIZE] = {};
+        WRITE_QWORD_LE_U(&rec[0], entry.offset);
+        WRITE_DWORD_LE_U(&rec[8], entry.stored_size);
+        WRITE_WORD_LE_U(&rec[12], entry.page_mask);
+        rec[14] = entry.method;
+        fwrite(rec, 1, sizeof(rec), f);
+    }
+
+    WRITE_QWORD_LE_U(&hdr[16], offset);
+    fseek(f, 16, SEEK_SET);
+    fwrite(&hdr[16], 1, 8, f);
+
+    bool ok = !ferror(f);
+    ok = !fclose(f) && ok;
+    if (!ok) {
+        LOG_F(ERROR, "RAMSnapshot: error writing %s", path.c_str());
+        return false;
+    }
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    LOG_F(INFO, "RAMSnapshot: saved %llu MiB of RAM to %s, %zu zero pages skipped, "
+          "%llu KiB written in %lld ms", (unsigned long long)(ram_size >> 20),
+          path.c_str(), zero_pages, (unsigned long long)(offset >> 10),
+          (long long)elapsed_ms);
+    return true;
+}
+
+//======================== Load ========================
+bool ram_snapshot_load(const std::string& path, bool lazy)
+{
+    if (!mem_ctrl_instance) {
+        LOG_F(ERROR, "RAMSnapshot: no machine");
+        return false;
+    }
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOG_F(ERROR, "RAMSnapshot: cannot open %s", path.c_str());
+        return false;
+    }
+
+    auto fail = [&](const char* reason) {
+        LOG_F(ERROR, "RAMSnapshot: %s: %s", path.c_str(), reason);
+        fclose(f);
+        return false;
+    };
+
+    uint8_t hdr[SNP_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        std::memcmp(hdr, snapshot_sig, sizeof(snapshot_sig)))
+        return fail("not a RAM snapshot");
+    if (READ_DWORD_LE_U(&hdr[8]) != SNP_CHUNK_PAGES)
+        return fail("unsupported chunk size");
+
+    std::vector<AddressMapEntry*> regions = mem_ctrl_instance->get_ram_regions();
+    if (uint32_t(READ_DWORD_LE_U(&hdr[12])) != regions.size())
+        return fail("RAM layout doesn't match this machine");
+    for (auto& rgn : regions) {
+        uint8_t rec[8];
+        if (fread(rec, 1, sizeof(rec), f) != sizeof(rec) ||
+            uint32_t(READ_DWORD_LE_U(&rec[0])) != rgn->start ||
+            uint32_t(READ_DWORD_LE_U(&rec[4])) != rgn->end - rgn->start + 1)
+            return fail("RAM layout doesn't match this machine");
+    }
+
+    std::vector<SnapshotChunk> chunks = split_into_chunks(regions);
+    std::vector<SnapshotIndexEntry> index(chunks.size());
+
+    // every chunk must lie between the region records and the index,
+    // which in turn must fit into the file
+    uint64_t data_start   = SNP_HEADER_SIZE + regions.size() * 8;
+    uint64_t index_offset = READ_QWORD_LE_U(&hdr[16]);
+    uint64_t size;
+    if (!file_size(f, size) || index_offset < data_start ||
+        index_offset + chunks.size() * SNP_INDEX_ENTRY_SIZE > size)
+        return fail("truncated index");
+
+    if (!file_seek(f, index_offset))
+        return fail("truncated index");
+    for (auto& entry : index) {
+        uint8_t rec[SNP_INDEX_ENTRY_SIZE];
+        if (fread(rec, 1, sizeof(rec), f) != sizeof(rec))
+            return fail("truncated index");
+        entry.offset      = READ_QWORD_LE_U(&rec[0]);
+        entry.stored_size = READ_DWORD_LE_U(&rec[8]);
+        entry.page_mask   = READ_WORD_LE_U(&rec[12]);
+        entry.method      = rec[14];
+        if (entry.stored_size > SNP_CHUNK_SIZE || entry.method > SNP_RAW ||
+            entry.offset < data_start || entry.offset + entry.stored_size > index_offset)
+            return fail("corrupted index");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(lazy_mutex);
+        lazy_restore_finish(); // a new snapshot replaces all RAM
+    }
+
+    // device owned RAM is read by its device without going through the MMU
+    std::vector<bool> deferred(chunks.size(), false);
+    std::vector<SnapshotRegion> lazy_rgns;
+    size_t num_deferred = 0;
+    size_t idx = 0;
+    for (auto& rgn : regions) {
+        uint64_t size  = uint64_t(rgn->end) - rgn->start + 1;
+        size_t   count = (size + SNP_CHUNK_SIZE - 1) / SNP_CHUNK_SIZE;
+        if (lazy && !rgn->devobj) {
+            lazy_rgns.push_back({rgn->mem_ptr, size, idx});
+            for (size_t i = idx; i < idx + count; i++) {
+                if (index[i].method != SNP_ZERO) {
+                    deferred[i] = true;
+                    num_deferred++;
+                }
+            }
+        }
+        idx += count;
+    }
+
+    // decode everything else in parallel, one batch of stored chunks at a time
+    std::vector<size_t> eager;
+    for (idx = 0; idx < chunks.size(); idx++) {
+        if (!deferred[idx])
+            eager.push_back(idx);
+    }
+
+    std::vector<std::vector<uint8_t>> stored(std::min(SNP_BATCH, eager.size()));
+    std::atomic<bool> ok{true};
+    for (size_t first = 0; first < eager.size(); first += SNP_BATCH) {
+        size_t count = std::min(SNP_BATCH, eager.size() - first);
+        for (size_t i = 0; i < count; i++) {
+            if (!read_stored(f, index[eager[first + i]], stored[i]))
+                return fail("truncated chunk data");
+        }
+        run_parallel(count, [&](size_t i, std::vector<uint8_t>& scratch) {
+            size_t n = eager[first + i];
+            if (!decode_chunk(chunks[n], index[n], stored[i].data(), scratch))
+                ok = false;
+        });
+        if (!ok)
+            return fail("corrupted chunk data");
+    }
+
+    size_t num_chunks = chunks.size();
+    if (num_deferred) {
+        std::lock_guard<std::mutex> lock(lazy_mutex);
+        lazy_file      = f;
+        lazy_regions   = std::move(lazy_rgns);
+        lazy_chunks    = std::move(chunks);
+        lazy_index     = std::move(index);
+        lazy_pending   = std::move(deferred);
+        lazy_remaining = num_deferred;
+        g_ram_snapshot_lazy = true;
+    } else {
+        fclose(f);
+    }
+
+    // cached translations would bypass lazily restored pages
+    mmu_flush_phys_range(0, UINT32_MAX);
+
+    LOG_F(INFO, "RAMSnapshot: restored %s, %zu of %zu chunks deferred until first access",
+          path.c_str(), num_deferred, num_chunks);
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Compressed guest RAM snapshots.
+
+    RAM is split into chunks of 16 pages. Pages containing only zeros are
+    skipped, the remaining pages of a chunk are compressed together as one
+    LZ4 block. Chunks are compressed in parallel by a pool of worker
+    threads and written in order, followed by an index so that any chunk
+    can be located without reading the others.
+
+    A snapshot can be restored lazily. Only the index is read up front,
+    a chunk is decompressed when the CPU first maps one of its pages into
+    the TLB or a device maps it for DMA. RAM owned by devices (VRAM) is
+    read directly by them and is therefore always restored right away.
+
+    Only guest RAM is saved; CPU and device state aren't serialized.
+
+    File format, all fields little-endian:
+        header  "DPPCSNP1" <u32 pages per chunk> <u32 region count>
+                <u64 index offset>
+        regions <u32 start> <u32 size> for each RAM region
+        data    compressed chunks
+        index   <u64 offset> <u32 stored size> <u16 page mask> <u8 method>
+                <u8 reserved> for each chunk of each region in order;
+                bit N of the mask is set if page N of the chunk was stored
+ */
+
+#ifndef RAM_SNAPSHOT_H
+#define RAM_SNAPSHOT_H
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+
+enum SnapshotMethod : uint8_t {
+    SNP_ZERO = 0, // all pages of the chunk are zero, nothing is stored
+    SNP_LZ4  = 1, // stored pages compressed as one LZ4 block
+    SNP_RAW  = 2, // stored pages didn't compress
+};
+
+extern bool ram_snapshot_save(const std::string& path);
+
+/** Restore a snapshot taken on a machine with the same RAM layout.
+    With lazy set, chunks are decompressed on first access. */
+extern bool ram_snapshot_load(const std::string& path, bool lazy);
+
+/** Set while chunks of a lazy restore are pending. DMA engines
+    running on their own threads check it as well. */
+extern std::atomic<bool> g_ram_snapshot_lazy;
+
+extern void ram_snapshot_fault(const uint8_t* host_ptr, uint32_t size);
+
+/** Make sure host memory about to be accessed directly has been restored. */
+static inline void ram_snapshot_touch(const uint8_t* host_ptr, uint32_t size) {
+    if (g_ram_snapshot_lazy) [[unlikely]]
+        ram_snapshot_fault(host_ptr, size);
+}
+
+#endif // RAM_SNAPSHOT_H
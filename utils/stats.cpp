@@ -0,0 +1,367 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Always-compiled runtime counters. */
+
+#include "stats.h"
+#include "profiler.h"
+
+#include <loguru.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32) && \
+    (defined(__APPLE__) || defined(__linux__) || defined(__unix__))
+#define DPPC_HAS_UNIX_SOCKETS 1
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+thread_local constinit StatShard* tls_stat_shard = nullptr;
+
+static const char* builtin_names[] = {
+    "itlb_primary_hits",
+    "itlb_secondary_hits",
+    "itlb_refills",
+    "dtlb_primary_hits",
+    "dtlb_secondary_hits",
+    "dtlb_refills",
+    "tlb_replacements",
+    "mmio_reads",
+    "mmio_writes",
+    "exc_0",
+    "exc_system_reset",
+    "exc_machine_check",
+    "exc_dsi",
+    "exc_isi",
+    "exc_ext_int",
+    "exc_alignment",
+    "exc_program",
+    "exc_no_fpu",
+    "exc_decr",
+    "exc_10",
+    "exc_11",
+    "exc_syscall",
+    "exc_trace",
+    "exc_vec_unavail",
+    "exc_15",
+    "timer_events",
+    "timer_wakeups",
+    "timer_wakeups_saved",
+    "dbdma_commands",
+    "busy_wait_skips",
+    "busy_wait_skipped_ns",
+};
+
+static_assert(sizeof(builtin_names) / sizeof(builtin_names[0]) == STAT_NUM_BUILTIN);
+
+// shards are never freed so counts of finished threads aren't lost
+static std::mutex                               stats_mutex;
+static std::vector<std::unique_ptr<StatShard>>  shards;
+static std::vector<std::string>                 counter_names(builtin_names,
+                                                    builtin_names + STAT_NUM_BUILTIN);
+static std::atomic<uint32_t>                    num_counters{STAT_NUM_BUILTIN};
+
+StatShard* stats_new_shard() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    shards.push_back(std::make_unique<StatShard>());
+    tls_stat_shard = shards.back().get();
+    return tls_stat_shard;
+}
+
+uint32_t stats_add_counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    for (uint32_t id = 0; id < counter_names.size(); id++) {
+        if (counter_names[id] == name)
+            return id;
+    }
+    if (counter_names.size() >= STATS_MAX_COUNTERS) {
+        LOG_F(WARNING, "Stats: no room for counter %s", name.c_str());
+        return STAT_INVALID;
+    }
+    counter_names.push_back(name);
+    num_counters.store((uint32_t)counter_names.size(), std::memory_order_release);
+    return (uint32_t)counter_names.size() - 1;
+}
+
+uint64_t stats_get(uint32_t id) {
+    if (id >= STATS_MAX_COUNTERS)
+        return 0;
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    uint64_t sum = 0;
+    for (auto& shard : shards)
+        sum += shard->counters[id].load(std::memory_order_relaxed);
+    return sum;
+}
+
+/** Take a snapshot of all counters along with their names. */
+static void stats_snapshot(std::vector<std::string>& names, std::vector<uint64_t>& values) {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    names = counter_names;
+    values.assign(names.size(), 0);
+    for (auto& shard : shards) {
+        for (size_t id = 0; id < names.size(); id++)
+            values[id] += shard->counters[id].load(std::memory_order_relaxed);
+    }
+}
+
+static uint64_t stats_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string stats_to_json() {
+    std::vector<std::string> names;
+    std::vector<uint64_t> values;
+    stats_snapshot(names, values);
+
+    std::string out = "{\"time_ms\":" + std::to_string(stats_time_ms()) + ",\"counters\":{";
+    for (size_t id = 0; id < names.size(); id++) {
+        if (id)
+            out += ",";
+        out += "\"" + names[id] + "\":" + std::to_string(values[id]);
+    }
+    out += "}}\n";
+    return out;
+}
+
+// ============================ Periodic export ===============================
+
+static std::thread              export_thread;
+static std::mutex               export_mutex;
+static std::condition_variable  export_cv;
+static bool                     export_stop = false;
+
+static void write_json_file(const std::string& path) {
+    // write a temporary file first so readers never see a partial snapshot
+    std::string tmp_path = path + ".tmp";
+    FILE* f = std::fopen(tmp_path.c_str(), "w");
+    if (!f)
+        return;
+    std::string json = stats_to_json();
+    std::fwrite(json.data(), 1, json.size(), f);
+    std::fclose(f);
+    std::rename(tmp_path.c_str(), path.c_str());
+}
+
+static void append_csv_row(const std::string& path, size_t& num_columns) {
+    std::vector<std::string> names;
+    std::vector<uint64_t> values;
+    stats_snapshot(names, values);
+
+    FILE* f = std::fopen(path.c_str(), "a");
+    if (!f)
+        return;
+    // repeat the header whenever counters were added
+    if (names.size() != num_columns) {
+        std::fputs("time_ms", f);
+        for (auto& name : names)
+            std::fprintf(f, ",%s", name.c_str());
+        std::fputs("\n", f);
+        num_columns = names.size();
+    }
+    std::fprintf(f, "%llu", (unsigned long long)stats_time_ms());
+    for (auto value : values)
+        std::fprintf(f, ",%llu", (unsigned long long)value);
+    std::fputs("\n", f);
+    std::fclose(f);
+}
+
+bool stats_start_export(const std::string& path, StatsFormat format, uint32_t interval_ms) {
+    if (export_thread.joinable()) {
+        LOG_F(ERROR, "Stats: export already running");
+        return false;
+    }
+    if (format == StatsFormat::CSV) {
+        // start a new file
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) {
+            LOG_F(ERROR, "Stats: could not create %s", path.c_str());
+            return false;
+        }
+        std::fclose(f);
+    }
+
+    export_stop = false;
+    export_thread = std::thread([path, format, interval_ms]() {
+        size_t num_columns = 0;
+        std::unique_lock<std::mutex> lock(export_mutex);
+        while (true) {
+            bool stop = export_cv.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                                           [] { return export_stop; });
+            if (format == StatsFormat::JSON)
+                write_json_file(path);
+            else
+                append_csv_row(path, num_columns);
+            if (stop)
+                break;
+        }
+    });
+
+    LOG_F(INFO, "Stats: writing counters to %s every %u ms", path.c_str(), interval_ms);
+    return true;
+}
+
+// ============================= Socket export ================================
+
+#if DPPC_HAS_UNIX_SOCKETS
+static std::thread  socket_thread;
+static int          listen_fd = -1;
+static std::string  socket_path;
+#endif
+
+bool stats_start_socket(const std::string& path) {
+#if DPPC_HAS_UNIX_SOCKETS
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        LOG_F(ERROR, "Stats: socket path %s is too long", path.c_str());
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        LOG_F(ERROR, "Stats: could not create a socket: %s", std::strerror(errno));
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 4) < 0) {
+        LOG_F(ERROR, "Stats: could not listen on %s: %s", path.c_str(), std::strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socket_path = path;
+
+    // every client gets the current counters as a single JSON object
+    socket_thread = std::thread([]() {
+        // a client that hangs up early must not kill us with SIGPIPE
+#ifdef MSG_NOSIGNAL
+        const int send_flags = MSG_NOSIGNAL;
+#else
+        const int send_flags = 0;
+#endif
+        while (true) {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            int ret = poll(&pfd, 1, 200);
+            {
+                std::lock_guard<std::mutex> lock(export_mutex);
+                if (export_stop)
+                    break;
+            }
+            if (ret <= 0)
+                continue;
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd < 0)
+                continue;
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(client_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            std::string json = stats_to_json();
+            const char* p = json.data();
+            size_t left = json.size();
+            while (left) {
+                ssize_t n = send(client_fd, p, left, send_flags);
+                if (n <= 0)
+                    break;
+                p += n;
+                left -= n;
+            }
+            close(client_fd);
+        }
+    });
+
+    LOG_F(INFO, "Stats: serving counters on %s", path.c_str());
+    return true;
+#else
+    LOG_F(ERROR, "Stats: UNIX sockets aren't supported on this platform");
+    return false;
+#endif
+}
+
+void stats_stop_export() {
+    {
+        std::lock_guard<std::mutex> lock(export_mutex);
+        export_stop = true;
+    }
+    export_cv.notify_all();
+    if (export_thread.joinable())
+        export_thread.join();
+#if DPPC_HAS_UNIX_SOCKETS
+    if (socket_thread.joinable())
+        socket_thread.join();
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+        listen_fd = -1;
+    }
+#endif
+}
+
+// ================================ Profile ===================================
+
+class StatsProfile : public BaseProfile {
+public:
+    StatsProfile() : BaseProfile("Stats") {}
+
+    void populate_variables(std::vector<ProfileVar>& vars) {
+        std::vector<std::string> names;
+        std::vector<uint64_t> values;
+        stats_snapshot(names, values);
+
+        vars.clear();
+        for (size_t id = 0; id < names.size(); id++) {
+            uint64_t base = id < this->baseline.size() ? this->baseline[id] : 0;
+            if (values[id] == base)
+                continue; // keep the output short
+            vars.push_back({.name = names[id],
+                            .format = ProfileVarFmt::DEC,
+                            .value = values[id] - base});
+        }
+    }
+
+    // counters are never cleared, remember their values instead
+    void reset() {
+        std::vector<std::string> names;
+        stats_snapshot(names, this->baseline);
+    }
+
+private:
+    std::vector<uint64_t> baseline;
+};
+
+void stats_register_profile() {
+    if (gProfilerObj)
+        gProfilerObj->register_profile("Stats",
+            std::unique_ptr<BaseProfile>(new StatsProfile()));
+}
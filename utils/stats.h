@@ -0,0 +1,104 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Always-compiled runtime counters.
+
+    Counters are sharded per thread: every thread increments its own
+    cache-line aligned copy with relaxed loads and stores, so counting
+    needs neither locks nor atomic read-modify-write operations. Readers
+    sum up all shards. Counter values can be exported periodically
+    to a JSON or CSV file or read from a UNIX domain socket.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+
+/** Built-in counters. More can be added at runtime with stats_add_counter. */
+enum StatId : uint32_t {
+    STAT_ITLB_PRIMARY_HITS,
+    STAT_ITLB_SECONDARY_HITS,
+    STAT_ITLB_REFILLS,
+    STAT_DTLB_PRIMARY_HITS,
+    STAT_DTLB_SECONDARY_HITS,
+    STAT_DTLB_REFILLS,
+    STAT_TLB_REPLACEMENTS,
+    STAT_MMIO_READS,
+    STAT_MMIO_WRITES,
+    STAT_EXCEPTIONS,        // first of STAT_NUM_EXC_TYPES counters indexed by Except_Type
+    STAT_TIMER_EVENTS = STAT_EXCEPTIONS + 16, // STAT_EXCEPTIONS + STAT_NUM_EXC_TYPES
+    STAT_TIMER_WAKEUPS,         // process_timers calls that fired a timer
+    STAT_TIMER_WAKEUPS_SAVED,   // timers fired in a wakeup for an earlier deadline
+    STAT_DBDMA_COMMANDS,
+    STAT_BUSY_WAIT_SKIPS,
+    STAT_BUSY_WAIT_SKIPPED_NS,
+    STAT_NUM_BUILTIN,
+};
+
+constexpr uint32_t STAT_NUM_EXC_TYPES = 16;
+constexpr uint32_t STATS_MAX_COUNTERS = 512;
+constexpr uint32_t STAT_INVALID       = UINT32_MAX; // ignored by stat_inc
+
+typedef struct alignas(64) StatShard {
+    std::atomic<uint64_t> counters[STATS_MAX_COUNTERS];
+} StatShard;
+
+extern thread_local constinit StatShard* tls_stat_shard;
+
+extern StatShard* stats_new_shard();
+
+/** Increment a counter. Only the calling thread writes its shard. */
+inline void stat_inc(uint32_t id, uint64_t n = 1) {
+    if (id >= STATS_MAX_COUNTERS) [[unlikely]]
+        return;
+    StatShard* shard = tls_stat_shard;
+    if (!shard) [[unlikely]]
+        shard = stats_new_shard();
+    std::atomic<uint64_t>& c = shard->counters[id];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/** Return the ID of the counter with the given name, adding it if needed.
+    Returns STAT_INVALID if no IDs are left. */
+extern uint32_t stats_add_counter(const std::string& name);
+
+/** Sum of a counter over all threads. */
+extern uint64_t stats_get(uint32_t id);
+
+enum class StatsFormat { JSON, CSV };
+
+/** Write the counters to path every interval_ms milliseconds.
+    JSON replaces the file with the latest values, CSV appends a row. */
+extern bool stats_start_export(const std::string& path, StatsFormat format,
+                               uint32_t interval_ms);
+
+/** Serve the counters as JSON to every client connecting to a UNIX socket. */
+extern bool stats_start_socket(const std::string& path);
+
+extern void stats_stop_export();
+
+/** Register the "Stats" profile with the profiler. */
+extern void stats_register_profile();
+
+#endif // STATS_H